@@ -0,0 +1,127 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* flux-sign-agent - serve curve signing requests for the calling user
+ *
+ * Usage: flux-sign-agent socket-path [cert-path]
+ *
+ * Load the user's signing cert (default ~/.flux/curve/sig) once, then
+ * sign on behalf of processes of the same user that connect to
+ * socket-path.  Configure [sign.curve] agent-socket = "socket-path" to
+ * have the curve mechanism use the agent.  In both places, "%u" in
+ * socket-path is replaced by the uid, so a shared system config such as
+ * agent-socket = "/run/user/%u/flux-sign-agent" gives each user their own.
+ * Runs in the foreground until terminated by SIGTERM, SIGINT, or SIGHUP,
+ * then removes socket-path.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <sys/types.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "src/libca/sigcert.h"
+#include "src/libca/sigagent.h"
+
+const char *prog = "flux-sign-agent";
+
+static void die (const char *fmt, ...)
+{
+    va_list ap;
+    char buf[256];
+
+    va_start (ap, fmt);
+    (void)vsnprintf (buf, sizeof (buf), fmt, ap);
+    va_end (ap);
+    fprintf (stderr, "%s: %s\n", prog, buf);
+    exit (1);
+}
+
+static void usage (void)
+{
+    fprintf (stderr, "Usage: flux-sign-agent socket-path [cert-path]\n");
+    exit (1);
+}
+
+static volatile sig_atomic_t terminate = 0;
+
+static void sig_handler (int signum)
+{
+    terminate = 1;
+}
+
+/* N.B. no SA_RESTART, so that a signal interrupts sigagent_serve().
+ */
+static void init_signals (void)
+{
+    struct sigaction sa;
+
+    memset (&sa, 0, sizeof (sa));
+    sa.sa_handler = sig_handler;
+    sigemptyset (&sa.sa_mask);
+    if (sigaction (SIGTERM, &sa, NULL) < 0
+            || sigaction (SIGINT, &sa, NULL) < 0
+            || sigaction (SIGHUP, &sa, NULL) < 0)
+        die ("sigaction: %s", strerror (errno));
+    signal (SIGPIPE, SIG_IGN);
+}
+
+int main (int argc, char **argv)
+{
+    char buf[PATH_MAX + 1];
+    char sockpath[PATH_MAX + 1];
+    const char *certpath;
+    struct sigcert *cert;
+    int fd;
+
+    if (argc != 2 && argc != 3)
+        usage ();
+    if (sigagent_path (argv[1], getuid (), sockpath, sizeof (sockpath)) < 0)
+        die ("%s: %s", argv[1], strerror (errno));
+    if (argc == 3)
+        certpath = argv[2];
+    else {
+        struct passwd *pw = getpwuid (getuid ());
+        if (!pw || snprintf (buf, sizeof (buf), "%s/.flux/curve/sig",
+                             pw->pw_dir) >= (int)sizeof (buf))
+            die ("could not determine cert path");
+        certpath = buf;
+    }
+    if (!(cert = sigcert_load (certpath, true)))
+        die ("load %s: %s", certpath, strerror (errno));
+
+    init_signals ();
+    if ((fd = sigagent_listen (sockpath)) < 0)
+        die ("%s: %s", sockpath, strerror (errno));
+    while (sigagent_serve (fd, cert) < 0) {
+        if (errno != EINTR) {
+            (void)unlink (sockpath);
+            die ("%s", strerror (errno));
+        }
+        if (terminate)
+            break;
+    }
+    (void)close (fd);
+    (void)unlink (sockpath);
+    sigcert_destroy (cert);
+    return 0;
+}
+
+/* vi: ts=4 sw=4 expandtab
+ */
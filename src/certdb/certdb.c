@@ -0,0 +1,297 @@
+/************************************************************\
+ * Copyright 2017 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* flux-certdb - build cert database from home directories, or binary certs
+ *
+ * Usage: flux-certdb [-j N] build dbpath [passwd-file]
+ *        flux-certdb [-j N] update dbpath userid ...
+ *        flux-certdb get dbpath userid
+ *        flux-certdb tobin certname
+ *
+ * 'build' scans ~/.flux/curve/sig.pub of every user in the password
+ * database (or passwd-file), and writes a new database.
+ * 'update' rescans the listed users and merges the result into an
+ * existing database, removing users whose cert is missing.
+ * 'get' prints the public cert recorded for userid.
+ * 'tobin' writes certname.pub.bin, a binary copy of certname.pub that
+ * loads without parsing TOML, e.g. for a cert in a user's home directory
+ * that is read by every verifier when no database is configured.
+ * The copy is used only while certname.pub is unchanged.
+ * Home directories are scanned by N threads in parallel (default 8).
+ *
+ * Configure [sign.curve] cert-db = "dbpath" to have the curve mechanism
+ * verify signers against the database instead of reading their home
+ * directories.  The database is replaced atomically, so it may be
+ * rebuilt (e.g. periodically by root) while in use; verifiers notice the
+ * new file and reopen it.  Verifiers refuse a database that is not owned
+ * by root or themselves, or that is writable by group or other.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <sys/types.h>
+#include <pwd.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "src/libca/sigcert.h"
+#include "src/libca/certdb.h"
+
+const char *prog = "flux-certdb";
+
+struct user {
+    int64_t userid;
+    char *home;
+    struct sigcert *cert;
+};
+
+struct scan {
+    struct user *users;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+};
+
+static void die (const char *fmt, ...)
+{
+    va_list ap;
+    char buf[256];
+
+    va_start (ap, fmt);
+    (void)vsnprintf (buf, sizeof (buf), fmt, ap);
+    va_end (ap);
+    fprintf (stderr, "%s: %s\n", prog, buf);
+    exit (1);
+}
+
+static void usage (void)
+{
+    fprintf (stderr,
+"Usage: flux-certdb [-j N] build dbpath [passwd-file]\n"
+"   or: flux-certdb [-j N] update dbpath userid ...\n"
+"   or: flux-certdb get dbpath userid\n"
+"   or: flux-certdb tobin certname\n"
+"\n"
+"build   write a new database from ~/.flux/curve/sig.pub of every user\n"
+"        in the password database, or in passwd-file\n"
+"update  rescan the listed users and merge them into dbpath, removing\n"
+"        users who no longer have a cert\n"
+"get     print the public cert recorded for userid\n"
+"tobin   write certname.pub.bin, a binary copy of certname.pub that\n"
+"        loads faster, and is used while certname.pub is unchanged\n"
+"\n"
+"  -j N  scan home directories with N threads (default 8)\n");
+    exit (1);
+}
+
+static void user_append (struct scan *scan, int64_t userid, const char *home)
+{
+    struct user *u;
+
+    if (!(u = realloc (scan->users, (scan->count + 1) * sizeof (*u))))
+        die ("out of memory");
+    scan->users = u;
+    u = &scan->users[scan->count++];
+    u->userid = userid;
+    u->cert = NULL;
+    if (!(u->home = strdup (home)))
+        die ("out of memory");
+}
+
+/* Worker thread: claim the next user and load its home cert, if any.
+ */
+static void *scan_thread (void *arg)
+{
+    struct scan *scan = arg;
+    char path[PATH_MAX + 1];
+    struct user *u;
+
+    for (;;) {
+        pthread_mutex_lock (&scan->lock);
+        u = scan->next < scan->count ? &scan->users[scan->next++] : NULL;
+        pthread_mutex_unlock (&scan->lock);
+        if (!u)
+            break;
+        if (snprintf (path, sizeof (path), "%s/.flux/curve/sig",
+                      u->home) >= (int)sizeof (path))
+            continue;
+        u->cert = sigcert_load (path, false);
+    }
+    return NULL;
+}
+
+static void scan_homes (struct scan *scan, int nthreads)
+{
+    pthread_t *t;
+    int i;
+    int e;
+
+    if (nthreads > scan->count)
+        nthreads = scan->count;
+    if (nthreads == 0)
+        return;
+    if (!(t = calloc (nthreads, sizeof (*t))))
+        die ("out of memory");
+    for (i = 0; i < nthreads; i++) {
+        if ((e = pthread_create (&t[i], NULL, scan_thread, scan)))
+            die ("pthread_create: %s", strerror (e));
+    }
+    for (i = 0; i < nthreads; i++)
+        (void)pthread_join (t[i], NULL);
+    free (t);
+}
+
+static void scan_destroy (struct scan *scan)
+{
+    int i;
+
+    for (i = 0; i < scan->count; i++) {
+        sigcert_destroy (scan->users[i].cert);
+        free (scan->users[i].home);
+    }
+    free (scan->users);
+    pthread_mutex_destroy (&scan->lock);
+}
+
+static void build (const char *dbpath, const char *passwd, int nthreads)
+{
+    struct scan scan = { .lock = PTHREAD_MUTEX_INITIALIZER };
+    struct certdb_builder *b;
+    struct passwd *pw;
+    FILE *f = NULL;
+    int i;
+
+    if (passwd) {
+        if (!(f = fopen (passwd, "r")))
+            die ("%s: %s", passwd, strerror (errno));
+        while ((pw = fgetpwent (f)))
+            user_append (&scan, pw->pw_uid, pw->pw_dir);
+        (void)fclose (f);
+    }
+    else {
+        setpwent ();
+        while ((pw = getpwent ()))
+            user_append (&scan, pw->pw_uid, pw->pw_dir);
+        endpwent ();
+    }
+    scan_homes (&scan, nthreads);
+
+    if (!(b = certdb_builder_create ()))
+        die ("certdb_builder_create: %s", strerror (errno));
+    for (i = 0; i < scan.count; i++) {
+        if (scan.users[i].cert
+                && certdb_builder_add (b, scan.users[i].userid,
+                                       scan.users[i].cert) < 0)
+            die ("certdb_builder_add: %s", strerror (errno));
+    }
+    if (certdb_builder_write (b, dbpath) < 0)
+        die ("%s: %s", dbpath, strerror (errno));
+    certdb_builder_destroy (b);
+    scan_destroy (&scan);
+}
+
+static void update (const char *dbpath, int argc, char **argv, int nthreads)
+{
+    struct scan scan = { .lock = PTHREAD_MUTEX_INITIALIZER };
+    struct certdb_builder *b;
+    struct certdb *db;
+    struct passwd *pw;
+    int i;
+
+    if (!(db = certdb_open (dbpath)))
+        die ("%s: %s", dbpath, strerror (errno));
+    for (i = 0; i < argc; i++) {
+        int64_t userid = strtoll (argv[i], NULL, 10);
+        if (!(pw = getpwuid (userid)))
+            die ("%s: unknown userid", argv[i]);
+        user_append (&scan, userid, pw->pw_dir);
+    }
+    scan_homes (&scan, nthreads);
+
+    if (!(b = certdb_builder_create ()))
+        die ("certdb_builder_create: %s", strerror (errno));
+    if (certdb_builder_add_db (b, db) < 0)
+        die ("certdb_builder_add_db: %s", strerror (errno));
+    for (i = 0; i < scan.count; i++) {
+        int rc;
+        if (scan.users[i].cert)
+            rc = certdb_builder_add (b, scan.users[i].userid,
+                                     scan.users[i].cert);
+        else
+            rc = certdb_builder_remove (b, scan.users[i].userid);
+        if (rc < 0)
+            die ("certdb_builder: %s", strerror (errno));
+    }
+    if (certdb_builder_write (b, dbpath) < 0)
+        die ("%s: %s", dbpath, strerror (errno));
+    certdb_builder_destroy (b);
+    certdb_close (db);
+    scan_destroy (&scan);
+}
+
+static void get (const char *dbpath, const char *userid)
+{
+    struct certdb *db;
+    struct sigcert *cert;
+
+    if (!(db = certdb_open (dbpath)))
+        die ("%s: %s", dbpath, strerror (errno));
+    if (!(cert = certdb_lookup (db, strtoll (userid, NULL, 10))))
+        die ("%s: %s", userid, strerror (errno));
+    if (sigcert_fwrite_public (cert, stdout) < 0)
+        die ("write: %s", strerror (errno));
+    sigcert_destroy (cert);
+    certdb_close (db);
+}
+
+/* Write binary copy of certname.pub to certname.pub.bin.
+ */
+static void tobin (const char *certname)
+{
+    struct sigcert *cert;
+
+    if (!(cert = sigcert_load (certname, false)))
+        die ("load %s: %s", certname, strerror (errno));
+    if (sigcert_store_bin (cert, certname) < 0)
+        die ("store %s.pub.bin: %s", certname, strerror (errno));
+    sigcert_destroy (cert);
+}
+
+int main (int argc, char **argv)
+{
+    int nthreads = 8;
+
+    if (argc > 2 && !strcmp (argv[1], "-j")) {
+        if ((nthreads = strtol (argv[2], NULL, 10)) < 1)
+            usage ();
+        argc -= 2;
+        argv += 2;
+    }
+    if ((argc == 3 || argc == 4) && !strcmp (argv[1], "build"))
+        build (argv[2], argc == 4 ? argv[3] : NULL, nthreads);
+    else if (argc >= 4 && !strcmp (argv[1], "update"))
+        update (argv[2], argc - 3, argv + 3, nthreads);
+    else if (argc == 4 && !strcmp (argv[1], "get"))
+        get (argv[2], argv[3]);
+    else if (argc == 3 && !strcmp (argv[1], "tobin"))
+        tobin (argv[2]);
+    else
+        usage ();
+    return 0;
+}
+
+/* vi: ts=4 sw=4 expandtab
+ */
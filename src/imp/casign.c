@@ -34,19 +34,7 @@
  */
 static struct sigcert *get_cert_from_kv (const struct kv *kv)
 {
-    struct kv *cert_kv;
-    const char *buf;
-    int len;
-    struct sigcert *cert = NULL;
-
-    if (!(cert_kv = kv_split (kv, "cert")))
-        goto done;
-    if (kv_encode (cert_kv, &buf, &len) < 0)
-        goto done;
-    cert = sigcert_decode (buf, len);
-done:
-    kv_destroy (cert_kv);
-    return cert;
+    return sigcert_decode_kv (kv, "cert");
 }
 
 /* Add cert to kv under 'cert' prefix.
@@ -23,17 +23,19 @@
 #include "imp_log.h"
 #include "impcmd.h"
 #include "sudosim.h"
+#include "src/libutil/cfcache.h"
 
 /*
  *  External function used to return current default config pattern.
  */
 extern const char *imp_get_config_pattern (void);
+extern const char *imp_get_config_cache (void);
 
 /*  Static prototypes:
  */
 static void initialize_logging ();
 static int  imp_state_init (struct imp_state *imp, int argc, char **argv);
-static cf_t * imp_conf_load (const char *pattern);
+static cf_t * imp_conf_load (const char *pattern, const char *cache);
 static bool imp_is_privileged ();
 static bool imp_is_setuid ();
 static void initialize_sudo_support ();
@@ -52,7 +54,8 @@ int main (int argc, char *argv[])
 
     /*  Configuration:
      */
-    if (!(imp.conf = imp_conf_load (imp_get_config_pattern ())))
+    if (!(imp.conf = imp_conf_load (imp_get_config_pattern (),
+                                    imp_get_config_cache ())))
         imp_die (1, "Failed to load configuration");
 
     /*  Audit subsystem initialization
@@ -117,10 +120,14 @@ static int imp_state_init (struct imp_state *imp, int argc, char *argv[])
 }
 
 /*
- *  Load IMP configuration from glob(7) `pattern`. Fatal error if configuration
- *   fails to load.
+ *  Load IMP configuration from glob(7) `pattern`, using the binary cache
+ *   at `cache` if it is valid. Fatal error if configuration fails to load.
+ *
+ *  The cache is only rewritten when the IMP is not running setuid, so
+ *   an unprivileged user cannot cause root to write files. With setuid,
+ *   a cache is used only if it is owned by root (see cfcache.h).
  */
-static cf_t * imp_conf_load (const char *pattern)
+static cf_t * imp_conf_load (const char *pattern, const char *cache)
 {
     int rc;
     struct cf_error err;
@@ -133,7 +140,8 @@ static cf_t * imp_conf_load (const char *pattern)
         return (NULL);
 
     memset (&err, 0, sizeof (err));
-    if ((rc = cf_update_glob (cf, pattern, &err)) < 0) {
+    if ((rc = cfcache_update_glob (cf, pattern, cache,
+                                   getuid () == geteuid (), &err)) < 0) {
         imp_warn ("loading config: %s: %d: %s",
                  err.filename, err.lineno, err.errbuf);
         cf_destroy (cf);
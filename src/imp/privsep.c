@@ -290,26 +290,41 @@ struct kv * privsep_read_kv (privsep_t *ps)
 
 ssize_t privsep_write_kv (privsep_t *ps, struct kv *kv)
 {
-    int n;
+    struct kv *cpy = NULL;
+    int n = -1;
     int len;
     const char *buf;
 
+    /*  Use binary encoding so the reader need not parse numeric values.
+     *  Convert a copy, if needed, so the caller's kv is left unchanged.
+     */
+    if (kv_get_encoding (kv) != KV_ENCODING_BINARY) {
+        if (!(cpy = kv_copy (kv))
+            || kv_set_encoding (cpy, KV_ENCODING_BINARY) < 0)
+            goto out;
+        kv = cpy;
+    }
     if (kv_encode (kv, &buf, &len) < 0)
-        return (-1);
+        goto out;
 
     if (len <= 0 || len > PRIVSEP_MAX_KVLEN) {
         errno = E2BIG;
-        return (-1);
+        goto out;
     }
 
     /*  Write length first */
     if (privsep_write (ps, &len, sizeof (len)) != sizeof (len))
-        return (-1);
+        goto out;
 
     /*  Then write encoded kv structure */
     if ((n = privsep_write (ps, buf, len)) != len)
-        return (-1);
-
+        n = -1;
+out:
+    if (cpy) {
+        int saved_errno = errno;
+        kv_destroy (cpy);
+        errno = saved_errno;
+    }
     return (n);
 }
 
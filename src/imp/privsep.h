@@ -56,7 +56,8 @@ ssize_t privsep_write (privsep_t *ps, const void *buf, size_t count);
 
 /*
  *  Write a struct kv over privsep pipe, returning size of the kv
- *   written on success, -1 on failure.
+ *   written on success, -1 on failure.  The kv is converted to the
+ *   binary kv encoding before it is written.
  *
  *  Specific errno values include:
  *    EINVAL  - Invalid argument (bad privsep handle or struct kv)
@@ -115,6 +115,8 @@ static void child_kv_test (privsep_t *ps, void *arg __attribute__ ((unused)))
 
     if (privsep_write_kv (ps, kv) <= 0)
         imp_die (1, "privsep_write_kv: %s", strerror (errno));
+    if (kv_get_encoding (kv) != KV_ENCODING_TEXT)
+        imp_die (1, "privsep_write_kv changed the kv encoding");
 
     imp_say ("privsep_write_kv complete");
 
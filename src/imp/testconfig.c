@@ -25,6 +25,15 @@ const char * imp_get_config_pattern (void)
     return (p);
 }
 
+/*
+ *  For build-tree/test IMP only! Return config cache path from environment
+ *   if set, otherwise NULL (no cache).
+ */
+const char * imp_get_config_cache (void)
+{
+    return getenv ("FLUX_IMP_CONFIG_CACHE");
+}
+
 /*
  *  vi: ts=4 sw=4 expandtab
  */
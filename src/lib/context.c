@@ -16,6 +16,7 @@
 #include <stdarg.h>
 #include <string.h>
 #include <errno.h>
+#include <stdbool.h>
 
 #include "src/libutil/cf.h"
 #include "src/libutil/aux.h"
@@ -23,8 +24,30 @@
 #include "context.h"
 #include "context_private.h"
 
+/* A configuration generation.  Aux items derived from configuration hold
+ * a reference to the generation they were built from, so values they point
+ * into remain valid after flux_security_reconfigure() installs a new one.
+ */
+struct config {
+    cf_t *cf;
+    int refcount;
+};
+
+/* Record of an aux item derived from the configuration values at 'deps'.
+ */
+struct cfdep {
+    char *name;
+    const char *const *deps;
+    security_check_f check;
+    security_refresh_f refresh;
+    struct config *config;
+    bool stale;
+    struct cfdep *next;
+};
+
 struct flux_security {
-    cf_t *config;
+    struct config *config;
+    struct cfdep *cfdeps;
     struct aux_item *aux;
     char error[200];
     int errnum;
@@ -50,6 +73,159 @@ void security_error (flux_security_t *ctx, const char *fmt, ...)
     }
 }
 
+static struct config *config_create (cf_t *cf)
+{
+    struct config *config;
+
+    if (!(config = calloc (1, sizeof (*config))))
+        return NULL;
+    config->cf = cf;
+    config->refcount = 1;
+    return config;
+}
+
+static struct config *config_incref (struct config *config)
+{
+    if (config)
+        config->refcount++;
+    return config;
+}
+
+static void config_decref (struct config *config)
+{
+    if (config && --config->refcount == 0) {
+        cf_destroy (config->cf);
+        free (config);
+    }
+}
+
+static void cfdep_destroy (struct cfdep *d)
+{
+    if (d) {
+        config_decref (d->config);
+        free (d->name);
+        free (d);
+    }
+}
+
+/* Forget the dependency record for aux item 'name', if any.
+ */
+static void cfdep_remove (flux_security_t *ctx, const char *name)
+{
+    struct cfdep **dp = &ctx->cfdeps;
+    struct cfdep *d;
+
+    while ((d = *dp)) {
+        if (!strcmp (d->name, name)) {
+            *dp = d->next;
+            cfdep_destroy (d);
+            break;
+        }
+        dp = &d->next;
+    }
+}
+
+/* Destroy config-derived aux items marked stale, or all of them if 'all'
+ * is true.  They are rebuilt from the current configuration on next use.
+ * Items that are kept are refreshed from the current configuration.
+ */
+static void cfdep_purge (flux_security_t *ctx, bool all)
+{
+    struct cfdep **dp = &ctx->cfdeps;
+    struct cfdep *d;
+
+    while ((d = *dp)) {
+        if (all || d->stale) {
+            *dp = d->next;
+            (void)aux_set (&ctx->aux, d->name, NULL, NULL);
+            cfdep_destroy (d);
+        }
+        else {
+            if (d->refresh)
+                d->refresh (ctx, aux_get (ctx->aux, d->name),
+                            ctx->config->cf);
+            dp = &d->next;
+        }
+    }
+}
+
+/* Look up dot-separated 'path', e.g. "sign.max-ttl", in table 'cf'.
+ */
+static const cf_t *lookup_path (const cf_t *cf, const char *path)
+{
+    char key[128];
+    const char *dot;
+
+    while (cf && (dot = strchr (path, '.'))) {
+        size_t len = dot - path;
+        if (len >= sizeof (key))
+            return NULL;
+        memcpy (key, path, len);
+        key[len] = '\0';
+        cf = cf_get_in (cf, key);
+        path = dot + 1;
+    }
+    return cf ? cf_get_in (cf, path) : NULL;
+}
+
+/* Return true if any value the item depends on differs in 'cf'.
+ */
+static bool cfdep_changed (struct cfdep *d, const cf_t *cf)
+{
+    int i;
+
+    for (i = 0; d->deps[i] != NULL; i++) {
+        if (!cf_equal (lookup_path (d->config->cf, d->deps[i]),
+                       lookup_path (cf, d->deps[i])))
+            return true;
+    }
+    return false;
+}
+
+/* Install 'cf' as the current configuration, taking ownership of it.
+ */
+static int set_config (flux_security_t *ctx, cf_t *cf)
+{
+    struct config *config;
+
+    if (!(config = config_create (cf)))
+        return -1;
+    config_decref (ctx->config);
+    ctx->config = config;
+    return 0;
+}
+
+/* Parse configuration files matching 'pattern' into a new cf_t object.
+ */
+static cf_t *load_config (flux_security_t *ctx, const char *pattern)
+{
+    struct cf_error cfe;
+    int n;
+    cf_t *cf = NULL;
+
+    if (!pattern)
+        pattern = INSTALLED_CF_PATTERN;
+    if (!(cf = cf_create ())) {
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    if ((n = cf_update_glob (cf, pattern, &cfe)) < 0) {
+        security_error (ctx, "%s::%d: %s",
+                        cfe.filename, cfe.lineno, cfe.errbuf);
+        goto error;
+    }
+    if (n == 0) {
+        errno = EINVAL;
+        security_error (ctx, "pattern %s matched nothing", pattern);
+        goto error;
+    }
+    return cf;
+error:
+    cf_destroy (cf);
+    errno = flux_security_last_errnum (ctx);
+    return NULL;
+}
+
 flux_security_t *flux_security_create (int flags)
 {
     flux_security_t *ctx;
@@ -66,8 +242,9 @@ flux_security_t *flux_security_create (int flags)
 void flux_security_destroy (flux_security_t *ctx)
 {
     if (ctx) {
+        cfdep_purge (ctx, true);
         aux_destroy (&ctx->aux);
-        cf_destroy (ctx->config);
+        config_decref (ctx->config);
         free (ctx);
     }
 }
@@ -85,32 +262,51 @@ int flux_security_last_errnum (flux_security_t *ctx)
 
 int flux_security_configure (flux_security_t *ctx, const char *pattern)
 {
-    struct cf_error cfe;
-    int n;
-    cf_t *cf = NULL;
+    cf_t *cf;
 
     if (!ctx) {
         errno = EINVAL;
         return -1;
     }
-    if (!pattern)
-        pattern = INSTALLED_CF_PATTERN;
-    if (!(cf = cf_create ())) {
+    if (!(cf = load_config (ctx, pattern)))
+        return -1;
+    if (set_config (ctx, cf) < 0) {
         security_error (ctx, NULL);
+        cf_destroy (cf);
         return -1;
     }
-    if ((n = cf_update_glob (cf, pattern, &cfe)) < 0) {
-        security_error (ctx, "%s::%d: %s",
-                        cfe.filename, cfe.lineno, cfe.errbuf);
-        goto error;
-    }
-    if (n == 0) {
+    cfdep_purge (ctx, true);
+    return 0;
+}
+
+/* Load new configuration off to the side.  Aux items registered with
+ * security_aux_set_config() whose dependencies are unchanged are kept,
+ * along with the configuration generation they point into.  The rest,
+ * and any with a refresh function, are validated against the new
+ * configuration.  Only if all pass is it installed, those items destroyed
+ * to be rebuilt on next use, and the kept items refreshed.
+ */
+int flux_security_reconfigure (flux_security_t *ctx, const char *pattern)
+{
+    struct cfdep *d;
+    cf_t *cf;
+
+    if (!ctx) {
         errno = EINVAL;
-        security_error (ctx, "pattern %s matched nothing", pattern);
+        return -1;
+    }
+    if (!(cf = load_config (ctx, pattern)))
+        return -1;
+    for (d = ctx->cfdeps; d != NULL; d = d->next) {
+        d->stale = cfdep_changed (d, cf);
+        if ((d->stale || d->refresh) && d->check && d->check (ctx, cf) < 0)
+            goto error;
+    }
+    if (set_config (ctx, cf) < 0) {
+        security_error (ctx, NULL);
         goto error;
     }
-    cf_destroy (ctx->config);
-    ctx->config = cf;
+    cfdep_purge (ctx, false);
     return 0;
 error:
     cf_destroy (cf);
@@ -127,9 +323,40 @@ int flux_security_aux_set (flux_security_t *ctx, const char *name,
     }
     if (aux_set (&ctx->aux, name, data, freefun) < 0)
         goto error;
+    cfdep_remove (ctx, name);
+    return 0;
+error:
+    security_error (ctx, NULL);
+    return -1;
+}
+
+int security_aux_set_config (flux_security_t *ctx, const char *name,
+                             void *data, flux_security_free_f freefun,
+                             const char *const deps[], security_check_f check,
+                             security_refresh_f refresh)
+{
+    struct cfdep *d;
+
+    if (!ctx || !name || !deps || !ctx->config) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(d = calloc (1, sizeof (*d))) || !(d->name = strdup (name)))
+        goto error;
+    if (aux_set (&ctx->aux, name, data, freefun) < 0)
+        goto error;
+    cfdep_remove (ctx, name);
+    d->deps = deps;
+    d->check = check;
+    d->refresh = refresh;
+    d->config = config_incref (ctx->config);
+    d->next = ctx->cfdeps;
+    ctx->cfdeps = d;
     return 0;
 error:
     security_error (ctx, NULL);
+    cfdep_destroy (d);
     return -1;
 }
 
@@ -164,8 +391,8 @@ const cf_t *security_get_config (flux_security_t *ctx, const char *key)
         return NULL;
     }
     if (key == NULL)
-        cf = ctx->config;
-    else if (!(cf = cf_get_in (ctx->config, key))) {
+        cf = ctx->config->cf;
+    else if (!(cf = cf_get_in (ctx->config->cf, key))) {
         security_error (ctx, "configuration object '%s' not found", key);
         return NULL;
     }
@@ -186,8 +413,12 @@ int security_set_config (flux_security_t *ctx, const cf_t *cf)
         security_error (ctx, "Failed to copy config object");
         return (-1);
     }
-    cf_destroy (ctx->config);
-    ctx->config = new;
+    if (set_config (ctx, new) < 0) {
+        security_error (ctx, NULL);
+        cf_destroy (new);
+        return (-1);
+    }
+    cfdep_purge (ctx, true);
     return (0);
 }
 
@@ -26,6 +26,7 @@ const char *flux_security_last_error (flux_security_t *ctx);
 int flux_security_last_errnum (flux_security_t *ctx);
 
 int flux_security_configure (flux_security_t *ctx, const char *pattern);
+int flux_security_reconfigure (flux_security_t *ctx, const char *pattern);
 
 int flux_security_aux_set (flux_security_t *ctx, const char *name,
 		           void *data, flux_security_free_f freefun);
@@ -29,4 +29,34 @@ const cf_t *security_get_config (flux_security_t *ctx, const char *key);
  */
 int security_set_config (flux_security_t *ctx, const cf_t *cf);
 
+/* Validate 'cf', the entire configuration, on behalf of a config-derived
+ * aux item.  Return 0 on success, or -1 with errno and ctx error set.
+ */
+typedef int (*security_check_f)(flux_security_t *ctx, const cf_t *cf);
+
+/* Update config-derived aux item 'data' in place from 'cf', the entire
+ * configuration, after flux_security_reconfigure() has installed it.
+ */
+typedef void (*security_refresh_f)(flux_security_t *ctx, void *data,
+                                   const cf_t *cf);
+
+/* Set aux item as with flux_security_aux_set(), recording that it was
+ * derived from the configuration values at 'deps', a NULL terminated array
+ * of dot-separated paths such as "sign.curve" (an entire table) or
+ * "sign.default-type".  'deps' must remain valid for the life of 'ctx'.
+ * flux_security_reconfigure() keeps the item, and the configuration it
+ * points into, if none of those values changed.  Otherwise the new
+ * configuration is validated with 'check' (if non-NULL), and the item
+ * destroyed so that it is rebuilt on next use.  Simple values that should
+ * not cost the item, e.g. "sign.max-ttl", are left out of 'deps' and
+ * updated by 'refresh' (if non-NULL) whenever the item is kept.  Since
+ * those may have changed, an item with 'refresh' is always validated.
+ * flux_security_configure() and security_set_config() destroy all such
+ * items.
+ */
+int security_aux_set_config (flux_security_t *ctx, const char *name,
+                             void *data, flux_security_free_f freefun,
+                             const char *const deps[], security_check_f check,
+                             security_refresh_f refresh);
+
 #endif /* !_FLUX_SECURITY_CONTEXT_PRIVATE_H */
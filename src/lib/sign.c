@@ -16,43 +16,129 @@
 #include <string.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
 #include <sodium.h>
 
 #include "src/libutil/cf.h"
 #include "src/libutil/kv.h"
 #include "src/libutil/macros.h"
+#include "src/libutil/sha256.h"
+#include "src/libutil/vcache.h"
 
 #include "context.h"
 #include "context_private.h"
 #include "sign.h"
 #include "sign_mech.h"
 
+/* Values from the [sign] table are bound to fields by cf_bind(),
+ * so they need not be looked up on each wrap/unwrap.
+ */
 struct sign {
-    const cf_t *config;
+    int64_t max_ttl;
+    const char *default_type;
+    uint32_t allowed_types;     // bitmask of mech_names indices
+    const char *verify_cache_dir;
+    int64_t verify_cache_writer;
+    const struct sign_mech *default_mech;
+    struct vcache *vcache;
+    bool vcache_tried;
+    BYTE cfdigest[SHA256_BLOCK_SIZE];
+    bool cfdigest_valid;
+};
+
+/* Buffers returned by flux_sign_wrap() and flux_sign_unwrap().  These are
+ * kept apart from 'struct sign' so that they survive reconfiguration.
+ */
+struct batch_buf {
+    void *buf;
+    int bufsz;
+};
+
+struct sign_buf {
     void *wrapbuf;
     int wrapbufsz;
     void *unwrapbuf;
     int unwrapbufsz;
+    struct batch_buf *wrapv;    // flux_sign_wrap_batch() results
+    int wrapvcount;
+    struct batch_buf *unwrapv;  // flux_sign_unwrap_batch() payloads
+    int unwrapvcount;
+};
+
+/* Number of entries in the verification cache, if configured.
+ */
+#define VERIFY_CACHE_SLOTS  4096
+
+/* [sign] keys, besides the [ca] table, whose values decide whether an
+ * envelope verifies.  A digest of them is part of each verification cache
+ * key, so that a reader configured differently from the writer does not
+ * accept entries the writer added.
+ */
+static const char *const verify_keys[] = {
+    "max-ttl",
+    "allowed-types",
+    "munge",
+    "curve",
+    "hmac",
+    NULL,
 };
 
 static const int64_t sign_version = 1;
 
+/* Mechanism names and the corresponding mechanisms, in the same order.
+ */
+static const char *const mech_names[] = {
+    "none",
+    "munge",
+    "curve",
+    "hmac",
+    NULL,
+};
+static const struct sign_mech *const mechs[] = {
+    &sign_mech_none,
+    &sign_mech_munge,
+    &sign_mech_curve,
+    &sign_mech_hmac,
+};
+
 static const struct cf_option sign_opts[] = {
     {"max-ttl",             CF_INT64,       true},
     {"default-type",        CF_STRING,      true},
     {"allowed-types",       CF_ARRAY,       true},
+    {"verify-cache-dir",    CF_STRING,      false},
+    {"verify-cache-writer", CF_INT64,       false},
     CF_OPTIONS_TABLE_END,
 };
 
+static const struct cf_field sign_fields[] = {
+    CF_FIELD ("max-ttl", struct sign, max_ttl),
+    CF_FIELD ("default-type", struct sign, default_type),
+    CF_MASK ("allowed-types", struct sign, allowed_types, mech_names),
+    CF_FIELD ("verify-cache-dir", struct sign, verify_cache_dir),
+    CF_FIELD ("verify-cache-writer", struct sign, verify_cache_writer),
+    CF_FIELDS_TABLE_END,
+};
+
+/* Return index of mechanism 'name' in mech_names/mechs, or -1 if unknown.
+ */
+static int lookup_mech_index (const char *name)
+{
+    int i;
+
+    for (i = 0; mech_names[i] != NULL; i++) {
+        if (!strcmp (name, mech_names[i]))
+            return i;
+    }
+    return -1;
+}
+
 static const struct sign_mech *lookup_mech (const char *name)
 {
-    if (!strcmp (name, "none"))
-        return &sign_mech_none;
-    if (!strcmp (name, "munge"))
-        return &sign_mech_munge;
-    if (!strcmp (name, "curve"))
-        return &sign_mech_curve;
-    return NULL;
+    int i = lookup_mech_index (name);
+
+    return i < 0 ? NULL : mechs[i];
 }
 
 /* Grow *buf to newsz if *bufsz is less than that.
@@ -70,75 +156,157 @@ static int grow_buf (void **buf, int *bufsz, int newsz)
     return 0;
 }
 
+/* Grow *v to at least 'count' batch buffers.  Existing buffers are kept
+ * for reuse, and new ones are empty.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+static int grow_bufv (struct batch_buf **v, int *vcount, int count)
+{
+    if (*vcount < count) {
+        struct batch_buf *new = realloc (*v, count * sizeof (*new));
+        if (!new)
+            return -1;
+        memset (new + *vcount, 0, (count - *vcount) * sizeof (*new));
+        *v = new;
+        *vcount = count;
+    }
+    return 0;
+}
+
+static void free_bufv (struct batch_buf *v, int vcount)
+{
+    int i;
+
+    for (i = 0; i < vcount; i++)
+        free (v[i].buf);
+    free (v);
+}
+
 static void sign_destroy (struct sign *sign)
 {
     if (sign) {
         int saved_errno = errno;
-        free (sign->wrapbuf);
-        free (sign->unwrapbuf);
+        vcache_close (sign->vcache);
         free (sign);
         errno = saved_errno;
     }
 }
 
-static bool validate_mech_array (flux_security_t *ctx, const cf_t *mechs)
+/* Bind and validate [sign] table 'config' into 'sign'.
+ * Return 0 on success, -1 on failure with errno and ctx error set.
+ */
+static int sign_configure (flux_security_t *ctx, struct sign *sign,
+                           const cf_t *config)
 {
-    int i;
-    const cf_t *el;
+    struct cf_error e;
 
-    for (i = 0; (el = cf_get_at (mechs, i)) != NULL; i++) {
-        if (cf_typeof (el) != CF_STRING) {
-            errno = EINVAL;
-            security_error (ctx, "sign: allowed-types[%d] not a string", i);
-            return false;
-        }
-        if (!lookup_mech (cf_string (el))) {
-            errno = EINVAL;
-            security_error (ctx, "sign: unknown mechanism=%s", cf_string (el));
-            return false;
-        }
+    if (!config) {
+        errno = EINVAL;
+        security_error (ctx, "sign: [sign] config missing");
+        return -1;
+    }
+    /* Unset verify-cache-writer means the cache is private to this user.
+     */
+    sign->verify_cache_writer = -1;
+    if (cf_bind (config, sign_opts, sign_fields, CF_STRICT | CF_ANYTAB,
+                 sign, &e) < 0) {
+        security_error (ctx, "sign: config error: %s", e.errbuf);
+        return -1;
+    }
+    /* Allow -100 for testing
+     */
+    if (sign->max_ttl <= 0 && sign->max_ttl != -100) {
+        errno = EINVAL;
+        security_error (ctx, "sign: max-ttl should be greater than zero");
+        return -1;
     }
-    if (i == 0) {
+    if (sign->allowed_types == 0) {
         errno = EINVAL;
         security_error (ctx, "sign: allowed-types array is empty");
-        return false;
+        return -1;
+    }
+    if (!(sign->default_mech = lookup_mech (sign->default_type))) {
+        errno = EINVAL;
+        security_error (ctx, "sign: unknown default-type=%s",
+                        sign->default_type);
+        return -1;
     }
+    return 0;
+}
 
-    return true;
+/* Validate new configuration 'cf' for flux_security_reconfigure().
+ */
+static int sign_check (flux_security_t *ctx, const cf_t *cf)
+{
+    struct sign sign;
+
+    memset (&sign, 0, sizeof (sign));
+    return sign_configure (ctx, &sign, cf_get_in (cf, "sign"));
+}
+
+/* Add 'name' and the serialized value 'cf' (if present) to 'shx'.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+static int digest_value (SHA256_CTX *shx, const char *name, const cf_t *cf)
+{
+    char *s;
+
+    sha256_update (shx, (const BYTE *)name, strlen (name) + 1);
+    if (cf) {
+        if (!(s = cf_dumps (cf)))
+            return -1;
+        sha256_update (shx, (const BYTE *)s, strlen (s) + 1);
+        free (s);
+    }
+    return 0;
+}
+
+/* Compute the digest of the verification settings in 'cf', the entire
+ * configuration.  If that fails, the verification cache is not used.
+ */
+static void sign_digest_config (struct sign *sign, const cf_t *cf)
+{
+    const cf_t *config = cf_get_in (cf, "sign");
+    SHA256_CTX shx;
+    int i;
+
+    sign->cfdigest_valid = false;
+    sha256_init (&shx);
+    for (i = 0; verify_keys[i] != NULL; i++) {
+        if (digest_value (&shx, verify_keys[i],
+                          cf_get_in (config, verify_keys[i])) < 0)
+            return;
+    }
+    if (digest_value (&shx, "ca", cf_get_in (cf, "ca")) < 0)
+        return;
+    sha256_final (&shx, sign->cfdigest);
+    sign->cfdigest_valid = true;
+}
+
+/* Update values that flux_security_reconfigure() changes in place.
+ * They were validated by sign_check().
+ */
+static void sign_refresh (flux_security_t *ctx, void *data, const cf_t *cf)
+{
+    struct sign *sign = data;
+
+    sign->max_ttl = cf_int64 (cf_get_in (cf_get_in (cf, "sign"), "max-ttl"));
+    sign_digest_config (sign, cf);
 }
 
 static struct sign *sign_create (flux_security_t *ctx)
 {
     struct sign *sign;
-    struct cf_error e;
-    const char *default_type;
-    const cf_t *allowed_types;
-    int64_t max_ttl;
+    const cf_t *config;
 
     if (!(sign = calloc (1, sizeof (*sign)))) {
         security_error (ctx, NULL);
         return NULL;
     }
-    if (!(sign->config = security_get_config (ctx, "sign")))
-        goto error;
-    if (cf_check (sign->config, sign_opts, CF_STRICT | CF_ANYTAB, &e) < 0) {
-        security_error (ctx, "sign: config error: %s", e.errbuf);
-        goto error;
-    }
-    /* Allow -100 for testing
-     */
-    max_ttl = cf_int64 (cf_get_in (sign->config, "max-ttl"));
-    if (max_ttl <= 0 && max_ttl != -100) {
-        errno = EINVAL;
-        security_error (ctx, "sign: max-ttl should be greater than zero");
-        goto error;
-    }
-    allowed_types = cf_get_in (sign->config, "allowed-types");
-    if (!validate_mech_array (ctx, allowed_types))
-        goto error;
-    default_type = cf_string (cf_get_in (sign->config, "default-type"));
-    if (!lookup_mech (default_type))
+    if (!(config = security_get_config (ctx, "sign"))
+            || sign_configure (ctx, sign, config) < 0)
         goto error;
+    sign_digest_config (sign, security_get_config (ctx, NULL));
     return sign;
 error:
     sign_destroy (sign);
@@ -147,14 +315,22 @@ error:
 
 static struct sign *sign_init (flux_security_t *ctx)
 {
+    static const char *const deps[] = {
+        "sign.default-type",
+        "sign.allowed-types",
+        "sign.verify-cache-dir",
+        "sign.verify-cache-writer",
+        NULL,
+    };
     const char *auxname = "flux::sign";
     struct sign *sign = flux_security_aux_get (ctx, auxname);
 
     if (!sign) {
         if (!(sign = sign_create (ctx)))
             goto error_nomsg;
-        if (flux_security_aux_set (ctx, auxname, sign,
-                                   (flux_security_free_f)sign_destroy) < 0)
+        if (security_aux_set_config (ctx, auxname, sign,
+                                     (flux_security_free_f)sign_destroy,
+                                     deps, sign_check, sign_refresh) < 0)
             goto error;
     }
     return sign;
@@ -165,6 +341,39 @@ error_nomsg:
     return NULL;
 }
 
+static void sign_buf_destroy (void *arg)
+{
+    struct sign_buf *buf = arg;
+
+    if (buf) {
+        int saved_errno = errno;
+        free (buf->wrapbuf);
+        free (buf->unwrapbuf);
+        free_bufv (buf->wrapv, buf->wrapvcount);
+        free_bufv (buf->unwrapv, buf->unwrapvcount);
+        free (buf);
+        errno = saved_errno;
+    }
+}
+
+static struct sign_buf *sign_buf_get (flux_security_t *ctx)
+{
+    const char *auxname = "flux::sign_buf";
+    struct sign_buf *buf = flux_security_aux_get (ctx, auxname);
+
+    if (!buf) {
+        if (!(buf = calloc (1, sizeof (*buf)))) {
+            security_error (ctx, NULL);
+            return NULL;
+        }
+        if (flux_security_aux_set (ctx, auxname, buf, sign_buf_destroy) < 0) {
+            sign_buf_destroy (buf);
+            return NULL;
+        }
+    }
+    return buf;
+}
+
 /* Convert header to base64, storing in buf/bufsz, growing as needed.
  * Any existing content is overwritten.  Result is NULL terminated.
  * Return 0 on success, -1 on failure with errno set.
@@ -233,35 +442,42 @@ static int signature_cat (const char *sig, void **buf, int *bufsz)
     return 0;
 }
 
-const char *flux_sign_wrap (flux_security_t *ctx,
-                            const void *pay, int paysz,
-                            const char *mech_type, int flags)
+/* Look up 'mech_type', or the configured default-type if NULL, and
+ * initialize the mechanism for signing.
+ * Return mechanism on success, NULL on failure with errno and ctx error set.
+ */
+static const struct sign_mech *wrap_mech (flux_security_t *ctx,
+                                          struct sign *sign,
+                                          const char *mech_type)
 {
-    struct sign *sign;
-    struct kv *header = NULL;
-    char *sig = NULL;
     const struct sign_mech *mech;
-    int64_t userid = getuid (); // real user id
-    int saved_errno;
 
-    if (!ctx || flags != 0 || paysz < 0 || (paysz > 0 && pay == NULL)) {
-        errno = EINVAL;
-        security_error (ctx, NULL);
-        return NULL;
-    }
-    if (!(sign = sign_init (ctx)))
-        return NULL;
     if (!mech_type)
-        mech_type = cf_string (cf_get_in (sign->config, "default-type"));
-    if (!(mech = lookup_mech (mech_type))) {
+        mech = sign->default_mech;
+    else if (!(mech = lookup_mech (mech_type))) {
         errno = EINVAL;
         security_error (ctx, "sign-wrap: unknown mechanism: %s", mech_type);
         return NULL;
     }
+    /* N.B. Pass the current [sign] table, since 'sign' may have been bound
+     * to an older one that flux_security_reconfigure() left in place.
+     */
     if (mech->init) {
-        if (mech->init (ctx, sign->config) < 0)
+        if (mech->init (ctx, security_get_config (ctx, "sign")) < 0)
             return NULL;
     }
+    return mech;
+}
+
+/* Serialize HEADER.PAYLOAD for 'mech' to buf/bufsz, growing as needed.
+ * Return 0 on success, -1 on failure with errno and ctx error set.
+ */
+static int wrap_encode (flux_security_t *ctx, const struct sign_mech *mech,
+                        const void *pay, int paysz, int flags,
+                        void **buf, int *bufsz)
+{
+    struct kv *header;
+    int64_t userid = getuid (); // real user id
 
     /* Create security header.
      */
@@ -279,24 +495,53 @@ const char *flux_sign_wrap (flux_security_t *ctx,
         if (mech->prep (ctx, header, flags) < 0)
             goto error_msg;
     }
-    /* Serialize to HEADER.PAYLOAD.SIGNATURE
-     */
-    if (header_encode_cpy (header, &sign->wrapbuf, &sign->wrapbufsz) < 0)
+    if (header_encode_cpy (header, buf, bufsz) < 0)
         goto error;
-    if (payload_encode_cat (pay, paysz, &sign->wrapbuf, &sign->wrapbufsz) < 0)
+    if (payload_encode_cat (pay, paysz, buf, bufsz) < 0)
         goto error;
-    if (!(sig = mech->sign (ctx, sign->wrapbuf, strlen (sign->wrapbuf), flags)))
+    kv_destroy (header);
+    return 0;
+error:
+    security_error (ctx, NULL);
+error_msg:
+    kv_destroy (header);
+    return -1;
+}
+
+const char *flux_sign_wrap (flux_security_t *ctx,
+                            const void *pay, int paysz,
+                            const char *mech_type, int flags)
+{
+    struct sign *sign;
+    struct sign_buf *buf;
+    char *sig = NULL;
+    const struct sign_mech *mech;
+    int saved_errno;
+
+    if (!ctx || flags != 0 || paysz < 0 || (paysz > 0 && pay == NULL)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    if (!(sign = sign_init (ctx)) || !(buf = sign_buf_get (ctx)))
+        return NULL;
+    if (!(mech = wrap_mech (ctx, sign, mech_type)))
+        return NULL;
+    /* Serialize to HEADER.PAYLOAD.SIGNATURE
+     */
+    if (wrap_encode (ctx, mech, pay, paysz, flags,
+                     &buf->wrapbuf, &buf->wrapbufsz) < 0)
+        return NULL;
+    if (!(sig = mech->sign (ctx, buf->wrapbuf, strlen (buf->wrapbuf), flags)))
         goto error_msg;
-    if (signature_cat (sig, &sign->wrapbuf, &sign->wrapbufsz) < 0)
+    if (signature_cat (sig, &buf->wrapbuf, &buf->wrapbufsz) < 0)
         goto error;
 
     free (sig);
-    kv_destroy (header);
-    return sign->wrapbuf;
+    return buf->wrapbuf;
 error:
     security_error (ctx, NULL);
 error_msg:
-    kv_destroy (header);
     saved_errno = errno;
     free (sig);
     errno = saved_errno;
@@ -376,49 +621,92 @@ static int payload_decode_cpy (const char *input, void **buf, int *bufsz,
     return dstlen;
 }
 
-/* Return true if mechanism 'name' is present in the 'allowed' array.
+/* Open the node's verification cache on first use, if verify-cache-dir
+ * is configured.  Only verify-cache-writer (default: this user) adds
+ * entries; other users just consume them.  The cache is an optimization,
+ * so if it cannot be used (e.g. the file is not owned by the writer),
+ * verification proceeds without it.
  */
-static bool mech_allowed (const char *name, const cf_t *allowed)
+static struct vcache *get_vcache (struct sign *sign)
 {
-    int i;
-    const cf_t *el;
+    char path[PATH_MAX + 1];
+    uid_t writer = geteuid ();
 
-    for (i = 0; (el = cf_get_at (allowed, i)) != NULL; i++) {
-        if (!strcmp (cf_string (el), name))
-            return true;
+    if (sign->verify_cache_writer >= 0)
+        writer = sign->verify_cache_writer;
+
+    if (!sign->vcache_tried) {
+        sign->vcache_tried = true;
+        if (sign->verify_cache_dir
+                && snprintf (path, sizeof (path), "%s/verify-cache",
+                             sign->verify_cache_dir) < (int)sizeof (path))
+            sign->vcache = vcache_open (path, VERIFY_CACHE_SLOTS, writer);
     }
-    return false;
+    return sign->vcache;
 }
 
-static int sign_unwrap (flux_security_t *ctx,
-                        const char *input,
-                        const void **payload, int *payloadsz,
-                        const char **mech_typep,
-                        int64_t *useridp, int flags, bool check_allowed)
+/* Compute the verification cache key for 'input' into 'key', if the
+ * cache is in use.  The key is the SHA-256 digest of the verification
+ * settings digest and the entire input.
+ * Return the cache, or NULL if it is not used.
+ */
+static struct vcache *verify_cache_key (struct sign *sign, const char *input,
+                                        BYTE *key)
+{
+    struct vcache *vc = sign->cfdigest_valid ? get_vcache (sign) : NULL;
+
+    if (vc) {
+        SHA256_CTX shx;
+
+        sha256_init (&shx);
+        sha256_update (&shx, sign->cfdigest, sizeof (sign->cfdigest));
+        sha256_update (&shx, (const BYTE *)input, strlen (input));
+        sha256_final (&shx, key);
+    }
+    return vc;
+}
+
+/* Mech-specific verification, consulting the verification cache, if any.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int verify_cached (flux_security_t *ctx, struct sign *sign,
+                          const struct sign_mech *mech,
+                          const struct kv *header, int64_t userid,
+                          const char *input, int inputsz,
+                          const char *signature, int flags)
+{
+    BYTE key[SHA256_BLOCK_SIZE];
+    struct vcache *vc = verify_cache_key (sign, input, key);
+    time_t xtime = 0;
+
+    if (vc && vcache_lookup (vc, key, userid, mech->name, time (NULL)) == 0)
+        return 0;
+    if (mech->verify (ctx, header, input, inputsz, signature, flags,
+                      &xtime) < 0)
+        return -1;
+    if (vc && xtime > 0)
+        (void)vcache_insert (vc, key, userid, mech->name, xtime);
+    return 0;
+}
+
+/* Parse and verify generic portion of the security header of 'input'.
+ * Set 'mechp' and 'useridp', and 'endptr' to the '.' following HEADER.
+ * Return header on success, NULL on failure with errno and ctx error set.
+ */
+static struct kv *unwrap_header (flux_security_t *ctx, struct sign *sign,
+                                 const char *input, bool check_allowed,
+                                 const struct sign_mech **mechp,
+                                 int64_t *useridp, char **endptr)
 {
-    struct sign *sign;
     struct kv *header;
-    int len;
-    int64_t userid;
     int64_t version;
     const char *mechanism;
-    const struct sign_mech *mech;
-    const cf_t *allowed_types;
-    char *endptr;
+    int mech_index;
 
-    if (!ctx || !input || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
-        errno = EINVAL;
-        security_error (ctx, NULL);
-        return -1;
-    }
-    if (!(sign = sign_init (ctx)))
-        return -1;
-    /* Parse and verify generic portion of security header.
-     */
-    if (!(header = header_decode (input, &endptr))) {
+    if (!(header = header_decode (input, endptr))) {
         security_error (ctx, "sign-unwrap: header decode error: %s",
                         strerror (errno));
-        return -1;
+        return NULL;
     }
     if (kv_get (header, "version", KV_INT64, &version) < 0) {
         errno = EINVAL;
@@ -436,29 +724,59 @@ static int sign_unwrap (flux_security_t *ctx,
         security_error (ctx, "sign-unwrap: header mechanism missing");
         goto error;
     }
-    if (!(mech = lookup_mech (mechanism))) {
+    if ((mech_index = lookup_mech_index (mechanism)) < 0) {
         errno = EINVAL;
         security_error (ctx, "sign-unwrap: header mechanism=%s unknown",
                         mechanism);
         goto error;
     }
     if (check_allowed) {
-        allowed_types = cf_get_in (sign->config, "allowed-types");
-        if (!mech_allowed (mechanism, allowed_types)) {
+        if (!(sign->allowed_types & (1U << mech_index))) {
             errno = EINVAL;
             security_error (ctx, "sign-unwrap: header mechanism=%s not allowed",
                             mechanism);
             goto error;
         }
     }
-    if (kv_get (header, "userid", KV_INT64, &userid) < 0) {
+    if (kv_get (header, "userid", KV_INT64, useridp) < 0) {
         errno = EINVAL;
         security_error (ctx, "sign-unwrap: header userid missing");
         goto error;
     }
+    *mechp = mechs[mech_index];
+    return header;
+error:
+    kv_destroy (header);
+    return NULL;
+}
+
+static int sign_unwrap (flux_security_t *ctx,
+                        const char *input,
+                        const void **payload, int *payloadsz,
+                        const char **mech_typep,
+                        int64_t *useridp, int flags, bool check_allowed)
+{
+    struct sign *sign;
+    struct sign_buf *buf;
+    struct kv *header;
+    int len;
+    int64_t userid;
+    const struct sign_mech *mech;
+    char *endptr;
+
+    if (!ctx || !input || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(sign = sign_init (ctx)) || !(buf = sign_buf_get (ctx)))
+        return -1;
+    if (!(header = unwrap_header (ctx, sign, input, check_allowed,
+                                  &mech, &userid, &endptr)))
+        return -1;
     /* Decode payload
      */
-    len = payload_decode_cpy (endptr + 1, &sign->unwrapbuf, &sign->unwrapbufsz,
+    len = payload_decode_cpy (endptr + 1, &buf->unwrapbuf, &buf->unwrapbufsz,
                               &endptr);
     if (len < 0) {
         security_error (ctx, "sign-unwrap: payload decode error: %s",
@@ -471,15 +789,16 @@ static int sign_unwrap (flux_security_t *ctx,
         int inputsz = endptr - input;
         const char *signature = endptr + 1;
         if (mech->init) {
-            if (mech->init (ctx, sign->config) < 0)
+            if (mech->init (ctx, security_get_config (ctx, "sign")) < 0)
                 goto error;
         }
-        if (mech->verify (ctx, header, input, inputsz, signature, flags) < 0)
+        if (verify_cached (ctx, sign, mech, header, userid,
+                           input, inputsz, signature, flags) < 0)
             goto error;
     }
     kv_destroy (header);
     if (payload)
-        *payload = (len > 0 ? sign->unwrapbuf : NULL);
+        *payload = (len > 0 ? buf->unwrapbuf : NULL);
     if (payloadsz)
         *payloadsz = len;
     if (mech_typep)
@@ -509,6 +828,294 @@ int flux_sign_unwrap (flux_security_t *ctx, const char *input,
                         NULL, userid, flags, true);
 }
 
+/* Sign 'count' items with 'mech', using its sign_batch callback if any.
+ * Return 0 if all items were signed, -1 if any failed.
+ */
+static int mech_sign_batch (flux_security_t *ctx,
+                            const struct sign_mech *mech,
+                            struct sign_mech_item *items, int count,
+                            int flags)
+{
+    int rc = 0;
+    int i;
+
+    if (mech->sign_batch)
+        return mech->sign_batch (ctx, items, count, flags);
+    for (i = 0; i < count; i++) {
+        items[i].sig = mech->sign (ctx, items[i].input, items[i].inputsz,
+                                   flags);
+        if (!items[i].sig) {
+            items[i].errnum = errno;
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+/* Verify 'count' items with 'mech', using its verify_batch callback if any.
+ * Return 0 if all items were verified, -1 if any failed.
+ */
+static int mech_verify_batch (flux_security_t *ctx,
+                              const struct sign_mech *mech,
+                              struct sign_mech_item *items, int count,
+                              int flags)
+{
+    int rc = 0;
+    int i;
+
+    if (mech->verify_batch)
+        return mech->verify_batch (ctx, items, count, flags);
+    for (i = 0; i < count; i++) {
+        if (mech->verify (ctx, items[i].header,
+                          items[i].input, items[i].inputsz,
+                          items[i].signature, flags, &items[i].xtime) < 0) {
+            items[i].errnum = errno;
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+int flux_sign_wrap_batch (flux_security_t *ctx,
+                          struct flux_sign_batch_item *items, int count,
+                          const char *mech_type, int flags)
+{
+    struct sign *sign;
+    struct sign_buf *buf;
+    const struct sign_mech *mech;
+    struct sign_mech_item *mitems = NULL;
+    int *index = NULL;
+    int failed = 0;
+    int n = 0;
+    int i;
+
+    if (!ctx || count < 0 || (count > 0 && !items) || flags != 0) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(sign = sign_init (ctx)) || !(buf = sign_buf_get (ctx)))
+        return -1;
+    if (!(mech = wrap_mech (ctx, sign, mech_type)))
+        return -1;
+    if (count == 0)
+        return 0;
+    if (grow_bufv (&buf->wrapv, &buf->wrapvcount, count) < 0
+            || !(mitems = calloc (count, sizeof (mitems[0])))
+            || !(index = calloc (count, sizeof (index[0])))) {
+        security_error (ctx, NULL);
+        goto error;
+    }
+    /* Serialize each HEADER.PAYLOAD, then sign them together.
+     */
+    for (i = 0; i < count; i++) {
+        struct flux_sign_batch_item *item = &items[i];
+        struct batch_buf *b = &buf->wrapv[i];
+
+        item->input = NULL;
+        item->errnum = 0;
+        if (item->payloadsz < 0 || (item->payloadsz > 0 && !item->payload)) {
+            errno = EINVAL;
+            security_error (ctx, NULL);
+        }
+        else if (wrap_encode (ctx, mech, item->payload, item->payloadsz,
+                              flags, &b->buf, &b->bufsz) == 0) {
+            mitems[n].input = b->buf;
+            mitems[n].inputsz = strlen (b->buf);
+            index[n++] = i;
+            continue;
+        }
+        item->errnum = errno;
+        failed++;
+    }
+    if (n > 0)
+        (void)mech_sign_batch (ctx, mech, mitems, n, flags);
+    for (i = 0; i < n; i++) {
+        struct flux_sign_batch_item *item = &items[index[i]];
+        struct batch_buf *b = &buf->wrapv[index[i]];
+
+        if (mitems[i].errnum != 0) {
+            item->errnum = mitems[i].errnum;
+            failed++;
+        }
+        else if (signature_cat (mitems[i].sig, &b->buf, &b->bufsz) < 0) {
+            security_error (ctx, NULL);
+            item->errnum = errno;
+            failed++;
+        }
+        else
+            item->input = b->buf;
+        free (mitems[i].sig);
+    }
+    free (mitems);
+    free (index);
+    if (failed > 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+error:
+    free (mitems);
+    free (index);
+    return -1;
+}
+
+/* Decode the payload of 'item' into 'b', setting 'headerp' to the parsed
+ * header, which the caller must destroy, and 'mitem' and 'mechp' for
+ * verification of its signature.
+ * Return 0 on success, -1 on failure with errno and ctx error set.
+ */
+static int unwrap_item (flux_security_t *ctx, struct sign *sign,
+                        struct flux_sign_batch_item *item,
+                        struct batch_buf *b,
+                        struct kv **headerp,
+                        struct sign_mech_item *mitem,
+                        const struct sign_mech **mechp)
+{
+    struct kv *header;
+    char *endptr;
+    int len;
+
+    if (!item->input) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(header = unwrap_header (ctx, sign, item->input, true,
+                                  mechp, &item->userid, &endptr)))
+        return -1;
+    len = payload_decode_cpy (endptr + 1, &b->buf, &b->bufsz, &endptr);
+    if (len < 0) {
+        security_error (ctx, "sign-unwrap: payload decode error: %s",
+                        strerror (errno));
+        kv_destroy (header);
+        return -1;
+    }
+    item->payload = (len > 0 ? b->buf : NULL);
+    item->payloadsz = len;
+    *headerp = header;
+    mitem->header = header;
+    mitem->input = item->input;
+    mitem->inputsz = endptr - item->input;
+    mitem->signature = endptr + 1;
+    return 0;
+}
+
+int flux_sign_unwrap_batch (flux_security_t *ctx,
+                            struct flux_sign_batch_item *items, int count,
+                            int flags)
+{
+    struct sign *sign;
+    struct sign_buf *buf;
+    struct vcache *vc = NULL;
+    struct kv **headers = NULL;
+    struct sign_mech_item *pending = NULL;
+    const struct sign_mech **pendmech = NULL;
+    BYTE (*keys)[SHA256_BLOCK_SIZE] = NULL;
+    struct sign_mech_item *mitems = NULL;
+    int *index = NULL;
+    time_t now = time (NULL);
+    int failed = 0;
+    int rc = -1;
+    int saved_errno;
+    int i, m;
+
+    if (!ctx || count < 0 || (count > 0 && !items)
+             || !(flags == 0 || flags == FLUX_SIGN_NOVERIFY)) {
+        errno = EINVAL;
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (!(sign = sign_init (ctx)) || !(buf = sign_buf_get (ctx)))
+        return -1;
+    if (count == 0)
+        return 0;
+    if (grow_bufv (&buf->unwrapv, &buf->unwrapvcount, count) < 0
+            || !(headers = calloc (count, sizeof (headers[0])))
+            || !(pending = calloc (count, sizeof (pending[0])))
+            || !(pendmech = calloc (count, sizeof (pendmech[0])))
+            || !(keys = calloc (count, sizeof (keys[0])))
+            || !(mitems = calloc (count, sizeof (mitems[0])))
+            || !(index = calloc (count, sizeof (index[0])))) {
+        security_error (ctx, NULL);
+        goto done;
+    }
+    /* Decode each item.  Those whose signature is to be verified and is
+     * not in the verification cache are left pending.
+     */
+    for (i = 0; i < count; i++) {
+        const struct sign_mech *mech;
+
+        items[i].payload = NULL;
+        items[i].payloadsz = 0;
+        items[i].errnum = 0;
+        if (unwrap_item (ctx, sign, &items[i], &buf->unwrapv[i],
+                         &headers[i], &pending[i], &mech) < 0) {
+            items[i].errnum = errno;
+            failed++;
+            continue;
+        }
+        if ((flags & FLUX_SIGN_NOVERIFY))
+            continue;
+        vc = verify_cache_key (sign, items[i].input, keys[i]);
+        if (vc && vcache_lookup (vc, keys[i], items[i].userid,
+                                 mech->name, now) == 0)
+            continue;
+        pendmech[i] = mech;
+    }
+    /* Verify pending items together, one mechanism at a time.
+     */
+    for (m = 0; mech_names[m] != NULL; m++) {
+        const struct sign_mech *mech = mechs[m];
+        int n = 0;
+
+        for (i = 0; i < count; i++) {
+            if (pendmech[i] == mech) {
+                mitems[n] = pending[i];
+                index[n++] = i;
+            }
+        }
+        if (n == 0)
+            continue;
+        if (mech->init
+                && mech->init (ctx, security_get_config (ctx, "sign")) < 0) {
+            for (i = 0; i < n; i++)
+                mitems[i].errnum = errno;
+        }
+        else
+            (void)mech_verify_batch (ctx, mech, mitems, n, flags);
+        for (i = 0; i < n; i++) {
+            struct flux_sign_batch_item *item = &items[index[i]];
+
+            if (mitems[i].errnum != 0) {
+                item->errnum = mitems[i].errnum;
+                failed++;
+            }
+            else if (vc && mitems[i].xtime > 0)
+                (void)vcache_insert (vc, keys[index[i]], item->userid,
+                                     mech->name, mitems[i].xtime);
+        }
+    }
+    if (failed > 0)
+        errno = EINVAL;
+    else
+        rc = 0;
+done:
+    saved_errno = errno;
+    if (headers) {
+        for (i = 0; i < count; i++)
+            kv_destroy (headers[i]);
+    }
+    free (headers);
+    free (pending);
+    free (pendmech);
+    free (keys);
+    free (mitems);
+    free (index);
+    errno = saved_errno;
+    return rc;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
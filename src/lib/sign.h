@@ -88,6 +88,41 @@ int flux_sign_unwrap_anymech (flux_security_t *ctx, const char *input,
                               const char **mech_type,
                               int64_t *userid, int flags);
 
+/* An entry for flux_sign_wrap_batch() and flux_sign_unwrap_batch().
+ */
+struct flux_sign_batch_item {
+    const char *input;          // wrapped string (wrap: out, unwrap: in)
+    const void *payload;        // payload (wrap: in, unwrap: out)
+    int payloadsz;
+    int64_t userid;             // userid that signed 'input' (unwrap: out)
+    int errnum;                 // 0 on success, otherwise errno (out)
+};
+
+/* Sign the payloads of 'count' items, setting each item's 'input'.
+ * This allows the mechanism to keep several requests in flight, e.g.
+ * the munge mechanism overlaps munged round trips on a pool of threads.
+ * The returned strings remain valid until the next call to
+ * flux_sign_wrap_batch() or 'ctx' is destroyed.  'mech_type' and 'flags'
+ * are as for flux_sign_wrap().
+ * Return 0 if all items were signed.  If any item failed, its 'errnum'
+ * is set, context error state describes one that failed, and
+ * -1 is returned with errno set to EINVAL.  On other errors, e.g. invalid
+ * arguments, -1 is returned with errno and context error state set.
+ */
+int flux_sign_wrap_batch (flux_security_t *ctx,
+                          struct flux_sign_batch_item *items, int count,
+                          const char *mech_type, int flags);
+
+/* Decode and verify the 'input' of 'count' items, as flux_sign_unwrap()
+ * would, setting each item's 'payload', 'payloadsz', and 'userid'.
+ * The payloads remain valid until the next call to flux_sign_unwrap_batch()
+ * or 'ctx' is destroyed.  Return value and error handling are as for
+ * flux_sign_wrap_batch().
+ */
+int flux_sign_unwrap_batch (flux_security_t *ctx,
+                            struct flux_sign_batch_item *items, int count,
+                            int flags);
+
 #ifdef __cplusplus
 }
 #endif
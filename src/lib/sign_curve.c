@@ -25,53 +25,114 @@
 #include "sign_mech.h"
 #include "src/libca/sigcert.h"
 #include "src/libca/ca.h"
+#include "src/libca/certdb.h"
+#include "src/libca/sigagent.h"
 
 struct sign_curve {
     struct sigcert *cert;
     int64_t max_ttl;
     const cf_t *curve_config;
-    struct ca *ca;
+    bool require_ca;            // [sign.curve] values bound by cf_bind()
+    const char *cert_path;
+    const char *cert_db;
+    const char *agent_socket;
+    struct certdb *certdb;
+    time_t certdb_checked;      // last check of cert_db for changes
+    struct sigagent *agent;     // if set, agent signs with sc->cert
 };
 
 static const struct cf_option curve_opts[] = {
     {"require-ca",              CF_BOOL,        true},
     {"cert-path",               CF_STRING,      false},
+    {"cert-db",                 CF_STRING,      false},
+    {"agent-socket",            CF_STRING,      false},
     CF_OPTIONS_TABLE_END,
 };
 
+static const struct cf_field curve_fields[] = {
+    CF_FIELD ("require-ca", struct sign_curve, require_ca),
+    CF_FIELD ("cert-path", struct sign_curve, cert_path),
+    CF_FIELD ("cert-db", struct sign_curve, cert_db),
+    CF_FIELD ("agent-socket", struct sign_curve, agent_socket),
+    CF_FIELDS_TABLE_END,
+};
+
 static const char *auxname = "flux::sign_curve";
+static const char *ca_auxname = "flux::sign_curve_ca";
+
+/* Seconds between checks of the cert database for changes.
+ */
+#define CERTDB_CHECK_INTERVAL   60
 
 static void sc_destroy (struct sign_curve *sc)
 {
     if (sc) {
-        ca_destroy (sc->ca);
+        certdb_close (sc->certdb);
+        sigagent_close (sc->agent);
         sigcert_destroy (sc->cert);
         free (sc);
     }
 }
 
+/* Bind and validate [sign] table 'cf' into 'sc'.
+ * Return 0 on success, -1 on failure with errno and ctx error set.
+ */
+static int sc_configure (flux_security_t *ctx, struct sign_curve *sc,
+                         const cf_t *cf)
+{
+    struct cf_error cfe;
+
+    sc->max_ttl = cf_int64 (cf_get_in (cf, "max-ttl"));
+    if (!(sc->curve_config = cf_get_in (cf, "curve"))) {
+        security_error (ctx, "sign-curve-init: [sign.curve] config missing");
+        return -1;
+    }
+    if (cf_bind (sc->curve_config, curve_opts, curve_fields, CF_STRICT, sc,
+                 &cfe) < 0) {
+        security_error (ctx, "sign-curve-init: [curve] config: %s", cfe.errbuf);
+        return -1;
+    }
+    return 0;
+}
+
+/* Validate new configuration 'cf' for flux_security_reconfigure().
+ */
+static int op_check (flux_security_t *ctx, const cf_t *cf)
+{
+    struct sign_curve sc;
+
+    memset (&sc, 0, sizeof (sc));
+    return sc_configure (ctx, &sc, cf_get_in (cf, "sign"));
+}
+
+/* Update max-ttl in place for flux_security_reconfigure().
+ */
+static void op_refresh (flux_security_t *ctx, void *data, const cf_t *cf)
+{
+    struct sign_curve *sc = data;
+
+    sc->max_ttl = cf_int64 (cf_get_in (cf_get_in (cf, "sign"), "max-ttl"));
+}
+
 /* init - one time mechansim initialization
  */
 static int op_init (flux_security_t *ctx, const cf_t *cf)
 {
+    static const char *const deps[] = {
+        "sign.curve",
+        NULL,
+    };
     struct sign_curve *sc = flux_security_aux_get (ctx, auxname);
-    struct cf_error cfe;
 
     if (sc != NULL)
         return 0;
     if (!(sc = calloc (1, sizeof (*sc))))
         goto error;
-    sc->max_ttl = cf_int64 (cf_get_in (cf, "max-ttl"));
-    if (!(sc->curve_config = cf_get_in (cf, "curve"))) {
-        security_error (ctx, "sign-curve-init: [sign.curve] config missing");
+    if (sc_configure (ctx, sc, cf) < 0)
         goto error_nomsg;
-    }
-    if (cf_check (sc->curve_config, curve_opts, CF_STRICT, &cfe) < 0) {
-        security_error (ctx, "sign-curve-init: [curve] config: %s", cfe.errbuf);
-        goto error_nomsg;
-    }
-    if (flux_security_aux_set (ctx, auxname, sc,
-                               (flux_security_free_f)sc_destroy) < 0)
+    if (security_aux_set_config (ctx, auxname, sc,
+                                 (flux_security_free_f)sc_destroy,
+                                 deps, op_check, op_refresh) < 0)
         goto error;
     return 0;
 error:
@@ -104,34 +165,140 @@ error:
     return -1;
 }
 
-/* Get cert from security header.
+/* Get cert from security header, decoding it in place.
  * Return cert on success, NULL on error with errno set.
  */
 static struct sigcert *header_get_cert (const struct kv *header,
                                         const char *prefix)
 {
-    struct kv *kv;
-    const char *buf;
-    int len;
+    return sigcert_decode_kv (header, prefix);
+}
+
+/* Connect to the signing agent, if agent-socket is configured, and get
+ * its public cert.  The configured path may contain "%u", replaced by the
+ * real uid, so that each user on the node has their own agent.
+ * Return the agent, or NULL if it is unavailable.
+ */
+static struct sigagent *agent_open (struct sign_curve *sc,
+                                    struct sigcert **certp)
+{
+    char path[PATH_MAX + 1];
+    struct sigagent *agent;
+    struct sigcert *cert;
+
+    if (!sc->agent_socket)
+        return NULL;
+    if (sigagent_path (sc->agent_socket, getuid (), path, sizeof (path)) < 0
+            || !(agent = sigagent_connect (path)))
+        return NULL;
+    if (!(cert = sigagent_get_cert (agent))) {
+        sigagent_close (agent);
+        return NULL;
+    }
+    *certp = cert;
+    return agent;
+}
+
+/* Get public signing cert from agent, if agent-socket is configured.
+ * The agent is optional:  on failure, the cert is loaded from disk instead.
+ */
+static void load_agent_cert (struct sign_curve *sc)
+{
+    struct sigcert *cert;
+
+    if ((sc->agent = agent_open (sc, &cert)))
+        sc->cert = cert;
+}
+
+/* Load signing cert, including secret key, from disk.
+ * Return cert on success, NULL on failure with ctx error set.
+ */
+static struct sigcert *load_disk_cert (flux_security_t *ctx,
+                                       struct sign_curve *sc)
+{
+    char buf[PATH_MAX + 1];
+    int bufsz = sizeof (buf);
+    const char *certpath;
     struct sigcert *cert;
 
-    if (!(kv = kv_split (header, prefix)))
+    if (sc->cert_path) // test
+        certpath = sc->cert_path;
+    else {
+        uid_t real_uid = getuid ();
+        struct passwd *pw = getpwuid (real_uid);
+        if (!pw || snprintf (buf, bufsz, "%s/.flux/curve/sig",
+                                                pw->pw_dir) >= bufsz) {
+            errno = EINVAL;
+            security_error (ctx, NULL);
+            return NULL;
+        }
+        certpath = buf;
+    }
+    if (!(cert = sigcert_load (certpath, true))) {
+        security_error (ctx, "sign-curve: load %s: %s",
+                        certpath, strerror (errno));
         return NULL;
-    if (kv_encode (kv, &buf, &len) < 0)
+    }
+    return cert;
+}
+
+/* Return true if 'cert' has the same public part as 'pub'.
+ */
+static bool same_public_cert (const struct sigcert *cert,
+                              const struct sigcert *pub)
+{
+    struct sigcert *cpy;
+    bool same;
+
+    if (!(cpy = sigcert_copy (cert)))
+        return false;
+    sigcert_forget_secret (cpy);
+    same = sigcert_equal (cpy, pub);
+    sigcert_destroy (cpy);
+    return same;
+}
+
+/* The agent failed to sign, e.g. because it was restarted or has exited.
+ * Reconnect once, and failing that, fall back to the cert on disk as
+ * load_agent_cert() does.  Either must match the cert op_prep() already
+ * put in the header.  Return 0 on success with sc->agent or sc->cert
+ * updated, or -1 with ctx error set.  On failure, state is reset so the
+ * next op_prep() starts over.
+ */
+static int agent_recover (flux_security_t *ctx, struct sign_curve *sc)
+{
+    struct sigcert *cert;
+    struct sigagent *agent;
+
+    sigagent_close (sc->agent);
+    sc->agent = NULL;
+    if ((agent = agent_open (sc, &cert))) {
+        bool same = sigcert_equal (cert, sc->cert);
+        sigcert_destroy (cert);
+        if (same) {
+            sc->agent = agent;
+            return 0;
+        }
+        sigagent_close (agent);
+    }
+    if (!(cert = load_disk_cert (ctx, sc)))
         goto error;
-    if (!(cert = sigcert_decode (buf, len)))
+    if (!same_public_cert (cert, sc->cert)) {
+        sigcert_destroy (cert);
+        errno = EINVAL;
+        security_error (ctx, "sign-curve: signing agent is unavailable"
+                        " and its cert differs from the one on disk");
         goto error;
-    return cert;
+    }
+    sigcert_destroy (sc->cert);
+    sc->cert = cert;
+    return 0;
 error:
-    kv_destroy (kv);
-    return NULL;
+    sigcert_destroy (sc->cert);
+    sc->cert = NULL;
+    return -1;
 }
 
-/* prep - add to security header
- *   curve.cert    signer's public certificate
- *   curve.ctime   signature creation time
- *   curve.xtime   signature expiration time
- */
 static int op_prep (flux_security_t *ctx, struct kv *header, int flags)
 {
     struct sign_curve *sc = flux_security_aux_get (ctx, auxname);
@@ -140,31 +307,11 @@ static int op_prep (flux_security_t *ctx, struct kv *header, int flags)
 
     assert (sc != NULL);
 
+    if (!sc->cert) // use signing agent, if any, on first use
+        load_agent_cert (sc);
     if (!sc->cert) { // load signing cert on first use
-        char buf[PATH_MAX + 1];
-        int bufsz = sizeof (buf);
-        const char *certpath;
-        struct sigcert *cert;
-        const cf_t *entry;
-        if ((entry = cf_get_in (sc->curve_config, "cert-path"))) // test
-            certpath = cf_string (entry);
-        else {
-            uid_t real_uid = getuid ();
-            struct passwd *pw = getpwuid (real_uid);
-            if (!pw || snprintf (buf, bufsz, "%s/.flux/curve/sig",
-                                                    pw->pw_dir) >= bufsz) {
-                errno = EINVAL;
-                goto error;
-            }
-            certpath = buf;
-        }
-        if (!(cert = sigcert_load (certpath, true))) {
-            security_error (ctx, "sign-curve-prep: load %s: %s",
-                            certpath, strerror (errno));
+        if (!(sc->cert = load_disk_cert (ctx, sc)))
             goto error_nomsg;
-        }
-        sigcert_destroy (sc->cert);
-        sc->cert = cert;
     }
     if ((ctime = time (NULL)) == (time_t)-1)
         goto error;
@@ -190,13 +337,99 @@ static char *op_sign (flux_security_t *ctx,
 
     assert (sc != NULL);
 
-    if (!(sign = sigcert_sign_detached (sc->cert, (uint8_t *)input, inputsz))) {
+    if (sc->agent) {
+        if ((sign = sigagent_sign (sc->agent, (uint8_t *)input, inputsz)))
+            return sign;
+        if (agent_recover (ctx, sc) < 0)
+            return NULL;
+    }
+    if (sc->agent)
+        sign = sigagent_sign (sc->agent, (uint8_t *)input, inputsz);
+    else
+        sign = sigcert_sign_detached (sc->cert, (uint8_t *)input, inputsz);
+    if (!sign) {
         security_error (ctx, "sign-curve: %s", strerror (errno));
         return NULL;
     }
     return sign;
 }
 
+/* Reopen the cert database if it has been rebuilt since it was opened,
+ * so that new, changed, and removed certs take effect without restarting.
+ * On failure to reopen, keep using the old database.
+ */
+static void certdb_refresh (struct sign_curve *sc, const char *path,
+                            time_t now)
+{
+    struct certdb *db;
+
+    sc->certdb_checked = now;
+    if (certdb_changed (sc->certdb, path) && (db = certdb_open (path))) {
+        certdb_close (sc->certdb);
+        sc->certdb = db;
+    }
+}
+
+/* Compare cert with the one recorded for userid in the cert database.
+ * Return 0 if they match, 1 if they differ, or -1 if there is no cert
+ * for userid.
+ */
+static int certdb_match (struct sign_curve *sc, const struct sigcert *cert,
+                         int64_t userid)
+{
+    struct sigcert *ucert;
+    bool match;
+
+    if (!(ucert = certdb_lookup (sc->certdb, userid)))
+        return -1;
+    match = sigcert_equal (ucert, cert);
+    sigcert_destroy (ucert);
+    return match ? 0 : 1;
+}
+
+/* Verify that cert authenticates userid, because it is the cert recorded
+ * for that user in the cert database (built from home directories).
+ * The database is checked for changes every CERTDB_CHECK_INTERVAL seconds,
+ * and before failing on a missing or different cert.
+ */
+static int verify_cert_db (flux_security_t *ctx, struct sign_curve *sc,
+                           const char *path,
+                           const struct sigcert *cert, int64_t userid)
+{
+    time_t now = time (NULL);
+    bool fresh = true;
+    int rc;
+
+    if (!sc->certdb) { // open cert database on first use
+        if (!(sc->certdb = certdb_open (path))) {
+            security_error (ctx, "sign-curve-verify: error opening %s: %s",
+                            path, strerror (errno));
+            return -1;
+        }
+        sc->certdb_checked = now;
+    }
+    else if (now - sc->certdb_checked >= CERTDB_CHECK_INTERVAL)
+        certdb_refresh (sc, path, now);
+    else
+        fresh = false;
+    if ((rc = certdb_match (sc, cert, userid)) != 0 && !fresh) {
+        certdb_refresh (sc, path, now);
+        rc = certdb_match (sc, cert, userid);
+    }
+    if (rc < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-curve-verify: error loading cert"
+                        " for userid %lld from %s", (long long)userid, path);
+        return -1;
+    }
+    if (rc > 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-curve-verify: cert verification failed");
+        return -1;
+    }
+    return 0;
+}
+
 /* Verify that cert authenticates userid, because it exists in that user's
  * home directory.
  */
@@ -205,9 +438,12 @@ static int verify_cert_home (flux_security_t *ctx, struct sign_curve *sc,
 {
     char buf[PATH_MAX + 1] = "unknown user";
     int bufsz = sizeof (buf);
-    struct passwd *pw = getpwuid (userid);
+    struct passwd *pw;
     struct sigcert *ucert = NULL;
 
+    if (sc->cert_db)
+        return verify_cert_db (ctx, sc, sc->cert_db, cert, userid);
+    pw = getpwuid (userid);
     if (!pw || snprintf (buf, bufsz, "%s/.flux/curve/sig", pw->pw_dir) >= bufsz
                                 || (!(ucert = sigcert_load (buf, false)))) {
         errno = EINVAL;
@@ -225,34 +461,79 @@ static int verify_cert_home (flux_security_t *ctx, struct sign_curve *sc,
     return 0;
 }
 
-/* Verify that cert authenticates userid, because it was signed by the CA,
- * and the cert contains the same userid.
+/* Validate [ca] in new configuration 'cf' for flux_security_reconfigure().
+ * The CA cert is loaded on next use, so only check that the table parses.
  */
-static int verify_cert_ca (flux_security_t *ctx, struct sign_curve *sc,
-                           const struct sigcert *cert, int64_t userid,
-                           time_t now, time_t ctime)
+static int ca_check (flux_security_t *ctx, const cf_t *cf)
 {
-    int64_t cert_max_sign_ttl;
-    int64_t cert_userid;
+    const cf_t *ca_config;
+    struct ca *ca;
     ca_error_t e;
 
-    if (!sc->ca) { // load CA context on first use
-        const cf_t *ca_config;
-        struct ca *ca;
-        ca_error_t e;
-
-        if (!(ca_config = security_get_config (ctx, "ca"))) {
-            security_error (ctx, "sign-curve-verify: [ca] config missing");
-            return -1;
-        }
-        if (!(ca = ca_create (ca_config, e)) || ca_load (ca, false, e)) {
+    if ((ca_config = cf_get_in (cf, "ca"))) {
+        if (!(ca = ca_create (ca_config, e))) {
             security_error (ctx, "sign-curve-verify: ca: %s", e);
-            ca_destroy (ca);
             return -1;
         }
-        sc->ca = ca;
+        ca_destroy (ca);
+    }
+    return 0;
+}
+
+/* Get the CA context used to verify certs, loading it on first use.
+ * It is kept apart from the signing state, so that a [ca] change does
+ * not drop the signing cert or agent connection, and vice versa.
+ * Return the CA context, or NULL on failure with ctx error set.
+ */
+static struct ca *get_ca (flux_security_t *ctx)
+{
+    static const char *const deps[] = {
+        "ca",
+        NULL,
+    };
+    struct ca *ca = flux_security_aux_get (ctx, ca_auxname);
+    const cf_t *ca_config;
+    ca_error_t e;
+
+    if (ca != NULL)
+        return ca;
+    if (!(ca_config = security_get_config (ctx, "ca"))) {
+        security_error (ctx, "sign-curve-verify: [ca] config missing");
+        return NULL;
+    }
+    if (!(ca = ca_create (ca_config, e)) || ca_load (ca, false, e) < 0) {
+        security_error (ctx, "sign-curve-verify: ca: %s", e);
+        ca_destroy (ca);
+        return NULL;
+    }
+    if (security_aux_set_config (ctx, ca_auxname, ca,
+                                 (flux_security_free_f)ca_destroy,
+                                 deps, ca_check, NULL) < 0) {
+        ca_destroy (ca);
+        return NULL;
     }
-    if (ca_verify (sc->ca, cert, &cert_userid, &cert_max_sign_ttl, e) < 0) {
+    return ca;
+}
+
+/* Verify that cert authenticates userid, because it was signed by the CA,
+ * and the cert contains the same userid.  On success, reduce *xtimep
+ * to the end of the cert's max-sign-ttl, or to the expiration of the cert
+ * or any CA cert in its chain, whichever is earliest.
+ */
+static int verify_cert_ca (flux_security_t *ctx, const struct sigcert *cert,
+                           int64_t userid, time_t now, time_t ctime,
+                           time_t *xtimep)
+{
+    int64_t cert_max_sign_ttl;
+    int64_t cert_userid;
+    time_t cert_xtime;
+    struct ca *ca;
+    ca_error_t e;
+
+    if (!(ca = get_ca (ctx)))
+        return -1;
+    if (ca_verify (ca, cert, &cert_userid, &cert_max_sign_ttl,
+                   &cert_xtime, e) < 0) {
         security_error (ctx, "sign-curve-verify: ca: %s", e);
         return -1;
     }
@@ -264,6 +545,10 @@ static int verify_cert_ca (flux_security_t *ctx, struct sign_curve *sc,
         security_error (ctx, "sign-curve-verify: ca: max-sign-ttl exceeded");
         return -1;
     }
+    if (ctime + cert_max_sign_ttl < *xtimep)
+        *xtimep = ctime + cert_max_sign_ttl;
+    if (cert_xtime < *xtimep)
+        *xtimep = cert_xtime;
     return 0;
 }
 
@@ -275,13 +560,14 @@ static int verify_cert_ca (flux_security_t *ctx, struct sign_curve *sc,
  */
 static int op_verify (flux_security_t *ctx, const struct kv *header,
                       const char *input, int inputsz,
-                      const char *signature, int flags)
+                      const char *signature, int flags, time_t *xtimep)
 {
     struct sign_curve *sc = flux_security_aux_get (ctx, auxname);
     struct sigcert *cert = NULL;
     time_t now;
     time_t ctime;
     time_t xtime;
+    time_t valid_until;
     int64_t userid;
 
     assert (sc != NULL);
@@ -301,8 +587,9 @@ static int op_verify (flux_security_t *ctx, const struct kv *header,
         security_error (ctx, "sign-curve-verify: verification failure");
         goto error_nomsg;
     }
-    if (cf_bool (cf_get_in (sc->curve_config, "require-ca"))) {
-        if (verify_cert_ca (ctx, sc, cert, userid, now, ctime) < 0)
+    valid_until = xtime < ctime + sc->max_ttl ? xtime : ctime + sc->max_ttl;
+    if (sc->require_ca) {
+        if (verify_cert_ca (ctx, cert, userid, now, ctime, &valid_until) < 0)
             goto error_nomsg;
     }
     else {          // require-ca = false
@@ -319,6 +606,7 @@ static int op_verify (flux_security_t *ctx, const struct kv *header,
         security_error (ctx, "sign-curve-verify: ctime is in the future");
         goto error_nomsg;
     }
+    *xtimep = valid_until;
     return 0;
 error:
     security_error (ctx, NULL);
@@ -0,0 +1,340 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* sign_hmac.c - shared secret signing mechanism
+ *
+ * HEADER.PAYLOAD is authenticated with a keyed hash (keyed BLAKE2b or
+ * HMAC-SHA256), using a key file shared by all signers and verifiers.
+ * Any holder of the key can sign for any userid, so this mechanism is
+ * only suitable for traffic between trusted services.
+ */
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+#include <sodium.h>
+
+#include "context.h"
+#include "context_private.h"
+#include "sign.h"
+#include "sign_mech.h"
+
+/* Both hash types produce a 32 byte MAC.
+ */
+#define HMAC_SIZE       crypto_auth_hmacsha256_BYTES
+
+/* Key file size limits.  The upper limit is the maximum BLAKE2b key size.
+ */
+#define HMAC_KEY_MIN    32
+#define HMAC_KEY_MAX    crypto_generichash_KEYBYTES_MAX
+
+struct sign_hmac {
+    unsigned char key[HMAC_KEY_MAX];
+    size_t keysz;
+    int64_t max_ttl;
+    const char *hash_type;      // hash type used for signing
+};
+
+static const struct cf_option hmac_opts[] = {
+    {"key-path",        CF_STRING,      true},
+    {"hash-type",       CF_STRING,      false},
+    CF_OPTIONS_TABLE_END,
+};
+
+static const char *auxname = "flux::sign_hmac";
+
+static void sh_destroy (struct sign_hmac *sh)
+{
+    if (sh) {
+        sodium_memzero (sh->key, sizeof (sh->key));
+        free (sh);
+    }
+}
+
+/* Read key from 'path', which must be a regular file not accessible
+ * by other users.
+ */
+static int load_key (flux_security_t *ctx, struct sign_hmac *sh,
+                     const char *path)
+{
+    struct stat sb;
+    ssize_t n;
+    int fd;
+
+    if ((fd = open (path, O_RDONLY)) < 0) {
+        security_error (ctx, "sign-hmac-init: %s: %s", path, strerror (errno));
+        return -1;
+    }
+    if (fstat (fd, &sb) < 0) {
+        security_error (ctx, "sign-hmac-init: %s: %s", path, strerror (errno));
+        goto error;
+    }
+    if (!S_ISREG (sb.st_mode) || (sb.st_mode & S_IRWXO)) {
+        errno = EPERM;
+        security_error (ctx, "sign-hmac-init: %s: key must be a regular file"
+                        " not accessible by other users", path);
+        goto error;
+    }
+    if (sb.st_size < HMAC_KEY_MIN || sb.st_size > HMAC_KEY_MAX) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-init: %s: key must be %d-%d bytes",
+                        path, HMAC_KEY_MIN, HMAC_KEY_MAX);
+        goto error;
+    }
+    if ((n = read (fd, sh->key, sb.st_size)) != sb.st_size) {
+        if (n >= 0)
+            errno = EIO;
+        security_error (ctx, "sign-hmac-init: %s: %s", path, strerror (errno));
+        goto error;
+    }
+    sh->keysz = n;
+    (void)close (fd);
+    return 0;
+error:
+    (void)close (fd);
+    return -1;
+}
+
+/* Bind and validate [sign] table 'cf' into 'sh', and load the key.
+ * Return 0 on success, -1 on failure with errno and ctx error set.
+ */
+static int sh_configure (flux_security_t *ctx, struct sign_hmac *sh,
+                         const cf_t *cf)
+{
+    const cf_t *hmac_config;
+    const cf_t *entry;
+    struct cf_error cfe;
+
+    sh->max_ttl = cf_int64 (cf_get_in (cf, "max-ttl"));
+    if (!(hmac_config = cf_get_in (cf, "hmac"))) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-init: [sign.hmac] config missing");
+        return -1;
+    }
+    if (cf_check (hmac_config, hmac_opts, CF_STRICT, &cfe) < 0) {
+        security_error (ctx, "sign-hmac-init: %s", cfe.errbuf);
+        return -1;
+    }
+    sh->hash_type = "blake2b";
+    if ((entry = cf_get_in (hmac_config, "hash-type"))) {
+        sh->hash_type = cf_string (entry);
+        if (strcmp (sh->hash_type, "blake2b") != 0
+                && strcmp (sh->hash_type, "sha256") != 0) {
+            errno = EINVAL;
+            security_error (ctx, "sign-hmac-init: unknown hash-type '%s'",
+                            sh->hash_type);
+            return -1;
+        }
+    }
+    return load_key (ctx, sh, cf_string (cf_get_in (hmac_config, "key-path")));
+}
+
+/* Validate new configuration 'cf' for flux_security_reconfigure(),
+ * including that the key can be loaded.
+ */
+static int op_check (flux_security_t *ctx, const cf_t *cf)
+{
+    struct sign_hmac sh;
+    int rc;
+
+    memset (&sh, 0, sizeof (sh));
+    rc = sh_configure (ctx, &sh, cf_get_in (cf, "sign"));
+    sodium_memzero (sh.key, sizeof (sh.key));
+    return rc;
+}
+
+/* Update max-ttl in place for flux_security_reconfigure().
+ */
+static void op_refresh (flux_security_t *ctx, void *data, const cf_t *cf)
+{
+    struct sign_hmac *sh = data;
+
+    sh->max_ttl = cf_int64 (cf_get_in (cf_get_in (cf, "sign"), "max-ttl"));
+}
+
+/* init - one time mechanism initialization
+ */
+static int op_init (flux_security_t *ctx, const cf_t *cf)
+{
+    static const char *const deps[] = {
+        "sign.hmac",
+        NULL,
+    };
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+
+    if (sh != NULL)
+        return 0;
+    if (!(sh = calloc (1, sizeof (*sh))))
+        goto error;
+    if (sh_configure (ctx, sh, cf) < 0)
+        goto error_nomsg;
+    if (security_aux_set_config (ctx, auxname, sh,
+                                 (flux_security_free_f)sh_destroy,
+                                 deps, op_check, op_refresh) < 0)
+        goto error;
+    return 0;
+error:
+    security_error (ctx, NULL);
+error_nomsg:
+    sh_destroy (sh);
+    return -1;
+}
+
+/* Compute MAC of 'input' with hash 'type'.
+ * Return 0 on success, -1 on unknown type.
+ */
+static int compute_mac (struct sign_hmac *sh, const char *type,
+                        const char *input, int inputsz,
+                        unsigned char mac[HMAC_SIZE])
+{
+    if (!strcmp (type, "blake2b"))
+        return crypto_generichash (mac, HMAC_SIZE,
+                                   (const unsigned char *)input, inputsz,
+                                   sh->key, sh->keysz);
+    if (!strcmp (type, "sha256")) {
+        crypto_auth_hmacsha256_state state;
+
+        crypto_auth_hmacsha256_init (&state, sh->key, sh->keysz);
+        crypto_auth_hmacsha256_update (&state, (const unsigned char *)input,
+                                       inputsz);
+        crypto_auth_hmacsha256_final (&state, mac);
+        sodium_memzero (&state, sizeof (state));
+        return 0;
+    }
+    return -1;
+}
+
+/* prep - add to security header
+ *   hmac.hash     hash type
+ *   hmac.ctime    signature creation time
+ */
+static int op_prep (flux_security_t *ctx, struct kv *header, int flags)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    time_t ctime;
+
+    assert (sh != NULL);
+
+    if ((ctime = time (NULL)) == (time_t)-1
+            || kv_put (header, "hmac.hash", KV_STRING, sh->hash_type) < 0
+            || kv_put (header, "hmac.ctime", KV_TIMESTAMP, ctime) < 0) {
+        security_error (ctx, NULL);
+        return -1;
+    }
+    return 0;
+}
+
+/* sign - compute MAC over HEADER.PAYLOAD, returned as base64 string
+ */
+static char *op_sign (flux_security_t *ctx,
+                      const char *input, int inputsz, int flags)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    unsigned char mac[HMAC_SIZE];
+    size_t sigsz = sodium_base64_ENCODED_LEN (HMAC_SIZE,
+                                              sodium_base64_VARIANT_ORIGINAL);
+    char *sig;
+
+    assert (sh != NULL);
+
+    if (compute_mac (sh, sh->hash_type, input, inputsz, mac) < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-sign: hash failed");
+        return NULL;
+    }
+    if (!(sig = malloc (sigsz))) {
+        security_error (ctx, NULL);
+        return NULL;
+    }
+    sodium_bin2base64 (sig, sigsz, mac, HMAC_SIZE,
+                       sodium_base64_VARIANT_ORIGINAL);
+    return sig;
+}
+
+/* verify - verify HEADER.PAYLOAD.SIGNATURE, e.g.
+ * - SIGNATURE is the MAC of HEADER.PAYLOAD with the shared key
+ * - ctime plus configured max-ttl has not passed
+ * Either hash type is accepted, regardless of configured hash-type.
+ */
+static int op_verify (flux_security_t *ctx, const struct kv *header,
+                      const char *input, int inputsz,
+                      const char *signature, int flags, time_t *xtimep)
+{
+    struct sign_hmac *sh = flux_security_aux_get (ctx, auxname);
+    unsigned char mac[HMAC_SIZE];
+    unsigned char refmac[HMAC_SIZE];
+    size_t macsz;
+    const char *type;
+    time_t ctime;
+    time_t now;
+
+    assert (sh != NULL);
+
+    if ((now = time (NULL)) == (time_t)-1) {
+        security_error (ctx, NULL);
+        return -1;
+    }
+    if (kv_get (header, "hmac.hash", KV_STRING, &type) < 0
+            || kv_get (header, "hmac.ctime", KV_TIMESTAMP, &ctime) < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: incomplete header");
+        return -1;
+    }
+    if (sodium_base642bin (mac, sizeof (mac), signature, strlen (signature),
+                           NULL, &macsz, NULL,
+                           sodium_base64_VARIANT_ORIGINAL) < 0
+            || macsz != HMAC_SIZE) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: malformed signature");
+        return -1;
+    }
+    if (compute_mac (sh, type, input, inputsz, refmac) < 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: unknown hash type");
+        return -1;
+    }
+    if (sodium_memcmp (mac, refmac, HMAC_SIZE) != 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: verification failure");
+        return -1;
+    }
+    if (ctime + sh->max_ttl < now) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: max-ttl exceeded");
+        return -1;
+    }
+    if (ctime > now) {
+        errno = EINVAL;
+        security_error (ctx, "sign-hmac-verify: ctime is in the future");
+        return -1;
+    }
+    *xtimep = ctime + sh->max_ttl;
+    return 0;
+}
+
+const struct sign_mech sign_mech_hmac = {
+    .name = "hmac",
+    .init = op_init,
+    .prep = op_prep,
+    .sign = op_sign,
+    .verify = op_verify,
+};
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -11,6 +11,8 @@
 #ifndef _FLUX_SECURITY_SIGN_MECH_H
 #define _FLUX_SECURITY_SIGN_MECH_H
 
+#include <time.h>
+
 #include "sign.h"
 
 #include "src/libutil/cf.h"
@@ -55,12 +57,49 @@ typedef char *(*sign_mech_sign_f)(flux_security_t *ctx,
  * input/inputsz (input != NULL, inputsz > 0).
  * Parsed security 'header' is provided for access to mechanism specific
  * data, if any, as well as claimed 'userid' value for verification.
+ * On success, the mechanism may set '*xtime' to the last time at which
+ * the signature would still verify, allowing the result to be cached in
+ * the node's verification cache until then.  If left at 0, the result is
+ * not cached, e.g. because it depends on the verifying process.
  * Return 0 on success, or -1 on error with errno and context error set.
  */
 typedef int (*sign_mech_verify_f)(flux_security_t *ctx,
                                   const struct kv *header,
 				  const char *input, int inputsz,
-				  const char *signature, int flags);
+				  const char *signature, int flags,
+				  time_t *xtime);
+
+/* An entry for the batch callbacks below.
+ */
+struct sign_mech_item {
+    const struct kv *header;    // verify: parsed security header
+    const char *input;          // HEADER.PAYLOAD
+    int inputsz;
+    const char *signature;      // verify: signature over input
+    char *sig;                  // sign: signature the caller must free
+    time_t xtime;               // verify: as for verify '*xtime'
+    int errnum;                 // 0 on success, otherwise errno
+};
+
+/* sign_batch (optional)
+ * Sign each of 'count' items as sign would, setting 'sig', or on failure,
+ * 'errnum' and the context error.  This lets the mechanism keep several
+ * requests in flight.  If undefined, sign is called for each item in turn.
+ * Return 0 if all items were signed, or -1 if any failed.
+ */
+typedef int (*sign_mech_sign_batch_f)(flux_security_t *ctx,
+                                      struct sign_mech_item *items,
+                                      int count, int flags);
+
+/* verify_batch (optional)
+ * Verify each of 'count' items as verify would, setting 'xtime', or on
+ * failure, 'errnum' and the context error.  If undefined, verify is called
+ * for each item in turn.
+ * Return 0 if all items were verified, or -1 if any failed.
+ */
+typedef int (*sign_mech_verify_batch_f)(flux_security_t *ctx,
+                                        struct sign_mech_item *items,
+                                        int count, int flags);
 
 struct sign_mech {
     const char *name;
@@ -68,10 +107,13 @@ struct sign_mech {
     sign_mech_prep_f prep;
     sign_mech_sign_f sign;
     sign_mech_verify_f verify;
+    sign_mech_sign_batch_f sign_batch;
+    sign_mech_verify_batch_f verify_batch;
 };
 
 extern const struct sign_mech sign_mech_none;
 extern const struct sign_mech sign_mech_munge;
 extern const struct sign_mech sign_mech_curve;
+extern const struct sign_mech sign_mech_hmac;
 
 #endif /* !_FLUX_SECURITY_SIGN_MECH_H */
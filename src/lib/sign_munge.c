@@ -11,29 +11,141 @@
 #if HAVE_CONFIG_H
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
+#include <sys/types.h>
+#include <unistd.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
 #include <errno.h>
 #include <string.h>
+#include <pthread.h>
 #include <munge.h>
+#include <sodium.h>
 #include <assert.h>
 
 #include "src/libutil/sha256.h"
+#include "src/libutil/hash.h"
+#include "src/libutil/treehash.h"
 
 #include "context.h"
 #include "context_private.h"
 #include "sign.h"
 #include "sign_mech.h"
 
-struct sign_munge {
-    munge_ctx_t munge;
-    int64_t max_ttl;
-};
-
 /* Single byte codes to indicate hash type used.
  */
 enum {
     HASH_TYPE_INVALID = 0,
     HASH_TYPE_SHA256 = 1,
+    HASH_TYPE_BLAKE2B = 2,
+    HASH_TYPE_TREE_SHA256 = 3,
+};
+
+/* All hash types produce a 32 byte digest.
+ */
+#define HASH_SIZE       SHA256_BLOCK_SIZE
+
+/* Inputs at least this large are hashed on the worker thread when
+ * async-hash is enabled.  Below this, thread handoff costs more than
+ * the overlap saves.
+ */
+#define ASYNC_HASH_MIN  16384
+
+/* Default and maximum number of munge_pool threads.  The default matches
+ * munged's default number of worker threads.
+ */
+#define BATCH_THREADS_DEFAULT   2
+#define BATCH_THREADS_MAX       64
+
+/* A worker thread that computes the hash of verify input while
+ * the calling thread waits for munged to decode the credential.
+ *
+ * N.B. flux_sign_wrap() and flux_sign_unwrap() have at most one request
+ * outstanding at munged.  The batch interface keeps several in flight
+ * on a munge_pool, below.
+ */
+struct hash_worker {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pid_t pid;                  // process that started the thread
+    bool shutdown;
+    bool pending;               // request posted and not yet completed
+    int type;
+    const BYTE *input;
+    int inputsz;
+    BYTE digest[HASH_SIZE];
+};
+
+struct munge_job;
+typedef void (*munge_job_f)(struct munge_job *job, munge_ctx_t munge);
+
+/* A request to munged, made on a munge_pool thread with its own
+ * munge context.  'digest' is the credential payload for encode, and
+ * for decode, the hash of the input computed meanwhile by the caller.
+ */
+struct munge_job {
+    munge_job_f run;
+    BYTE digest[HASH_SIZE + 1];
+    const char *cred;           // decode: credential to decode
+    char *outcred;              // encode: credential (caller frees)
+    void *outdigest;            // decode: payload (caller frees)
+    int outdigestsz;
+    uid_t uid;                  // decode: credential uid
+    time_t encode_time;         // decode: credential encode time
+    bool failed;
+    char errstr[256];
+    bool done;
+};
+
+struct munge_pool_thread {
+    pthread_t thread;
+    munge_ctx_t munge;
+    struct munge_pool *pool;
+};
+
+/* Threads that run the jobs of a batch, so that up to 'nthreads' requests
+ * are in flight at munged at once.  Jobs are started in the order they
+ * were posted and may finish in any order.
+ */
+struct munge_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        // jobs posted, or shutdown
+    pthread_cond_t done_cond;   // a job finished
+    pid_t pid;                  // process that started the threads
+    bool shutdown;
+    struct munge_job **jobs;
+    int posted;                 // jobs[0..posted-1] may be started
+    int next;                   // next job to start
+    int nthreads;
+    struct munge_pool_thread threads[];
+};
+
+/* Decoded munge credentials are cached, keyed by the SHA-256 hash of the
+ * credential string, so that verifying the same envelope again need not
+ * contact munged.  Entries are dropped once max-ttl has elapsed since the
+ * credential was encoded, since verification would fail anyway.
+ */
+#define CRED_CACHE_MAX  1024
+
+struct cred_entry {
+    BYTE key[SHA256_BLOCK_SIZE];
+    uid_t uid;
+    time_t encode_time;
+    int digestsz;
+    char digest[];
+};
+
+struct sign_munge {
+    munge_ctx_t munge;
+    int64_t max_ttl;
+    int hash_type;              // hash type used for signing
+    bool async_hash;
+    struct hash_worker *worker;
+    hash_t cache;
+    char *socket_path;
+    int batch_threads;
+    struct munge_pool *pool;
 };
 
 /* [sign.munge] table is optional since it contains
@@ -41,15 +153,396 @@ enum {
  */
 static const struct cf_option munge_opts[] = {
     {"socket-path",     CF_STRING,      false},
+    {"async-hash",      CF_BOOL,        false},
+    {"hash-type",       CF_STRING,      false},
+    {"batch-threads",   CF_INT64,       false},
     CF_OPTIONS_TABLE_END,
 };
 
 static const char *auxname = "flux::sign_munge";
 
+static const char *hash_type_name (int type)
+{
+    switch (type) {
+        case HASH_TYPE_SHA256:
+            return "SHA256";
+        case HASH_TYPE_BLAKE2B:
+            return "BLAKE2B";
+        case HASH_TYPE_TREE_SHA256:
+            return "TREE-SHA256";
+    }
+    return "unknown";
+}
+
+/* Compute 'type' hash of input into HASH_SIZE 'digest'.
+ */
+static void compute_hash (int type, const BYTE *input, int inputsz,
+                          BYTE *digest)
+{
+    switch (type) {
+        case HASH_TYPE_SHA256: {
+            SHA256_CTX shx;
+
+            sha256_init (&shx);
+            sha256_update (&shx, input, inputsz);
+            sha256_final (&shx, digest);
+            break;
+        }
+        case HASH_TYPE_BLAKE2B:
+            crypto_generichash (digest, HASH_SIZE, input, inputsz, NULL, 0);
+            break;
+        case HASH_TYPE_TREE_SHA256:
+            treehash_sha256 (input, inputsz, 0, digest);
+            break;
+        default:
+            assert (0);
+    }
+}
+
+static void *hash_worker_thread (void *arg)
+{
+    struct hash_worker *w = arg;
+
+    pthread_mutex_lock (&w->lock);
+    for (;;) {
+        while (!w->pending && !w->shutdown)
+            pthread_cond_wait (&w->cond, &w->lock);
+        if (w->shutdown)
+            break;
+        pthread_mutex_unlock (&w->lock);
+
+        compute_hash (w->type, w->input, w->inputsz, w->digest);
+
+        pthread_mutex_lock (&w->lock);
+        w->pending = false;
+        pthread_cond_broadcast (&w->cond);
+    }
+    pthread_mutex_unlock (&w->lock);
+    return NULL;
+}
+
+/* N.B. After fork, the thread exists only in the parent.
+ * The child leaks the worker rather than waiting on a thread that is gone.
+ */
+static void hash_worker_destroy (struct hash_worker *w)
+{
+    if (w && w->pid == getpid ()) {
+        int saved_errno = errno;
+        pthread_mutex_lock (&w->lock);
+        w->shutdown = true;
+        pthread_cond_broadcast (&w->cond);
+        pthread_mutex_unlock (&w->lock);
+        (void)pthread_join (w->thread, NULL);
+        pthread_cond_destroy (&w->cond);
+        pthread_mutex_destroy (&w->lock);
+        free (w);
+        errno = saved_errno;
+    }
+}
+
+static struct hash_worker *hash_worker_create (void)
+{
+    struct hash_worker *w;
+    int e;
+
+    if (!(w = calloc (1, sizeof (*w))))
+        return NULL;
+    pthread_mutex_init (&w->lock, NULL);
+    pthread_cond_init (&w->cond, NULL);
+    w->pid = getpid ();
+    if ((e = pthread_create (&w->thread, NULL, hash_worker_thread, w))) {
+        pthread_cond_destroy (&w->cond);
+        pthread_mutex_destroy (&w->lock);
+        free (w);
+        errno = e;
+        return NULL;
+    }
+    return w;
+}
+
+/* Post input to the worker thread, if async-hash is enabled and input
+ * is large enough.  If this returns true, hash_async_wait() must be called
+ * before 'input' is released.  On any problem, return false so the caller
+ * hashes synchronously.
+ */
+static bool hash_async_start (struct sign_munge *sm,
+                              const char *input, int inputsz)
+{
+    struct hash_worker *w;
+
+    if (!sm->async_hash || inputsz < ASYNC_HASH_MIN)
+        return false;
+    if (sm->worker && sm->worker->pid != getpid ())
+        sm->worker = NULL; // forked: thread belongs to parent
+    if (!sm->worker && !(sm->worker = hash_worker_create ()))
+        return false;
+    w = sm->worker;
+    pthread_mutex_lock (&w->lock);
+    w->type = sm->hash_type;
+    w->input = (const BYTE *)input;
+    w->inputsz = inputsz;
+    w->pending = true;
+    pthread_cond_broadcast (&w->cond);
+    pthread_mutex_unlock (&w->lock);
+    return true;
+}
+
+static void hash_async_wait (struct sign_munge *sm, BYTE *digest)
+{
+    struct hash_worker *w = sm->worker;
+
+    pthread_mutex_lock (&w->lock);
+    while (w->pending)
+        pthread_cond_wait (&w->cond, &w->lock);
+    memcpy (digest, w->digest, HASH_SIZE);
+    pthread_mutex_unlock (&w->lock);
+}
+
+static void *munge_pool_thread (void *arg)
+{
+    struct munge_pool_thread *t = arg;
+    struct munge_pool *p = t->pool;
+    struct munge_job *job;
+
+    pthread_mutex_lock (&p->lock);
+    for (;;) {
+        while (p->next >= p->posted && !p->shutdown)
+            pthread_cond_wait (&p->cond, &p->lock);
+        if (p->shutdown)
+            break;
+        job = p->jobs[p->next++];
+        pthread_mutex_unlock (&p->lock);
+
+        job->run (job, t->munge);
+
+        pthread_mutex_lock (&p->lock);
+        job->done = true;
+        pthread_cond_broadcast (&p->done_cond);
+    }
+    pthread_mutex_unlock (&p->lock);
+    return NULL;
+}
+
+/* Stop and join the first 'count' threads of 'p', then free it.
+ */
+static void munge_pool_free (struct munge_pool *p, int count)
+{
+    int i;
+
+    pthread_mutex_lock (&p->lock);
+    p->shutdown = true;
+    pthread_cond_broadcast (&p->cond);
+    pthread_mutex_unlock (&p->lock);
+    for (i = 0; i < count; i++)
+        (void)pthread_join (p->threads[i].thread, NULL);
+    for (i = 0; i < p->nthreads; i++) {
+        if (p->threads[i].munge)
+            munge_ctx_destroy (p->threads[i].munge);
+    }
+    pthread_cond_destroy (&p->done_cond);
+    pthread_cond_destroy (&p->cond);
+    pthread_mutex_destroy (&p->lock);
+    free (p);
+}
+
+/* N.B. After fork, the threads exist only in the parent.
+ * The child leaks the pool rather than waiting on threads that are gone.
+ */
+static void munge_pool_destroy (struct munge_pool *p)
+{
+    if (p && p->pid == getpid ()) {
+        int saved_errno = errno;
+        munge_pool_free (p, p->nthreads);
+        errno = saved_errno;
+    }
+}
+
+/* Create a pool of 'nthreads' threads, whose munge contexts use
+ * 'socket_path' if non-NULL.
+ * Return pool on success, NULL on failure with errno set.
+ */
+static struct munge_pool *munge_pool_create (int nthreads,
+                                             const char *socket_path)
+{
+    struct munge_pool *p;
+    int started = 0;
+    int i;
+    int e;
+
+    if (!(p = calloc (1, sizeof (*p) + nthreads * sizeof (p->threads[0]))))
+        return NULL;
+    pthread_mutex_init (&p->lock, NULL);
+    pthread_cond_init (&p->cond, NULL);
+    pthread_cond_init (&p->done_cond, NULL);
+    p->pid = getpid ();
+    p->nthreads = nthreads;
+    for (i = 0; i < nthreads; i++) {
+        struct munge_pool_thread *t = &p->threads[i];
+
+        t->pool = p;
+        if (!(t->munge = munge_ctx_create ())) {
+            e = ENOMEM;
+            goto error;
+        }
+        if (socket_path && munge_ctx_set (t->munge, MUNGE_OPT_SOCKET,
+                                          socket_path) != EMUNGE_SUCCESS) {
+            e = EINVAL;
+            goto error;
+        }
+    }
+    for (i = 0; i < nthreads; i++) {
+        e = pthread_create (&p->threads[i].thread, NULL,
+                            munge_pool_thread, &p->threads[i]);
+        if (e)
+            goto error;
+        started++;
+    }
+    return p;
+error:
+    munge_pool_free (p, started);
+    errno = e;
+    return NULL;
+}
+
+/* Begin a batch of 'jobs', none of which may be started until posted.
+ * Every posted job must be waited on before 'jobs' is released.
+ */
+static void munge_pool_start (struct munge_pool *p, struct munge_job **jobs)
+{
+    pthread_mutex_lock (&p->lock);
+    p->jobs = jobs;
+    p->posted = 0;
+    p->next = 0;
+    pthread_mutex_unlock (&p->lock);
+}
+
+/* Allow jobs[0..count-1] of the current batch to be started.
+ */
+static void munge_pool_post (struct munge_pool *p, int count)
+{
+    pthread_mutex_lock (&p->lock);
+    p->posted = count;
+    pthread_cond_broadcast (&p->cond);
+    pthread_mutex_unlock (&p->lock);
+}
+
+static void munge_pool_wait (struct munge_pool *p, struct munge_job *job)
+{
+    pthread_mutex_lock (&p->lock);
+    while (!job->done)
+        pthread_cond_wait (&p->done_cond, &p->lock);
+    pthread_mutex_unlock (&p->lock);
+}
+
+/* Return the pool for batches, creating it on first use.
+ * Return NULL on failure with errno set.
+ */
+static struct munge_pool *get_pool (struct sign_munge *sm)
+{
+    if (sm->pool && sm->pool->pid != getpid ())
+        sm->pool = NULL; // forked: threads belong to parent
+    if (!sm->pool)
+        sm->pool = munge_pool_create (sm->batch_threads, sm->socket_path);
+    return sm->pool;
+}
+
+static void job_encode (struct munge_job *job, munge_ctx_t munge)
+{
+    munge_err_t e;
+
+    e = munge_encode (&job->outcred, munge, job->digest, sizeof (job->digest));
+    if (e != EMUNGE_SUCCESS) {
+        job->failed = true;
+        snprintf (job->errstr, sizeof (job->errstr), "%s",
+                  munge_ctx_strerror (munge));
+    }
+}
+
+static void job_decode (struct munge_job *job, munge_ctx_t munge)
+{
+    munge_err_t e;
+
+    e = munge_decode (job->cred, munge, &job->outdigest, &job->outdigestsz,
+                      &job->uid, NULL);
+    if (e != EMUNGE_SUCCESS && e != EMUNGE_CRED_REPLAYED
+                            && e != EMUNGE_CRED_EXPIRED) {
+        job->failed = true;
+        snprintf (job->errstr, sizeof (job->errstr), "munge_decode: %s",
+                  munge_ctx_strerror (munge));
+        return;
+    }
+    e = munge_ctx_get (munge, MUNGE_OPT_ENCODE_TIME, &job->encode_time);
+    if (e != EMUNGE_SUCCESS) {
+        job->failed = true;
+        snprintf (job->errstr, sizeof (job->errstr),
+                  "munge_ctx_get ENCODE_TIME: %s",
+                  munge_ctx_strerror (munge));
+    }
+}
+
+static unsigned int cred_key_hash (const BYTE *key)
+{
+    unsigned int h;
+
+    memcpy (&h, key, sizeof (h)); // key is already a uniform hash
+    return h;
+}
+
+static int cred_key_cmp (const BYTE *key1, const BYTE *key2)
+{
+    return memcmp (key1, key2, SHA256_BLOCK_SIZE);
+}
+
+static int cred_expired (struct cred_entry *entry, const void *key,
+                         time_t *expire_time)
+{
+    return entry->encode_time < *expire_time;
+}
+
+static void cred_key (const char *signature, BYTE *key)
+{
+    SHA256_CTX shx;
+
+    sha256_init (&shx);
+    sha256_update (&shx, (const BYTE *)signature, strlen (signature));
+    sha256_final (&shx, key);
+}
+
+/* Cache a decoded credential.  If the cache is full, drop expired entries,
+ * or if there are none, start over.  Failure to cache is not an error.
+ */
+static void cred_cache_put (struct sign_munge *sm, const BYTE *key,
+                            uid_t uid, time_t encode_time,
+                            const char *digest, int digestsz, time_t now)
+{
+    struct cred_entry *entry;
+
+    if (hash_count (sm->cache) >= CRED_CACHE_MAX) {
+        time_t expire_time = now - sm->max_ttl;
+        if (hash_delete_if (sm->cache, (hash_arg_f)cred_expired,
+                            &expire_time) == 0)
+            hash_reset (sm->cache);
+    }
+    if (!(entry = calloc (1, sizeof (*entry) + digestsz)))
+        return;
+    memcpy (entry->key, key, sizeof (entry->key));
+    entry->uid = uid;
+    entry->encode_time = encode_time;
+    entry->digestsz = digestsz;
+    memcpy (entry->digest, digest, digestsz);
+    if (!hash_insert (sm->cache, entry->key, entry))
+        free (entry);
+}
+
 static void sm_destroy (struct sign_munge *sm)
 {
     if (sm) {
         int saved_errno = errno;
+        if (sm->cache)
+            hash_destroy (sm->cache);
+        hash_worker_destroy (sm->worker);
+        munge_pool_destroy (sm->pool);
+        free (sm->socket_path);
         if (sm->munge)
             munge_ctx_destroy (sm->munge);
         free (sm);
@@ -57,34 +550,102 @@ static void sm_destroy (struct sign_munge *sm)
     }
 }
 
-static int op_init (flux_security_t *ctx, const cf_t *cf)
+/* Bind and validate [sign] table 'cf' into 'sm'.  The socket path,
+ * if configured, is assigned to 'socket_path'.
+ * Return 0 on success, -1 on failure with errno and ctx error set.
+ */
+static int sm_configure (flux_security_t *ctx, struct sign_munge *sm,
+                         const cf_t *cf, const char **socket_path)
 {
-    struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
     const cf_t *munge_config;
-    const char *socket_path = NULL;
+    const char *hash_type = NULL;
 
-    if (sm != NULL)
-        return 0;
-    if (!(sm = calloc (1, sizeof (*sm))))
-        goto error;
-    if (!(sm->munge = munge_ctx_create ()))
-        goto error;
-    if (flux_security_aux_set (ctx, auxname, sm,
-                               (flux_security_free_f)sm_destroy) < 0)
-        goto error;
     sm->max_ttl = cf_int64 (cf_get_in (cf, "max-ttl"));
+    sm->batch_threads = BATCH_THREADS_DEFAULT;
     if ((munge_config = cf_get_in (cf, "munge"))) {
         struct cf_error cfe;
         const cf_t *entry;
         if (cf_check (munge_config, munge_opts, CF_STRICT, &cfe) < 0) {
             security_error (ctx, "sign-munge-init: %s", cfe.errbuf);
-            goto error_nomsg;
+            return -1;
         }
         if ((entry = cf_get_in (munge_config, "socket-path")))
-            socket_path = cf_string (entry);
+            *socket_path = cf_string (entry);
+        if ((entry = cf_get_in (munge_config, "async-hash")))
+            sm->async_hash = cf_bool (entry);
+        if ((entry = cf_get_in (munge_config, "hash-type")))
+            hash_type = cf_string (entry);
+        if ((entry = cf_get_in (munge_config, "batch-threads"))) {
+            int64_t n = cf_int64 (entry);
+            if (n < 1 || n > BATCH_THREADS_MAX) {
+                errno = EINVAL;
+                security_error (ctx, "sign-munge-init: batch-threads must be "
+                                "from 1 to %d", BATCH_THREADS_MAX);
+                return -1;
+            }
+            sm->batch_threads = n;
+        }
+    }
+    if (!hash_type || !strcmp (hash_type, "sha256"))
+        sm->hash_type = HASH_TYPE_SHA256;
+    else if (!strcmp (hash_type, "blake2b"))
+        sm->hash_type = HASH_TYPE_BLAKE2B;
+    else if (!strcmp (hash_type, "tree-sha256"))
+        sm->hash_type = HASH_TYPE_TREE_SHA256;
+    else {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-init: unknown hash-type '%s'",
+                        hash_type);
+        return -1;
     }
+    return 0;
+}
+
+/* Validate new configuration 'cf' for flux_security_reconfigure().
+ */
+static int op_check (flux_security_t *ctx, const cf_t *cf)
+{
+    struct sign_munge sm;
+    const char *socket_path = NULL;
+
+    memset (&sm, 0, sizeof (sm));
+    return sm_configure (ctx, &sm, cf_get_in (cf, "sign"), &socket_path);
+}
+
+/* Update max-ttl in place for flux_security_reconfigure().
+ */
+static void op_refresh (flux_security_t *ctx, void *data, const cf_t *cf)
+{
+    struct sign_munge *sm = data;
+
+    sm->max_ttl = cf_int64 (cf_get_in (cf_get_in (cf, "sign"), "max-ttl"));
+}
+
+static int op_init (flux_security_t *ctx, const cf_t *cf)
+{
+    static const char *const deps[] = {
+        "sign.munge",
+        NULL,
+    };
+    struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
+    const char *socket_path = NULL;
+
+    if (sm != NULL)
+        return 0;
+    if (!(sm = calloc (1, sizeof (*sm))))
+        goto error;
+    if (!(sm->munge = munge_ctx_create ()))
+        goto error;
+    if (!(sm->cache = hash_create (0, (hash_key_f)cred_key_hash,
+                                      (hash_cmp_f)cred_key_cmp,
+                                      (hash_del_f)free)))
+        goto error;
+    if (sm_configure (ctx, sm, cf, &socket_path) < 0)
+        goto error_nomsg;
     if (socket_path) {
         munge_err_t e;
+        if (!(sm->socket_path = strdup (socket_path)))
+            goto error;
         e = munge_ctx_set (sm->munge, MUNGE_OPT_SOCKET, socket_path);
         if (e != EMUNGE_SUCCESS) {
             security_error (ctx, "sign-munge-init: munge_opt_set %s: %s",
@@ -92,6 +653,10 @@ static int op_init (flux_security_t *ctx, const cf_t *cf)
             goto error_nomsg;
         }
     }
+    if (security_aux_set_config (ctx, auxname, sm,
+                                 (flux_security_free_f)sm_destroy,
+                                 deps, op_check, op_refresh) < 0)
+        goto error;
     return 0;
 error:
     security_error (ctx, NULL);
@@ -108,15 +673,13 @@ static char *op_sign (flux_security_t *ctx,
                       const char *input, int inputsz, int flags)
 {
     struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
-    BYTE digest[SHA256_BLOCK_SIZE + 1] = { HASH_TYPE_SHA256 };
-    SHA256_CTX shx;
+    BYTE digest[HASH_SIZE + 1];
     char *cred;
     munge_err_t e;
 
     assert (sm != NULL);
-    sha256_init (&shx);
-    sha256_update (&shx, (const BYTE *)input, inputsz);
-    sha256_final (&shx, digest + 1);
+    digest[0] = sm->hash_type;
+    compute_hash (sm->hash_type, (const BYTE *)input, inputsz, digest + 1);
     e = munge_encode (&cred, sm->munge, digest, sizeof (digest));
     if (e != EMUNGE_SUCCESS) {
         errno = EINVAL;
@@ -127,80 +690,131 @@ static char *op_sign (flux_security_t *ctx,
     return cred;
 }
 
+/* Check a decoded credential against HEADER.PAYLOAD 'input':
+ * - credential's payload matches the computed hash of input
+ * - security header userid matches credential uid
+ * - encode time plus configured max-ttl is not past.
+ * If non-NULL, 'hash' is the hash of input of the configured hash-type,
+ * already computed.  On success, set '*xtimep' to when max-ttl elapses.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int check_cred (flux_security_t *ctx, struct sign_munge *sm,
+                       const struct kv *header,
+                       const char *input, int inputsz,
+                       const char *digest, int digestsz,
+                       uid_t uid, time_t encode_time,
+                       const BYTE *hash, time_t now, time_t *xtimep)
+{
+    BYTE refdigest[HASH_SIZE + 1];
+    uint64_t userid;
+    int type;
+
+    /* Any hash type is accepted, regardless of configured hash-type.
+     * The precomputed hash is used only if it has the same type.
+     */
+    type = digestsz > 0 ? digest[0] : HASH_TYPE_INVALID;
+    if (type != HASH_TYPE_SHA256 && type != HASH_TYPE_BLAKE2B
+                                 && type != HASH_TYPE_TREE_SHA256) {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-verify: unknown hash type");
+        return -1;
+    }
+    refdigest[0] = type;
+    if (hash && type == sm->hash_type)
+        memcpy (refdigest + 1, hash, HASH_SIZE);
+    else
+        compute_hash (type, (const BYTE *)input, inputsz, refdigest + 1);
+    if (digestsz != sizeof (refdigest)
+                || memcmp (refdigest, digest, digestsz) != 0) {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-verify: %s hash mismatch",
+                        hash_type_name (type));
+        return -1;
+    }
+
+    if (kv_get (header, "userid", KV_INT64, &userid) < 0 || userid != uid) {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-verify: uid mismatch");
+        return -1;
+    }
+    if (encode_time + sm->max_ttl < now) {
+        errno = EINVAL;
+        security_error (ctx, "sign-munge-verify: max-ttl exceeded");
+        return -1;
+    }
+    *xtimep = encode_time + sm->max_ttl;
+    return 0;
+}
+
 /* Recompute hash over HEADER.PAYLOAD portion of input, then munge_decode
- * the SIGNATURE portion of input as a munge cred, and check:
- * - munge cred's payload matches the computed hash
- * - security header userid matches munge cred uid
- * - munge encode time plus configured max-ttl is not past.
+ * the SIGNATURE portion of input as a munge cred, and check it as
+ * described above.  A credential found in the decoded-credential cache
+ * is not sent to munged, but the checks are repeated.
  */
 static int op_verify (flux_security_t *ctx, const struct kv *header,
                       const char *input, int inputsz,
-                      const char *signature, int flags)
+                      const char *signature, int flags, time_t *xtimep)
 {
     struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
     munge_err_t e;
     char *indigest = NULL;
     int indigestsz = 0;
+    const char *digest;
+    int digestsz;
+    BYTE hash[HASH_SIZE];
+    BYTE key[SHA256_BLOCK_SIZE];
+    struct cred_entry *entry;
+    bool async = false;
     uid_t uid;
-    uint64_t userid;
     time_t now;
     time_t encode_time;
     int saved_errno;
 
     assert (sm != NULL);
 
-    e = munge_decode (signature, sm->munge, (void **)&indigest,
-                                                     &indigestsz, &uid, NULL);
-    if (e != EMUNGE_SUCCESS && e != EMUNGE_CRED_REPLAYED
-                            && e != EMUNGE_CRED_EXPIRED) {
-        errno = EINVAL;
-        security_error (ctx, "sign-munge-verify: munge_decode: %s",
-                        munge_ctx_strerror (sm->munge));
+    if ((now = time (NULL)) == (time_t)-1)
         goto error;
+    cred_key (signature, key);
+    if ((entry = hash_find (sm->cache, key))
+                    && entry->encode_time + sm->max_ttl >= now) {
+        uid = entry->uid;
+        encode_time = entry->encode_time;
+        digest = entry->digest;
+        digestsz = entry->digestsz;
     }
-
-    switch (indigestsz > 0 ? indigest[0] : HASH_TYPE_INVALID) {
-        case HASH_TYPE_SHA256: {
-            BYTE refdigest[SHA256_BLOCK_SIZE + 1] = { HASH_TYPE_SHA256 };
-            SHA256_CTX shx;
-
-            sha256_init (&shx);
-            sha256_update (&shx, (const BYTE *)input, inputsz);
-            sha256_final (&shx, refdigest + 1);
-
-            if (indigestsz != sizeof (refdigest)
-                        || memcmp (refdigest, indigest, indigestsz) != 0) {
-                errno = EINVAL;
-                security_error (ctx, "sign-munge-verify: SHA256 hash mismatch");
-                goto error;
-            }
-            break;
+    else {
+        if (entry)
+            free (hash_remove (sm->cache, key));
+        /* If async-hash is enabled, the SHA-256 hash is computed on the
+         * worker thread while munged decodes the credential.
+         */
+        async = hash_async_start (sm, input, inputsz);
+        e = munge_decode (signature, sm->munge, (void **)&indigest,
+                                                     &indigestsz, &uid, NULL);
+        if (async)
+            hash_async_wait (sm, hash);
+        if (e != EMUNGE_SUCCESS && e != EMUNGE_CRED_REPLAYED
+                                && e != EMUNGE_CRED_EXPIRED) {
+            errno = EINVAL;
+            security_error (ctx, "sign-munge-verify: munge_decode: %s",
+                            munge_ctx_strerror (sm->munge));
+            goto error;
         }
-        default:
+        e = munge_ctx_get (sm->munge, MUNGE_OPT_ENCODE_TIME, &encode_time);
+        if (e != EMUNGE_SUCCESS) {
             errno = EINVAL;
-            security_error (ctx, "sign-munge-verify: unknown hash type");
+            security_error (ctx,
+                            "sign-munge-verify: munge_ctx_get ENCODE_TIME: %s",
+                            munge_ctx_strerror (sm->munge));
             goto error;
+        }
+        cred_cache_put (sm, key, uid, encode_time, indigest, indigestsz, now);
+        digest = indigest;
+        digestsz = indigestsz;
     }
-
-    if (kv_get (header, "userid", KV_INT64, &userid) < 0 || userid != uid) {
-        errno = EINVAL;
-        security_error (ctx, "sign-munge-verify: uid mismatch");
-        goto error;
-    }
-    e = munge_ctx_get (sm->munge, MUNGE_OPT_ENCODE_TIME, &encode_time);
-    if (e != EMUNGE_SUCCESS) {
-        errno = EINVAL;
-        security_error (ctx, "sign-munge-verify: munge_ctx_get ENCODE_TIME: %s",
-                        munge_ctx_strerror (sm->munge));
-        goto error;
-    }
-    if ((now = time (NULL)) == (time_t)-1)
+    if (check_cred (ctx, sm, header, input, inputsz, digest, digestsz,
+                    uid, encode_time, async ? hash : NULL, now, xtimep) < 0)
         goto error;
-    if (encode_time + sm->max_ttl < now) {
-        errno = EINVAL;
-        security_error (ctx, "sign-munge-verify: max-ttl exceeded");
-        goto error;
-    }
     free (indigest);
     return 0;
 error:
@@ -210,12 +824,171 @@ error:
     return -1;
 }
 
+/* Sign a batch on the munge_pool.  Each job is posted as soon as its
+ * hash is computed, so hashing the next input overlaps the munged round
+ * trips already in flight.  If the pool cannot be started, sign each
+ * item in turn.
+ */
+static int op_sign_batch (flux_security_t *ctx,
+                          struct sign_mech_item *items, int count, int flags)
+{
+    struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
+    struct munge_pool *pool;
+    struct munge_job *jobs = NULL;
+    struct munge_job **posts = NULL;
+    int rc = 0;
+    int i;
+
+    assert (sm != NULL);
+
+    if (!(pool = get_pool (sm))
+            || !(jobs = calloc (count, sizeof (jobs[0])))
+            || !(posts = calloc (count, sizeof (posts[0])))) {
+        free (jobs);
+        for (i = 0; i < count; i++) {
+            if (!(items[i].sig = op_sign (ctx, items[i].input,
+                                          items[i].inputsz, flags))) {
+                items[i].errnum = errno;
+                rc = -1;
+            }
+        }
+        return rc;
+    }
+    munge_pool_start (pool, posts);
+    for (i = 0; i < count; i++) {
+        jobs[i].run = job_encode;
+        jobs[i].digest[0] = sm->hash_type;
+        compute_hash (sm->hash_type, (const BYTE *)items[i].input,
+                      items[i].inputsz, jobs[i].digest + 1);
+        posts[i] = &jobs[i];
+        munge_pool_post (pool, i + 1);
+    }
+    for (i = 0; i < count; i++) {
+        munge_pool_wait (pool, &jobs[i]);
+        if (jobs[i].failed) {
+            items[i].errnum = EINVAL;
+            security_error (ctx, "sign-munge-sign: %s", jobs[i].errstr);
+            rc = -1;
+        }
+        else
+            items[i].sig = jobs[i].outcred;
+    }
+    free (posts);
+    free (jobs);
+    return rc;
+}
+
+/* Finish verifying 'item' once the credential decoded by 'job', if it was
+ * posted, is available.
+ * Return 0 on success, -1 on failure with errno and context error set.
+ */
+static int verify_job (flux_security_t *ctx, struct sign_munge *sm,
+                       struct munge_pool *pool, struct munge_job *job,
+                       struct sign_mech_item *item, const BYTE *key,
+                       time_t now)
+{
+    if (job->run) {
+        munge_pool_wait (pool, job);
+        if (job->failed) {
+            errno = EINVAL;
+            security_error (ctx, "sign-munge-verify: %s", job->errstr);
+            return -1;
+        }
+        cred_cache_put (sm, key, job->uid, job->encode_time,
+                        job->outdigest, job->outdigestsz, now);
+    }
+    return check_cred (ctx, sm, item->header, item->input, item->inputsz,
+                       job->outdigest, job->outdigestsz,
+                       job->uid, job->encode_time,
+                       job->digest + 1, now, &item->xtime);
+}
+
+/* Verify a batch on the munge_pool.  Credentials not in the
+ * decoded-credential cache are all posted for decoding first, then
+ * the inputs are hashed while munged works on them.  If the pool cannot
+ * be started, verify each item in turn.
+ */
+static int op_verify_batch (flux_security_t *ctx,
+                            struct sign_mech_item *items, int count,
+                            int flags)
+{
+    struct sign_munge *sm = flux_security_aux_get (ctx, auxname);
+    struct munge_pool *pool;
+    struct munge_job *jobs = NULL;
+    struct munge_job **posts = NULL;
+    BYTE (*keys)[SHA256_BLOCK_SIZE] = NULL;
+    struct cred_entry *entry;
+    time_t now = time (NULL);
+    int rc = 0;
+    int n = 0;
+    int i;
+
+    assert (sm != NULL);
+
+    if (!(pool = get_pool (sm))
+            || !(jobs = calloc (count, sizeof (jobs[0])))
+            || !(posts = calloc (count, sizeof (posts[0])))
+            || !(keys = calloc (count, sizeof (keys[0])))) {
+        free (jobs);
+        free (posts);
+        for (i = 0; i < count; i++) {
+            if (op_verify (ctx, items[i].header,
+                           items[i].input, items[i].inputsz,
+                           items[i].signature, flags, &items[i].xtime) < 0) {
+                items[i].errnum = errno;
+                rc = -1;
+            }
+        }
+        return rc;
+    }
+    /* Cached credentials are copied, since adding decoded credentials
+     * to the cache below may evict them.
+     */
+    for (i = 0; i < count; i++) {
+        cred_key (items[i].signature, keys[i]);
+        if ((entry = hash_find (sm->cache, keys[i]))) {
+            if (entry->encode_time + sm->max_ttl >= now
+                    && (jobs[i].outdigest = malloc (entry->digestsz))) {
+                memcpy (jobs[i].outdigest, entry->digest, entry->digestsz);
+                jobs[i].outdigestsz = entry->digestsz;
+                jobs[i].uid = entry->uid;
+                jobs[i].encode_time = entry->encode_time;
+                continue;
+            }
+            free (hash_remove (sm->cache, keys[i]));
+        }
+        jobs[i].run = job_decode;
+        jobs[i].cred = items[i].signature;
+        posts[n++] = &jobs[i];
+    }
+    munge_pool_start (pool, posts);
+    munge_pool_post (pool, n);
+    for (i = 0; i < count; i++)
+        compute_hash (sm->hash_type, (const BYTE *)items[i].input,
+                      items[i].inputsz, jobs[i].digest + 1);
+    for (i = 0; i < count; i++) {
+        if (verify_job (ctx, sm, pool, &jobs[i], &items[i], keys[i],
+                        now) < 0) {
+            items[i].errnum = errno;
+            rc = -1;
+        }
+    }
+    for (i = 0; i < count; i++)
+        free (jobs[i].outdigest);
+    free (keys);
+    free (posts);
+    free (jobs);
+    return rc;
+}
+
 const struct sign_mech sign_mech_munge = {
     .name = "munge",
     .init = op_init,
     .prep = NULL,
     .sign = op_sign,
     .verify = op_verify,
+    .sign_batch = op_sign_batch,
+    .verify_batch = op_verify_batch,
 };
 
 /*
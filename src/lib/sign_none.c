@@ -36,7 +36,7 @@ static char *op_sign (flux_security_t *ctx,
 
 static int op_verify (flux_security_t *ctx, const struct kv *header,
                       const char *input, int inputsz,
-                      const char *signature, int flags)
+                      const char *signature, int flags, time_t *xtimep)
 {
     int64_t userid;
     int64_t real_userid = getuid ();
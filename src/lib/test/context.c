@@ -13,6 +13,7 @@
 #endif
 #include <errno.h>
 #include <string.h>
+#include <stdbool.h>
 #include <sys/param.h>
 
 #include "src/libtap/tap.h"
@@ -25,10 +26,21 @@ const char *conf = "foo = 42\n";
 static char tmpdir[PATH_MAX + 1];
 static char cfpath[PATH_MAX + 1];
 
+void conf_write (const char *buf)
+{
+    FILE *f;
+
+    if (!(f = fopen (cfpath, "w")))
+        BAIL_OUT ("fopen %s: %s", cfpath, strerror (errno));
+    if (fwrite (buf, 1, strlen (buf), f) != strlen (buf))
+        BAIL_OUT ("fwrite failed");
+    if (fclose (f) != 0)
+        BAIL_OUT ("fclose failed");
+}
+
 void conf_init (void)
 {
     const char *t = getenv ("TMPDIR");
-    FILE *f;
     int n;
 
     n = sizeof (tmpdir);
@@ -39,12 +51,7 @@ void conf_init (void)
     n = sizeof (cfpath);
     if (snprintf (cfpath, n, "%s/conf.toml", tmpdir) >= n)
         BAIL_OUT ("cfpath buffer overflow");
-    if (!(f = fopen (cfpath, "w")))
-        BAIL_OUT ("fopen %s: %s", cfpath, strerror (errno));
-    if (fwrite (conf, 1, strlen (conf), f) != strlen (conf))
-        BAIL_OUT ("fwrite failed");
-    if (fclose (f) != 0)
-        BAIL_OUT ("fclose failed");
+    conf_write (conf);
 }
 
 void conf_fini (void)
@@ -167,7 +174,7 @@ void aux_free (void *data)
 void test_aux (void)
 {
     flux_security_t *ctx;
-    char *s, *p;
+    char *s, *p, *q;
 
     if (!(ctx = flux_security_create (0)))
         BAIL_OUT ("flux_security_create failed");
@@ -175,6 +182,8 @@ void test_aux (void)
         BAIL_OUT ("strdup failed");
     if (!(p = strdup ("goodbye")))
         BAIL_OUT ("strdup failed");
+    if (!(q = strdup ("again")))
+        BAIL_OUT ("strdup failed");
 
     ok (flux_security_aux_get (ctx, "unknown") == NULL,
         "flux_security_aux_get key=unknown returns NULL");
@@ -189,7 +198,7 @@ void test_aux (void)
     ok (flux_security_aux_get (ctx, "bar") == p,
         "flux_security_aux_get retrieves data");
 
-    ok (flux_security_aux_set (ctx, "foo", p, aux_free) == 0,
+    ok (flux_security_aux_set (ctx, "foo", q, aux_free) == 0,
         "flux_security_aux_set key=existing works");
     ok (free_flag == 1,
         "destructor was called");
@@ -200,6 +209,183 @@ void test_aux (void)
         "flux_security_destroy called aux destructor for each item");
 }
 
+static int check_count = 0;
+static bool check_fail = false;
+int check_fn (flux_security_t *ctx, const cf_t *cf)
+{
+    check_count++;
+    if (check_fail) {
+        errno = EINVAL;
+        security_error (ctx, "check failed");
+        return -1;
+    }
+    return 0;
+}
+
+static int refresh_count = 0;
+static int64_t refresh_value = 0;
+void refresh_fn (flux_security_t *ctx, void *data, const cf_t *cf)
+{
+    refresh_count++;
+    refresh_value = cf_int64 (cf_get_in (cf_get_in (cf, "b"), "z"));
+}
+
+void test_reconfigure (void)
+{
+    static const char *const deps_a[] = { "a", NULL };
+    static const char *const deps_b[] = { "b.y", "c", NULL };
+    static const char *const deps_r[] = { "d", NULL };
+    flux_security_t *ctx;
+    char pattern[PATH_MAX + 1];
+    const cf_t *a;
+    char *s, *p;
+    int n;
+
+    if (!(ctx = flux_security_create (0)))
+        BAIL_OUT ("flux_security_create failed");
+    n = sizeof (pattern);
+    if (snprintf (pattern, n, "%s/*.toml", tmpdir) >= n)
+        BAIL_OUT ("pattern buffer overflow");
+    if (!(s = strdup ("a")) || !(p = strdup ("b")))
+        BAIL_OUT ("strdup failed");
+
+    errno = 0;
+    ok (security_aux_set_config (ctx, "a", s, aux_free,
+                                 deps_a, check_fn, NULL) < 0
+        && errno == EINVAL,
+        "security_aux_set_config without loading config fails with EINVAL");
+
+    conf_write ("[a]\nx = 1\n[b]\ny = 2\nz = 3\n");
+    if (flux_security_configure (ctx, pattern) < 0)
+        BAIL_OUT ("flux_security_configure: %s",
+                  flux_security_last_error (ctx));
+    ok (security_aux_set_config (ctx, "a", s, aux_free,
+                                 deps_a, check_fn, NULL) == 0
+        && flux_security_aux_get (ctx, "a") == s,
+        "security_aux_set_config works");
+    ok (security_aux_set_config (ctx, "b", p, aux_free,
+                                 deps_b, check_fn, NULL) == 0
+        && flux_security_aux_get (ctx, "b") == p,
+        "security_aux_set_config works again");
+    a = security_get_config (ctx, "a");
+
+    /* Changing a value that only item "b" depends on rebuilds just "b".
+     */
+    free_flag = 0;
+    conf_write ("[a]\nx = 1\n[b]\ny = 4\nz = 3\n");
+    ok (flux_security_reconfigure (ctx, pattern) == 0,
+        "flux_security_reconfigure works");
+    ok (check_count == 1,
+        "check was called only for the item whose dependency changed");
+    ok (flux_security_aux_get (ctx, "a") == s,
+        "item with unchanged dependencies was kept");
+    ok (flux_security_aux_get (ctx, "b") == NULL && free_flag == 1,
+        "item with changed dependencies was destroyed");
+    ok (cf_int64 (cf_get_in (a, "x")) == 1,
+        "config object held by kept item remains valid");
+    ok (cf_int64 (cf_get_in (security_get_config (ctx, "b"), "y")) == 4,
+        "new config is in effect");
+
+    /* A value no item depends on changes.
+     */
+    check_count = 0;
+    conf_write ("[a]\nx = 1\n[b]\ny = 4\nz = 5\n");
+    ok (flux_security_reconfigure (ctx, pattern) == 0 && check_count == 0
+        && flux_security_aux_get (ctx, "a") == s,
+        "flux_security_reconfigure with unrelated change keeps items");
+
+    /* An item with a refresh function is kept, validated, and refreshed
+     * when values outside its dependencies change.
+     */
+    if (!(p = strdup ("r")))
+        BAIL_OUT ("strdup failed");
+    ok (security_aux_set_config (ctx, "r", p, aux_free, deps_r, check_fn,
+                                 refresh_fn) == 0,
+        "security_aux_set_config with refresh function works");
+    check_count = 0;
+    conf_write ("[a]\nx = 1\n[b]\ny = 4\nz = 6\n");
+    ok (flux_security_reconfigure (ctx, pattern) == 0
+        && flux_security_aux_get (ctx, "r") == p
+        && check_count == 1,
+        "flux_security_reconfigure keeps and validates refreshable item");
+    ok (refresh_count == 1 && refresh_value == 6,
+        "refresh function was called with new config");
+    conf_write ("[a]\nx = 1\n[b]\ny = 4\nz = 7\n[d]\n");
+    ok (flux_security_reconfigure (ctx, pattern) == 0
+        && flux_security_aux_get (ctx, "r") == NULL
+        && refresh_count == 1,
+        "refreshable item is destroyed if its dependencies change");
+    conf_write ("[a]\nx = 1\n[b]\ny = 4\nz = 5\n");
+    if (flux_security_reconfigure (ctx, pattern) < 0)
+        BAIL_OUT ("flux_security_reconfigure: %s",
+                  flux_security_last_error (ctx));
+
+    /* A failed check leaves everything unchanged.
+     */
+    check_fail = true;
+    conf_write ("[a]\nx = 2\n");
+    errno = 0;
+    ok (flux_security_reconfigure (ctx, pattern) < 0 && errno == EINVAL,
+        "flux_security_reconfigure fails with EINVAL if check fails");
+    diag ("%s", flux_security_last_error (ctx));
+    ok (flux_security_aux_get (ctx, "a") == s
+        && cf_int64 (cf_get_in (security_get_config (ctx, "a"), "x")) == 1
+        && security_get_config (ctx, "b") != NULL,
+        "item and config are unchanged");
+    errno = 0;
+    ok (flux_security_reconfigure (ctx, "/bad/path") < 0 && errno == EINVAL
+        && flux_security_aux_get (ctx, "a") == s,
+        "flux_security_reconfigure on a bad path fails and keeps items");
+    check_fail = false;
+
+    /* Adding a dependency that was absent counts as a change.
+     */
+    check_count = 0;
+    if (!(p = strdup ("b")))
+        BAIL_OUT ("strdup failed");
+    if (security_aux_set_config (ctx, "b", p, aux_free,
+                                 deps_b, check_fn, NULL) < 0)
+        BAIL_OUT ("security_aux_set_config failed");
+    conf_write ("[a]\nx = 1\n[b]\ny = 4\n[c]\n");
+    ok (flux_security_reconfigure (ctx, pattern) == 0 && check_count == 1
+        && flux_security_aux_get (ctx, "b") == NULL,
+        "flux_security_reconfigure detects added table");
+
+    /* flux_security_aux_set() on the same name forgets the dependencies.
+     */
+    if (!(p = strdup ("a")))
+        BAIL_OUT ("strdup failed");
+    ok (flux_security_aux_set (ctx, "a", p, aux_free) == 0,
+        "flux_security_aux_set replaced config-derived item");
+    conf_write ("[a]\nx = 2\n");
+    ok (flux_security_reconfigure (ctx, pattern) == 0
+        && flux_security_aux_get (ctx, "a") == p,
+        "flux_security_reconfigure does not touch plain aux items");
+
+    /* flux_security_configure() drops all config-derived items.
+     */
+    if (!(s = strdup ("b")))
+        BAIL_OUT ("strdup failed");
+    if (security_aux_set_config (ctx, "b", s, aux_free,
+                                 deps_b, NULL, NULL) < 0)
+        BAIL_OUT ("security_aux_set_config failed");
+    ok (flux_security_configure (ctx, pattern) == 0
+        && flux_security_aux_get (ctx, "b") == NULL
+        && flux_security_aux_get (ctx, "a") == p,
+        "flux_security_configure destroys config-derived items");
+
+    errno = 0;
+    ok (flux_security_reconfigure (NULL, pattern) < 0 && errno == EINVAL,
+        "flux_security_reconfigure ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (security_aux_set_config (ctx, "c", s, aux_free, NULL, NULL, NULL) < 0
+        && errno == EINVAL,
+        "security_aux_set_config deps=NULL fails with EINVAL");
+
+    flux_security_destroy (ctx);
+    conf_write (conf);
+}
+
 void test_corner (void)
 {
     flux_security_t *ctx;
@@ -267,6 +453,7 @@ int main (int argc, char *argv[])
     test_set_config ();
     test_error ();
     test_aux ();
+    test_reconfigure ();
     test_corner ();
 
     conf_fini ();
@@ -14,10 +14,20 @@
 #include <errno.h>
 #include <string.h>
 #include <sys/param.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdbool.h>
 #include <sodium.h>
 
 #include "src/libtap/tap.h"
 #include "src/libutil/kv.h"
+#include "src/libutil/cf.h"
+#include "src/libca/ca.h"
+#include "src/libca/sigcert.h"
+#include "src/libca/certdb.h"
+#include "src/libca/sigagent.h"
 
 #include "src/lib/sign.h"
 
@@ -95,12 +105,9 @@ void cfpath_fini (void)
         BAIL_OUT ("rmdir %s: %s", tmpdir, strerror (errno));
 }
 
-flux_security_t *context_init (const char *config_buf)
+void config_write (const char *config_buf)
 {
     FILE *f;
-    int n;
-    char pattern[PATH_MAX + 1];
-    flux_security_t *ctx;
     size_t len = strlen (config_buf);
 
     if (!(f = fopen (cfpath, "w")))
@@ -109,18 +116,37 @@ flux_security_t *context_init (const char *config_buf)
         BAIL_OUT ("fwrite failed");
     if (fclose (f) != 0)
         BAIL_OUT ("fclose failed");
+}
+
+const char *config_pattern (void)
+{
+    static char pattern[PATH_MAX + 1];
+    int n = sizeof (pattern);
 
-    if (!(ctx = flux_security_create (0)))
-        BAIL_OUT ("flux_security_create failed");
-    n = sizeof (pattern);
     if (snprintf (pattern, n, "%s/*.toml", tmpdir) >= n)
         BAIL_OUT ("pattern buffer overflow");
-    if (flux_security_configure (ctx, pattern) < 0)
+    return pattern;
+}
+
+flux_security_t *context_init (const char *config_buf)
+{
+    flux_security_t *ctx;
+
+    config_write (config_buf);
+    if (!(ctx = flux_security_create (0)))
+        BAIL_OUT ("flux_security_create failed");
+    if (flux_security_configure (ctx, config_pattern ()) < 0)
         BAIL_OUT ("config error: %s", flux_security_last_error (ctx));
 
     return ctx;
 }
 
+int context_reconfigure (flux_security_t *ctx, const char *config_buf)
+{
+    config_write (config_buf);
+    return flux_security_reconfigure (ctx, config_pattern ());
+}
+
 void test_config (void)
 {
     flux_security_t *ctx;
@@ -517,6 +543,652 @@ void test_corner (flux_security_t *ctx)
     free (cpy);
 }
 
+void test_batch (flux_security_t *ctx)
+{
+    struct flux_sign_batch_item items[3];
+    char *s[3];
+    int i;
+
+    memset (items, 0, sizeof (items));
+    items[0].payload = "foo";
+    items[0].payloadsz = 3;
+    items[1].payload = "hello world";
+    items[1].payloadsz = 11;
+    ok (flux_sign_wrap_batch (ctx, items, 3, NULL, 0) == 0,
+        "flux_sign_wrap_batch works");
+    ok (items[0].input != NULL && items[0].errnum == 0
+        && items[1].input != NULL && items[1].errnum == 0
+        && items[2].input != NULL && items[2].errnum == 0,
+        "each item was wrapped");
+    ok (flux_sign_unwrap (ctx, items[1].input, NULL, NULL, NULL, 0) == 0,
+        "flux_sign_unwrap accepts a batch result");
+    for (i = 0; i < 3; i++) {
+        if (!(s[i] = strdup (items[i].input)))
+            BAIL_OUT ("strdup failed");
+    }
+
+    memset (items, 0, sizeof (items));
+    for (i = 0; i < 3; i++)
+        items[i].input = s[i];
+    ok (flux_sign_unwrap_batch (ctx, items, 3, 0) == 0,
+        "flux_sign_unwrap_batch works");
+    ok (items[0].payloadsz == 3 && memcmp (items[0].payload, "foo", 3) == 0
+        && items[1].payloadsz == 11
+        && memcmp (items[1].payload, "hello world", 11) == 0,
+        "payloads match");
+    ok (items[2].payload == NULL && items[2].payloadsz == 0,
+        "empty payload is returned as NULL");
+    ok (items[0].userid == getuid () && items[2].userid == getuid (),
+        "userid is set");
+    ok (items[0].errnum == 0 && items[1].errnum == 0 && items[2].errnum == 0,
+        "errnum is clear on success");
+
+    /* One bad item fails without affecting the others.
+     */
+    s[1][0] = '!';
+    memset (items, 0, sizeof (items));
+    for (i = 0; i < 3; i++)
+        items[i].input = s[i];
+    errno = 0;
+    ok (flux_sign_unwrap_batch (ctx, items, 3, 0) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_batch with a bad item fails with EINVAL");
+    ok (items[1].errnum == EINVAL,
+        "bad item errnum is EINVAL");
+    ok (items[0].errnum == 0 && items[2].errnum == 0
+        && items[0].payloadsz == 3 && memcmp (items[0].payload, "foo", 3) == 0,
+        "other items were unwrapped");
+    diag ("%s", flux_security_last_error (ctx));
+    memset (items, 0, sizeof (items));
+    items[0].input = s[0];
+    ok (flux_sign_unwrap_batch (ctx, items, 2, FLUX_SIGN_NOVERIFY) < 0
+        && items[0].errnum == 0 && items[1].errnum == EINVAL,
+        "flux_sign_unwrap_batch NOVERIFY fails only the NULL input");
+
+    memset (items, 0, sizeof (items));
+    items[0].payload = "foo";
+    items[0].payloadsz = 3;
+    items[1].payloadsz = -1;
+    errno = 0;
+    ok (flux_sign_wrap_batch (ctx, items, 2, NULL, 0) < 0 && errno == EINVAL
+        && items[0].errnum == 0 && items[0].input != NULL
+        && items[1].errnum == EINVAL && items[1].input == NULL,
+        "flux_sign_wrap_batch fails only the item with payloadsz < 0");
+
+    ok (flux_sign_wrap_batch (ctx, NULL, 0, NULL, 0) == 0
+        && flux_sign_unwrap_batch (ctx, NULL, 0, 0) == 0,
+        "empty batches work");
+    errno = 0;
+    ok (flux_sign_wrap_batch (NULL, items, 1, NULL, 0) < 0 && errno == EINVAL,
+        "flux_sign_wrap_batch ctx=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_batch (ctx, items, -1, NULL, 0) < 0 && errno == EINVAL,
+        "flux_sign_wrap_batch count=-1 fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_batch (ctx, items, 1, NULL, 0xff) < 0
+        && errno == EINVAL,
+        "flux_sign_wrap_batch flags=0xff fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_wrap_batch (ctx, items, 1, "unknown", 0) < 0
+        && errno == EINVAL,
+        "flux_sign_wrap_batch mech=unknown fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_batch (ctx, NULL, 1, 0) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_batch items=NULL fails with EINVAL");
+    errno = 0;
+    ok (flux_sign_unwrap_batch (ctx, items, 1, 0xff) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_batch flags=0xff fails with EINVAL");
+
+    for (i = 0; i < 3; i++)
+        free (s[i]);
+}
+
+/* Build hmac config with 'max_ttl', 'types', and optional 'extra' lines
+ * appended to the [sign.hmac] table.
+ */
+const char *hmac_conf (int max_ttl, const char *types,
+                       const char *keypath, const char *extra)
+{
+    static char buf[PATH_MAX + 256];
+    int n = sizeof (buf);
+
+    if (snprintf (buf, n, "[sign]\n"
+                          "max-ttl = %d\n"
+                          "default-type = \"none\"\n"
+                          "allowed-types = [ %s ]\n"
+                          "[sign.hmac]\n"
+                          "key-path = \"%s\"\n"
+                          "%s",
+                  max_ttl, types, keypath, extra ? extra : "") >= n)
+        BAIL_OUT ("config buffer overflow");
+    return buf;
+}
+
+bool roundtrip (flux_security_t *ctx, const char *mech_type)
+{
+    const char *s;
+    const void *outmsg;
+    int outmsgsz;
+
+    if (!(s = flux_sign_wrap (ctx, "foo", 3, mech_type, 0))) {
+        diag ("wrap: %s", flux_security_last_error (ctx));
+        return false;
+    }
+    if (flux_sign_unwrap (ctx, s, &outmsg, &outmsgsz, NULL, 0) < 0) {
+        diag ("unwrap: %s", flux_security_last_error (ctx));
+        return false;
+    }
+    return outmsgsz == 3 && memcmp (outmsg, "foo", 3) == 0;
+}
+
+void test_reconfigure (void)
+{
+    const char *both = "\"none\", \"hmac\"";
+    const char *sha256 = "hash-type = \"sha256\"\n";
+    char keypath[PATH_MAX + 1];
+    unsigned char key[32];
+    flux_security_t *ctx;
+    void *sign, *sh;
+    const char *s;
+    char *copy;
+    FILE *f;
+    int n;
+
+    n = sizeof (keypath);
+    if (snprintf (keypath, n, "%s/hmac.key", tmpdir) >= n)
+        BAIL_OUT ("keypath buffer overflow");
+    randombytes_buf (key, sizeof (key));
+    if (!(f = fopen (keypath, "w"))
+            || fwrite (key, 1, sizeof (key), f) != sizeof (key)
+            || fclose (f) != 0
+            || chmod (keypath, 0600) < 0)
+        BAIL_OUT ("%s: %s", keypath, strerror (errno));
+
+    ctx = context_init (hmac_conf (30, both, keypath, NULL));
+    ok (roundtrip (ctx, "hmac"),
+        "hmac wrap/unwrap works");
+    sign = flux_security_aux_get (ctx, "flux::sign");
+    sh = flux_security_aux_get (ctx, "flux::sign_hmac");
+    if (!sign || !sh)
+        BAIL_OUT ("sign state was not created");
+    if (!(s = flux_sign_wrap (ctx, "bar", 3, "hmac", 0)))
+        BAIL_OUT ("flux_sign_wrap failed");
+
+    ok (context_reconfigure (ctx, hmac_conf (30, both, keypath,
+                                             "[other]\nx = 1\n")) == 0,
+        "flux_security_reconfigure with unrelated change works");
+    ok (flux_security_aux_get (ctx, "flux::sign") == sign
+        && flux_security_aux_get (ctx, "flux::sign_hmac") == sh,
+        "sign and hmac state were kept");
+    ok (flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) == 0,
+        "envelope wrapped before reconfigure is still valid");
+
+    ok (context_reconfigure (ctx, hmac_conf (30, both, keypath, sha256)) == 0,
+        "flux_security_reconfigure with new hmac hash-type works");
+    ok (flux_security_aux_get (ctx, "flux::sign") == sign
+        && flux_security_aux_get (ctx, "flux::sign_hmac") == NULL,
+        "sign state was kept and hmac state was dropped");
+    ok (roundtrip (ctx, "hmac")
+        && flux_security_aux_get (ctx, "flux::sign_hmac") != NULL,
+        "hmac wrap/unwrap works and hmac state was rebuilt");
+    sh = flux_security_aux_get (ctx, "flux::sign_hmac");
+
+    errno = 0;
+    ok (context_reconfigure (ctx, hmac_conf (30, both, "/noexist", NULL)) < 0
+        && errno == ENOENT,
+        "flux_security_reconfigure with missing hmac key fails");
+    diag ("%s", flux_security_last_error (ctx));
+    errno = 0;
+    ok (context_reconfigure (ctx, hmac_conf (-1, both, keypath, NULL)) < 0
+        && errno == EINVAL,
+        "flux_security_reconfigure with neg max-ttl fails with EINVAL");
+    diag ("%s", flux_security_last_error (ctx));
+    ok (flux_security_aux_get (ctx, "flux::sign") == sign
+        && flux_security_aux_get (ctx, "flux::sign_hmac") == sh
+        && roundtrip (ctx, "hmac"),
+        "failed reconfigure left state unchanged");
+
+    /* max-ttl is updated in place, without dropping any state.
+     * -100 is allowed for testing and makes every envelope expired.
+     */
+    ok (context_reconfigure (ctx, hmac_conf (60, both, keypath, sha256)) == 0,
+        "flux_security_reconfigure with new max-ttl works");
+    ok (flux_security_aux_get (ctx, "flux::sign") == sign
+        && flux_security_aux_get (ctx, "flux::sign_hmac") == sh,
+        "sign and hmac state were kept");
+    ok (roundtrip (ctx, "hmac"),
+        "hmac wrap/unwrap works");
+    ok (context_reconfigure (ctx, hmac_conf (-100, both, keypath, sha256)) == 0
+        && flux_security_aux_get (ctx, "flux::sign") == sign
+        && flux_security_aux_get (ctx, "flux::sign_hmac") == sh
+        && !roundtrip (ctx, "hmac"),
+        "new max-ttl takes effect in kept hmac state");
+    if (context_reconfigure (ctx, hmac_conf (60, both, keypath, sha256)) < 0)
+        BAIL_OUT ("reconfigure: %s", flux_security_last_error (ctx));
+
+    if (!(s = flux_sign_wrap (ctx, "bar", 3, "none", 0))
+            || !(copy = strdup (s)))
+        BAIL_OUT ("flux_sign_wrap failed");
+    ok (context_reconfigure (ctx, hmac_conf (60, "\"none\"", keypath,
+                                             sha256)) == 0,
+        "flux_security_reconfigure with new allowed-types works");
+    ok (flux_security_aux_get (ctx, "flux::sign") == NULL
+        && flux_security_aux_get (ctx, "flux::sign_hmac") == sh,
+        "sign state was dropped and hmac state was kept");
+    ok (strcmp (s, copy) == 0,
+        "string returned by flux_sign_wrap survives reconfigure");
+    free (copy);
+    ok (!roundtrip (ctx, "hmac") && roundtrip (ctx, "none"),
+        "hmac is no longer allowed but none still works");
+
+    flux_security_destroy (ctx);
+    (void)unlink (keypath);
+}
+
+static pid_t start_agent (const struct sigcert *cert, const char *path)
+{
+    pid_t pid;
+    int fd;
+
+    if ((fd = sigagent_listen (path)) < 0)
+        BAIL_OUT ("sigagent_listen: %s", strerror (errno));
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork: %s", strerror (errno));
+    if (pid == 0) {
+        (void)sigagent_serve (fd, cert);
+        _exit (1);
+    }
+    (void)close (fd);
+    return pid;
+}
+
+static void stop_agent (pid_t pid)
+{
+    int status;
+
+    if (kill (pid, SIGTERM) < 0 || waitpid (pid, &status, 0) < 0)
+        BAIL_OUT ("failed to stop agent: %s", strerror (errno));
+}
+
+static void tmpfile_path (char *buf, int size, const char *name)
+{
+    if (snprintf (buf, size, "%s/%s", tmpdir, name) >= size)
+        BAIL_OUT ("%s: buffer overflow", name);
+}
+
+/* Build curve config using the cert at 'certpath', verified against
+ * the cert database at 'dbpath', with optional agent at 'sockpath'.
+ */
+const char *curve_conf (const char *certpath, const char *dbpath,
+                        const char *sockpath)
+{
+    static char buf[4*PATH_MAX + 256];
+    int n = sizeof (buf);
+
+    if (snprintf (buf, n, "[sign]\n"
+                          "max-ttl = 30\n"
+                          "default-type = \"curve\"\n"
+                          "allowed-types = [ \"curve\" ]\n"
+                          "[sign.curve]\n"
+                          "require-ca = false\n"
+                          "cert-path = \"%s\"\n"
+                          "cert-db = \"%s\"\n"
+                          "%s%s%s",
+                  certpath, dbpath,
+                  sockpath ? "agent-socket = \"" : "",
+                  sockpath ? sockpath : "",
+                  sockpath ? "\"\n" : "") >= n)
+        BAIL_OUT ("config buffer overflow");
+    return buf;
+}
+
+static void certdb_write (const char *path, int64_t userid,
+                          const struct sigcert *cert)
+{
+    struct certdb_builder *b;
+
+    if (!(b = certdb_builder_create ())
+            || certdb_builder_add (b, userid, cert) < 0
+            || certdb_builder_write (b, path) < 0)
+        BAIL_OUT ("failed to write cert db: %s", strerror (errno));
+    certdb_builder_destroy (b);
+}
+
+/* A context opens the cert database once, but should notice when it
+ * has been rebuilt, e.g. to add a new user, without being recreated.
+ */
+void test_certdb (void)
+{
+    char certpath[PATH_MAX + 1];
+    char pubpath[PATH_MAX + 1];
+    char binpath[PATH_MAX + 1];
+    char dbpath[PATH_MAX + 1];
+    char otherpath[PATH_MAX + 1];
+    char otherpub[PATH_MAX + 1];
+    char otherbin[PATH_MAX + 1];
+    struct sigcert *cert;
+    struct sigcert *other = NULL;
+    flux_security_t *ctx;
+    flux_security_t *ctx2;
+    const char *s;
+
+    tmpfile_path (certpath, sizeof (certpath), "sig");
+    tmpfile_path (pubpath, sizeof (pubpath), "sig.pub");
+    tmpfile_path (binpath, sizeof (binpath), "sig.pub.bin");
+    tmpfile_path (dbpath, sizeof (dbpath), "certdb");
+    tmpfile_path (otherpath, sizeof (otherpath), "other");
+    tmpfile_path (otherpub, sizeof (otherpub), "other.pub");
+    tmpfile_path (otherbin, sizeof (otherbin), "other.pub.bin");
+
+    if (!(cert = sigcert_create ())
+            || !(other = sigcert_create ())
+            || sigcert_store (cert, certpath) < 0
+            || sigcert_store (other, otherpath) < 0)
+        BAIL_OUT ("failed to create certs: %s", strerror (errno));
+    certdb_write (dbpath, (int64_t)getuid () + 1, cert);
+
+    ctx = context_init (curve_conf (certpath, dbpath, NULL));
+    if (!(s = flux_sign_wrap (ctx, "foo", 3, "curve", 0)))
+        BAIL_OUT ("flux_sign_wrap: %s", flux_security_last_error (ctx));
+    ok (flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) < 0,
+        "curve unwrap fails when user is not in cert db");
+    diag ("%s", flux_security_last_error (ctx));
+
+    certdb_write (dbpath, getuid (), cert);
+    ok (flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) == 0,
+        "curve unwrap works after user is added to cert db");
+
+    /* Sign with a new cert in a second context, as if the user
+     * had replaced their cert, and update the database.
+     */
+    ctx2 = context_init (curve_conf (otherpath, dbpath, NULL));
+    if (!(s = flux_sign_wrap (ctx2, "foo", 3, "curve", 0)))
+        BAIL_OUT ("flux_sign_wrap: %s", flux_security_last_error (ctx2));
+    ok (flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) < 0,
+        "curve unwrap with user's new cert fails before cert db update");
+    diag ("%s", flux_security_last_error (ctx));
+    certdb_write (dbpath, getuid (), other);
+    ok (flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) == 0,
+        "curve unwrap with user's new cert works after cert db update");
+
+    flux_security_destroy (ctx2);
+    flux_security_destroy (ctx);
+    sigcert_destroy (other);
+    sigcert_destroy (cert);
+    (void)unlink (certpath);
+    (void)unlink (pubpath);
+    (void)unlink (binpath);
+    (void)unlink (otherpath);
+    (void)unlink (otherpub);
+    (void)unlink (otherbin);
+    (void)unlink (dbpath);
+}
+
+/* Build curve config requiring a CA-issued cert at 'certpath', with
+ * the CA cert at 'capath' and the verify cache in tmpdir.
+ */
+const char *ca_conf (int max_ttl, int max_sign_ttl,
+                     const char *certpath, const char *capath)
+{
+    static char buf[4*PATH_MAX + 512];
+    int n = sizeof (buf);
+
+    if (snprintf (buf, n, "[sign]\n"
+                          "max-ttl = %d\n"
+                          "default-type = \"curve\"\n"
+                          "allowed-types = [ \"curve\" ]\n"
+                          "verify-cache-dir = \"%s\"\n"
+                          "[sign.curve]\n"
+                          "require-ca = true\n"
+                          "cert-path = \"%s\"\n"
+                          "[ca]\n"
+                          "max-cert-ttl = 60\n"
+                          "max-sign-ttl = %d\n"
+                          "cert-path = \"%s\"\n"
+                          "revoke-dir = \"%s/ca-revoke\"\n"
+                          "revoke-allow = false\n"
+                          "domain = \"FLUX.TEST\"\n",
+                  max_ttl, tmpdir, certpath, max_sign_ttl, capath,
+                  tmpdir) >= n)
+        BAIL_OUT ("config buffer overflow");
+    return buf;
+}
+
+/* Generate a CA using [ca] from 'conf', store it, and use it to sign a
+ * new cert for the current user that is valid from 'nvbt' for 'ttl'
+ * seconds.  Store the cert at 'certpath'.
+ */
+static struct sigcert *ca_cert_create (const char *conf, const char *certpath,
+                                       time_t nvbt, int64_t ttl)
+{
+    struct cf_error cferr;
+    struct sigcert *cert;
+    struct ca *ca;
+    cf_t *cf;
+    ca_error_t e;
+
+    if (!(cf = cf_create ())
+            || cf_update (cf, conf, strlen (conf), &cferr) < 0)
+        BAIL_OUT ("cf_update: %s", cferr.errbuf);
+    if (!(ca = ca_create (cf_get_in (cf, "ca"), e))
+            || ca_keygen (ca, 0, 0, e) < 0
+            || ca_store (ca, e) < 0)
+        BAIL_OUT ("CA setup: %s", e);
+    if (!(cert = sigcert_create ())
+            || ca_sign (ca, cert, nvbt, ttl, getuid (), e) < 0
+            || sigcert_store (cert, certpath) < 0)
+        BAIL_OUT ("failed to create cert: %s", e);
+    ca_destroy (ca);
+    cf_destroy (cf);
+    return cert;
+}
+
+static void ca_files_unlink (void)
+{
+    const char *names[] = { "sig", "sig.pub", "sig.pub.bin", "ca-cert",
+                            "ca-cert.pub", "ca-cert.pub.bin", "verify-cache",
+                            NULL };
+    char path[PATH_MAX + 1];
+    int i;
+
+    for (i = 0; names[i] != NULL; i++) {
+        tmpfile_path (path, sizeof (path), names[i]);
+        (void)unlink (path);
+    }
+}
+
+/* A CA-issued cert may expire before ctime + max-sign-ttl.  A verify cache
+ * entry for an envelope it signed must expire with it.
+ */
+void test_ca_expiry (void)
+{
+    char certpath[PATH_MAX + 1];
+    char capath[PATH_MAX + 1];
+    char vcpath[PATH_MAX + 1];
+    struct sigcert *cert;
+    flux_security_t *ctx;
+    const char *s;
+
+    tmpfile_path (certpath, sizeof (certpath), "sig");
+    tmpfile_path (capath, sizeof (capath), "ca-cert");
+    tmpfile_path (vcpath, sizeof (vcpath), "verify-cache");
+
+    /* The cert expires in 3s, well before max-ttl or max-sign-ttl.
+     */
+    cert = ca_cert_create (ca_conf (30, 30, certpath, capath), certpath,
+                           time (NULL) - 57, 60);
+    ctx = context_init (ca_conf (30, 30, certpath, capath));
+    if (!(s = flux_sign_wrap (ctx, "foo", 3, "curve", 0)))
+        BAIL_OUT ("flux_sign_wrap: %s", flux_security_last_error (ctx));
+    ok (flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) == 0
+        && access (vcpath, F_OK) == 0,
+        "curve unwrap with CA-issued cert works and fills verify cache");
+    sleep (4);
+    ok (flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) < 0,
+        "curve unwrap fails from verify cache once the cert has expired");
+    diag ("%s", flux_security_last_error (ctx));
+
+    flux_security_destroy (ctx);
+    sigcert_destroy (cert);
+    ca_files_unlink ();
+}
+
+/* Verify cache entries added under one verification policy are not
+ * accepted by a context with a different one.
+ */
+void test_vcache_config (void)
+{
+    char certpath[PATH_MAX + 1];
+    char capath[PATH_MAX + 1];
+    struct sigcert *cert;
+    flux_security_t *ctx;
+    flux_security_t *ctx2;
+    const char *s;
+
+    tmpfile_path (certpath, sizeof (certpath), "sig");
+    tmpfile_path (capath, sizeof (capath), "ca-cert");
+
+    cert = ca_cert_create (ca_conf (30, 30, certpath, capath), certpath,
+                           0, 0);
+    ctx = context_init (ca_conf (30, 30, certpath, capath));
+    if (!(s = flux_sign_wrap (ctx, "foo", 3, "curve", 0))
+            || flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) < 0)
+        BAIL_OUT ("curve wrap/unwrap: %s", flux_security_last_error (ctx));
+
+    ctx2 = context_init (ca_conf (-100, 30, certpath, capath));
+    ok (flux_sign_unwrap (ctx2, s, NULL, NULL, NULL, 0) < 0,
+        "cached envelope is verified again under a different max-ttl");
+    diag ("%s", flux_security_last_error (ctx2));
+    flux_security_destroy (ctx2);
+
+    ctx2 = context_init (ca_conf (30, 30, certpath, capath));
+    ok (flux_sign_unwrap (ctx2, s, NULL, NULL, NULL, 0) == 0,
+        "cached envelope is accepted under the same config");
+    flux_security_destroy (ctx2);
+
+    flux_security_destroy (ctx);
+    sigcert_destroy (cert);
+    ca_files_unlink ();
+}
+
+/* Changing max-ttl keeps all curve state.  Changing [ca] drops only the
+ * CA verifier, not the signing cert.
+ */
+void test_curve_reconfigure (void)
+{
+    char certpath[PATH_MAX + 1];
+    char capath[PATH_MAX + 1];
+    struct sigcert *cert;
+    flux_security_t *ctx;
+    void *sc, *ca;
+    const char *s;
+
+    tmpfile_path (certpath, sizeof (certpath), "sig");
+    tmpfile_path (capath, sizeof (capath), "ca-cert");
+
+    cert = ca_cert_create (ca_conf (30, 30, certpath, capath), certpath,
+                           0, 0);
+    ctx = context_init (ca_conf (30, 30, certpath, capath));
+    ok (roundtrip (ctx, "curve"),
+        "curve wrap/unwrap works with CA-issued cert");
+    sc = flux_security_aux_get (ctx, "flux::sign_curve");
+    ca = flux_security_aux_get (ctx, "flux::sign_curve_ca");
+    if (!sc || !ca)
+        BAIL_OUT ("curve state was not created");
+
+    ok (context_reconfigure (ctx, ca_conf (60, 30, certpath, capath)) == 0
+        && flux_security_aux_get (ctx, "flux::sign_curve") == sc
+        && flux_security_aux_get (ctx, "flux::sign_curve_ca") == ca,
+        "flux_security_reconfigure with new max-ttl keeps curve state");
+    ok (context_reconfigure (ctx, ca_conf (-100, 30, certpath, capath)) == 0
+        && flux_security_aux_get (ctx, "flux::sign_curve") == sc
+        && !roundtrip (ctx, "curve"),
+        "new max-ttl takes effect in kept curve state");
+
+    ok (context_reconfigure (ctx, ca_conf (30, 20, certpath, capath)) == 0
+        && flux_security_aux_get (ctx, "flux::sign_curve") == sc
+        && flux_security_aux_get (ctx, "flux::sign_curve_ca") == NULL,
+        "flux_security_reconfigure with new [ca] drops only the CA state");
+    /* Use a new payload, so that verification is not satisfied from
+     * the verify cache.
+     */
+    if (!(s = flux_sign_wrap (ctx, "bar", 3, "curve", 0)))
+        BAIL_OUT ("flux_sign_wrap: %s", flux_security_last_error (ctx));
+    ok (flux_sign_unwrap (ctx, s, NULL, NULL, NULL, 0) == 0
+        && flux_security_aux_get (ctx, "flux::sign_curve") == sc
+        && flux_security_aux_get (ctx, "flux::sign_curve_ca") != NULL,
+        "curve wrap/unwrap works and CA state was rebuilt");
+
+    flux_security_destroy (ctx);
+    sigcert_destroy (cert);
+    ca_files_unlink ();
+}
+
+/* The signing agent may exit or be restarted while a context holds a
+ * connection to it.  Signing should reconnect, or fall back to the
+ * cert on disk, as it does when the agent is not running at first use.
+ */
+void test_agent (void)
+{
+    char certpath[PATH_MAX + 1];
+    char hidden[PATH_MAX + 1];
+    char pubpath[PATH_MAX + 1];
+    char binpath[PATH_MAX + 1];
+    char dbpath[PATH_MAX + 1];
+    char sockpath[PATH_MAX + 1];
+    struct sigcert *cert;
+    flux_security_t *ctx;
+    pid_t pid;
+
+    tmpfile_path (certpath, sizeof (certpath), "sig");
+    tmpfile_path (hidden, sizeof (hidden), "sig.hidden");
+    tmpfile_path (pubpath, sizeof (pubpath), "sig.pub");
+    tmpfile_path (binpath, sizeof (binpath), "sig.pub.bin");
+    tmpfile_path (dbpath, sizeof (dbpath), "certdb");
+    tmpfile_path (sockpath, sizeof (sockpath), "agent.sock");
+
+    if (!(cert = sigcert_create ())
+            || sigcert_store (cert, certpath) < 0)
+        BAIL_OUT ("failed to create cert: %s", strerror (errno));
+    certdb_write (dbpath, getuid (), cert);
+
+    ctx = context_init (curve_conf (certpath, dbpath, sockpath));
+
+    /* Hide the secret key so that only the agent can sign.
+     */
+    if (rename (certpath, hidden) < 0)
+        BAIL_OUT ("rename %s: %s", certpath, strerror (errno));
+
+    pid = start_agent (cert, sockpath);
+    ok (roundtrip (ctx, "curve"),
+        "curve wrap/unwrap works with signing agent");
+    stop_agent (pid);
+    pid = start_agent (cert, sockpath);
+    ok (roundtrip (ctx, "curve"),
+        "curve wrap/unwrap works after agent restart");
+    stop_agent (pid);
+    ok (flux_sign_wrap (ctx, "foo", 3, "curve", 0) == NULL,
+        "curve wrap fails when agent has exited and no cert is on disk");
+    diag ("%s", flux_security_last_error (ctx));
+
+    if (rename (hidden, certpath) < 0)
+        BAIL_OUT ("rename %s: %s", hidden, strerror (errno));
+
+    pid = start_agent (cert, sockpath);
+    ok (roundtrip (ctx, "curve"),
+        "curve wrap/unwrap works with restarted signing agent");
+    stop_agent (pid);
+    ok (roundtrip (ctx, "curve"),
+        "curve wrap/unwrap falls back to cert on disk when agent exits");
+
+    flux_security_destroy (ctx);
+    sigcert_destroy (cert);
+    (void)unlink (certpath);
+    (void)unlink (pubpath);
+    (void)unlink (binpath);
+    (void)unlink (dbpath);
+    (void)unlink (sockpath);
+}
+
 int main (int argc, char *argv[])
 {
     flux_security_t *ctx;
@@ -534,8 +1206,16 @@ int main (int argc, char *argv[])
     test_badpayload (ctx);
     test_badsignature (ctx);
     test_corner (ctx);
+    test_batch (ctx);
     flux_security_destroy (ctx);
 
+    test_reconfigure ();
+    test_certdb ();
+    test_ca_expiry ();
+    test_vcache_config ();
+    test_curve_reconfigure ();
+    test_agent ();
+
     cfpath_fini ();
 
     done_testing ();
@@ -0,0 +1,424 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* Exercise the sign-munge async hash worker and batch thread pool, which
+ * otherwise run only when munged is available.  The mechanism's static
+ * functions are tested directly by including its source.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <sys/wait.h>
+#include <sys/param.h>
+#include <stdio.h>
+
+#include "src/libtap/tap.h"
+
+#include "src/lib/sign_munge.c"
+
+static BYTE input[4 * ASYNC_HASH_MIN];
+
+/* Hash input asynchronously and check the result against compute_hash().
+ */
+static bool async_hash_ok (struct sign_munge *sm, int type, int inputsz)
+{
+    BYTE digest[HASH_SIZE];
+    BYTE refdigest[HASH_SIZE];
+
+    sm->hash_type = type;
+    if (!hash_async_start (sm, (const char *)input, inputsz))
+        return false;
+    hash_async_wait (sm, digest);
+    compute_hash (type, input, inputsz, refdigest);
+    return memcmp (digest, refdigest, HASH_SIZE) == 0;
+}
+
+void test_async (void)
+{
+    struct sign_munge sm;
+
+    memset (&sm, 0, sizeof (sm));
+    sm.async_hash = true;
+
+    ok (async_hash_ok (&sm, HASH_TYPE_SHA256, ASYNC_HASH_MIN),
+        "hash_async_start works on SHA256 input of ASYNC_HASH_MIN bytes");
+    ok (sm.worker != NULL,
+        "worker thread was started on first use");
+    ok (async_hash_ok (&sm, HASH_TYPE_SHA256, sizeof (input)),
+        "worker thread is reused for another SHA256 input");
+    ok (async_hash_ok (&sm, HASH_TYPE_BLAKE2B, sizeof (input)),
+        "hash_async_start works on BLAKE2B input");
+    ok (async_hash_ok (&sm, HASH_TYPE_TREE_SHA256, sizeof (input)),
+        "hash_async_start works on TREE-SHA256 input");
+
+    ok (hash_async_start (&sm, (const char *)input, ASYNC_HASH_MIN - 1)
+        == false,
+        "hash_async_start declines input smaller than ASYNC_HASH_MIN");
+    sm.async_hash = false;
+    ok (hash_async_start (&sm, (const char *)input, sizeof (input)) == false,
+        "hash_async_start declines when async-hash is disabled");
+
+    hash_worker_destroy (sm.worker);
+}
+
+/* A forked child must start its own worker, since the parent's
+ * thread does not exist in the child.
+ */
+void test_fork (void)
+{
+    struct sign_munge sm;
+    struct hash_worker *parent_worker;
+    pid_t pid;
+    int status;
+
+    memset (&sm, 0, sizeof (sm));
+    sm.async_hash = true;
+
+    if (!async_hash_ok (&sm, HASH_TYPE_SHA256, sizeof (input)))
+        BAIL_OUT ("hash_async_start failed");
+    parent_worker = sm.worker;
+
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork: %s", strerror (errno));
+    if (pid == 0) {
+        if (!async_hash_ok (&sm, HASH_TYPE_SHA256, sizeof (input))
+                || sm.worker == parent_worker)
+            _exit (1);
+        hash_worker_destroy (sm.worker);
+        _exit (0);
+    }
+    ok (waitpid (pid, &status, 0) == pid
+        && WIFEXITED (status) && WEXITSTATUS (status) == 0,
+        "forked child hashes asynchronously with its own worker");
+    ok (async_hash_ok (&sm, HASH_TYPE_SHA256, sizeof (input))
+        && sm.worker == parent_worker,
+        "parent still uses its worker after fork");
+
+    hash_worker_destroy (sm.worker);
+}
+
+static char tmpdir[PATH_MAX + 1];
+static char cfpath[PATH_MAX + 1];
+static char pattern[PATH_MAX + 1];
+
+static void tmpdir_init (void)
+{
+    const char *t = getenv ("TMPDIR");
+    int n = PATH_MAX + 1;
+
+    if (snprintf (tmpdir, n, "%s/sign-munge-XXXXXX", t ? t : "/tmp") >= n
+            || !mkdtemp (tmpdir))
+        BAIL_OUT ("mkdtemp: %s", strerror (errno));
+    if (snprintf (cfpath, n, "%s/conf.toml", tmpdir) >= n
+            || snprintf (pattern, n, "%s/*.toml", tmpdir) >= n)
+        BAIL_OUT ("path buffer overflow");
+}
+
+static void tmpdir_fini (void)
+{
+    (void)unlink (cfpath);
+    if (rmdir (tmpdir) < 0)
+        BAIL_OUT ("rmdir %s: %s", tmpdir, strerror (errno));
+}
+
+/* Write config with 'max_ttl', 'hash_type', and optional 'extra' lines
+ * appended to the [sign.munge] table.
+ */
+static void conf_write (int max_ttl, const char *hash_type,
+                        const char *extra)
+{
+    FILE *f;
+
+    if (!(f = fopen (cfpath, "w"))
+            || fprintf (f, "[sign]\n"
+                           "max-ttl = %d\n"
+                           "default-type = \"munge\"\n"
+                           "allowed-types = [ \"munge\" ]\n"
+                           "[sign.munge]\n"
+                           "hash-type = \"%s\"\n"
+                           "%s",
+                        max_ttl, hash_type, extra ? extra : "") < 0
+            || fclose (f) != 0)
+        BAIL_OUT ("%s: %s", cfpath, strerror (errno));
+}
+
+/* A max-ttl change is applied to the existing mechanism state, so the
+ * munge context and credential cache survive it.  munged is not needed,
+ * since nothing is encoded.
+ */
+void test_reconfigure (void)
+{
+    flux_security_t *ctx;
+    struct sign_munge *sm = NULL;
+
+    conf_write (30, "sha256", NULL);
+    if (!(ctx = flux_security_create (0))
+            || flux_security_configure (ctx, pattern) < 0)
+        BAIL_OUT ("flux_security_configure: %s",
+                  flux_security_last_error (ctx));
+    ok (op_init (ctx, security_get_config (ctx, "sign")) == 0
+        && (sm = flux_security_aux_get (ctx, auxname)) != NULL
+        && sm->max_ttl == 30,
+        "op_init works");
+
+    conf_write (60, "sha256", NULL);
+    ok (flux_security_reconfigure (ctx, pattern) == 0
+        && flux_security_aux_get (ctx, auxname) == sm
+        && sm->max_ttl == 60,
+        "max-ttl change keeps munge state and updates max-ttl");
+
+    conf_write (60, "blake2b", NULL);
+    ok (flux_security_reconfigure (ctx, pattern) == 0
+        && flux_security_aux_get (ctx, auxname) == NULL,
+        "[sign.munge] change drops munge state");
+
+    flux_security_destroy (ctx);
+}
+
+static pthread_mutex_t fake_lock = PTHREAD_MUTEX_INITIALIZER;
+static int fake_active;
+static int fake_max;
+
+/* Stand-in for a munged round trip that records how many jobs
+ * are running at once.
+ */
+static void job_fake (struct munge_job *job, munge_ctx_t munge)
+{
+    pthread_mutex_lock (&fake_lock);
+    if (++fake_active > fake_max)
+        fake_max = fake_active;
+    pthread_mutex_unlock (&fake_lock);
+
+    usleep (20000);
+    job->uid = (munge != NULL);
+
+    pthread_mutex_lock (&fake_lock);
+    fake_active--;
+    pthread_mutex_unlock (&fake_lock);
+}
+
+void test_pool (void)
+{
+    struct munge_pool *p;
+    struct munge_job jobs[16];
+    struct munge_job *posts[16];
+    int count = 0;
+    int i;
+
+    memset (jobs, 0, sizeof (jobs));
+    for (i = 0; i < 16; i++) {
+        jobs[i].run = job_fake;
+        posts[i] = &jobs[i];
+    }
+    if (!(p = munge_pool_create (4, NULL)))
+        BAIL_OUT ("munge_pool_create: %s", strerror (errno));
+    munge_pool_start (p, posts);
+    munge_pool_post (p, 1);
+    munge_pool_wait (p, &jobs[0]);
+    ok (jobs[0].done && !jobs[1].done,
+        "munge_pool runs posted jobs only");
+
+    munge_pool_post (p, 16);
+    for (i = 0; i < 16; i++) {
+        munge_pool_wait (p, &jobs[i]);
+        count += jobs[i].uid;
+    }
+    ok (count == 16,
+        "each job ran with a munge context");
+    ok (fake_max > 1 && fake_max <= 4,
+        "jobs ran concurrently, at most one per thread");
+    diag ("%d jobs ran at once", fake_max);
+
+    munge_pool_destroy (p);
+}
+
+/* A forked child must start its own pool, since the parent's
+ * threads do not exist in the child.
+ */
+void test_pool_fork (void)
+{
+    struct sign_munge sm;
+    struct munge_pool *parent_pool;
+    struct munge_job job;
+    struct munge_job *posts[1] = { &job };
+    pid_t pid;
+    int status;
+
+    memset (&sm, 0, sizeof (sm));
+    sm.batch_threads = 2;
+    if (!(parent_pool = get_pool (&sm)))
+        BAIL_OUT ("get_pool: %s", strerror (errno));
+
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork: %s", strerror (errno));
+    if (pid == 0) {
+        struct munge_pool *p = get_pool (&sm);
+        if (!p || p == parent_pool)
+            _exit (1);
+        memset (&job, 0, sizeof (job));
+        job.run = job_fake;
+        munge_pool_start (p, posts);
+        munge_pool_post (p, 1);
+        munge_pool_wait (p, &job);
+        munge_pool_destroy (p);
+        _exit (job.uid == 1 ? 0 : 1);
+    }
+    ok (waitpid (pid, &status, 0) == pid
+        && WIFEXITED (status) && WEXITSTATUS (status) == 0,
+        "forked child runs jobs on its own pool");
+    ok (get_pool (&sm) == parent_pool,
+        "parent still uses its pool after fork");
+
+    munge_pool_destroy (sm.pool);
+}
+
+/* Build a munge envelope for 'payload' with signature 'cred'.  If 'seed'
+ * is true, add 'cred' to the decoded-credential cache of 'sm' as though
+ * munged had decoded it, so it verifies without munged.
+ */
+static char *envelope (struct sign_munge *sm, const char *payload,
+                       const char *cred, bool seed)
+{
+    struct kv *header;
+    const char *src;
+    int srclen;
+    char buf[1024];
+    int len;
+    BYTE digest[HASH_SIZE + 1];
+    BYTE key[SHA256_BLOCK_SIZE];
+    char *s;
+
+    if (!(header = kv_create ())
+            || kv_put (header, "version", KV_INT64, 1) < 0
+            || kv_put (header, "mechanism", KV_STRING, "munge") < 0
+            || kv_put (header, "userid", KV_INT64, (int64_t)getuid ()) < 0
+            || kv_encode (header, &src, &srclen) < 0)
+        BAIL_OUT ("kv: %s", strerror (errno));
+    sodium_bin2base64 (buf, sizeof (buf) / 2, (const unsigned char *)src,
+                       srclen, sodium_base64_VARIANT_ORIGINAL);
+    kv_destroy (header);
+    len = strlen (buf);
+    buf[len++] = '.';
+    sodium_bin2base64 (buf + len, sizeof (buf) / 2 - len,
+                       (const unsigned char *)payload, strlen (payload),
+                       sodium_base64_VARIANT_ORIGINAL);
+    if (seed) {
+        digest[0] = HASH_TYPE_SHA256;
+        compute_hash (HASH_TYPE_SHA256, (const BYTE *)buf, strlen (buf),
+                      digest + 1);
+        cred_key (cred, key);
+        cred_cache_put (sm, key, getuid (), time (NULL), (char *)digest,
+                        sizeof (digest), time (NULL));
+    }
+    len = strlen (buf);
+    buf[len++] = '.';
+    strcpy (buf + len, cred);
+    if (!(s = strdup (buf)))
+        BAIL_OUT ("strdup failed");
+    return s;
+}
+
+/* With no munged listening, requests fail quickly, so batches can be
+ * checked end to end with credentials seeded into the cache.
+ */
+void test_batch (void)
+{
+    char extra[PATH_MAX + 64];
+    struct flux_sign_batch_item items[4];
+    flux_security_t *ctx;
+    struct sign_munge *sm = NULL;
+    char *s[4];
+    int n = sizeof (extra);
+    int i;
+
+    if (snprintf (extra, n, "socket-path = \"%s/nosuch.sock\"\n"
+                            "batch-threads = 3\n", tmpdir) >= n)
+        BAIL_OUT ("config buffer overflow");
+    conf_write (30, "sha256", extra);
+    if (!(ctx = flux_security_create (0))
+            || flux_security_configure (ctx, pattern) < 0)
+        BAIL_OUT ("flux_security_configure: %s",
+                  flux_security_last_error (ctx));
+
+    memset (items, 0, sizeof (items));
+    for (i = 0; i < 4; i++) {
+        items[i].payload = "foo";
+        items[i].payloadsz = 3;
+    }
+    errno = 0;
+    ok (flux_sign_wrap_batch (ctx, items, 4, NULL, 0) < 0 && errno == EINVAL,
+        "flux_sign_wrap_batch fails with EINVAL without munged");
+    ok (items[0].errnum == EINVAL && items[3].errnum == EINVAL
+        && items[0].input == NULL,
+        "each item failed");
+    ok (strstr (flux_security_last_error (ctx), "sign-munge-sign") != NULL,
+        "error is from munge_encode");
+    diag ("%s", flux_security_last_error (ctx));
+    ok ((sm = flux_security_aux_get (ctx, auxname)) != NULL
+        && sm->pool != NULL && sm->pool->nthreads == 3,
+        "batch-threads sets the number of pool threads");
+    if (!sm)
+        BAIL_OUT ("munge state is missing");
+
+    s[0] = envelope (sm, "foo", "cred-0", true);
+    s[1] = envelope (sm, "bar", "cred-1", false);
+    free (envelope (sm, "baz", "cred-2", true));
+    s[2] = envelope (sm, "qux", "cred-2", false);
+    s[3] = envelope (sm, "quux", "cred-3", true);
+    memset (items, 0, sizeof (items));
+    for (i = 0; i < 4; i++)
+        items[i].input = s[i];
+    errno = 0;
+    ok (flux_sign_unwrap_batch (ctx, items, 4, 0) < 0 && errno == EINVAL,
+        "flux_sign_unwrap_batch with bad items fails with EINVAL");
+    ok (items[0].errnum == 0 && items[0].payloadsz == 3
+        && memcmp (items[0].payload, "foo", 3) == 0
+        && items[3].errnum == 0 && items[3].payloadsz == 4
+        && memcmp (items[3].payload, "quux", 4) == 0,
+        "items with cached credentials were verified");
+    ok (items[1].errnum == EINVAL,
+        "item sent to munged failed");
+    ok (items[2].errnum == EINVAL,
+        "item whose payload does not match its credential failed");
+    diag ("%s", flux_security_last_error (ctx));
+
+    conf_write (30, "sha256", "batch-threads = 0\n");
+    ok (flux_security_reconfigure (ctx, pattern) < 0
+        && strstr (flux_security_last_error (ctx), "batch-threads") != NULL,
+        "batch-threads = 0 is rejected");
+    diag ("%s", flux_security_last_error (ctx));
+
+    for (i = 0; i < 4; i++)
+        free (s[i]);
+    flux_security_destroy (ctx);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    randombytes_buf (input, sizeof (input));
+    tmpdir_init ();
+
+    test_async ();
+    test_fork ();
+    test_reconfigure ();
+    test_pool ();
+    test_pool_fork ();
+    test_batch ();
+
+    tmpdir_fini ();
+    done_testing ();
+}
+
+/*
+ * vi: ts=4 sw=4 expandtab
+ */
@@ -21,17 +21,49 @@
 #include <string.h>
 #include <stdarg.h>
 #include <uuid.h>
+#include <glob.h>
+#include <limits.h>
 #include <assert.h>
 
 #include "src/libutil/cf.h"
+#include "src/libutil/hash.h"
 #include "sigcert.h"
 #include "ca.h"
 
 #define UUID_STRING_SIZE    37  // see uuid_unparse(3)
+#define MAX_CHAIN_DEPTH     8   // max intermediate CA certs in a chain
+
+enum {
+    CHAIN_UNCHECKED = 0,
+    CHAIN_VALID,
+    CHAIN_INVALID,
+};
+
+/* A CA cert from 'trust-dir'.  Self-signed certs are trust anchors.
+ * Others are intermediates, whose signature is checked against their
+ * issuer by check_links() whenever the CA cert is set, and the result
+ * cached in 'state', with 'issuer' pointing to the issuing trust cert
+ * (NULL if issued by the configured CA cert).
+ */
+struct trust_cert {
+    struct sigcert *cert;
+    const struct sigcert_info *info;
+    int state;
+    const struct trust_cert *issuer;
+};
 
 struct ca {
     cf_t *cf;                   // config table is cached
     struct sigcert *ca_cert;    // the CA certificate
+    hash_t trust;               // trust_cert's from 'trust-dir', by uuid
+
+    int64_t max_cert_ttl;       // values bound from 'cf' by cf_bind()
+    int64_t max_sign_ttl;
+    const char *cert_path;
+    const char *revoke_dir;
+    bool revoke_allow;
+    const char *domain;
+    const char *trust_dir;
 };
 
 static const struct cf_option ca_opts[] = {
@@ -41,9 +73,21 @@ static const struct cf_option ca_opts[] = {
     {"revoke-dir",      CF_STRING,   true},
     {"revoke-allow",    CF_BOOL,     true},
     {"domain",          CF_STRING,   true},
+    {"trust-dir",       CF_STRING,   false},
     CF_OPTIONS_TABLE_END,
 };
 
+static const struct cf_field ca_fields[] = {
+    CF_FIELD ("max-cert-ttl", struct ca, max_cert_ttl),
+    CF_FIELD ("max-sign-ttl", struct ca, max_sign_ttl),
+    CF_FIELD ("cert-path", struct ca, cert_path),
+    CF_FIELD ("revoke-dir", struct ca, revoke_dir),
+    CF_FIELD ("revoke-allow", struct ca, revoke_allow),
+    CF_FIELD ("domain", struct ca, domain),
+    CF_FIELD ("trust-dir", struct ca, trust_dir),
+    CF_FIELDS_TABLE_END,
+};
+
 /* Update 'e' if non-NULL.
  * If 'fmt' is non-NULL, build message; otherwise use strerror (errno).
  */
@@ -88,16 +132,17 @@ struct ca *ca_create (const cf_t *cf, ca_error_t e)
         errno = EINVAL;
         goto error;
     }
-    if (cf_check (cf, ca_opts, CF_STRICT, &error) < 0) {
+    if (!(ca = ca_alloc (cf))) {
+        goto error;
+    }
+    if (cf_bind (ca->cf, ca_opts, ca_fields, CF_STRICT, ca, &error) < 0) {
+        ca_destroy (ca);
         if (errno == EINVAL) {
             ca_error (e, "%s", error.errbuf);
             return NULL;
         }
         goto error;
     }
-    if (!(ca = ca_alloc (cf))) {
-        goto error;
-    }
     return ca;
 error:
     ca_error (e, NULL);
@@ -109,6 +154,8 @@ void ca_destroy (struct ca *ca)
     if (ca) {
         int saved_errno = errno;
         sigcert_destroy (ca->ca_cert);
+        if (ca->trust)
+            hash_destroy (ca->trust);
         cf_destroy (ca->cf);
         free (ca);
         errno = saved_errno;
@@ -120,13 +167,14 @@ static int sign_with (const struct ca *ca, const struct sigcert *ca_cert,
                       int64_t ttl, int64_t userid,
                       bool ca_capability, ca_error_t e)
 {
-    int64_t max_cert_ttl = cf_int64 (cf_get_in (ca->cf, "max-cert-ttl"));
-    int64_t max_sign_ttl = cf_int64 (cf_get_in (ca->cf, "max-sign-ttl"));
-    const char *domain = cf_string (cf_get_in (ca->cf, "domain"));
+    int64_t max_cert_ttl = ca->max_cert_ttl;
+    int64_t max_sign_ttl = ca->max_sign_ttl;
+    const char *domain = ca->domain;
     uuid_t uuid_bin;
     char uuid[UUID_STRING_SIZE];
     time_t now;
     const char *ca_uuid;
+    const struct sigcert_info *ca_info;
 
     if (ttl > max_cert_ttl) {
         errno = EINVAL;
@@ -139,6 +187,29 @@ static int sign_with (const struct ca *ca, const struct sigcert *ca_cert,
         goto error;
     if (not_valid_before_time == 0)
         not_valid_before_time = now;
+    if (ca_cert != cert) {
+        if (!(ca_info = sigcert_info (ca_cert)))
+            goto error;
+        if (!(ca_info->valid & SIGCERT_INFO_UUID)) {
+            errno = ENOENT;
+            goto error;
+        }
+        /* An intermediate CA cert must not outlive its issuer.
+         */
+        if (ca_capability && (ca_info->valid & SIGCERT_INFO_XTIME)) {
+            if (ca_info->xtime <= not_valid_before_time) {
+                errno = EINVAL;
+                ca_error (e, "CA cert expires before not-valid-before-time");
+                return -1;
+            }
+            if (ttl > ca_info->xtime - not_valid_before_time)
+                ttl = ca_info->xtime - not_valid_before_time;
+        }
+        ca_uuid = ca_info->uuid;
+    }
+    else { // self-signed
+        ca_uuid = uuid;
+    }
 
     uuid_generate (uuid_bin);
     uuid_unparse (uuid_bin, uuid);
@@ -156,13 +227,6 @@ static int sign_with (const struct ca *ca, const struct sigcert *ca_cert,
         goto error;
     if (sigcert_meta_set (cert, "max-sign-ttl", SM_INT64, max_sign_ttl) < 0)
         goto error;
-    if (ca_cert != cert) {
-        if (sigcert_meta_get (ca_cert, "uuid", SM_STRING, &ca_uuid) < 0)
-            goto error;
-    }
-    else { // self-signed
-        ca_uuid = uuid;
-    }
     if (sigcert_meta_set (cert, "issuer", SM_STRING, ca_uuid) < 0)
         goto error;
     if (sigcert_meta_set (cert, "domain", SM_STRING, domain) < 0)
@@ -177,6 +241,21 @@ error:
     return -1;
 }
 
+static int check_signer (const struct ca *ca, ca_error_t e)
+{
+    if (!ca->ca_cert) {
+        errno = EINVAL;
+        ca_error (e, "CA cert has not been loaded/generated");
+        return -1;
+    }
+    if (!sigcert_has_secret (ca->ca_cert)) {
+        errno = EINVAL;
+        ca_error (e, "CA cert does not contain secret key");
+        return -1;
+    }
+    return 0;
+}
+
 int ca_sign (const struct ca *ca, struct sigcert *cert,
              time_t not_valid_before_time, int64_t ttl,
              int64_t userid, ca_error_t e)
@@ -186,18 +265,25 @@ int ca_sign (const struct ca *ca, struct sigcert *cert,
         ca_error (e, NULL);
         return -1;
     }
-    if (!ca->ca_cert) {
-        errno = EINVAL;
-        ca_error (e, "CA cert has not been loaded/generated");
+    if (check_signer (ca, e) < 0)
         return -1;
-    }
-    if (!sigcert_has_secret (ca->ca_cert)) {
+    return sign_with (ca, ca->ca_cert, cert, not_valid_before_time, ttl,
+                      userid, false, e);
+}
+
+int ca_sign_ca (const struct ca *ca, struct sigcert *cert,
+                time_t not_valid_before_time, int64_t ttl,
+                int64_t userid, ca_error_t e)
+{
+    if (!ca || !cert || ttl < 0 || not_valid_before_time < 0 || userid < 0) {
         errno = EINVAL;
-        ca_error (e, "CA cert does not contain secret key");
+        ca_error (e, NULL);
         return -1;
     }
+    if (check_signer (ca, e) < 0)
+        return -1;
     return sign_with (ca, ca->ca_cert, cert, not_valid_before_time, ttl,
-                      userid, false, e);
+                      userid, true, e);
 }
 
 int ca_revoke (const struct ca *ca, const char *uuid, ca_error_t e)
@@ -210,11 +296,11 @@ int ca_revoke (const struct ca *ca, const char *uuid, ca_error_t e)
         errno = EINVAL;
         goto error;
     }
-    if (!cf_bool (cf_get_in (ca->cf, "revoke-allow"))) {
+    if (!ca->revoke_allow) {
         ca_error (e, "revocation not permitted on this node");
         return -1;
     }
-    dir = cf_string (cf_get_in (ca->cf, "revoke-dir"));
+    dir = ca->revoke_dir;
     if (mkdir (dir, 0755) < 0) {
         if (errno != EEXIST)
             goto error;
@@ -241,7 +327,7 @@ static int check_revocation (const struct ca *ca, const char *uuid,
                              ca_error_t e)
 {
     char path[PATH_MAX + 1];
-    const char *dir = cf_string (cf_get_in (ca->cf, "revoke-dir"));
+    const char *dir = ca->revoke_dir;
     if (snprintf (path, sizeof (path), "%s/%s", dir, uuid) >= sizeof (path)) {
         errno = EINVAL;
         ca_error (e, NULL);
@@ -255,17 +341,136 @@ static int check_revocation (const struct ca *ca, const char *uuid,
     return 0;
 }
 
+/* Find the trust-dir cert whose uuid matches the issuer of 'info'.
+ * Returns NULL if there is none, i.e. the configured CA cert is the issuer.
+ */
+static const struct trust_cert *find_issuer (const struct ca *ca,
+                                             const struct sigcert_info *info)
+{
+    if (ca->trust && (info->valid & SIGCERT_INFO_ISSUER))
+        return hash_find (ca->trust, info->issuer);
+    return NULL;
+}
+
+static bool is_self_signed (const struct sigcert_info *info)
+{
+    return (info->valid & SIGCERT_INFO_ISSUER)
+        && !strcmp (info->issuer, info->uuid);
+}
+
+/* Verify the signature of trust cert 'tc' against its issuer and cache
+ * the result in tc->state.  The issuer's own link is checked separately.
+ */
+static int check_link (void *data, const void *key, void *arg)
+{
+    struct trust_cert *tc = data;
+    const struct ca *ca = arg;
+    const struct sigcert *issuer_cert;
+
+    tc->state = CHAIN_UNCHECKED;
+    tc->issuer = NULL;
+    if (is_self_signed (tc->info))
+        return 0;
+    if ((tc->issuer = find_issuer (ca, tc->info)))
+        issuer_cert = tc->issuer->cert;
+    else
+        issuer_cert = ca->ca_cert;
+    if (issuer_cert) {
+        if (sigcert_verify_cert (issuer_cert, tc->cert) < 0)
+            tc->state = CHAIN_INVALID;
+        else
+            tc->state = CHAIN_VALID;
+    }
+    return 0;
+}
+
+/* (Re-)check all trust-dir links.  Call whenever the CA cert changes,
+ * since intermediates without a trust-dir issuer are verified with it.
+ */
+static void check_links (struct ca *ca)
+{
+    if (ca->trust)
+        (void)hash_for_each (ca->trust, check_link, ca);
+}
+
+/* Check the chain from trust cert 'tc' up to a trust anchor or the
+ * configured CA cert.  Signatures were verified by check_links().
+ * Validity times and revocation of intermediates are checked on every
+ * call since they may change.
+ */
+static int check_chain (const struct ca *ca, const struct trust_cert *tc,
+                        time_t now, ca_error_t e)
+{
+    int depth = 0;
+
+    while (tc && !is_self_signed (tc->info)) {
+        if (depth++ >= MAX_CHAIN_DEPTH) {
+            errno = EINVAL;
+            ca_error (e, "CA chain is too long");
+            return -1;
+        }
+        if (tc->state != CHAIN_VALID) {
+            errno = EINVAL;
+            ca_error (e, "intermediate CA cert signature verification failed");
+            return -1;
+        }
+        if ((tc->info->valid & SIGCERT_INFO_XTIME) && tc->info->xtime < now) {
+            errno = EINVAL;
+            ca_error (e, "intermediate CA cert has expired");
+            return -1;
+        }
+        if ((tc->info->valid & SIGCERT_INFO_NOT_VALID_BEFORE_TIME)
+                && tc->info->not_valid_before_time > now) {
+            errno = EINVAL;
+            ca_error (e, "intermediate CA cert is not yet valid");
+            return -1;
+        }
+        if (check_revocation (ca, tc->info->uuid, e) < 0)
+            return -1;
+        tc = tc->issuer;
+    }
+    return 0;
+}
+
+/* Return the earliest of 'xtime' and the expiration times of the CA certs
+ * that vouch for a cert issued by 'tc', up to and including a trust anchor
+ * or the configured CA cert.  'tc' may be NULL if the configured CA cert
+ * is the issuer.
+ */
+static time_t chain_xtime (const struct ca *ca, const struct trust_cert *tc,
+                           time_t xtime)
+{
+    const struct sigcert_info *info;
+
+    while (tc) {
+        if ((tc->info->valid & SIGCERT_INFO_XTIME) && tc->info->xtime < xtime)
+            xtime = tc->info->xtime;
+        if (is_self_signed (tc->info))
+            return xtime;
+        tc = tc->issuer;
+    }
+    if ((info = sigcert_info (ca->ca_cert))
+            && (info->valid & SIGCERT_INFO_XTIME)
+            && info->xtime < xtime)
+        xtime = info->xtime;
+    return xtime;
+}
+
 int ca_verify (const struct ca *ca, const struct sigcert *cert,
-               int64_t *useridp, int64_t *max_sign_ttlp, ca_error_t e)
+               int64_t *useridp, int64_t *max_sign_ttlp, time_t *xtimep,
+               ca_error_t e)
 {
-    int64_t max_sign_ttl;
-    int64_t userid;
-    time_t ctime;
-    time_t xtime;
-    time_t not_valid_before_time;
+    const int required = SIGCERT_INFO_UUID
+                       | SIGCERT_INFO_NOT_VALID_BEFORE_TIME
+                       | SIGCERT_INFO_CTIME
+                       | SIGCERT_INFO_XTIME
+                       | SIGCERT_INFO_USERID
+                       | SIGCERT_INFO_MAX_SIGN_TTL;
+    const struct sigcert *ca_cert;
+    const struct sigcert_info *ca_info;
+    const struct sigcert_info *info;
+    const struct trust_cert *tc;
     time_t now;
-    const char *uuid;
-    bool ca_capability;
 
     if (!ca || !cert) {
         errno = EINVAL;
@@ -276,48 +481,49 @@ int ca_verify (const struct ca *ca, const struct sigcert *cert,
         errno = EINVAL;
         return -1;
     }
-    if (sigcert_meta_get (ca->ca_cert, "ca-capability", SM_BOOL,
-                          &ca_capability) < 0 || ca_capability == false) {
+    if (!(info = sigcert_info (cert)))
+        goto error;
+    if (time (&now) == (time_t)-1)
+        goto error;
+    if ((tc = find_issuer (ca, info))) {
+        if (check_chain (ca, tc, now, e) < 0)
+            return -1;
+        ca_cert = tc->cert;
+    }
+    else
+        ca_cert = ca->ca_cert;
+    if (!(ca_info = sigcert_info (ca_cert))
+            || !(ca_info->valid & SIGCERT_INFO_CA_CAPABILITY)
+            || ca_info->ca_capability == false) {
         errno = EINVAL;
         ca_error (e, "ca certificate lacks ca-capability");
         return -1;
     }
-    if (time (&now) == (time_t)-1)
-        goto error;
-    if (sigcert_verify_cert (ca->ca_cert, cert) < 0) {
+    if (sigcert_verify_cert (ca_cert, cert) < 0) {
         ca_error (e, "signature verification failed");
         errno = EINVAL;
         return -1;
     }
-    if (sigcert_meta_get (cert, "uuid", SM_STRING, &uuid) < 0)
-        goto error_cert;
-    if (sigcert_meta_get (cert, "not-valid-before-time", SM_TIMESTAMP,
-                          &not_valid_before_time) < 0)
-        goto error_cert;
-    if (sigcert_meta_get (cert, "ctime", SM_TIMESTAMP, &ctime) < 0)
-        goto error_cert;
-    if (sigcert_meta_get (cert, "xtime", SM_TIMESTAMP, &xtime) < 0)
+    if ((info->valid & required) != required)
         goto error_cert;
-    if (sigcert_meta_get (cert, "userid", SM_INT64, &userid) < 0)
-        goto error_cert;
-    if (sigcert_meta_get (cert, "max-sign-ttl", SM_INT64, &max_sign_ttl) < 0)
-        goto error_cert;
-    if (xtime < now) {
+    if (info->xtime < now) {
         ca_error (e, "cert has expired");
         errno = EINVAL;
         return -1;
     }
-    if (not_valid_before_time > now) {
+    if (info->not_valid_before_time > now) {
         ca_error (e, "cert is not yet valid");
         errno = EINVAL;
         return -1;
     }
-    if (check_revocation (ca, uuid, e) < 0)
+    if (check_revocation (ca, info->uuid, e) < 0)
         return -1;
     if (useridp)
-        *useridp = userid;
+        *useridp = info->userid;
     if (max_sign_ttlp)
-        *max_sign_ttlp = max_sign_ttl;
+        *max_sign_ttlp = info->max_sign_ttl;
+    if (xtimep)
+        *xtimep = chain_xtime (ca, tc, info->xtime);
     return 0;
 error_cert:
     ca_error (e, "required metadata is missing from cert");
@@ -353,6 +559,7 @@ int ca_keygen (struct ca *ca, time_t not_valid_before_time,
     }
     sigcert_destroy (ca->ca_cert);
     ca->ca_cert = cert;
+    check_links (ca);
     return 0;
 }
 
@@ -365,7 +572,7 @@ int ca_store (const struct ca *ca, ca_error_t e)
         ca_error (e, NULL);
         return -1;
     }
-    path = cf_string (cf_get_in (ca->cf, "cert-path"));
+    path = ca->cert_path;
     if (!ca->ca_cert) {
         errno = EINVAL;
         ca_error (e, "CA cert was not initialized");
@@ -383,6 +590,113 @@ int ca_store (const struct ca *ca, ca_error_t e)
     return 0;
 }
 
+static void trust_cert_destroy (struct trust_cert *tc)
+{
+    if (tc) {
+        int saved_errno = errno;
+        sigcert_destroy (tc->cert);
+        free (tc);
+        errno = saved_errno;
+    }
+}
+
+/* Load public CA certs from 'trust-dir' (if configured), indexed by uuid.
+ * Each cert must have a uuid and ca-capability = true.
+ * Intermediate certs are verified by check_links() once the CA cert is set.
+ */
+static int load_trust_dir (struct ca *ca, ca_error_t e)
+{
+    char pattern[PATH_MAX + 1];
+    char name[PATH_MAX + 1];
+    glob_t gl;
+    hash_t trust;
+    size_t i;
+    int rc;
+
+    if (!ca->trust_dir)
+        return 0;
+    if (snprintf (pattern, sizeof (pattern), "%s/*.pub",
+                  ca->trust_dir) >= sizeof (pattern)) {
+        errno = EINVAL;
+        ca_error (e, NULL);
+        return -1;
+    }
+    if (!(trust = hash_create (0, (hash_key_f)hash_key_string,
+                                  (hash_cmp_f)strcmp,
+                                  (hash_del_f)trust_cert_destroy))) {
+        ca_error (e, NULL);
+        return -1;
+    }
+    if ((rc = glob (pattern, GLOB_ERR, NULL, &gl)) != 0
+                                            && rc != GLOB_NOMATCH) {
+        errno = EINVAL;
+        ca_error (e, "%s: error reading trust-dir", ca->trust_dir);
+        hash_destroy (trust);
+        return -1;
+    }
+    for (i = 0; rc == 0 && i < gl.gl_pathc; i++) {
+        const struct sigcert_info *info;
+        struct sigcert *cert;
+        struct trust_cert *tc;
+        size_t len = strlen (gl.gl_pathv[i]) - strlen (".pub");
+
+        if (len >= sizeof (name)) {
+            errno = EINVAL;
+            ca_error (e, "%s: %s", gl.gl_pathv[i], strerror (errno));
+            goto error;
+        }
+        memcpy (name, gl.gl_pathv[i], len);
+        name[len] = '\0';
+        if (!(cert = sigcert_load (name, false))) {
+            ca_error (e, "%s: %s", gl.gl_pathv[i], strerror (errno));
+            goto error;
+        }
+        if (!(info = sigcert_info (cert))
+                || !(info->valid & SIGCERT_INFO_UUID)
+                || !(info->valid & SIGCERT_INFO_CA_CAPABILITY)
+                || info->ca_capability == false) {
+            errno = EINVAL;
+            ca_error (e, "%s: not a CA cert", gl.gl_pathv[i]);
+            sigcert_destroy (cert);
+            goto error;
+        }
+        if (!(tc = calloc (1, sizeof (*tc)))) {
+            ca_error (e, NULL);
+            sigcert_destroy (cert);
+            goto error;
+        }
+        tc->cert = cert;
+        tc->info = info;
+        if (!hash_insert (trust, info->uuid, tc)) {
+            struct trust_cert *dup;
+            if (errno != EEXIST) {
+                ca_error (e, NULL);
+                trust_cert_destroy (tc);
+                goto error;
+            }
+            dup = hash_find (trust, info->uuid);
+            if (!dup || !sigcert_equal (dup->cert, cert)) {
+                errno = EINVAL;
+                ca_error (e, "%s: conflicting trust cert with uuid %s",
+                          gl.gl_pathv[i], info->uuid);
+                trust_cert_destroy (tc);
+                goto error;
+            }
+            trust_cert_destroy (tc); // another copy of the same cert
+        }
+    }
+    if (rc == 0)
+        globfree (&gl);
+    if (ca->trust)
+        hash_destroy (ca->trust);
+    ca->trust = trust;
+    return 0;
+error:
+    globfree (&gl);
+    hash_destroy (trust);
+    return -1;
+}
+
 int ca_load (struct ca *ca, bool secret, ca_error_t e)
 {
     const char *path;
@@ -393,13 +707,18 @@ int ca_load (struct ca *ca, bool secret, ca_error_t e)
         ca_error (e, NULL);
         return -1;
     }
-    path = cf_string (cf_get_in (ca->cf, "cert-path"));
+    path = ca->cert_path;
     if (!(cert = sigcert_load (path, secret))) {
         ca_error (e, "%s: %s", path, strerror (errno));
         return -1;
     }
+    if (load_trust_dir (ca, e) < 0) {
+        sigcert_destroy (cert);
+        return -1;
+    }
     sigcert_destroy (ca->ca_cert);
     ca->ca_cert = cert;
+    check_links (ca);
     return 0;
 }
 
@@ -428,6 +747,7 @@ int ca_set_cert (struct ca *ca, const struct sigcert *ca_cert, ca_error_t e)
     }
     sigcert_destroy (ca->ca_cert);
     ca->ca_cert = cpy;
+    check_links (ca);
     return 0;
 }
 
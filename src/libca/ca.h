@@ -34,6 +34,18 @@
  *
  * Cert revocation consists of placing the uuid of a cert in a directory
  * that is propagated along with the CA public key.
+ *
+ * Additional CA public certs (e.g. during CA key rotation) may be placed
+ * in the optional 'trust-dir'.  A user cert is verified with the CA cert
+ * whose uuid matches the cert's 'issuer'.
+ *
+ * A site-local intermediate CA cert may be signed by the CA with
+ * ca_sign_ca(), then used to sign user certs.  Verifiers need its public
+ * cert in 'trust-dir'.  Self-signed certs in 'trust-dir' are trust anchors;
+ * any other cert there must chain up to an anchor or the configured CA
+ * cert.  Each link of a chain is verified when the CA cert is loaded or set
+ * and the result is cached, so verifying a user cert costs one signature
+ * check.
  */
 
 typedef char ca_error_t[200];
@@ -57,6 +69,16 @@ int ca_sign (const struct ca *ca, struct sigcert *cert,
              time_t not_valid_before_time, int64_t ttl,
              int64_t userid, ca_error_t error);
 
+/* Like ca_sign(), but set ca-capability = true in 'cert' so it may be
+ * used as an intermediate CA.  'userid' is the uid of the intermediate
+ * CA's owner.  The cert expires no later than the signing CA cert.
+ * Return 0 on success, -1 on failure with errno set.
+ * On failure, if 'error' is non-NULL, it will contain a textual error message.
+ */
+int ca_sign_ca (const struct ca *ca, struct sigcert *cert,
+                time_t not_valid_before_time, int64_t ttl,
+                int64_t userid, ca_error_t error);
+
 /* Add cert identified by 'uuid' to the revocation list.
  * This creates an empty file named 'uuid' in 'revoke-dir'.
  * This function fails if 'revoke-allow' is false on this node,
@@ -70,11 +92,14 @@ int ca_revoke (const struct ca *ca, const char *uuid, ca_error_t error);
  * This function fails if the CA public key has not been loaded with ca_load
  * or ca_keygen.  Return the userid in 'userid' if non-NULL.
  * Return the max-sign-ttl in 'max_sign_ttl' if non-NULL.
+ * Return the earliest expiration time of 'cert' and the CA certs it chains
+ * up to in 'xtime' if non-NULL.
  * Return 0 on success, -1 on failure with errno set.
  * On failure, if 'error' is non-NULL, it will contain a textual error message.
  */
 int ca_verify (const struct ca *ca, const struct sigcert *cert,
-               int64_t *userid, int64_t *max_sign_ttl, ca_error_t error);
+               int64_t *userid, int64_t *max_sign_ttl, time_t *xtime,
+               ca_error_t error);
 
 /* Generate new CA cert in memory, replacing any cached cert with the new one.
  * Return 0 on success, -1 on failure with errno set.
@@ -92,6 +117,7 @@ int ca_store (const struct ca *ca, ca_error_t error);
 /* Load CA cert from configured path, replacing any cached cert with load one.
  * Call with secret=true to load secret key for signing certs.
  * Call with secret=false to load only public key for verifying certs.
+ * Public CA certs in 'trust-dir', if configured, are loaded as well.
  * Return 0 on success, -1 on failure with errno set.
  * On failure, if 'error' is non-NULL, it will contain a textual error message.
  */
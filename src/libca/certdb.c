@@ -0,0 +1,419 @@
+/************************************************************\
+ * Copyright 2017 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+
+#include "sigcert.h"
+#include "certdb.h"
+
+/* File layout: header, 'count' index entries sorted by userid, then
+ * records in sigcert_encode_bin() format, each aligned to 8 bytes.
+ * Fields are in host byte order.
+ */
+#define CERTDB_MAGIC "FLXCDB01"
+#define CERTDB_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+struct certdb_header {
+    char magic[8];
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct certdb_index {
+    int64_t userid;
+    uint64_t offset;
+    uint64_t len;
+};
+
+struct certdb {
+    void *map;
+    size_t size;
+    dev_t dev;              // identity of the file at open, for
+    ino_t ino;              //   certdb_changed()
+    struct timespec mtime;
+    const struct certdb_index *index;
+    uint32_t count;
+};
+
+/* Builder entries are appended in order.  At write time they are sorted
+ * by (userid, seq) and only the last entry for each userid is kept.
+ * A NULL 'buf' marks a removed userid.
+ */
+struct builder_entry {
+    int64_t userid;
+    size_t seq;
+    void *buf;
+    size_t len;
+};
+
+struct certdb_builder {
+    struct builder_entry *entries;
+    size_t count;
+    size_t size;
+};
+
+void certdb_close (struct certdb *db)
+{
+    if (db) {
+        int saved_errno = errno;
+        if (db->map)
+            (void)munmap (db->map, db->size);
+        free (db);
+        errno = saved_errno;
+    }
+}
+
+struct certdb *certdb_open (const char *path)
+{
+    struct certdb *db;
+    struct certdb_header hdr;
+    struct stat sb;
+    int fd;
+
+    if (!path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(db = calloc (1, sizeof (*db))))
+        return NULL;
+    if ((fd = open (path, O_RDONLY)) < 0)
+        goto error;
+    if (fstat (fd, &sb) < 0)
+        goto error_close;
+    /* Anyone who can write the database can bind a userid to any key.
+     */
+    if (!S_ISREG (sb.st_mode)
+            || (sb.st_uid != 0 && sb.st_uid != geteuid ())
+            || (sb.st_mode & (S_IWGRP | S_IWOTH))) {
+        errno = EPERM;
+        goto error_close;
+    }
+    if (sb.st_size < sizeof (hdr)) {
+        errno = EINVAL;
+        goto error_close;
+    }
+    db->size = sb.st_size;
+    db->dev = sb.st_dev;
+    db->ino = sb.st_ino;
+    db->mtime = sb.st_mtim;
+    if ((db->map = mmap (NULL, db->size, PROT_READ, MAP_SHARED,
+                         fd, 0)) == MAP_FAILED) {
+        db->map = NULL;
+        goto error_close;
+    }
+    (void)close (fd);
+    memcpy (&hdr, db->map, sizeof (hdr));
+    if (memcmp (hdr.magic, CERTDB_MAGIC, sizeof (hdr.magic)) != 0
+            || hdr.count > (db->size - sizeof (hdr))
+                                    / sizeof (struct certdb_index)) {
+        errno = EINVAL;
+        goto error;
+    }
+    db->count = hdr.count;
+    db->index = (const struct certdb_index *)((char *)db->map + sizeof (hdr));
+    return db;
+error_close:
+    (void)close (fd);
+error:
+    certdb_close (db);
+    return NULL;
+}
+
+bool certdb_changed (const struct certdb *db, const char *path)
+{
+    struct stat sb;
+
+    if (!db || !path || stat (path, &sb) < 0)
+        return false;
+    return sb.st_dev != db->dev
+        || sb.st_ino != db->ino
+        || sb.st_size != db->size
+        || sb.st_mtim.tv_sec != db->mtime.tv_sec
+        || sb.st_mtim.tv_nsec != db->mtime.tv_nsec;
+}
+
+int certdb_count (const struct certdb *db)
+{
+    return db ? db->count : 0;
+}
+
+static const struct certdb_index *certdb_find (const struct certdb *db,
+                                               int64_t userid)
+{
+    uint32_t lo = 0;
+    uint32_t hi = db->count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (db->index[mid].userid < userid)
+            lo = mid + 1;
+        else if (db->index[mid].userid > userid)
+            hi = mid;
+        else
+            return &db->index[mid];
+    }
+    return NULL;
+}
+
+/* Return pointer to record, after checking that it lies within the map.
+ */
+static const void *certdb_record (const struct certdb *db,
+                                  const struct certdb_index *ix)
+{
+    if (ix->offset > db->size || ix->len > db->size - ix->offset) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return (const char *)db->map + ix->offset;
+}
+
+struct sigcert *certdb_lookup (const struct certdb *db, int64_t userid)
+{
+    const struct certdb_index *ix;
+    const void *rec;
+
+    if (!db) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(ix = certdb_find (db, userid))) {
+        errno = ENOENT;
+        return NULL;
+    }
+    if (!(rec = certdb_record (db, ix)))
+        return NULL;
+    return sigcert_decode_bin (rec, ix->len);
+}
+
+void certdb_builder_destroy (struct certdb_builder *b)
+{
+    if (b) {
+        int saved_errno = errno;
+        size_t i;
+        for (i = 0; i < b->count; i++)
+            free (b->entries[i].buf);
+        free (b->entries);
+        free (b);
+        errno = saved_errno;
+    }
+}
+
+struct certdb_builder *certdb_builder_create (void)
+{
+    return calloc (1, sizeof (struct certdb_builder));
+}
+
+/* Append entry, taking ownership of 'buf'.
+ */
+static int builder_append (struct certdb_builder *b, int64_t userid,
+                           void *buf, size_t len)
+{
+    struct builder_entry *e;
+
+    if (b->count == b->size) {
+        size_t newsize = b->size ? b->size * 2 : 64;
+        struct builder_entry *new;
+        if (!(new = realloc (b->entries, newsize * sizeof (*new))))
+            return -1;
+        b->entries = new;
+        b->size = newsize;
+    }
+    e = &b->entries[b->count];
+    e->userid = userid;
+    e->seq = b->count++;
+    e->buf = buf;
+    e->len = len;
+    return 0;
+}
+
+int certdb_builder_add (struct certdb_builder *b, int64_t userid,
+                        const struct sigcert *cert)
+{
+    void *buf;
+    size_t len;
+
+    if (!b || !cert) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (!(buf = sigcert_encode_bin (cert, &len)))
+        return -1;
+    if (builder_append (b, userid, buf, len) < 0) {
+        free (buf);
+        return -1;
+    }
+    return 0;
+}
+
+int certdb_builder_remove (struct certdb_builder *b, int64_t userid)
+{
+    if (!b) {
+        errno = EINVAL;
+        return -1;
+    }
+    return builder_append (b, userid, NULL, 0);
+}
+
+int certdb_builder_add_db (struct certdb_builder *b, const struct certdb *db)
+{
+    uint32_t i;
+
+    if (!b || !db) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < db->count; i++) {
+        const struct certdb_index *ix = &db->index[i];
+        const void *rec;
+        void *buf;
+
+        if (!(rec = certdb_record (db, ix)))
+            return -1;
+        if (!(buf = malloc (ix->len > 0 ? ix->len : 1)))
+            return -1;
+        memcpy (buf, rec, ix->len);
+        if (builder_append (b, ix->userid, buf, ix->len) < 0) {
+            free (buf);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int entry_cmp (const void *a, const void *b)
+{
+    const struct builder_entry *e1 = a;
+    const struct builder_entry *e2 = b;
+
+    if (e1->userid != e2->userid)
+        return e1->userid < e2->userid ? -1 : 1;
+    return e1->seq < e2->seq ? -1 : (e1->seq > e2->seq ? 1 : 0);
+}
+
+static int write_all (int fd, const void *buf, size_t len)
+{
+    const char *cp = buf;
+
+    while (len > 0) {
+        ssize_t n = write (fd, cp, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        cp += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int certdb_builder_write (struct certdb_builder *b, const char *path)
+{
+    char tmp[PATH_MAX + 1];
+    struct certdb_header hdr;
+    struct certdb_index *index = NULL;
+    static const char pad[8];
+    size_t count = 0;
+    size_t offset;
+    size_t i;
+    int fd = -1;
+    int saved_errno;
+
+    if (!b || !path) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (snprintf (tmp, sizeof (tmp), "%s.XXXXXX", path) >= sizeof (tmp)) {
+        errno = EINVAL;
+        return -1;
+    }
+    /* Sort, then keep the last entry for each userid, dropping removals.
+     */
+    qsort (b->entries, b->count, sizeof (b->entries[0]), entry_cmp);
+    if (!(index = calloc (b->count > 0 ? b->count : 1, sizeof (*index))))
+        return -1;
+    for (i = 0; i < b->count; i++) {
+        struct builder_entry *e = &b->entries[i];
+        if (i + 1 < b->count && b->entries[i + 1].userid == e->userid)
+            continue;
+        if (!e->buf)
+            continue;
+        index[count].userid = e->userid;
+        index[count].len = e->len;
+        count++;
+    }
+    if (count > UINT32_MAX) {
+        errno = EOVERFLOW;
+        goto error;
+    }
+    memset (&hdr, 0, sizeof (hdr));
+    memcpy (hdr.magic, CERTDB_MAGIC, sizeof (hdr.magic));
+    hdr.count = count;
+    offset = sizeof (hdr) + count * sizeof (*index);
+    for (i = 0; i < count; i++) {
+        index[i].offset = offset;
+        offset += CERTDB_ALIGN (index[i].len);
+    }
+
+    if ((fd = mkstemp (tmp)) < 0)
+        goto error;
+    if (fchmod (fd, 0644) < 0)
+        goto error_unlink;
+    if (write_all (fd, &hdr, sizeof (hdr)) < 0
+            || write_all (fd, index, count * sizeof (*index)) < 0)
+        goto error_unlink;
+    for (i = 0; i < b->count; i++) {
+        struct builder_entry *e = &b->entries[i];
+        if (i + 1 < b->count && b->entries[i + 1].userid == e->userid)
+            continue;
+        if (!e->buf)
+            continue;
+        if (write_all (fd, e->buf, e->len) < 0
+                || write_all (fd, pad, CERTDB_ALIGN (e->len) - e->len) < 0)
+            goto error_unlink;
+    }
+    if (fsync (fd) < 0 || close (fd) < 0) {
+        fd = -1;
+        goto error_unlink;
+    }
+    fd = -1;
+    if (rename (tmp, path) < 0)
+        goto error_unlink;
+    free (index);
+    return 0;
+error_unlink:
+    saved_errno = errno;
+    (void)unlink (tmp);
+    errno = saved_errno;
+error:
+    saved_errno = errno;
+    if (fd >= 0)
+        (void)close (fd);
+    free (index);
+    errno = saved_errno;
+    return -1;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
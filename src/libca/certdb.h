@@ -0,0 +1,97 @@
+/************************************************************\
+ * Copyright 2017 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_CERTDB_H
+#define _UTIL_CERTDB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sigcert.h"
+
+/* Database of public certs indexed by userid.
+ *
+ * The database is a single file, created with a certdb_builder, and
+ * memory-mapped read-only by certdb_open().  Certs are stored in the
+ * sigcert_encode_bin() format, and looked up by binary search of an
+ * index sorted by userid, so a lookup requires no file I/O.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct certdb;
+struct certdb_builder;
+
+/* Open/close database.
+ * The file must be a regular file owned by root or the effective uid,
+ * and not writable by group or other.
+ * certdb_open() returns database on success, NULL on failure with errno set:
+ *   EPERM  - file has unsafe ownership or permissions
+ *   EINVAL - invalid argument, or file is not a cert database
+ */
+struct certdb *certdb_open (const char *path);
+void certdb_close (struct certdb *db);
+
+/* Return true if 'path' now refers to a different file than the one 'db'
+ * was opened from, or that file has been modified, e.g. because the
+ * database was rebuilt.  The caller may then open 'path' again.
+ * Returns false if 'path' cannot be accessed.
+ */
+bool certdb_changed (const struct certdb *db, const char *path);
+
+/* Return number of certs in database.
+ */
+int certdb_count (const struct certdb *db);
+
+/* Look up cert by userid.  Caller must destroy.
+ * Returns cert on success, NULL on failure with errno set:
+ *   ENOENT - no cert for userid
+ *   EINVAL - invalid argument or corrupt database entry
+ */
+struct sigcert *certdb_lookup (const struct certdb *db, int64_t userid);
+
+/* Create/destroy database builder.
+ */
+struct certdb_builder *certdb_builder_create (void);
+void certdb_builder_destroy (struct certdb_builder *b);
+
+/* Add public portion of cert for userid, replacing any earlier entry.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int certdb_builder_add (struct certdb_builder *b, int64_t userid,
+                        const struct sigcert *cert);
+
+/* Remove entry for userid, if any.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int certdb_builder_remove (struct certdb_builder *b, int64_t userid);
+
+/* Add all entries of an existing database (e.g. to update it).
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int certdb_builder_add_db (struct certdb_builder *b, const struct certdb *db);
+
+/* Write database to 'path'.  The file is replaced atomically, so
+ * processes that have the old database open are unaffected.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int certdb_builder_write (struct certdb_builder *b, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_UTIL_CERTDB_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,392 @@
+/************************************************************\
+ * Copyright 2017 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sodium.h>
+
+#include "src/libutil/kv.h"
+
+#include "sigcert.h"
+#include "pubcert.h"
+
+#define SIGN_BASE64_SIZE \
+    (sodium_base64_ENCODED_LEN (crypto_sign_BYTES, \
+                                sodium_base64_VARIANT_ORIGINAL))
+#define PUBLICKEY_BASE64_SIZE \
+    (sodium_base64_ENCODED_LEN (crypto_sign_PUBLICKEYBYTES, \
+                                sodium_base64_VARIANT_ORIGINAL))
+
+/* Metadata entry.  'key' and string values are byte offsets from
+ * the start of the pubcert to NULL-terminated strings that follow
+ * the entry array.
+ */
+struct pubcert_meta {
+    uint32_t key;
+    uint32_t type;      // enum sigcert_meta_type
+    union {
+        uint32_t s;
+        int64_t i;
+        double d;
+        bool b;
+        int64_t t;
+    } val;
+};
+
+struct pubcert {
+    uint32_t size;
+    uint32_t count;
+    bool signature_valid;
+    uint8_t public_key[crypto_sign_PUBLICKEYBYTES];
+    uint8_t signature[crypto_sign_BYTES];
+    struct pubcert_meta meta[];
+};
+
+static const char *meta_prefix = "meta.";
+
+static const char *pc_string (const struct pubcert *pc, uint32_t offset)
+{
+    return (const char *)pc + offset;
+}
+
+static int decode_base64_exact (const char *src, uint8_t *dst, size_t dstsz)
+{
+    size_t dstlen;
+
+    if (sodium_base642bin (dst, dstsz, src, strlen (src),
+                           NULL, &dstlen, NULL,
+                           sodium_base64_VARIANT_ORIGINAL) < 0
+            || dstlen != dstsz) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+void pubcert_destroy (struct pubcert *pc)
+{
+    if (pc) {
+        int saved_errno = errno;
+        free (pc);
+        errno = saved_errno;
+    }
+}
+
+/* Size the allocation in a first pass over the "meta." entries of kv,
+ * then fill in entries and the string pool in a second pass.
+ */
+struct pubcert *pubcert_decode (const char *s, int len)
+{
+    struct kv *kv;
+    struct pubcert *pc = NULL;
+    const char *key;
+    const char *val;
+    size_t prefixlen = strlen (meta_prefix);
+    size_t count = 0;
+    size_t size;
+    size_t strsz = 0;
+    char *p;
+    struct pubcert_meta *m;
+
+    if (!s || len == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(kv = kv_decode (s, len)))
+        return NULL;
+    key = NULL;
+    while ((key = kv_next (kv, key))) {
+        if (strncmp (key, meta_prefix, prefixlen) != 0)
+            continue;
+        strsz += strlen (key + prefixlen) + 1;
+        if (kv_typeof (key) == KV_STRING)
+            strsz += strlen (kv_val_string (key)) + 1;
+        count++;
+    }
+    size = sizeof (*pc) + count * sizeof (pc->meta[0]) + strsz;
+    if (size > UINT32_MAX) {
+        errno = EOVERFLOW;
+        goto error;
+    }
+    if (!(pc = calloc (1, size)))
+        goto error;
+    pc->size = size;
+    pc->count = count;
+    if (kv_get (kv, "curve.public-key", KV_STRING, &val) < 0
+            || decode_base64_exact (val, pc->public_key,
+                                    sizeof (pc->public_key)) < 0)
+        goto error;
+    if (kv_get (kv, "curve.signature", KV_STRING, &val) == 0) {
+        if (decode_base64_exact (val, pc->signature,
+                                 sizeof (pc->signature)) < 0)
+            goto error;
+        pc->signature_valid = true;
+    }
+    else if (errno != ENOENT)
+        goto error;
+
+    p = (char *)&pc->meta[count];
+    m = pc->meta;
+    key = NULL;
+    while ((key = kv_next (kv, key))) {
+        if (strncmp (key, meta_prefix, prefixlen) != 0)
+            continue;
+        m->key = p - (char *)pc;
+        p = stpcpy (p, key + prefixlen) + 1;
+        switch ((m->type = kv_typeof (key))) {
+            case KV_STRING:
+                m->val.s = p - (char *)pc;
+                p = stpcpy (p, kv_val_string (key)) + 1;
+                break;
+            case KV_INT64:
+                m->val.i = kv_val_int64 (key);
+                break;
+            case KV_DOUBLE:
+                m->val.d = kv_val_double (key);
+                break;
+            case KV_BOOL:
+                m->val.b = kv_val_bool (key);
+                break;
+            case KV_TIMESTAMP:
+                m->val.t = kv_val_timestamp (key);
+                break;
+            default:
+                errno = EINVAL;
+                goto error;
+        }
+        m++;
+    }
+    kv_destroy (kv);
+    return pc;
+error:
+    kv_destroy (kv);
+    pubcert_destroy (pc);
+    return NULL;
+}
+
+struct pubcert *pubcert_create (const struct sigcert *cert)
+{
+    const char *buf;
+    int len;
+
+    if (!cert) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (sigcert_encode (cert, &buf, &len) < 0)
+        return NULL;
+    return pubcert_decode (buf, len);
+}
+
+static int meta_put (struct kv *kv, const struct pubcert *pc,
+                     const struct pubcert_meta *m)
+{
+    const char *key = pc_string (pc, m->key);
+
+    switch (m->type) {
+        case KV_STRING:
+            return kv_put (kv, key, KV_STRING, pc_string (pc, m->val.s));
+        case KV_INT64:
+            return kv_put (kv, key, KV_INT64, m->val.i);
+        case KV_DOUBLE:
+            return kv_put (kv, key, KV_DOUBLE, m->val.d);
+        case KV_BOOL:
+            return kv_put (kv, key, KV_BOOL, m->val.b);
+        case KV_TIMESTAMP:
+            return kv_put (kv, key, KV_TIMESTAMP, (time_t)m->val.t);
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+struct sigcert *pubcert_sigcert (const struct pubcert *pc)
+{
+    struct kv *meta = NULL;
+    struct kv *kv = NULL;
+    struct sigcert *cert = NULL;
+    char pubkey[PUBLICKEY_BASE64_SIZE];
+    char sign[SIGN_BASE64_SIZE];
+    const char *buf;
+    int len;
+    int i;
+
+    if (!pc) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(meta = kv_create ()) || !(kv = kv_create ()))
+        goto done;
+    for (i = 0; i < pc->count; i++) {
+        if (meta_put (meta, pc, &pc->meta[i]) < 0)
+            goto done;
+    }
+    if (kv_join (kv, meta, meta_prefix) < 0)
+        goto done;
+    sodium_bin2base64 (pubkey, sizeof (pubkey),
+                       pc->public_key, sizeof (pc->public_key),
+                       sodium_base64_VARIANT_ORIGINAL);
+    if (kv_put (kv, "curve.public-key", KV_STRING, pubkey) < 0)
+        goto done;
+    if (pc->signature_valid) {
+        sodium_bin2base64 (sign, sizeof (sign),
+                           pc->signature, sizeof (pc->signature),
+                           sodium_base64_VARIANT_ORIGINAL);
+        if (kv_put (kv, "curve.signature", KV_STRING, sign) < 0)
+            goto done;
+    }
+    if (kv_encode (kv, &buf, &len) < 0)
+        goto done;
+    cert = sigcert_decode (buf, len);
+done:
+    kv_destroy (kv);
+    kv_destroy (meta);
+    return cert;
+}
+
+size_t pubcert_size (const struct pubcert *pc)
+{
+    return pc ? pc->size : 0;
+}
+
+static bool meta_equal (const struct pubcert *pc1,
+                        const struct pubcert_meta *m1,
+                        const struct pubcert *pc2,
+                        const struct pubcert_meta *m2)
+{
+    if (m1->type != m2->type
+            || strcmp (pc_string (pc1, m1->key), pc_string (pc2, m2->key)))
+        return false;
+    switch (m1->type) {
+        case KV_STRING:
+            return !strcmp (pc_string (pc1, m1->val.s),
+                            pc_string (pc2, m2->val.s));
+        case KV_INT64:
+            return m1->val.i == m2->val.i;
+        case KV_DOUBLE:
+            return m1->val.d == m2->val.d;
+        case KV_BOOL:
+            return m1->val.b == m2->val.b;
+        case KV_TIMESTAMP:
+            return m1->val.t == m2->val.t;
+    }
+    return false;
+}
+
+bool pubcert_equal (const struct pubcert *pc, const struct sigcert *cert)
+{
+    struct pubcert *tmp;
+    bool equal = false;
+    int i;
+
+    if (!pc || !(tmp = pubcert_create (cert)))
+        return false;
+    if (memcmp (pc->public_key, tmp->public_key, sizeof (pc->public_key))
+            || pc->count != tmp->count)
+        goto done;
+    for (i = 0; i < pc->count; i++) {
+        if (!meta_equal (pc, &pc->meta[i], tmp, &tmp->meta[i]))
+            goto done;
+    }
+    equal = true;
+done:
+    pubcert_destroy (tmp);
+    return equal;
+}
+
+int pubcert_meta_get (const struct pubcert *pc, const char *key,
+                      enum sigcert_meta_type type, ...)
+{
+    const struct pubcert_meta *m = NULL;
+    va_list ap;
+    int i;
+
+    if (!pc || !key || type == SM_UNKNOWN) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < pc->count; i++) {
+        if (!strcmp (pc_string (pc, pc->meta[i].key), key)) {
+            m = &pc->meta[i];
+            break;
+        }
+    }
+    if (!m || m->type != type) {
+        errno = ENOENT;
+        return -1;
+    }
+    va_start (ap, type);
+    switch (type) {
+        case SM_STRING: {
+            const char **val = va_arg (ap, const char **);
+            if (val)
+                *val = pc_string (pc, m->val.s);
+            break;
+        }
+        case SM_INT64: {
+            int64_t *val = va_arg (ap, int64_t *);
+            if (val)
+                *val = m->val.i;
+            break;
+        }
+        case SM_DOUBLE: {
+            double *val = va_arg (ap, double *);
+            if (val)
+                *val = m->val.d;
+            break;
+        }
+        case SM_BOOL: {
+            bool *val = va_arg (ap, bool *);
+            if (val)
+                *val = m->val.b;
+            break;
+        }
+        case SM_TIMESTAMP: {
+            time_t *val = va_arg (ap, time_t *);
+            if (val)
+                *val = m->val.t;
+            break;
+        }
+        default:
+            break;
+    }
+    va_end (ap);
+    return 0;
+}
+
+int pubcert_verify_detached (const struct pubcert *pc,
+                             const char *signature,
+                             const uint8_t *buf, int len)
+{
+    uint8_t sig[crypto_sign_BYTES];
+
+    if (!pc || !signature || len < 0 || (len > 0 && buf == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (decode_base64_exact (signature, sig, sizeof (sig)) < 0)
+        return -1;
+    if (crypto_sign_verify_detached (sig, buf, len, pc->public_key) < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,80 @@
+/************************************************************\
+ * Copyright 2017 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_PUBCERT_H
+#define _UTIL_PUBCERT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "sigcert.h"
+
+/* Compact, immutable public certificate.
+ *
+ * A pubcert holds the public key, signature, and typed metadata of a
+ * sigcert in a single contiguous allocation, with no secret key and
+ * no kv objects.  It is intended for verifiers that cache many certs.
+ * Internal references are stored as offsets, so a pubcert may be
+ * copied with memcpy() given its pubcert_size().
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pubcert;
+
+/* Destroy pubcert.
+ */
+void pubcert_destroy (struct pubcert *pc);
+
+/* Create pubcert from public portion of cert.
+ */
+struct pubcert *pubcert_create (const struct sigcert *cert);
+
+/* Create pubcert from kv buffer as produced by sigcert_encode().
+ */
+struct pubcert *pubcert_decode (const char *s, int len);
+
+/* Convert pubcert back to a (public) sigcert.  Caller must destroy.
+ */
+struct sigcert *pubcert_sigcert (const struct pubcert *pc);
+
+/* Return size in bytes of the pubcert allocation.
+ */
+size_t pubcert_size (const struct pubcert *pc);
+
+/* Return true if pubcert has the same public key and metadata as cert.
+ */
+bool pubcert_equal (const struct pubcert *pc, const struct sigcert *cert);
+
+/* Get meta value.  String values point into pubcert.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+int pubcert_meta_get (const struct pubcert *pc, const char *key,
+                      enum sigcert_meta_type type, ...);
+
+/* Verify a detached signature (base64 string) over buf, len.
+ * Returns 0 on success, -1 on failure.
+ */
+int pubcert_verify_detached (const struct pubcert *pc,
+                             const char *signature,
+                             const uint8_t *buf, int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_UTIL_PUBCERT_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,423 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sigcert.h"
+#include "sigagent.h"
+
+#define HEADER_SIZE     5
+
+/* Maximum number of connected clients.  Further connections wait in
+ * the listen backlog.
+ */
+#define MAX_CLIENTS     64
+
+/* A client that stalls mid-frame is disconnected after this long.
+ */
+#define CLIENT_TIMEOUT  5
+
+struct sigagent {
+    int fd;
+};
+
+static int read_all (int fd, void *buf, size_t len)
+{
+    char *cp = buf;
+
+    while (len > 0) {
+        ssize_t n = read (fd, cp, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (n == 0) {
+            errno = EPROTO;
+            return -1;
+        }
+        cp += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int write_all (int fd, const void *buf, size_t len)
+{
+    const char *cp = buf;
+
+    while (len > 0) {
+        ssize_t n = send (fd, cp, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        cp += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int send_frame (int fd, int type, const void *body, size_t len)
+{
+    uint8_t hdr[HEADER_SIZE];
+    uint32_t n = htonl (len);
+
+    memcpy (hdr, &n, 4);
+    hdr[4] = type;
+    if (write_all (fd, hdr, sizeof (hdr)) < 0
+            || write_all (fd, body, len) < 0)
+        return -1;
+    return 0;
+}
+
+/* Receive frame.  On success, the body is returned in *bodyp, which the
+ * caller must free.  It is NULL terminated (not included in *lenp).
+ */
+static int recv_frame (int fd, int *typep, char **bodyp, size_t *lenp)
+{
+    uint8_t hdr[HEADER_SIZE];
+    uint32_t n;
+    char *body;
+
+    if (read_all (fd, hdr, sizeof (hdr)) < 0)
+        return -1;
+    memcpy (&n, hdr, 4);
+    n = ntohl (n);
+    if (n > SIGAGENT_MAX_BODY) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (!(body = malloc (n + 1)))
+        return -1;
+    if (read_all (fd, body, n) < 0) {
+        int saved_errno = errno;
+        free (body);
+        errno = saved_errno;
+        return -1;
+    }
+    body[n] = '\0';
+    *typep = hdr[4];
+    *bodyp = body;
+    *lenp = n;
+    return 0;
+}
+
+/* Receive response.  Return body, or NULL with errno set from the
+ * response type if the agent reported an error.
+ */
+static char *recv_response (int fd, size_t *lenp)
+{
+    int type;
+    char *body;
+    size_t len;
+
+    if (recv_frame (fd, &type, &body, &len) < 0)
+        return NULL;
+    if (type != 0) {
+        free (body);
+        errno = type;
+        return NULL;
+    }
+    if (lenp)
+        *lenp = len;
+    return body;
+}
+
+static int set_sockaddr (struct sockaddr_un *addr, const char *path)
+{
+    memset (addr, 0, sizeof (*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen (path) >= sizeof (addr->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy (addr->sun_path, path);
+    return 0;
+}
+
+int sigagent_path (const char *tmpl, uid_t uid, char *buf, size_t size)
+{
+    size_t len = 0;
+    int n;
+
+    if (!tmpl || !buf || size == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    while (*tmpl) {
+        if (tmpl[0] != '%')
+            n = snprintf (buf + len, size - len, "%c", tmpl[0]);
+        else if (tmpl[1] == 'u')
+            n = snprintf (buf + len, size - len, "%ju", (uintmax_t)uid);
+        else if (tmpl[1] == '%')
+            n = snprintf (buf + len, size - len, "%%");
+        else {
+            errno = EINVAL;
+            return -1;
+        }
+        if ((size_t)n >= size - len) {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        len += n;
+        tmpl += tmpl[0] == '%' ? 2 : 1;
+    }
+    buf[len] = '\0';
+    return 0;
+}
+
+void sigagent_close (struct sigagent *agent)
+{
+    if (agent) {
+        int saved_errno = errno;
+        (void)close (agent->fd);
+        free (agent);
+        errno = saved_errno;
+    }
+}
+
+/* Fail with EPERM unless the agent at the other end of 'fd' runs as our
+ * real uid, so that a socket planted by another user cannot collect our
+ * sign requests and hand back its own cert.
+ */
+static int check_peer (int fd)
+{
+    struct ucred cred;
+    socklen_t credlen = sizeof (cred);
+
+    if (getsockopt (fd, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) < 0)
+        return -1;
+    if (cred.uid != getuid ()) {
+        errno = EPERM;
+        return -1;
+    }
+    return 0;
+}
+
+struct sigagent *sigagent_connect (const char *path)
+{
+    struct sigagent *agent;
+    struct sockaddr_un addr;
+
+    if (!path) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (set_sockaddr (&addr, path) < 0)
+        return NULL;
+    if (!(agent = calloc (1, sizeof (*agent))))
+        return NULL;
+    if ((agent->fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0) {
+        free (agent);
+        return NULL;
+    }
+    if (connect (agent->fd, (struct sockaddr *)&addr, sizeof (addr)) < 0
+            || check_peer (agent->fd) < 0) {
+        sigagent_close (agent);
+        return NULL;
+    }
+    return agent;
+}
+
+struct sigcert *sigagent_get_cert (struct sigagent *agent)
+{
+    struct sigcert *cert;
+    char *body;
+    size_t len;
+
+    if (!agent) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (send_frame (agent->fd, SIGAGENT_GET_CERT, NULL, 0) < 0)
+        return NULL;
+    if (!(body = recv_response (agent->fd, &len)))
+        return NULL;
+    cert = sigcert_decode (body, len);
+    free (body);
+    return cert;
+}
+
+char *sigagent_sign (struct sigagent *agent, const uint8_t *buf, int len)
+{
+    if (!agent || len < 0 || (len > 0 && !buf)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (send_frame (agent->fd, SIGAGENT_SIGN, buf, len) < 0)
+        return NULL;
+    return recv_response (agent->fd, NULL);
+}
+
+int sigagent_listen (const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat sb;
+    mode_t saved_umask;
+    int fd;
+    int rc;
+
+    if (!path) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (set_sockaddr (&addr, path) < 0)
+        return -1;
+    if ((fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+        return -1;
+    /* Only replace a stale socket, never e.g. a mistyped cert file.
+     */
+    if (lstat (path, &sb) == 0) {
+        if (!S_ISSOCK (sb.st_mode)) {
+            errno = EEXIST;
+            goto error;
+        }
+        if (unlink (path) < 0 && errno != ENOENT)
+            goto error;
+    }
+    else if (errno != ENOENT)
+        goto error;
+    saved_umask = umask (0177);
+    rc = bind (fd, (struct sockaddr *)&addr, sizeof (addr));
+    (void)umask (saved_umask);
+    if (rc < 0)
+        goto error;
+    if (listen (fd, 128) < 0)
+        goto error;
+    return fd;
+error:
+    rc = errno;
+    (void)close (fd);
+    errno = rc;
+    return -1;
+}
+
+/* Accept a connection, or return -1 if it is not from our uid.
+ */
+static int accept_client (int fd)
+{
+    struct ucred cred;
+    socklen_t credlen = sizeof (cred);
+    struct timeval tv = { .tv_sec = CLIENT_TIMEOUT };
+    int cfd;
+
+    if ((cfd = accept4 (fd, NULL, NULL, SOCK_CLOEXEC)) < 0)
+        return -1;
+    if (getsockopt (cfd, SOL_SOCKET, SO_PEERCRED, &cred, &credlen) < 0
+            || cred.uid != geteuid ()
+            || setsockopt (cfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof (tv)) < 0
+            || setsockopt (cfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof (tv)) < 0) {
+        (void)close (cfd);
+        return -1;
+    }
+    return cfd;
+}
+
+/* Read one request from client and respond.
+ * Return 0 on success, -1 if the client should be disconnected.
+ */
+static int serve_request (int fd, const struct sigcert *cert)
+{
+    int type;
+    char *body;
+    size_t len;
+    const char *buf;
+    int bufsz;
+    char *sig;
+    int rc = -1;
+
+    if (recv_frame (fd, &type, &body, &len) < 0)
+        return -1;
+    switch (type) {
+        case SIGAGENT_GET_CERT:
+            if (sigcert_encode (cert, &buf, &bufsz) < 0)
+                rc = send_frame (fd, errno, NULL, 0);
+            else
+                rc = send_frame (fd, 0, buf, bufsz);
+            break;
+        case SIGAGENT_SIGN:
+            if (!(sig = sigcert_sign_detached (cert, (uint8_t *)body, len)))
+                rc = send_frame (fd, errno, NULL, 0);
+            else {
+                rc = send_frame (fd, 0, sig, strlen (sig));
+                free (sig);
+            }
+            break;
+        default:
+            (void)send_frame (fd, EPROTO, NULL, 0);
+            break;
+    }
+    free (body);
+    return rc;
+}
+
+int sigagent_serve (int fd, const struct sigcert *cert)
+{
+    struct pollfd pfd[MAX_CLIENTS + 1];
+    int nfds = 1;
+    int saved_errno;
+    int i;
+
+    if (fd < 0 || !cert || !sigcert_has_secret (cert)) {
+        errno = EINVAL;
+        return -1;
+    }
+    pfd[0].fd = fd;
+    pfd[0].events = POLLIN;
+    for (;;) {
+        pfd[0].events = nfds <= MAX_CLIENTS ? POLLIN : 0;
+        if (poll (pfd, nfds, -1) < 0)
+            break;
+        for (i = nfds - 1; i > 0; i--) {
+            if (pfd[i].revents == 0)
+                continue;
+            if (!(pfd[i].revents & POLLIN)
+                    || serve_request (pfd[i].fd, cert) < 0) {
+                (void)close (pfd[i].fd);
+                pfd[i] = pfd[--nfds];
+            }
+        }
+        if ((pfd[0].revents & POLLIN)) {
+            int cfd;
+            if ((cfd = accept_client (fd)) >= 0) {
+                pfd[nfds].fd = cfd;
+                pfd[nfds].events = POLLIN;
+                pfd[nfds].revents = 0;
+                nfds++;
+            }
+        }
+    }
+    saved_errno = errno;
+    for (i = 1; i < nfds; i++)
+        (void)close (pfd[i].fd);
+    errno = saved_errno;
+    return -1;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,95 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_SIGAGENT_H
+#define _UTIL_SIGAGENT_H
+
+#include <sys/types.h>
+#include <stdint.h>
+
+#include "sigcert.h"
+
+/* Signing agent - holds a loaded signing cert and signs on behalf of
+ * processes of the same user, over a UNIX domain socket, so that each
+ * signer need not load the secret key from disk.
+ *
+ * Each request and response is a frame: 4 byte body length (network
+ * order), 1 byte type, then the body.  Requests:
+ *   SIGAGENT_GET_CERT  (empty body)   -> public cert, sigcert_encode() format
+ *   SIGAGENT_SIGN      (data to sign) -> signature, sigcert_sign_detached()
+ * A response type of 0 indicates success, otherwise it is an errno value
+ * and the body is empty.  A client may send several requests before
+ * reading responses, which are returned in request order.
+ *
+ * The agent only accepts connections from processes with its own
+ * effective uid, and the client only talks to an agent running as the
+ * client's real uid.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum {
+    SIGAGENT_GET_CERT = 1,
+    SIGAGENT_SIGN = 2,
+};
+
+/* Maximum frame body size.
+ */
+#define SIGAGENT_MAX_BODY   (256*1024*1024)
+
+struct sigagent;
+
+/* Expand socket path template 'tmpl' for 'uid' into buf/size, replacing
+ * "%u" with the uid and "%%" with "%", so that a single configured path
+ * such as "/run/user/%u/flux-sign-agent" gives each user their own agent.
+ * Returns 0 on success, -1 on failure with errno set (EINVAL for any
+ * other '%' sequence, ENAMETOOLONG if the result does not fit).
+ */
+int sigagent_path (const char *tmpl, uid_t uid, char *buf, size_t size);
+
+/* Client: connect to agent at 'path' / disconnect.
+ * Connecting fails with EPERM if the agent is run by another user.
+ */
+struct sigagent *sigagent_connect (const char *path);
+void sigagent_close (struct sigagent *agent);
+
+/* Get the agent's public cert.  Caller must destroy.
+ * Returns cert on success, NULL on failure with errno set.
+ */
+struct sigcert *sigagent_get_cert (struct sigagent *agent);
+
+/* Sign buf/len, returning signature that caller must free.
+ * Returns signature on success, NULL on failure with errno set.
+ */
+char *sigagent_sign (struct sigagent *agent, const uint8_t *buf, int len);
+
+/* Server: create a listening socket at 'path' (mode 0600), replacing
+ * any stale socket.  Returns file descriptor, or -1 on failure with
+ * errno set (EEXIST if 'path' exists and is not a socket).
+ */
+int sigagent_listen (const char *path);
+
+/* Server: accept and serve clients of listening socket 'fd', signing with
+ * 'cert', which must have a secret key.  Runs until an error occurs or
+ * a signal interrupts it.  Returns -1 with errno set (EINTR on signal).
+ */
+int sigagent_serve (int fd, const struct sigcert *cert);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !_UTIL_SIGAGENT_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
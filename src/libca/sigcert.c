@@ -23,11 +23,13 @@
 #include <stdbool.h>
 #include <string.h>
 #include <limits.h>
+#include <stddef.h>
 #include <time.h>
 #include <sodium.h>
 
 #include "src/libutil/tomltk.h"
 #include "src/libutil/kv.h"
+#include "src/libutil/timestamp.h"
 #include "src/libutil/macros.h"
 
 #include "sigcert.h"
@@ -51,6 +53,34 @@ static const size_t cert_read_limit = (1024*1024*10); // 10mb
     (sodium_base64_ENCODED_LEN (crypto_sign_BYTES, \
                                 sodium_base64_VARIANT_ORIGINAL))
 
+/* Binary encoding of the public portion of a cert: a fixed header
+ * followed by 'metalen' bytes of metadata in the kv binary encoding, so
+ * numeric metadata need not be parsed when loaded.  The pub_* fields
+ * identify the TOML .pub file that a stored binary copy was made from
+ * (zero if not stored), so that a stale copy is detected with stat(2)
+ * rather than by reading the .pub file.  Fields are in host byte order.
+ */
+#define SIGCERT_BIN_MAGIC "FLXCERT3"
+#define SIGCERT_BIN_SIGNATURE 1
+struct sigcert_bin_pub {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+};
+
+struct sigcert_bin {
+    char magic[8];
+    uint32_t flags;
+    uint32_t metalen;
+    struct sigcert_bin_pub pub;
+    uint8_t public_key[crypto_sign_PUBLICKEYBYTES];
+    uint8_t signature[crypto_sign_BYTES];
+};
+
 #define FLUX_SIGCERT_MAGIC 0x2349c0ed
 struct sigcert {
     int magic;
@@ -64,14 +94,91 @@ struct sigcert {
     bool secret_valid;
     bool signature_valid;
 
+    struct sigcert_info info;
+    bool info_valid;
+
     struct kv *enc;
+    struct kv *tbs;         // cached to-be-signed encoding (see sign_cert)
 };
 
+/* Well-known metadata keys, decoded to 'struct sigcert_info'.
+ */
+struct info_field {
+    const char *key;
+    enum kv_type type;
+    int flag;
+    size_t offset;
+};
+
+static const struct info_field info_fields[] = {
+    { "uuid", KV_STRING, SIGCERT_INFO_UUID,
+      offsetof (struct sigcert_info, uuid) },
+    { "userid", KV_INT64, SIGCERT_INFO_USERID,
+      offsetof (struct sigcert_info, userid) },
+    { "ctime", KV_TIMESTAMP, SIGCERT_INFO_CTIME,
+      offsetof (struct sigcert_info, ctime) },
+    { "xtime", KV_TIMESTAMP, SIGCERT_INFO_XTIME,
+      offsetof (struct sigcert_info, xtime) },
+    { "not-valid-before-time", KV_TIMESTAMP,
+      SIGCERT_INFO_NOT_VALID_BEFORE_TIME,
+      offsetof (struct sigcert_info, not_valid_before_time) },
+    { "max-sign-ttl", KV_INT64, SIGCERT_INFO_MAX_SIGN_TTL,
+      offsetof (struct sigcert_info, max_sign_ttl) },
+    { "issuer", KV_STRING, SIGCERT_INFO_ISSUER,
+      offsetof (struct sigcert_info, issuer) },
+    { "domain", KV_STRING, SIGCERT_INFO_DOMAIN,
+      offsetof (struct sigcert_info, domain) },
+    { "ca-capability", KV_BOOL, SIGCERT_INFO_CA_CAPABILITY,
+      offsetof (struct sigcert_info, ca_capability) },
+};
+static const int info_fields_count = sizeof (info_fields)
+                                     / sizeof (info_fields[0]);
+
+/* Decode well-known metadata in a single pass over cert->meta.
+ * String fields point into cert->meta, so this must be redone
+ * whenever cert->meta is modified.
+ */
+static void sigcert_info_decode (struct sigcert *cert)
+{
+    const char *key = NULL;
+    int i;
+
+    memset (&cert->info, 0, sizeof (cert->info));
+    while ((key = kv_next (cert->meta, key))) {
+        for (i = 0; i < info_fields_count; i++) {
+            if (!strcmp (key, info_fields[i].key))
+                break;
+        }
+        if (i == info_fields_count || kv_typeof (key) != info_fields[i].type)
+            continue;
+        void *dst = (char *)&cert->info + info_fields[i].offset;
+        switch (info_fields[i].type) {
+            case KV_STRING:
+                *(const char **)dst = kv_val_string (key);
+                break;
+            case KV_INT64:
+                *(int64_t *)dst = kv_val_int64 (key);
+                break;
+            case KV_TIMESTAMP:
+                *(time_t *)dst = kv_val_timestamp (key);
+                break;
+            case KV_BOOL:
+                *(bool *)dst = kv_val_bool (key);
+                break;
+            default:
+                continue;
+        }
+        cert->info.valid |= info_fields[i].flag;
+    }
+    cert->info_valid = true;
+}
+
 void sigcert_destroy (struct sigcert *cert)
 {
     if (cert) {
         int saved_errno = errno;
         assert (cert->magic == FLUX_SIGCERT_MAGIC);
+        kv_destroy (cert->tbs);
         kv_destroy (cert->enc);
         kv_destroy (cert->meta);
         memset (cert->public_key, 0, crypto_sign_PUBLICKEYBYTES);
@@ -146,6 +253,9 @@ struct sigcert *sigcert_copy (const struct sigcert *cert)
     }
     memcpy (cpy, cert, sizeof (*cpy));
     cpy->meta = metacpy;
+    cpy->enc = NULL;
+    cpy->tbs = NULL;
+    sigcert_info_decode (cpy);
     return cpy;
 }
 
@@ -192,6 +302,9 @@ static int sigcert_meta_vset (struct sigcert *cert, const char *key,
         errno = EINVAL;
         return -1;
     }
+    cert->info_valid = false;
+    kv_destroy (cert->tbs);
+    cert->tbs = NULL;
     return kv_vput (cert->meta, key, type_tokv (type), ap);
 }
 
@@ -231,6 +344,20 @@ int sigcert_meta_get (const struct sigcert *cert, const char *key,
     return rc;
 }
 
+/* N.B. const is cast away to refresh the decoded info after
+ * sigcert_meta_set(), similar to cert->enc in sigcert_encode().
+ */
+const struct sigcert_info *sigcert_info (const struct sigcert *cert)
+{
+    if (!cert) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!cert->info_valid)
+        sigcert_info_decode ((struct sigcert *)cert);
+    return &cert->info;
+}
+
 /* Decode a base64 string string to 'dst', a buffer of size 'dstsz'.
  * The decoded size must exactly match 'dstsz'.
  * Return 0 on success, -1 on error.
@@ -271,6 +398,139 @@ static FILE *fopen_mode (const char *pathname, mode_t mode)
     return fp;
 }
 
+/* Read file of at most 'limit' bytes with a single read.
+ * Caller must free.
+ */
+static char *read_file (const char *path, size_t limit, size_t *len)
+{
+    int fd;
+    struct stat sb;
+    char *buf = NULL;
+    int saved_errno;
+
+    if ((fd = open (path, O_RDONLY)) < 0)
+        return NULL;
+    if (fstat (fd, &sb) < 0)
+        goto error;
+    if (sb.st_size > limit) {
+        errno = EINVAL;
+        goto error;
+    }
+    if (!(buf = malloc (sb.st_size > 0 ? sb.st_size : 1)))
+        goto error;
+    if (read (fd, buf, sb.st_size) != sb.st_size) {
+        errno = EIO;
+        goto error;
+    }
+    (void)close (fd);
+    *len = sb.st_size;
+    return buf;
+error:
+    saved_errno = errno;
+    free (buf);
+    (void)close (fd);
+    errno = saved_errno;
+    return NULL;
+}
+
+/* Identify file 'path' by stat(2) for a binary copy's header.
+ */
+static int stat_pub (const char *path, struct sigcert_bin_pub *pub)
+{
+    struct stat sb;
+
+    if (stat (path, &sb) < 0)
+        return -1;
+    memset (pub, 0, sizeof (*pub));
+    pub->dev = sb.st_dev;
+    pub->ino = sb.st_ino;
+    pub->size = sb.st_size;
+    pub->mtime_sec = sb.st_mtim.tv_sec;
+    pub->mtime_nsec = sb.st_mtim.tv_nsec;
+    pub->ctime_sec = sb.st_ctim.tv_sec;
+    pub->ctime_nsec = sb.st_ctim.tv_nsec;
+    return 0;
+}
+
+/* Encode public portion of cert to binary.  If 'pub' is non-NULL,
+ * record the identity of the .pub file in the header.
+ */
+static void *sigcert_encode_bin_from (const struct sigcert *cert,
+                                      const struct sigcert_bin_pub *pub,
+                                      size_t *len)
+{
+    struct sigcert_bin hdr;
+    struct kv *metabin;
+    const char *meta;
+    int metalen;
+    char *buf = NULL;
+
+    if (!(metabin = kv_copy (cert->meta))
+            || kv_set_encoding (metabin, KV_ENCODING_BINARY) < 0
+            || kv_encode (metabin, &meta, &metalen) < 0)
+        goto done;
+    memset (&hdr, 0, sizeof (hdr));
+    memcpy (hdr.magic, SIGCERT_BIN_MAGIC, sizeof (hdr.magic));
+    hdr.metalen = metalen;
+    if (pub)
+        hdr.pub = *pub;
+    memcpy (hdr.public_key, cert->public_key, sizeof (hdr.public_key));
+    if (cert->signature_valid) {
+        hdr.flags |= SIGCERT_BIN_SIGNATURE;
+        memcpy (hdr.signature, cert->signature, sizeof (hdr.signature));
+    }
+    if (!(buf = malloc (sizeof (hdr) + metalen)))
+        goto done;
+    memcpy (buf, &hdr, sizeof (hdr));
+    if (metalen > 0)
+        memcpy (buf + sizeof (hdr), meta, metalen);
+    *len = sizeof (hdr) + metalen;
+done:
+    kv_destroy (metabin);
+    return buf;
+}
+
+/* Decode binary cert.  If 'pub' is non-NULL, fail with ESTALE unless
+ * it matches the identity of the .pub file the binary was made from.
+ */
+static struct sigcert *sigcert_decode_bin_from (const void *buf, size_t len,
+                                        const struct sigcert_bin_pub *pub)
+{
+    struct sigcert_bin hdr;
+    struct sigcert *cert;
+
+    if (!buf || len < sizeof (hdr)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    memcpy (&hdr, buf, sizeof (hdr));
+    if (memcmp (hdr.magic, SIGCERT_BIN_MAGIC, sizeof (hdr.magic)) != 0
+            || hdr.metalen != len - sizeof (hdr)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (pub && memcmp (&hdr.pub, pub, sizeof (hdr.pub)) != 0) {
+        errno = ESTALE;
+        return NULL;
+    }
+    if (!(cert = sigcert_alloc ()))
+        return NULL;
+    kv_destroy (cert->meta);
+    if (!(cert->meta = kv_decode ((const char *)buf + sizeof (hdr),
+                                  hdr.metalen)))
+        goto error;
+    memcpy (cert->public_key, hdr.public_key, sizeof (cert->public_key));
+    if ((hdr.flags & SIGCERT_BIN_SIGNATURE)) {
+        memcpy (cert->signature, hdr.signature, sizeof (cert->signature));
+        cert->signature_valid = true;
+    }
+    sigcert_info_decode (cert);
+    return cert;
+error:
+    sigcert_destroy (cert);
+    return NULL;
+}
+
 /* Write secret-key (only) to 'fp' in TOML format.
  */
 static int sigcert_fwrite_secret (const struct sigcert *cert, FILE *fp)
@@ -315,11 +575,18 @@ int sigcert_fwrite_public (const struct sigcert *cert, FILE *fp)
                     goto error;
                 break;
             case KV_BOOL:       // kv_val_string is "true" or "false"
-            case KV_TIMESTAMP:  // kv_val_string is ISO 8601 time string
                 if (fprintf (fp, "    %s = %s\n",
                              key, kv_val_string (key)) < 0)
                     goto error;
                 break;
+            case KV_TIMESTAMP: {
+                char ts[80];
+                if (timestamp_tostr (kv_val_timestamp (key),
+                                     ts, sizeof (ts)) < 0
+                        || fprintf (fp, "    %s = %s\n", key, ts) < 0)
+                    goto error;
+                break;
+            }
             default:
                 errno = EINVAL;
                 goto error;
@@ -378,6 +645,15 @@ int sigcert_store (const struct sigcert *cert, const char *name)
         if (fclose (fp) < 0)
             goto error;
     }
+    /* The binary copy only speeds up sigcert_load(), so failing to write
+     * it is not an error.  Remove any copy left by an earlier store.
+     */
+    if (sigcert_store_bin (cert, name) < 0) {
+        char name_bin[PATH_MAX + 1];
+        if (snprintf (name_bin, sizeof (name_bin), "%s.bin", name_pub)
+                                                    < sizeof (name_bin))
+            (void)unlink (name_bin);
+    }
     return 0;
 error:
     saved_errno = errno;
@@ -569,6 +845,7 @@ struct sigcert *sigcert_fread_public (FILE *fp)
             goto inval;
         cert->signature_valid = true;
     }
+    sigcert_info_decode (cert);
     free (conf);
     toml_free (cert_table);
     return cert;
@@ -580,6 +857,28 @@ inval:
     return NULL;
 }
 
+/* Load 'name_pub'.bin, if it is a binary copy of the current 'name_pub'.
+ * Return NULL if it is missing, stale, or invalid.
+ */
+static struct sigcert *sigcert_load_public_bin (const char *name_pub)
+{
+    char path[PATH_MAX + 1];
+    struct sigcert_bin_pub pub;
+    char *buf;
+    size_t len;
+    struct sigcert *cert;
+
+    if (snprintf (path, sizeof (path), "%s.bin", name_pub) >= sizeof (path))
+        return NULL;
+    if (stat_pub (name_pub, &pub) < 0)
+        return NULL;
+    if (!(buf = read_file (path, cert_read_limit, &len)))
+        return NULL;
+    cert = sigcert_decode_bin_from (buf, len, &pub);
+    free (buf);
+    return cert;
+}
+
 struct sigcert *sigcert_load (const char *name, bool secret)
 {
     FILE *fp = NULL;
@@ -591,13 +890,15 @@ struct sigcert *sigcert_load (const char *name, bool secret)
         goto inval;
     if (snprintf (name_pub, PATH_MAX + 1, "%s.pub", name) >= PATH_MAX + 1)
         goto inval;
-    // name.pub - public
-    if (!(fp = fopen (name_pub, "r")))
-        goto error;
-    if (!(cert = sigcert_fread_public (fp)))
-        goto error;
-    if (fclose (fp) < 0)
-        goto error;
+    // name.pub.bin - public, if up to date, else name.pub
+    if (!(cert = sigcert_load_public_bin (name_pub))) {
+        if (!(fp = fopen (name_pub, "r")))
+            goto error;
+        if (!(cert = sigcert_fread_public (fp)))
+            goto error;
+        if (fclose (fp) < 0)
+            goto error;
+    }
     // name - secret
     if (secret) {
         if (!(fp = fopen (name, "r")))
@@ -619,56 +920,84 @@ error:
     return NULL;
 }
 
-/* Decode a kv string key to 'dst', a buffer of size 'dstsz'.
+/* Decode kv string entry to 'dst', a buffer of size 'dstsz', unless
+ * 'found' is already set (as with kv_get(), the first entry wins).
  * The decoded size must exactly match 'dstsz'.
  * Return 0 on success, -1 on error with errno set.
  */
-static int get_base64_exact (struct kv *kv, const char *key,
-                             uint8_t *dst, size_t dstsz)
+static int get_base64_exact (const char *entry, uint8_t *dst, size_t dstsz,
+                             bool *found)
 {
-    const char *src;
-    if (kv_get (kv, key, KV_STRING, &src) < 0)
-        return -1;
-    if (decode_base64_exact (src, dst, dstsz) < 0) {
+    if (*found || kv_typeof (entry) != KV_STRING)
+        return 0;
+    if (decode_base64_exact (kv_val_string (entry), dst, dstsz) < 0) {
         errno = EINVAL;
         return -1;
     }
+    *found = true;
     return 0;
 }
 
-struct sigcert *sigcert_decode (const char *s, int len)
+struct sigcert *sigcert_decode_kv (const struct kv *kv, const char *prefix)
 {
-    struct kv *kv;
     struct sigcert *cert;
+    const char *key = NULL;
+    int n = prefix ? strlen (prefix) : 0;
+    bool have_public_key = false;
 
-    if (!s || len == 0) {
+    if (!kv) {
         errno = EINVAL;
         return NULL;
     }
-    if (!(kv = kv_decode (s, len)))
-        return NULL;
     if (!(cert = sigcert_alloc ()))
-        goto error;
+        return NULL;
+    while ((key = kv_next_prefix (kv, prefix, key))) {
+        const char *name = key + n;
 
-    kv_destroy (cert->meta);
-    if (!(cert->meta = kv_split (kv, "meta.")))
-        goto error;
-    if (get_base64_exact (kv, "curve.public-key",
-                          cert->public_key, sizeof (cert->public_key)) < 0)
-        goto error;
-    if (get_base64_exact (kv, "curve.signature",
-                          cert->signature, sizeof (cert->signature)) == 0)
-        cert->signature_valid = true;
-    else if (errno != ENOENT)
+        if (!strncmp (name, "meta.", 5) && name[5] != '\0') {
+            if (kv_put_entry (cert->meta, name + 5, key) < 0)
+                goto error;
+        }
+        else if (!strcmp (name, "curve.public-key")) {
+            if (get_base64_exact (key, cert->public_key,
+                                  sizeof (cert->public_key),
+                                  &have_public_key) < 0)
+                goto error;
+        }
+        else if (!strcmp (name, "curve.signature")) {
+            if (get_base64_exact (key, cert->signature,
+                                  sizeof (cert->signature),
+                                  &cert->signature_valid) < 0)
+                goto error;
+        }
+    }
+    if (!have_public_key) {
+        errno = ENOENT;
         goto error;
-    kv_destroy (kv);
+    }
+    sigcert_info_decode (cert);
     return cert;
 error:
-    kv_destroy (kv);
     sigcert_destroy (cert);
     return NULL;
 }
 
+struct sigcert *sigcert_decode (const char *s, int len)
+{
+    struct kv *kv;
+    struct sigcert *cert;
+
+    if (!s || len == 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(kv = kv_view (s, len)))
+        return NULL;
+    cert = sigcert_decode_kv (kv, NULL);
+    kv_destroy (kv);
+    return cert;
+}
+
 int sigcert_encode (const struct sigcert *cert, const char **buf, int *len)
 {
     char pubkey[PUBLICKEY_BASE64_SIZE];
@@ -698,6 +1027,64 @@ int sigcert_encode (const struct sigcert *cert, const char **buf, int *len)
     return kv_encode (cert->enc, buf, len);
 }
 
+void *sigcert_encode_bin (const struct sigcert *cert, size_t *len)
+{
+    if (!cert || !len) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return sigcert_encode_bin_from (cert, NULL, len);
+}
+
+struct sigcert *sigcert_decode_bin (const void *buf, size_t len)
+{
+    return sigcert_decode_bin_from (buf, len, NULL);
+}
+
+int sigcert_store_bin (const struct sigcert *cert, const char *name)
+{
+    FILE *fp = NULL;
+    char name_pub[PATH_MAX + 1];
+    char path[PATH_MAX + 1];
+    struct sigcert_bin_pub pub;
+    void *buf = NULL;
+    size_t len;
+    int saved_errno;
+
+    if (!cert || !name || strlen (name) == 0) {
+        errno = EINVAL;
+        goto error;
+    }
+    if (snprintf (name_pub, sizeof (name_pub), "%s.pub", name)
+                                                    >= sizeof (name_pub)
+        || snprintf (path, sizeof (path), "%s.pub.bin", name)
+                                                    >= sizeof (path)) {
+        errno = EINVAL;
+        goto error;
+    }
+    if (stat_pub (name_pub, &pub) < 0)
+        goto error;
+    if (!(buf = sigcert_encode_bin_from (cert, &pub, &len)))
+        goto error;
+    if (!(fp = fopen_mode (path, 0644)))
+        goto error;
+    if (fwrite (buf, len, 1, fp) != 1)
+        goto error;
+    if (fclose (fp) < 0) {
+        fp = NULL;
+        goto error;
+    }
+    free (buf);
+    return 0;
+error:
+    saved_errno = errno;
+    if (fp)
+        (void)fclose (fp);
+    free (buf);
+    errno = saved_errno;
+    return -1;
+}
+
 bool sigcert_equal (const struct sigcert *cert1,
                     const struct sigcert *cert2)
 {
@@ -761,80 +1148,122 @@ int sigcert_verify_detached (const struct sigcert *cert,
     return 0;
 }
 
-/* Serialize cert2, excluding secret + signature, sign with cert1.
+/* Signatures are checked one at a time with libsodium, so an invalid
+ * entry is pinpointed without a second pass.  Malformed entries are
+ * rejected before any signature is checked.
+ */
+int sigcert_verify_detached_batch (struct sigcert_batch_item *items,
+                                   int count)
+{
+    uint8_t sig[crypto_sign_BYTES];
+    int errors = 0;
+    int i;
+
+    if (count < 0 || (count > 0 && !items)) {
+        errno = EINVAL;
+        return -1;
+    }
+    for (i = 0; i < count; i++) {
+        struct sigcert_batch_item *item = &items[i];
+
+        item->result = -1;
+        if (!item->cert || !item->signature || item->len < 0
+                        || (item->len > 0 && item->buf == NULL))
+            errors++;
+        else
+            item->result = 0;
+    }
+    for (i = 0; i < count; i++) {
+        struct sigcert_batch_item *item = &items[i];
+
+        if (item->result < 0)
+            continue;
+        if (decode_base64_exact (item->signature, sig, sizeof (sig)) < 0
+                || crypto_sign_verify_detached (sig, item->buf, item->len,
+                                        item->cert->public_key) < 0) {
+            item->result = -1;
+            errors++;
+        }
+    }
+    if (errors > 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Serialize public key and metadata of 'cert' (excluding secret and
+ * signature), the portion of a cert covered by the CA signature.
+ * The encoding is cached in cert->tbs and invalidated by meta_set.
+ * N.B. const is cast away to update the cache, similar to cert->enc
+ * in sigcert_encode().
+ */
+static int sigcert_tbs_encode (const struct sigcert *cert,
+                               const char **buf, int *len)
+{
+    struct kv *kv;
+    char pubkey[PUBLICKEY_BASE64_SIZE];
+
+    if (!cert->tbs) {
+        if (!(kv = kv_create()))
+            return -1;
+        sodium_bin2base64 (pubkey, sizeof (pubkey),
+                           cert->public_key, sizeof (cert->public_key),
+                           sodium_base64_VARIANT_ORIGINAL);
+        if (kv_put (kv, "curve.public_key", KV_STRING, pubkey) < 0
+                || kv_join (kv, cert->meta, "meta.") < 0) {
+            kv_destroy (kv);
+            return -1;
+        }
+        ((struct sigcert *)cert)->tbs = kv;
+    }
+    return kv_encode (cert->tbs, buf, len);
+}
+
+/* Sign serialized cert2 with cert1.
  * Add 'signature' attribute to [curve] stanza.
  */
 int sigcert_sign_cert (const struct sigcert *cert1,
                        struct sigcert *cert2)
 {
-    struct kv *kv;
     const char *kv_s;
     int kv_len;
-    int rc = -1;
-    char pubkey[PUBLICKEY_BASE64_SIZE];
 
     if (!cert1 || !cert2 || !cert1->secret_valid) {
         errno = EINVAL;
         return -1;
     }
-    if (!(kv = kv_create()))
+    if (sigcert_tbs_encode (cert2, &kv_s, &kv_len) < 0)
         return -1;
-    sodium_bin2base64 (pubkey, sizeof (pubkey),
-                       cert2->public_key, sizeof (cert2->public_key),
-                       sodium_base64_VARIANT_ORIGINAL);
-    if (kv_put (kv, "curve.public_key", KV_STRING, pubkey) < 0)
-        goto done;
-    if (kv_join (kv, cert2->meta, "meta.") < 0)
-        goto done;
-    if (kv_encode (kv, &kv_s, &kv_len) < 0)
-        goto done;
     if (crypto_sign_detached (cert2->signature, NULL,
                               (uint8_t *)kv_s, kv_len,
                               cert1->secret_key) < 0) {
         errno = EINVAL;
-        goto done;
+        return -1;
     }
     cert2->signature_valid = true;
-    rc = 0;
-done:
-    kv_destroy (kv);
-    return rc;
+    return 0;
 }
 
 int sigcert_verify_cert (const struct sigcert *cert1,
                          const struct sigcert *cert2)
 {
-    struct kv *kv;
     const char *kv_s;
     int kv_len;
-    int rc = -1;
-    char pubkey[PUBLICKEY_BASE64_SIZE];
 
     if (!cert1 || !cert2 || !cert2->signature_valid) {
         errno = EINVAL;
         return -1;
     }
-    if (!(kv = kv_create()))
+    if (sigcert_tbs_encode (cert2, &kv_s, &kv_len) < 0)
         return -1;
-    sodium_bin2base64 (pubkey, sizeof (pubkey),
-                       cert2->public_key, sizeof (cert2->public_key),
-                       sodium_base64_VARIANT_ORIGINAL);
-    if (kv_put (kv, "curve.public_key", KV_STRING, pubkey) < 0)
-        goto done;
-    if (kv_join (kv, cert2->meta, "meta.") < 0)
-        goto done;
-    if (kv_encode (kv, &kv_s, &kv_len) < 0)
-        goto done;
     if (crypto_sign_verify_detached (cert2->signature,
                                      (uint8_t *)kv_s, kv_len,
                                      cert1->public_key) < 0) {
         errno = EINVAL;
-        goto done;
+        return -1;
     }
-    rc = 0;
-done:
-    kv_destroy (kv);
-    return rc;
+    return 0;
 }
 
 /*
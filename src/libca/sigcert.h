@@ -29,6 +29,7 @@ extern "C" {
 #endif
 
 struct sigcert;
+struct kv;
 
 /* Destroy cert.
  */
@@ -50,12 +51,14 @@ void sigcert_forget_secret (struct sigcert *cert);
  */
 bool sigcert_has_secret (const struct sigcert *cert);
 
-/* Load cert from file 'name.pub'.
+/* Load cert from file 'name.pub', or from 'name.pub.bin' if it is
+ * an up to date binary copy (see sigcert_store_bin()).
  * If secret=true, load secret-key from 'name' also.
  */
 struct sigcert *sigcert_load (const char *name, bool secret);
 
-/* Store cert to 'name' and 'name.pub'.
+/* Store cert to 'name', 'name.pub', and 'name.pub.bin'.
+ * 'name.pub.bin' is optional: if it cannot be written, it is removed.
  */
 int sigcert_store (const struct sigcert *cert, const char *name);
 
@@ -71,10 +74,35 @@ struct sigcert *sigcert_fread_public (FILE *fp);
  */
 struct sigcert *sigcert_decode (const char *s, int len);
 
+/* Decode cert from the entries of 'kv' with key prefix 'prefix' (if
+ * non-NULL), e.g. a cert embedded in a larger kv object, without copying
+ * them to a separate kv object first.
+ */
+struct sigcert *sigcert_decode_kv (const struct kv *kv, const char *prefix);
+
 /* Encode cert to kv buffer.
  */
 int sigcert_encode (const struct sigcert *cert, const char **bp, int *len);
 
+/* Encode public portion of cert to binary buffer.
+ * Caller must free.
+ */
+void *sigcert_encode_bin (const struct sigcert *cert, size_t *len);
+
+/* Decode binary buffer to cert.
+ */
+struct sigcert *sigcert_decode_bin (const void *buf, size_t len);
+
+/* Write 'name.pub.bin', a binary copy of cert that records the device,
+ * inode, size, mtime, and ctime of 'name.pub'.  sigcert_load() reads the
+ * binary copy instead of parsing 'name.pub' as long as stat(2) of
+ * 'name.pub' still matches.  Since ctime cannot be set by the user, any
+ * rewrite of 'name.pub', even one that preserves its size and mtime,
+ * invalidates the copy.  sigcert_store() calls this after writing
+ * 'name.pub'.
+ */
+int sigcert_store_bin (const struct sigcert *cert, const char *name);
+
 /* Return true if two certificates have the same keys.
  */
 bool sigcert_equal (const struct sigcert *cert1,
@@ -93,6 +121,24 @@ int sigcert_verify_detached (const struct sigcert *cert,
                              const char *signature,
                              const uint8_t *buf, int len);
 
+/* One entry in a batch of detached signatures to verify.
+ * 'result' is set to 0 if the signature is valid, or -1 if it is not.
+ */
+struct sigcert_batch_item {
+    const struct sigcert *cert;
+    const char *signature;
+    const uint8_t *buf;
+    int len;
+    int result;
+};
+
+/* Verify 'count' detached signatures, setting each item's 'result'.
+ * Returns 0 if all are valid, -1 with errno = EINVAL if any are invalid
+ * (check 'result' to find which) or if arguments are invalid.
+ */
+int sigcert_verify_detached_batch (struct sigcert_batch_item *items,
+                                   int count);
+
 /* Use cert1 to sign cert2.
  * The signature covers public key and all metadata.
  * It does not cover secret key or existing signature, if any.
@@ -131,6 +177,43 @@ int sigcert_meta_set (struct sigcert *cert, const char *key,
 int sigcert_meta_get (const struct sigcert *cert, const char *key,
                       enum sigcert_meta_type type, ...);
 
+/* Well-known metadata (as set by the CA), decoded to native types.
+ * A field is valid only if its flag is set in 'valid'; a key that is
+ * missing or has an unexpected type leaves the flag clear.
+ */
+enum {
+    SIGCERT_INFO_UUID = 0x001,
+    SIGCERT_INFO_USERID = 0x002,
+    SIGCERT_INFO_CTIME = 0x004,
+    SIGCERT_INFO_XTIME = 0x008,
+    SIGCERT_INFO_NOT_VALID_BEFORE_TIME = 0x010,
+    SIGCERT_INFO_MAX_SIGN_TTL = 0x020,
+    SIGCERT_INFO_ISSUER = 0x040,
+    SIGCERT_INFO_DOMAIN = 0x080,
+    SIGCERT_INFO_CA_CAPABILITY = 0x100,
+};
+
+struct sigcert_info {
+    int valid;
+    const char *uuid;
+    int64_t userid;
+    time_t ctime;
+    time_t xtime;
+    time_t not_valid_before_time;
+    int64_t max_sign_ttl;
+    const char *issuer;
+    const char *domain;
+    bool ca_capability;
+};
+
+/* Get decoded well-known metadata.  The metadata is decoded once when
+ * the cert is loaded or decoded, and again on first access after
+ * sigcert_meta_set().  String fields point into the cert and are
+ * invalidated by sigcert_meta_set() and sigcert_destroy().
+ * Returns info on success, NULL on failure with errno set.
+ */
+const struct sigcert_info *sigcert_info (const struct sigcert *cert);
+
 #ifdef __cplusplus
 }
 #endif
@@ -62,9 +62,16 @@ void cf_fini (void)
 {
     char path[PATH_MAX + 1];
 
-    (void)snprintf (path, sizeof (path), "%s/ca-cert", tmpdir);
+    if (snprintf (path, sizeof (path), "%s/ca-cert", tmpdir) >= sizeof (path))
+        BAIL_OUT ("path is too long");
     (void)unlink (path);
-    (void)snprintf (path, sizeof (path), "%s/ca-cert.pub", tmpdir);
+    if (snprintf (path, sizeof (path), "%s/ca-cert.pub", tmpdir)
+            >= sizeof (path))
+        BAIL_OUT ("path is too long");
+    (void)unlink (path);
+    if (snprintf (path, sizeof (path), "%s/ca-cert.pub.bin", tmpdir)
+            >= sizeof (path))
+        BAIL_OUT ("path is too long");
     (void)unlink (path);
     if (rmdir (tmpdir) < 0)
         BAIL_OUT ("rmdir %s: %s", tmpdir, strerror (errno));
@@ -108,7 +115,7 @@ void test_basic (void)
     /* Verification fails before ca sign
      */
     errno = 0;
-    ok (ca_verify (ca, cert, NULL, NULL, e) < 0 && errno == EINVAL,
+    ok (ca_verify (ca, cert, NULL, NULL, NULL, e) < 0 && errno == EINVAL,
         "ca_verify fails with EINVAL");
     diag ("%s", e);
 
@@ -148,7 +155,7 @@ void test_basic (void)
      */
     userid = 0;
     ttl = 0;
-    ok (ca_verify (ca, cert, &userid, &ttl, e) == 0,
+    ok (ca_verify (ca, cert, &userid, &ttl, NULL, e) == 0,
         "ca_verify works");
     ok (userid == getuid (),
         "userid is correct");
@@ -161,7 +168,7 @@ void test_basic (void)
         "ca_store works");
     ok (ca_load (ca, false, e) == 0,
         "ca_load secret=false works");
-    ok (ca_verify (ca, cert, NULL, NULL, e) == 0,
+    ok (ca_verify (ca, cert, NULL, NULL, NULL, e) == 0,
         "ca_verify still works");
     errno = 0;
     ok (ca_sign (ca, cert, 0, 0, getuid (), e) < 0 && errno == EINVAL,
@@ -169,7 +176,7 @@ void test_basic (void)
     diag ("%s", e);
     ok (ca_load (ca, true, e) == 0,
         "ca_load secret=true works");
-    ok (ca_verify (ca, cert, NULL, NULL, e) == 0,
+    ok (ca_verify (ca, cert, NULL, NULL, NULL, e) == 0,
         "ca_verify still works");
 
     /* Change userid in cert
@@ -179,7 +186,7 @@ void test_basic (void)
     ok (sigcert_meta_set (badcert, "userid", SM_INT64, userid + 1) == 0,
         "changed userid in cert");
     errno = 0;
-    ok (ca_verify (ca, badcert, NULL, NULL, e) < 0 && errno == EINVAL,
+    ok (ca_verify (ca, badcert, NULL, NULL, NULL, e) < 0 && errno == EINVAL,
         "ca_verify fails with EINVAL");
     diag ("%s", e);
     sigcert_destroy (badcert);
@@ -191,15 +198,19 @@ void test_basic (void)
     ok (ca_revoke (ca, uuid, e) == 0,
         "sigcert revoke works");
     errno = 0;
-    ok (ca_verify (ca, badcert, NULL, NULL, e) < 0 && errno == EINVAL,
+    ok (ca_verify (ca, cert, NULL, NULL, NULL, e) < 0 && errno == EINVAL,
         "ca_verify fails with EINVAL");
     diag ("%s", e);
 
     /* clean up revocation dir */
-    snprintf (path, sizeof (path), "%s/ca-revoke/%s", tmpdir, uuid);
+    if (snprintf (path, sizeof (path), "%s/ca-revoke/%s", tmpdir, uuid)
+            >= sizeof (path))
+        BAIL_OUT ("path is too long");
     if (unlink (path) < 0)
         BAIL_OUT ("%s: %s", path, strerror (errno));
-    snprintf (path, sizeof (path), "%s/ca-revoke", tmpdir);
+    if (snprintf (path, sizeof (path), "%s/ca-revoke", tmpdir)
+            >= sizeof (path))
+        BAIL_OUT ("path is too long");
     if (rmdir (path) < 0)
         BAIL_OUT ("%s: %s", path, strerror (errno));
 
@@ -255,7 +266,7 @@ void test_ca_meta (void)
     ok (ca_capability == true,
         "ca-capability is true");
 
-    ok (ca_verify (ca, ca_cert, NULL, NULL, e) == 0,
+    ok (ca_verify (ca, ca_cert, NULL, NULL, NULL, e) == 0,
         "ca_verify works on self-signed CA cert");
 
     ca_destroy (ca);
@@ -283,7 +294,7 @@ void test_ca_capability (void)
         "ca_sign works with incapable CA cert");
     errno = 0;
     *e = '\0';
-    ok (ca_verify (ca, cert, NULL, NULL, e) < 0 && errno == EINVAL && *e,
+    ok (ca_verify (ca, cert, NULL, NULL, NULL, e) < 0 && errno == EINVAL && *e,
         "but ca_verify fails with EINVAL and updates e");
     diag ("ca_verify: %s", e);
 
@@ -317,7 +328,7 @@ void test_expiration (void)
         "ca_sign works with xtime past");
     errno = 0;
     *e = '\0';
-    ok (ca_verify (ca, cert, NULL, NULL, e) < 0 && errno == EINVAL && *e,
+    ok (ca_verify (ca, cert, NULL, NULL, NULL, e) < 0 && errno == EINVAL && *e,
         "but ca_verify fails with EINVAL and updates e");
 
     /* not_valid_before_time is future
@@ -326,7 +337,7 @@ void test_expiration (void)
         "ca_sign works with not_valid_before_time future");
     errno = 0;
     *e = '\0';
-    ok (ca_verify (ca, cert, NULL, NULL, e) < 0 && errno == EINVAL && *e,
+    ok (ca_verify (ca, cert, NULL, NULL, NULL, e) < 0 && errno == EINVAL && *e,
         "but ca_verify fails with EINVAL and updates e");
 
     ca_destroy (ca);
@@ -397,20 +408,23 @@ void test_corner (void)
     errno = 0;
     *e = '\0';
 
-    ok (ca_verify (ca, cert, NULL, NULL, NULL) == 0,
+    ok (ca_verify (ca, cert, NULL, NULL, NULL, NULL) == 0,
         "test cert sig is still valid");
 
     errno = 0;
     *e = '\0';
-    ok (ca_verify (NULL, cert, NULL, NULL, e) < 0 && errno == EINVAL && *e,
+    ok (ca_verify (NULL, cert, NULL, NULL, NULL, e) < 0
+        && errno == EINVAL && *e,
         "ca_verify ca=NULL fails with EINVAL and updates e");
     errno = 0;
     *e = '\0';
-    ok (ca_verify (ca, NULL, NULL, NULL, e) < 0 && errno == EINVAL && *e,
+    ok (ca_verify (ca, NULL, NULL, NULL, NULL, e) < 0
+        && errno == EINVAL && *e,
         "ca_verify cert=NULL fails with EINVAL and updates e");
     errno = 0;
     *e = '\0';
-    ok (ca_verify (canokey, cert, NULL, NULL, e) < 0 && errno == EINVAL && *e,
+    ok (ca_verify (canokey, cert, NULL, NULL, NULL, e) < 0
+        && errno == EINVAL && *e,
         "ca_verify cert=(nokeys) fails with EINVAL and updates e");
 
     errno = 0;
@@ -469,6 +483,316 @@ void test_corner (void)
     ca_destroy (canokey);
 }
 
+/* Create [ca] config with cert-path in 'dir' and optional 'trust_dir'.
+ */
+static cf_t *trust_cf_create (const char *dir, const char *trust_dir)
+{
+    char conf[1024];
+    struct cf_error error;
+    cf_t *cf;
+    int n;
+
+    n = snprintf (conf, sizeof (conf), conf_tmpl, dir, tmpdir);
+    if (trust_dir)
+        n += snprintf (conf + n, sizeof (conf) - n,
+                       "trust-dir = \"%s\"\n", trust_dir);
+    if (n >= sizeof (conf))
+        BAIL_OUT ("conf buffer overflow");
+    if (!(cf = cf_create ()))
+        BAIL_OUT ("cf_create: %s", strerror (errno));
+    if (cf_update (cf, conf, strlen (conf), &error) < 0)
+        BAIL_OUT ("cf_update: %s", errno == EINVAL ? error.errbuf
+                                                   : strerror (errno));
+    return cf;
+}
+
+static void unlink_cert (const char *dir, const char *name)
+{
+    char path[PATH_MAX + 1];
+
+    (void)snprintf (path, sizeof (path), "%s/%s", dir, name);
+    (void)unlink (path);
+    (void)snprintf (path, sizeof (path), "%s/%s.pub", dir, name);
+    (void)unlink (path);
+    (void)snprintf (path, sizeof (path), "%s/%s.pub.bin", dir, name);
+    (void)unlink (path);
+}
+
+/* Verify certs signed by any CA in trust-dir.
+ */
+void test_trust_dir (void)
+{
+    char trust_dir[PATH_MAX + 1];
+    char other_dir[PATH_MAX + 1];
+    char path[PATH_MAX + 1];
+    cf_t *cf1, *cf2, *cf3;
+    struct ca *ca1, *ca2, *ca3;
+    struct sigcert *cert, *cert2;
+    const struct sigcert_info *info;
+    ca_error_t e;
+    int64_t userid;
+
+    if (snprintf (trust_dir, sizeof (trust_dir), "%s/trust", tmpdir)
+            >= sizeof (trust_dir))
+        BAIL_OUT ("path is too long");
+    if (snprintf (other_dir, sizeof (other_dir), "%s/other", tmpdir)
+            >= sizeof (other_dir))
+        BAIL_OUT ("path is too long");
+    if (mkdir (trust_dir, 0755) < 0 || mkdir (other_dir, 0755) < 0)
+        BAIL_OUT ("mkdir: %s", strerror (errno));
+
+    /* ca1 is the configured CA, ca2 is in trust-dir, ca3 is neither.
+     */
+    cf1 = trust_cf_create (tmpdir, trust_dir);
+    cf2 = trust_cf_create (trust_dir, NULL);
+    cf3 = trust_cf_create (other_dir, NULL);
+    if (!(ca1 = ca_create (cf1, e)))
+        BAIL_OUT ("ca_create: %s", e);
+    if (!(ca2 = ca_create (cf2, e)))
+        BAIL_OUT ("ca_create: %s", e);
+    if (!(ca3 = ca_create (cf3, e)))
+        BAIL_OUT ("ca_create: %s", e);
+    if (ca_keygen (ca1, 0, 0, e) < 0 || ca_store (ca1, e) < 0
+            || ca_keygen (ca2, 0, 0, e) < 0 || ca_store (ca2, e) < 0
+            || ca_keygen (ca3, 0, 0, e) < 0)
+        BAIL_OUT ("ca_keygen/ca_store: %s", e);
+    ok (ca_load (ca1, true, e) == 0,
+        "ca_load loads trust-dir");
+
+    if (!(cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    if (ca_sign (ca2, cert, 0, 0, 42, e) < 0)
+        BAIL_OUT ("ca_sign: %s", e);
+    userid = 0;
+    ok (ca_verify (ca1, cert, &userid, NULL, NULL, e) == 0 && userid == 42,
+        "ca_verify works on cert signed by trust-dir CA");
+    if (ca_sign (ca1, cert, 0, 0, 43, e) < 0)
+        BAIL_OUT ("ca_sign: %s", e);
+    ok (ca_verify (ca1, cert, &userid, NULL, NULL, e) == 0 && userid == 43,
+        "ca_verify works on cert signed by configured CA");
+    if (ca_sign (ca3, cert, 0, 0, 44, e) < 0)
+        BAIL_OUT ("ca_sign: %s", e);
+    errno = 0;
+    ok (ca_verify (ca1, cert, NULL, NULL, NULL, e) < 0 && errno == EINVAL,
+        "ca_verify fails with EINVAL on cert signed by untrusted CA");
+    diag ("%s", e);
+    sigcert_destroy (cert);
+
+    /* Another copy of a trust-dir cert is accepted, but a different
+     * cert with the same uuid causes ca_load to fail.
+     */
+    if (snprintf (path, sizeof (path), "%s/ca-cert", trust_dir)
+            >= sizeof (path))
+        BAIL_OUT ("path is too long");
+    if (!(cert = sigcert_load (path, false))
+            || !(info = sigcert_info (cert)))
+        BAIL_OUT ("sigcert_load %s: %s", path, strerror (errno));
+    if (snprintf (path, sizeof (path), "%s/copy", trust_dir) >= sizeof (path))
+        BAIL_OUT ("path is too long");
+    if (sigcert_store (cert, path) < 0)
+        BAIL_OUT ("sigcert_store: %s", strerror (errno));
+    ok (ca_load (ca1, false, e) == 0,
+        "ca_load accepts another copy of a trust-dir cert");
+    if (!(cert2 = sigcert_create ())
+            || sigcert_meta_set (cert2, "uuid", SM_STRING, info->uuid) < 0
+            || sigcert_meta_set (cert2, "ca-capability", SM_BOOL, true) < 0
+            || sigcert_store (cert2, path) < 0)
+        BAIL_OUT ("failed to create conflicting cert: %s", strerror (errno));
+    errno = 0;
+    ok (ca_load (ca1, false, e) < 0 && errno == EINVAL
+        && strstr (e, "conflicting trust cert") != NULL,
+        "ca_load fails with EINVAL on conflicting cert with same uuid");
+    diag ("%s", e);
+    unlink_cert (trust_dir, "copy");
+    sigcert_destroy (cert2);
+    sigcert_destroy (cert);
+
+    /* A non-CA cert in trust-dir causes ca_load to fail.
+     */
+    if (!(cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    if (snprintf (path, sizeof (path), "%s/user", trust_dir) >= sizeof (path))
+        BAIL_OUT ("path is too long");
+    if (sigcert_store (cert, path) < 0)
+        BAIL_OUT ("sigcert_store: %s", strerror (errno));
+    errno = 0;
+    ok (ca_load (ca1, false, e) < 0 && errno == EINVAL,
+        "ca_load fails with EINVAL on non-CA cert in trust-dir");
+    diag ("%s", e);
+    sigcert_destroy (cert);
+
+    unlink_cert (trust_dir, "user");
+    unlink_cert (trust_dir, "ca-cert");
+    if (rmdir (trust_dir) < 0 || rmdir (other_dir) < 0)
+        BAIL_OUT ("rmdir: %s", strerror (errno));
+
+    ca_destroy (ca3);
+    ca_destroy (ca2);
+    ca_destroy (ca1);
+    cf_destroy (cf3);
+    cf_destroy (cf2);
+    cf_destroy (cf1);
+}
+
+/* Verify user certs issued by an intermediate CA.
+ */
+void test_chain (void)
+{
+    char chain_dir[PATH_MAX + 1];
+    char path[PATH_MAX + 1];
+    cf_t *cf_root, *cf_inter, *cf_rogue;
+    struct ca *root, *inter, *rogue, *verifier;
+    struct sigcert *icert, *rcert, *cert, *cert2;
+    const struct sigcert_info *info;
+    const struct sigcert_info *root_info;
+    const struct sigcert_info *cert_info;
+    const char *uuid;
+    ca_error_t e;
+    int64_t userid;
+    time_t xtime;
+
+    if (snprintf (chain_dir, sizeof (chain_dir), "%s/chain", tmpdir)
+            >= sizeof (chain_dir))
+        BAIL_OUT ("path is too long");
+    if (mkdir (chain_dir, 0755) < 0)
+        BAIL_OUT ("mkdir: %s", strerror (errno));
+    cf_root = trust_cf_create (tmpdir, chain_dir);
+    cf_inter = trust_cf_create (chain_dir, NULL);
+    cf_rogue = trust_cf_create (chain_dir, NULL);
+    if (!(root = ca_create (cf_root, e)))
+        BAIL_OUT ("ca_create: %s", e);
+    if (!(inter = ca_create (cf_inter, e)))
+        BAIL_OUT ("ca_create: %s", e);
+    if (!(rogue = ca_create (cf_rogue, e)))
+        BAIL_OUT ("ca_create: %s", e);
+    if (!(verifier = ca_create (cf_root, e)))
+        BAIL_OUT ("ca_create: %s", e);
+    if (ca_keygen (root, time (NULL) - 30, 0, e) < 0 || ca_store (root, e) < 0
+            || ca_keygen (rogue, 0, 0, e) < 0)
+        BAIL_OUT ("ca_keygen/ca_store: %s", e);
+
+    /* Root signs intermediate, which is stored to its cert-path
+     * in trust-dir, where verifiers will find it.
+     */
+    if (!(icert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    ok (ca_sign_ca (root, icert, 0, 0, 1234, e) == 0,
+        "ca_sign_ca works");
+    ok ((info = sigcert_info (icert)) != NULL
+        && (info->valid & SIGCERT_INFO_CA_CAPABILITY)
+        && info->ca_capability == true,
+        "intermediate cert has ca-capability");
+    ok (info != NULL && info->userid == 1234,
+        "intermediate cert has requested userid");
+    if (!(root_info = sigcert_info (ca_get_cert (root, e))))
+        BAIL_OUT ("sigcert_info: %s", strerror (errno));
+    ok (info != NULL && info->xtime == root_info->xtime,
+        "intermediate cert expiration is clamped to its issuer's");
+    if (!(cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    errno = 0;
+    ok (ca_sign_ca (root, cert, root_info->xtime, 0, 1234, e) < 0
+        && errno == EINVAL,
+        "ca_sign_ca fails with EINVAL if issuer expires before cert is valid");
+    diag ("%s", e);
+    errno = 0;
+    ok (ca_sign_ca (root, cert, 0, 0, -1, e) < 0 && errno == EINVAL,
+        "ca_sign_ca userid=-1 fails with EINVAL");
+    sigcert_destroy (cert);
+    if (ca_set_cert (inter, icert, e) < 0 || ca_store (inter, e) < 0)
+        BAIL_OUT ("ca_set_cert/ca_store: %s", e);
+    ok (ca_load (inter, true, e) == 0,
+        "intermediate CA loaded with secret key");
+
+    if (!(cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    ok (ca_sign (inter, cert, 0, 0, 42, e) == 0,
+        "intermediate CA can sign user cert");
+
+    if (ca_load (verifier, false, e) < 0)
+        BAIL_OUT ("ca_load: %s", e);
+    userid = 0;
+    ok (ca_verify (verifier, cert, &userid, NULL, NULL, e) == 0
+        && userid == 42,
+        "ca_verify works on cert issued by intermediate CA");
+    userid = 0;
+    ok (ca_verify (verifier, cert, &userid, NULL, NULL, e) == 0
+        && userid == 42,
+        "ca_verify works again with cached chain");
+    xtime = 0;
+    ok (ca_verify (verifier, cert, NULL, NULL, &xtime, e) == 0
+        && (cert_info = sigcert_info (cert)) != NULL
+        && cert_info->xtime > info->xtime
+        && xtime == info->xtime,
+        "ca_verify returns intermediate CA expiration if it is earliest");
+
+    /* An intermediate signed by an untrusted CA is rejected.
+     */
+    if (!(rcert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    if (ca_sign_ca (rogue, rcert, 0, 0, getuid (), e) < 0)
+        BAIL_OUT ("ca_sign_ca: %s", e);
+    if (snprintf (path, sizeof (path), "%s/rogue", chain_dir) >= sizeof (path))
+        BAIL_OUT ("path is too long");
+    if (sigcert_store (rcert, path) < 0)
+        BAIL_OUT ("sigcert_store: %s", strerror (errno));
+    if (ca_set_cert (rogue, rcert, e) < 0)
+        BAIL_OUT ("ca_set_cert: %s", e);
+    if (!(cert2 = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    if (ca_sign (rogue, cert2, 0, 0, 43, e) < 0)
+        BAIL_OUT ("ca_sign: %s", e);
+    ok (ca_load (verifier, false, e) == 0,
+        "ca_load works with untrusted intermediate in trust-dir");
+    errno = 0;
+    ok (ca_verify (verifier, cert2, NULL, NULL, NULL, e) < 0
+        && errno == EINVAL,
+        "ca_verify fails with EINVAL on cert from untrusted intermediate");
+    diag ("%s", e);
+    errno = 0;
+    ok (ca_verify (verifier, cert2, NULL, NULL, NULL, e) < 0
+        && errno == EINVAL,
+        "ca_verify fails again with cached chain");
+    ok (ca_verify (verifier, cert, NULL, NULL, NULL, e) == 0,
+        "ca_verify still works on cert from trusted intermediate");
+
+    /* Revoking the intermediate invalidates certs it issued.
+     */
+    if (sigcert_meta_get (icert, "uuid", SM_STRING, &uuid) < 0)
+        BAIL_OUT ("sigcert_meta_get: %s", strerror (errno));
+    if (ca_revoke (root, uuid, e) < 0)
+        BAIL_OUT ("ca_revoke: %s", e);
+    errno = 0;
+    ok (ca_verify (verifier, cert, NULL, NULL, NULL, e) < 0 && errno == EINVAL,
+        "ca_verify fails with EINVAL after intermediate is revoked");
+    diag ("%s", e);
+
+    if (snprintf (path, sizeof (path), "%s/ca-revoke/%s", tmpdir, uuid)
+            >= sizeof (path))
+        BAIL_OUT ("path is too long");
+    (void)unlink (path);
+    if (snprintf (path, sizeof (path), "%s/ca-revoke", tmpdir)
+            >= sizeof (path))
+        BAIL_OUT ("path is too long");
+    (void)rmdir (path);
+    unlink_cert (chain_dir, "ca-cert");
+    unlink_cert (chain_dir, "rogue");
+    if (rmdir (chain_dir) < 0)
+        BAIL_OUT ("rmdir: %s", strerror (errno));
+
+    sigcert_destroy (cert2);
+    sigcert_destroy (cert);
+    sigcert_destroy (rcert);
+    sigcert_destroy (icert);
+    ca_destroy (verifier);
+    ca_destroy (rogue);
+    ca_destroy (inter);
+    ca_destroy (root);
+    cf_destroy (cf_rogue);
+    cf_destroy (cf_inter);
+    cf_destroy (cf_root);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -480,6 +804,8 @@ int main (int argc, char *argv[])
     test_ca_capability ();
     test_expiration ();
     test_corner ();
+    test_trust_dir ();
+    test_chain ();
 
     cf_fini ();
 
@@ -0,0 +1,204 @@
+/************************************************************\
+ * Copyright 2017 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "src/libtap/tap.h"
+#include "sigcert.h"
+#include "certdb.h"
+
+static char tmpdir[PATH_MAX + 1];
+static char dbpath[PATH_MAX + 1];
+
+#define NCERTS 4
+static struct sigcert *certs[NCERTS];
+
+static void init (void)
+{
+    const char *t = getenv ("TMPDIR");
+    int i;
+
+    (void)snprintf (tmpdir, sizeof (tmpdir), "%s/certdb-XXXXXX",
+                    t ? t : "/tmp");
+    if (!mkdtemp (tmpdir))
+        BAIL_OUT ("mkdtemp %s: %s", tmpdir, strerror (errno));
+    if (snprintf (dbpath, sizeof (dbpath), "%s/certs.db", tmpdir)
+            >= sizeof (dbpath))
+        BAIL_OUT ("path is too long");
+    for (i = 0; i < NCERTS; i++) {
+        if (!(certs[i] = sigcert_create ()))
+            BAIL_OUT ("sigcert_create: %s", strerror (errno));
+        if (sigcert_meta_set (certs[i], "userid", SM_INT64,
+                              (int64_t)(1000 + i)) < 0)
+            BAIL_OUT ("sigcert_meta_set: %s", strerror (errno));
+        sigcert_forget_secret (certs[i]);
+    }
+}
+
+static void fini (void)
+{
+    int i;
+
+    (void)unlink (dbpath);
+    if (rmdir (tmpdir) < 0)
+        BAIL_OUT ("rmdir %s: %s", tmpdir, strerror (errno));
+    for (i = 0; i < NCERTS; i++)
+        sigcert_destroy (certs[i]);
+}
+
+static bool lookup_equal (struct certdb *db, int64_t userid,
+                          struct sigcert *cert)
+{
+    struct sigcert *c;
+    bool equal;
+
+    if (!(c = certdb_lookup (db, userid)))
+        return false;
+    equal = sigcert_equal (c, cert);
+    sigcert_destroy (c);
+    return equal;
+}
+
+void test_build (void)
+{
+    struct certdb_builder *b;
+    struct certdb *db;
+    struct certdb *db2;
+
+    b = certdb_builder_create ();
+    ok (b != NULL,
+        "certdb_builder_create works");
+    /* Add in descending order with one replacement and one removal:
+     * 1002 -> certs[2], 1001 -> certs[3], 1000 -> certs[0] (removed)
+     */
+    ok (certdb_builder_add (b, 1002, certs[2]) == 0
+        && certdb_builder_add (b, 1001, certs[1]) == 0
+        && certdb_builder_add (b, 1000, certs[0]) == 0,
+        "certdb_builder_add works");
+    ok (certdb_builder_add (b, 1001, certs[3]) == 0,
+        "certdb_builder_add works on existing userid");
+    ok (certdb_builder_remove (b, 1000) == 0,
+        "certdb_builder_remove works");
+    ok (certdb_builder_write (b, dbpath) == 0,
+        "certdb_builder_write works");
+    certdb_builder_destroy (b);
+
+    db = certdb_open (dbpath);
+    ok (db != NULL,
+        "certdb_open works");
+    ok (certdb_count (db) == 2,
+        "certdb_count returns 2");
+    ok (lookup_equal (db, 1002, certs[2]),
+        "certdb_lookup 1002 returns expected cert");
+    ok (lookup_equal (db, 1001, certs[3]),
+        "certdb_lookup 1001 returns replacement cert");
+    errno = 0;
+    ok (certdb_lookup (db, 1000) == NULL && errno == ENOENT,
+        "certdb_lookup of removed userid fails with ENOENT");
+    errno = 0;
+    ok (certdb_lookup (db, 42) == NULL && errno == ENOENT,
+        "certdb_lookup of unknown userid fails with ENOENT");
+
+    /* Update database in place.
+     */
+    ok (certdb_changed (db, dbpath) == false,
+        "certdb_changed returns false for unchanged database");
+    if (!(b = certdb_builder_create ()))
+        BAIL_OUT ("certdb_builder_create: %s", strerror (errno));
+    ok (certdb_builder_add_db (b, db) == 0,
+        "certdb_builder_add_db works");
+    ok (certdb_builder_add (b, 1000, certs[0]) == 0
+        && certdb_builder_remove (b, 1002) == 0,
+        "added 1000 and removed 1002");
+    ok (certdb_builder_write (b, dbpath) == 0,
+        "certdb_builder_write replaced database");
+    certdb_builder_destroy (b);
+
+    ok (lookup_equal (db, 1002, certs[2]),
+        "old database is still usable after replacement");
+    ok (certdb_changed (db, dbpath) == true,
+        "certdb_changed returns true for old database");
+    db2 = certdb_open (dbpath);
+    ok (db2 != NULL && certdb_count (db2) == 2,
+        "certdb_open of updated database works");
+    ok (certdb_changed (db2, dbpath) == false,
+        "certdb_changed returns false for updated database");
+    ok (lookup_equal (db2, 1000, certs[0])
+        && lookup_equal (db2, 1001, certs[3]),
+        "updated database has expected certs");
+    errno = 0;
+    ok (certdb_lookup (db2, 1002) == NULL && errno == ENOENT,
+        "updated database does not contain removed userid");
+
+    certdb_close (db2);
+    certdb_close (db);
+}
+
+void test_errors (void)
+{
+    FILE *fp;
+
+    errno = 0;
+    ok (certdb_open (NULL) == NULL && errno == EINVAL,
+        "certdb_open path=NULL fails with EINVAL");
+    errno = 0;
+    ok (certdb_open ("/noexist") == NULL && errno == ENOENT,
+        "certdb_open of missing file fails with ENOENT");
+    if (!(fp = fopen (dbpath, "w")))
+        BAIL_OUT ("fopen %s: %s", dbpath, strerror (errno));
+    fprintf (fp, "this is not a certdb\n");
+    fclose (fp);
+    if (chmod (dbpath, 0644) < 0)
+        BAIL_OUT ("chmod %s: %s", dbpath, strerror (errno));
+    errno = 0;
+    ok (certdb_open (dbpath) == NULL && errno == EINVAL,
+        "certdb_open of bad file fails with EINVAL");
+    if (chmod (dbpath, 0664) < 0)
+        BAIL_OUT ("chmod %s: %s", dbpath, strerror (errno));
+    errno = 0;
+    ok (certdb_open (dbpath) == NULL && errno == EPERM,
+        "certdb_open of group writable file fails with EPERM");
+    errno = 0;
+    ok (certdb_open (tmpdir) == NULL && errno == EPERM,
+        "certdb_open of directory fails with EPERM");
+    ok (certdb_changed (NULL, dbpath) == false,
+        "certdb_changed db=NULL returns false");
+    errno = 0;
+    ok (certdb_lookup (NULL, 0) == NULL && errno == EINVAL,
+        "certdb_lookup db=NULL fails with EINVAL");
+    errno = 0;
+    ok (certdb_builder_add (NULL, 0, certs[0]) < 0 && errno == EINVAL,
+        "certdb_builder_add b=NULL fails with EINVAL");
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    init ();
+    test_build ();
+    test_errors ();
+    fini ();
+
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
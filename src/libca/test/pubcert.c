@@ -0,0 +1,183 @@
+/************************************************************\
+ * Copyright 2017 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "src/libtap/tap.h"
+#include "sigcert.h"
+#include "pubcert.h"
+
+static struct sigcert *create_cert (time_t now)
+{
+    struct sigcert *cert;
+
+    if (!(cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    if (sigcert_meta_set (cert, "uuid", SM_STRING, "foo") < 0
+        || sigcert_meta_set (cert, "userid", SM_INT64, (int64_t)42) < 0
+        || sigcert_meta_set (cert, "ratio", SM_DOUBLE, 3.5) < 0
+        || sigcert_meta_set (cert, "ca-capability", SM_BOOL, true) < 0
+        || sigcert_meta_set (cert, "ctime", SM_TIMESTAMP, now) < 0)
+        BAIL_OUT ("sigcert_meta_set: %s", strerror (errno));
+    return cert;
+}
+
+void test_meta (void)
+{
+    time_t now = time (NULL);
+    struct sigcert *cert = create_cert (now);
+    struct pubcert *pc;
+    const char *s;
+    int64_t i;
+    double d;
+    bool b;
+    time_t t;
+
+    pc = pubcert_create (cert);
+    ok (pc != NULL,
+        "pubcert_create works");
+    ok (pubcert_size (pc) > 0,
+        "pubcert_size returns %zu", pubcert_size (pc));
+    ok (pubcert_meta_get (pc, "uuid", SM_STRING, &s) == 0
+        && !strcmp (s, "foo"),
+        "pubcert_meta_get string works");
+    ok (pubcert_meta_get (pc, "userid", SM_INT64, &i) == 0 && i == 42,
+        "pubcert_meta_get int64 works");
+    ok (pubcert_meta_get (pc, "ratio", SM_DOUBLE, &d) == 0 && d == 3.5,
+        "pubcert_meta_get double works");
+    ok (pubcert_meta_get (pc, "ca-capability", SM_BOOL, &b) == 0
+        && b == true,
+        "pubcert_meta_get bool works");
+    ok (pubcert_meta_get (pc, "ctime", SM_TIMESTAMP, &t) == 0 && t == now,
+        "pubcert_meta_get timestamp works");
+    errno = 0;
+    ok (pubcert_meta_get (pc, "userid", SM_STRING, &s) < 0
+        && errno == ENOENT,
+        "pubcert_meta_get wrong type fails with ENOENT");
+    errno = 0;
+    ok (pubcert_meta_get (pc, "nokey", SM_STRING, &s) < 0
+        && errno == ENOENT,
+        "pubcert_meta_get missing key fails with ENOENT");
+    errno = 0;
+    ok (pubcert_meta_get (NULL, "uuid", SM_STRING, &s) < 0
+        && errno == EINVAL,
+        "pubcert_meta_get pc=NULL fails with EINVAL");
+    ok (pubcert_equal (pc, cert) == true,
+        "pubcert_equal returns true for source cert");
+
+    if (sigcert_meta_set (cert, "userid", SM_INT64, (int64_t)43) < 0)
+        BAIL_OUT ("sigcert_meta_set: %s", strerror (errno));
+    ok (pubcert_equal (pc, cert) == false,
+        "pubcert_equal returns false after cert metadata changed");
+
+    pubcert_destroy (pc);
+    sigcert_destroy (cert);
+}
+
+void test_copy (void)
+{
+    struct sigcert *cert = create_cert (time (NULL));
+    struct pubcert *pc;
+    struct pubcert *cpy;
+    const char *s;
+
+    if (!(pc = pubcert_create (cert)))
+        BAIL_OUT ("pubcert_create: %s", strerror (errno));
+    if (!(cpy = malloc (pubcert_size (pc))))
+        BAIL_OUT ("out of memory");
+    memcpy (cpy, pc, pubcert_size (pc));
+    pubcert_destroy (pc);
+
+    ok (pubcert_meta_get (cpy, "uuid", SM_STRING, &s) == 0
+        && !strcmp (s, "foo"),
+        "pubcert copied with memcpy is usable");
+    ok (pubcert_equal (cpy, cert) == true,
+        "pubcert copied with memcpy is equal to source cert");
+
+    free (cpy);
+    sigcert_destroy (cert);
+}
+
+void test_verify (void)
+{
+    struct sigcert *ca = create_cert (time (NULL));
+    struct sigcert *cert = create_cert (time (NULL));
+    struct sigcert *cert2;
+    struct pubcert *pc;
+    uint8_t data[] = "hello world";
+    char *sig;
+
+    if (sigcert_sign_cert (ca, cert) < 0)
+        BAIL_OUT ("sigcert_sign_cert: %s", strerror (errno));
+    if (!(sig = sigcert_sign_detached (cert, data, sizeof (data))))
+        BAIL_OUT ("sigcert_sign_detached: %s", strerror (errno));
+    if (!(pc = pubcert_create (cert)))
+        BAIL_OUT ("pubcert_create: %s", strerror (errno));
+
+    ok (pubcert_verify_detached (pc, sig, data, sizeof (data)) == 0,
+        "pubcert_verify_detached works");
+    data[0] = 'j';
+    errno = 0;
+    ok (pubcert_verify_detached (pc, sig, data, sizeof (data)) < 0
+        && errno == EINVAL,
+        "pubcert_verify_detached fails with EINVAL on modified data");
+    errno = 0;
+    ok (pubcert_verify_detached (pc, "foo", data, sizeof (data)) < 0
+        && errno == EINVAL,
+        "pubcert_verify_detached fails with EINVAL on bad signature");
+    errno = 0;
+    ok (pubcert_verify_detached (NULL, sig, data, sizeof (data)) < 0
+        && errno == EINVAL,
+        "pubcert_verify_detached pc=NULL fails with EINVAL");
+
+    cert2 = pubcert_sigcert (pc);
+    ok (cert2 != NULL,
+        "pubcert_sigcert works");
+    ok (sigcert_has_secret (cert2) == false,
+        "converted cert has no secret");
+    ok (pubcert_equal (pc, cert2) == true,
+        "converted cert is equal to pubcert");
+    ok (sigcert_verify_cert (ca, cert2) == 0,
+        "converted cert signature verifies with CA");
+
+    errno = 0;
+    ok (pubcert_create (NULL) == NULL && errno == EINVAL,
+        "pubcert_create cert=NULL fails with EINVAL");
+    errno = 0;
+    ok (pubcert_decode (NULL, 0) == NULL && errno == EINVAL,
+        "pubcert_decode s=NULL fails with EINVAL");
+
+    free (sig);
+    sigcert_destroy (cert2);
+    pubcert_destroy (pc);
+    sigcert_destroy (cert);
+    sigcert_destroy (ca);
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_meta ();
+    test_copy ();
+    test_verify ();
+
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
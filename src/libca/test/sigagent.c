@@ -0,0 +1,329 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pwd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "src/libtap/tap.h"
+#include "sigcert.h"
+#include "sigagent.h"
+
+static char tmpdir[PATH_MAX + 1];
+static char sockpath[PATH_MAX + 1];
+
+static pid_t start_agent (struct sigcert *cert)
+{
+    pid_t pid;
+    int fd;
+
+    if ((fd = sigagent_listen (sockpath)) < 0)
+        BAIL_OUT ("sigagent_listen: %s", strerror (errno));
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork: %s", strerror (errno));
+    if (pid == 0) {
+        (void)sigagent_serve (fd, cert);
+        _exit (1);
+    }
+    (void)close (fd);
+    return pid;
+}
+
+static void stop_agent (pid_t pid)
+{
+    int status;
+
+    if (kill (pid, SIGTERM) < 0 || waitpid (pid, &status, 0) < 0)
+        BAIL_OUT ("failed to stop agent: %s", strerror (errno));
+}
+
+void test_sign (struct sigcert *cert)
+{
+    struct sigagent *agent;
+    struct sigcert *pub;
+    struct sigcert *expected;
+    char *sig;
+
+    if (!(expected = sigcert_copy (cert)))
+        BAIL_OUT ("sigcert_copy: %s", strerror (errno));
+    sigcert_forget_secret (expected);
+
+    agent = sigagent_connect (sockpath);
+    ok (agent != NULL,
+        "sigagent_connect works");
+
+    pub = sigagent_get_cert (agent);
+    ok (pub != NULL,
+        "sigagent_get_cert works");
+    ok (pub && sigcert_equal (pub, expected),
+        "agent returned public cert");
+
+    sig = sigagent_sign (agent, (uint8_t *)"hello", 5);
+    ok (sig != NULL,
+        "sigagent_sign works");
+    ok (sig && sigcert_verify_detached (pub, sig, (uint8_t *)"hello", 5) == 0,
+        "signature verifies with public cert");
+    free (sig);
+
+    sig = sigagent_sign (agent, NULL, 0);
+    ok (sig && sigcert_verify_detached (pub, sig, NULL, 0) == 0,
+        "sigagent_sign of empty buffer works");
+    free (sig);
+
+    errno = 0;
+    ok (sigagent_sign (NULL, (uint8_t *)"hello", 5) == NULL && errno == EINVAL,
+        "sigagent_sign agent=NULL fails with EINVAL");
+
+    sigcert_destroy (expected);
+    sigcert_destroy (pub);
+    sigagent_close (agent);
+}
+
+void test_errors (struct sigcert *cert)
+{
+    struct sigcert *pub;
+    struct stat sb;
+    int fd;
+
+    errno = 0;
+    ok (sigagent_connect ("/noexist") == NULL && errno == ENOENT,
+        "sigagent_connect to missing socket fails with ENOENT");
+    errno = 0;
+    ok (sigagent_connect (NULL) == NULL && errno == EINVAL,
+        "sigagent_connect path=NULL fails with EINVAL");
+    errno = 0;
+    ok (sigagent_listen (NULL) < 0 && errno == EINVAL,
+        "sigagent_listen path=NULL fails with EINVAL");
+
+    ok ((fd = sigagent_listen (sockpath)) >= 0,
+        "sigagent_listen replaces stale socket");
+    (void)close (fd);
+    if (unlink (sockpath) < 0
+            || (fd = open (sockpath, O_WRONLY | O_CREAT, 0600)) < 0)
+        BAIL_OUT ("%s: %s", sockpath, strerror (errno));
+    (void)close (fd);
+    errno = 0;
+    ok (sigagent_listen (sockpath) < 0 && errno == EEXIST,
+        "sigagent_listen fails with EEXIST if path is not a socket");
+    ok (lstat (sockpath, &sb) == 0 && S_ISREG (sb.st_mode),
+        "and the file is left alone");
+    (void)unlink (sockpath);
+
+    if (!(pub = sigcert_copy (cert)))
+        BAIL_OUT ("sigcert_copy: %s", strerror (errno));
+    sigcert_forget_secret (pub);
+    errno = 0;
+    ok (sigagent_serve (0, pub) < 0 && errno == EINVAL,
+        "sigagent_serve with public cert fails with EINVAL");
+    sigcert_destroy (pub);
+}
+
+/* Start an agent listening on 'path' as 'uid' and 'gid'.
+ */
+static pid_t start_agent_as (struct sigcert *cert, const char *path,
+                             uid_t uid, gid_t gid)
+{
+    pid_t pid;
+    int i;
+
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork: %s", strerror (errno));
+    if (pid == 0) {
+        int fd;
+        if (setgid (gid) < 0 || setuid (uid) < 0
+                || (fd = sigagent_listen (path)) < 0)
+            _exit (1);
+        (void)sigagent_serve (fd, cert);
+        _exit (1);
+    }
+    for (i = 0; i < 100 && access (path, F_OK) < 0; i++)
+        usleep (50000);
+    return pid;
+}
+
+void test_path (void)
+{
+    char buf1[PATH_MAX + 1];
+    char buf2[PATH_MAX + 1];
+    char small[8];
+
+    ok (sigagent_path ("/run/user/%u/agent", 1000, buf1, sizeof (buf1)) == 0
+        && !strcmp (buf1, "/run/user/1000/agent"),
+        "sigagent_path expands %%u");
+    ok (sigagent_path ("/run/user/%u/agent", 1001, buf2, sizeof (buf2)) == 0
+        && strcmp (buf1, buf2) != 0,
+        "sigagent_path gives different users different paths");
+    ok (sigagent_path ("a%%u%u", 0, buf1, sizeof (buf1)) == 0
+        && !strcmp (buf1, "a%u0"),
+        "sigagent_path expands %%%% to %%");
+    ok (sigagent_path ("agent.sock", 1000, buf1, sizeof (buf1)) == 0
+        && !strcmp (buf1, "agent.sock"),
+        "sigagent_path leaves path without %% alone");
+    errno = 0;
+    ok (sigagent_path ("/tmp/%x", 0, buf1, sizeof (buf1)) < 0
+        && errno == EINVAL,
+        "sigagent_path with unknown %% sequence fails with EINVAL");
+    errno = 0;
+    ok (sigagent_path ("/tmp/%", 0, buf1, sizeof (buf1)) < 0
+        && errno == EINVAL,
+        "sigagent_path with trailing %% fails with EINVAL");
+    errno = 0;
+    ok (sigagent_path ("/tmp/%u", 123456, small, sizeof (small)) < 0
+        && errno == ENAMETOOLONG,
+        "sigagent_path fails with ENAMETOOLONG if result does not fit");
+    errno = 0;
+    ok (sigagent_path (NULL, 0, buf1, sizeof (buf1)) < 0 && errno == EINVAL,
+        "sigagent_path tmpl=NULL fails with EINVAL");
+}
+
+/* Return true if the agent at 'path' can be reached and serves 'cert'.
+ */
+static bool agent_serves (const char *path, const struct sigcert *cert)
+{
+    struct sigagent *agent;
+    struct sigcert *pub;
+    struct sigcert *expected;
+    bool result = false;
+
+    if (!(expected = sigcert_copy (cert)))
+        BAIL_OUT ("sigcert_copy: %s", strerror (errno));
+    sigcert_forget_secret (expected);
+    if ((agent = sigagent_connect (path))) {
+        if ((pub = sigagent_get_cert (agent))) {
+            result = sigcert_equal (pub, expected);
+            sigcert_destroy (pub);
+        }
+        sigagent_close (agent);
+    }
+    sigcert_destroy (expected);
+    return result;
+}
+
+/* Two users share one socket path template, each running their own agent.
+ * Each reaches only their own agent, and an agent run by another user,
+ * e.g. one planted at a path the client expects, is rejected.
+ * Running as another uid requires root.
+ */
+void test_multiuser (struct sigcert *cert)
+{
+    char dir[PATH_MAX + 1];
+    char tmpl[PATH_MAX + 1];
+    char path[PATH_MAX + 1];
+    char other_path[PATH_MAX + 1];
+    struct sigcert *other_cert;
+    struct passwd *pw = NULL;
+    pid_t pid, other_pid, child;
+    int status;
+
+    skip (geteuid () != 0 || !(pw = getpwnam ("nobody")), 6,
+          "must be root, with a nobody user");
+    if (!(other_cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    if (snprintf (dir, sizeof (dir), "%s/run", tmpdir) >= sizeof (dir)
+            || snprintf (tmpl, sizeof (tmpl), "%s/agent-%%u", dir)
+                >= sizeof (tmpl)
+            || sigagent_path (tmpl, getuid (), path, sizeof (path)) < 0
+            || sigagent_path (tmpl, pw->pw_uid, other_path,
+                              sizeof (other_path)) < 0)
+        BAIL_OUT ("path is too long");
+    if (chmod (tmpdir, 0711) < 0
+            || mkdir (dir, 0700) < 0
+            || chmod (dir, 01777) < 0)
+        BAIL_OUT ("%s: %s", dir, strerror (errno));
+
+    pid = start_agent_as (cert, path, getuid (), getgid ());
+    other_pid = start_agent_as (other_cert, other_path, pw->pw_uid,
+                                pw->pw_gid);
+    ok (access (path, F_OK) == 0 && access (other_path, F_OK) == 0,
+        "agents started as uid %d and uid %d at %s",
+        (int)getuid (), (int)pw->pw_uid, tmpl);
+    ok (agent_serves (path, cert),
+        "uid %d reaches its own agent", (int)getuid ());
+    errno = 0;
+    ok (sigagent_connect (other_path) == NULL && errno == EPERM,
+        "sigagent_connect to agent of another user fails with EPERM");
+
+    if ((child = fork ()) < 0)
+        BAIL_OUT ("fork: %s", strerror (errno));
+    if (child == 0) {
+        if (setgid (pw->pw_gid) < 0 || setuid (pw->pw_uid) < 0)
+            _exit (2);
+        if (!agent_serves (other_path, other_cert))
+            _exit (3);
+        if (sigagent_connect (path) != NULL) // EACCES: socket is 0600
+            _exit (4);
+        _exit (0);
+    }
+    ok (waitpid (child, &status, 0) == child,
+        "ran client as uid %d", (int)pw->pw_uid);
+    ok (WIFEXITED (status) && WEXITSTATUS (status) == 0,
+        "uid %d reaches its own agent and not the other (status %d)",
+        (int)pw->pw_uid, WIFEXITED (status) ? WEXITSTATUS (status) : -1);
+    ok (strcmp (path, other_path) != 0,
+        "the users' socket paths differ");
+
+    stop_agent (other_pid);
+    stop_agent (pid);
+    (void)unlink (path);
+    (void)unlink (other_path);
+    (void)rmdir (dir);
+    (void)chmod (tmpdir, 0700);
+    sigcert_destroy (other_cert);
+    end_skip;
+}
+
+int main (int argc, char *argv[])
+{
+    const char *t = getenv ("TMPDIR");
+    struct sigcert *cert;
+    pid_t pid;
+
+    plan (NO_PLAN);
+
+    (void)snprintf (tmpdir, sizeof (tmpdir), "%s/sigagent-XXXXXX",
+                    t ? t : "/tmp");
+    if (!mkdtemp (tmpdir))
+        BAIL_OUT ("mkdtemp %s: %s", tmpdir, strerror (errno));
+    if (snprintf (sockpath, sizeof (sockpath), "%s/agent",
+                  tmpdir) >= sizeof (sockpath))
+        BAIL_OUT ("socket path is too long");
+    if (!(cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+
+    pid = start_agent (cert);
+    test_sign (cert);
+    stop_agent (pid);
+    test_errors (cert);
+    test_path ();
+    test_multiuser (cert);
+
+    (void)unlink (sockpath);
+    if (rmdir (tmpdir) < 0)
+        BAIL_OUT ("rmdir %s: %s", tmpdir, strerror (errno));
+    sigcert_destroy (cert);
+
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -13,12 +13,14 @@
 #endif
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
 
 #include "src/libtap/tap.h"
+#include "src/libutil/kv.h"
 #include "sigcert.h"
 
 static char scratch[PATH_MAX + 1];
@@ -117,6 +119,77 @@ void test_meta (void)
     sigcert_destroy (cert);
 }
 
+void test_info (void)
+{
+    struct sigcert *cert;
+    struct sigcert *cert2;
+    const struct sigcert_info *info;
+    const char *s;
+    int len;
+    time_t tnow = time (NULL);
+
+    if (!(cert = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    info = sigcert_info (cert);
+    ok (info != NULL && info->valid == 0,
+        "sigcert_info on new cert has no valid fields");
+
+    ok (sigcert_meta_set (cert, "uuid", SM_STRING, "foo") == 0
+        && sigcert_meta_set (cert, "userid", SM_INT64, 42LL) == 0
+        && sigcert_meta_set (cert, "ctime", SM_TIMESTAMP, tnow) == 0
+        && sigcert_meta_set (cert, "xtime", SM_TIMESTAMP, tnow + 60) == 0
+        && sigcert_meta_set (cert, "issuer", SM_STRING, "bar") == 0
+        && sigcert_meta_set (cert, "ca-capability", SM_BOOL, true) == 0,
+        "sigcert_meta_set some well-known keys");
+    ok (sigcert_meta_set (cert, "max-sign-ttl", SM_STRING, "notanint") == 0,
+        "sigcert_meta_set max-sign-ttl with wrong type");
+    info = sigcert_info (cert);
+    ok (info != NULL
+        && info->valid == (SIGCERT_INFO_UUID | SIGCERT_INFO_USERID
+                           | SIGCERT_INFO_CTIME | SIGCERT_INFO_XTIME
+                           | SIGCERT_INFO_ISSUER
+                           | SIGCERT_INFO_CA_CAPABILITY),
+        "sigcert_info valid flags reflect set keys of correct type");
+    ok (info != NULL
+        && !strcmp (info->uuid, "foo")
+        && info->userid == 42
+        && info->ctime == tnow
+        && info->xtime == tnow + 60
+        && !strcmp (info->issuer, "bar")
+        && info->ca_capability == true,
+        "sigcert_info fields have expected values");
+
+    ok (sigcert_meta_set (cert, "userid", SM_INT64, 43LL) == 0,
+        "sigcert_meta_set userid=43");
+    info = sigcert_info (cert);
+    ok (info != NULL && info->userid == 43 && !strcmp (info->uuid, "foo"),
+        "sigcert_info reflects update");
+
+    /* Decoded info survives encode/decode and copy.
+     */
+    if (sigcert_encode (cert, &s, &len) < 0)
+        BAIL_OUT ("sigcert_encode: %s", strerror (errno));
+    if (!(cert2 = sigcert_decode (s, len)))
+        BAIL_OUT ("sigcert_decode: %s", strerror (errno));
+    info = sigcert_info (cert2);
+    ok (info != NULL && info->userid == 43 && info->xtime == tnow + 60
+        && !strcmp (info->issuer, "bar"),
+        "sigcert_info works on decoded cert");
+    sigcert_destroy (cert2);
+
+    if (!(cert2 = sigcert_copy (cert)))
+        BAIL_OUT ("sigcert_copy: %s", strerror (errno));
+    sigcert_destroy (cert);
+    info = sigcert_info (cert2);
+    ok (info != NULL && !strcmp (info->uuid, "foo") && info->userid == 43,
+        "sigcert_info works on copy after original is destroyed");
+    sigcert_destroy (cert2);
+
+    errno = 0;
+    ok (sigcert_info (NULL) == NULL && errno == EINVAL,
+        "sigcert_info cert=NULL fails with EINVAL");
+}
+
 void test_load_store (void)
 {
     struct sigcert *cert;
@@ -206,8 +279,10 @@ void test_load_store (void)
 
     cleanup_keypath ("test");
     cleanup_keypath ("test.pub");
+    cleanup_keypath ("test.pub.bin");
     cleanup_keypath ("foo");
     cleanup_keypath ("foo.pub");
+    cleanup_keypath ("foo.pub.bin");
 }
 
 void test_fread_fwrite (void)
@@ -310,11 +385,108 @@ void test_sign_verify_detached (void)
     sigcert_destroy (cert2);
 }
 
+/* Verify a batch of randomized signatures, some corrupted, and check
+ * that the per-item results match individual verification.
+ */
+#define BATCH_CERTS 4
+#define BATCH_SIZE 64
+void test_verify_batch (void)
+{
+    struct sigcert *certs[BATCH_CERTS];
+    struct sigcert_batch_item items[BATCH_SIZE];
+    uint8_t msgs[BATCH_SIZE][32];
+    char *sigs[BATCH_SIZE];
+    int invalid = 0;
+    int mismatch = 0;
+    int i, j;
+
+    srand (42);
+    for (i = 0; i < BATCH_CERTS; i++) {
+        if (!(certs[i] = sigcert_create ()))
+            BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    }
+    for (i = 0; i < BATCH_SIZE; i++) {
+        for (j = 0; j < sizeof (msgs[i]); j++)
+            msgs[i][j] = rand () & 0xff;
+        items[i].cert = certs[rand () % BATCH_CERTS];
+        items[i].buf = msgs[i];
+        items[i].len = rand () % (sizeof (msgs[i]) + 1);
+        if (!(sigs[i] = sigcert_sign_detached (items[i].cert,
+                                               items[i].buf,
+                                               items[i].len)))
+            BAIL_OUT ("sigcert_sign_detached: %s", strerror (errno));
+        items[i].signature = sigs[i];
+    }
+
+    ok (sigcert_verify_detached_batch (items, BATCH_SIZE) == 0,
+        "sigcert_verify_detached_batch works");
+    for (i = 0; i < BATCH_SIZE; i++) {
+        if (items[i].result != 0)
+            mismatch++;
+    }
+    ok (mismatch == 0,
+        "all items have result = 0");
+
+    /* Corrupt every 5th item: wrong cert, tampered message, or bad sig.
+     */
+    for (i = 0; i < BATCH_SIZE; i += 5) {
+        switch (rand () % 3) {
+            case 0:
+                items[i].cert = items[i].cert == certs[0] ? certs[1]
+                                                          : certs[0];
+                break;
+            case 1:
+                msgs[i][0] ^= 1;
+                if (items[i].len == 0)
+                    items[i].len = 1;
+                break;
+            case 2:
+                items[i].signature = "foo";
+                break;
+        }
+        invalid++;
+    }
+    errno = 0;
+    ok (sigcert_verify_detached_batch (items, BATCH_SIZE) < 0
+        && errno == EINVAL,
+        "sigcert_verify_detached_batch fails with EINVAL on bad items");
+    mismatch = 0;
+    j = 0;
+    for (i = 0; i < BATCH_SIZE; i++) {
+        int rc = sigcert_verify_detached (items[i].cert, items[i].signature,
+                                          items[i].buf, items[i].len);
+        if (rc != items[i].result)
+            mismatch++;
+        if (items[i].result < 0)
+            j++;
+    }
+    ok (mismatch == 0 && j == invalid,
+        "per-item results match individual verification (%d invalid)", j);
+
+    items[2].cert = NULL;
+    errno = 0;
+    ok (sigcert_verify_detached_batch (&items[1], 2) < 0 && errno == EINVAL
+        && items[1].result == 0 && items[2].result < 0,
+        "sigcert_verify_detached_batch marks cert=NULL item invalid");
+    errno = 0;
+    ok (sigcert_verify_detached_batch (NULL, 1) < 0 && errno == EINVAL,
+        "sigcert_verify_detached_batch items=NULL fails with EINVAL");
+    ok (sigcert_verify_detached_batch (NULL, 0) == 0,
+        "sigcert_verify_detached_batch count=0 works");
+
+    for (i = 0; i < BATCH_SIZE; i++)
+        free (sigs[i]);
+    for (i = 0; i < BATCH_CERTS; i++)
+        sigcert_destroy (certs[i]);
+}
+
 void test_codec (void)
 {
     struct sigcert *cert;
     struct sigcert *cert_pub;
     struct sigcert *cert2;
+    struct kv *kv;
+    struct kv *kv2 = NULL;
     const char *s;
     int len;
 
@@ -354,12 +526,197 @@ void test_codec (void)
         "sigcert_decode works");
     ok (sigcert_equal (cert2, cert_pub) == true,
         "the two certs are equal");
+    sigcert_destroy (cert2);
+
+    /* Embed encoded cert in a larger kv object with prefix,
+     * then decode it from there.
+     */
+    if (!(kv = kv_create ())
+        || kv_put (kv, "other", KV_STRING, "stuff") < 0
+        || !(kv2 = kv_decode (s, len))
+        || kv_join (kv, kv2, "x.cert.") < 0)
+        BAIL_OUT ("failed to create kv with embedded cert");
+    cert2 = sigcert_decode_kv (kv, "x.cert.");
+    ok (cert2 != NULL && sigcert_equal (cert2, cert_pub) == true,
+        "sigcert_decode_kv works with prefix");
+    errno = 0;
+    ok (sigcert_decode_kv (kv, "y.cert.") == NULL && errno == ENOENT,
+        "sigcert_decode_kv with wrong prefix fails with ENOENT");
+    kv_destroy (kv2);
+    kv_destroy (kv);
 
     sigcert_destroy (cert);
     sigcert_destroy (cert_pub);
     sigcert_destroy (cert2);
 }
 
+void test_bin (void)
+{
+    struct sigcert *cert;
+    struct sigcert *cert_pub;
+    struct sigcert *cert2;
+    struct sigcert *ca;
+    const char *name;
+    char *buf;
+    size_t len;
+    FILE *fp;
+    struct timespec mtime[2] = { { 0, UTIME_OMIT }, { 1, 0 } };
+    struct stat sb;
+    const char *s;
+
+    if (!(cert = sigcert_create ()) || !(ca = sigcert_create ()))
+        BAIL_OUT ("sigcert_create: %s", strerror (errno));
+    if (sigcert_meta_set (cert, "foo", SM_STRING, "bar") < 0
+        || sigcert_meta_set (cert, "bar", SM_INT64, 42LL) < 0
+        || sigcert_meta_set (cert, "time", SM_TIMESTAMP, time (NULL)) < 0)
+        BAIL_OUT ("sigcert_meta_set failed");
+    if (sigcert_sign_cert (ca, cert) < 0)
+        BAIL_OUT ("sigcert_sign_cert: %s", strerror (errno));
+    if (!(cert_pub = sigcert_copy (cert)))
+        BAIL_OUT ("sigcert_copy: %s", strerror (errno));
+    sigcert_forget_secret (cert_pub);
+
+    /* Encode/decode binary.
+     */
+    buf = sigcert_encode_bin (cert, &len);
+    ok (buf != NULL && len > 0,
+        "sigcert_encode_bin works");
+    cert2 = sigcert_decode_bin (buf, len);
+    ok (cert2 != NULL,
+        "sigcert_decode_bin works");
+    ok (sigcert_equal (cert2, cert_pub) == true,
+        "decoded cert is equal to public cert");
+    ok (sigcert_verify_cert (ca, cert2) == 0,
+        "decoded cert signature verifies");
+    sigcert_destroy (cert2);
+
+    errno = 0;
+    ok (sigcert_decode_bin (buf, len - 1) == NULL && errno == EINVAL,
+        "sigcert_decode_bin fails with EINVAL on truncated buffer");
+    buf[0] = 'x';
+    errno = 0;
+    ok (sigcert_decode_bin (buf, len) == NULL && errno == EINVAL,
+        "sigcert_decode_bin fails with EINVAL on bad magic");
+    errno = 0;
+    ok (sigcert_decode_bin (NULL, 0) == NULL && errno == EINVAL,
+        "sigcert_decode_bin buf=NULL fails with EINVAL");
+    errno = 0;
+    ok (sigcert_encode_bin (NULL, &len) == NULL && errno == EINVAL,
+        "sigcert_encode_bin cert=NULL fails with EINVAL");
+    free (buf);
+
+    /* sigcert_store writes test.pub.bin, which sigcert_load uses
+     * as long as test.pub is unchanged.
+     */
+    name = new_keypath ("test");
+    ok (sigcert_store (cert, name) == 0,
+        "sigcert_store works");
+    name = new_keypath ("test.pub.bin");
+    ok (access (name, R_OK) == 0,
+        "sigcert_store created test.pub.bin");
+    name = new_keypath ("test");
+    ok ((cert2 = sigcert_load (name, false)) != NULL
+        && sigcert_equal (cert2, cert_pub) == true,
+        "sigcert_load works with binary copy");
+    sigcert_destroy (cert2);
+
+    /* Bind a binary copy of ca to test.pub, to tell which file is read.
+     */
+    ok (sigcert_store_bin (ca, name) == 0,
+        "sigcert_store_bin works");
+    ok ((cert2 = sigcert_load (name, false)) != NULL
+        && sigcert_verify_cert (ca, cert2) < 0,
+        "sigcert_load reads binary copy when test.pub is unchanged");
+    sigcert_destroy (cert2);
+
+    /* A new mtime on test.pub invalidates the binary copy, even though
+     * the contents are unchanged.
+     */
+    name = new_keypath ("test.pub");
+    if (utimensat (AT_FDCWD, name, mtime, 0) < 0)
+        BAIL_OUT ("utimensat %s: %s", name, strerror (errno));
+    name = new_keypath ("test");
+    ok ((cert2 = sigcert_load (name, false)) != NULL
+        && sigcert_equal (cert2, cert_pub) == true,
+        "sigcert_load reads test.pub after its mtime changes");
+    sigcert_destroy (cert2);
+    if (sigcert_store_bin (ca, name) < 0)
+        BAIL_OUT ("sigcert_store_bin: %s", strerror (errno));
+
+    if (sigcert_meta_set (cert, "foo", SM_STRING, "baz") < 0
+        || sigcert_sign_cert (ca, cert) < 0)
+        BAIL_OUT ("failed to update cert: %s", strerror (errno));
+    name = new_keypath ("test.pub");
+    if (!(fp = fopen (name, "w")))
+        BAIL_OUT ("fopen %s: %s", name, strerror (errno));
+    if (sigcert_fwrite_public (cert, fp) < 0 || fclose (fp) < 0)
+        BAIL_OUT ("failed to rewrite %s", name);
+    name = new_keypath ("test");
+    ok ((cert2 = sigcert_load (name, false)) != NULL
+        && sigcert_verify_cert (ca, cert2) == 0,
+        "sigcert_load reads test.pub after it is modified");
+    sigcert_destroy (cert2);
+
+    /* Rewriting test.pub in place with the same size and mtime still
+     * invalidates the binary copy, since the ctime changes.
+     */
+    if (sigcert_store_bin (ca, name) < 0)
+        BAIL_OUT ("sigcert_store_bin: %s", strerror (errno));
+    if (sigcert_meta_set (cert, "foo", SM_STRING, "bay") < 0
+        || sigcert_sign_cert (ca, cert) < 0)
+        BAIL_OUT ("failed to update cert: %s", strerror (errno));
+    name = new_keypath ("test.pub");
+    if (stat (name, &sb) < 0)
+        BAIL_OUT ("stat %s: %s", name, strerror (errno));
+    if (!(fp = fopen (name, "r+")))
+        BAIL_OUT ("fopen %s: %s", name, strerror (errno));
+    if (sigcert_fwrite_public (cert, fp) < 0 || fclose (fp) < 0)
+        BAIL_OUT ("failed to rewrite %s", name);
+    mtime[0].tv_nsec = UTIME_OMIT;
+    mtime[1] = sb.st_mtim;
+    if (utimensat (AT_FDCWD, name, mtime, 0) < 0)
+        BAIL_OUT ("utimensat %s: %s", name, strerror (errno));
+    name = new_keypath ("test");
+    ok ((cert2 = sigcert_load (name, false)) != NULL
+        && sigcert_verify_cert (ca, cert2) == 0
+        && sigcert_meta_get (cert2, "foo", SM_STRING, &s) == 0
+        && !strcmp (s, "bay"),
+        "sigcert_load reads test.pub rewritten with the same size and mtime");
+    sigcert_destroy (cert2);
+
+    /* Failure to write the binary copy does not fail sigcert_store.
+     */
+    name = new_keypath ("test.pub.bin");
+    if (unlink (name) < 0 || mkdir (name, 0700) < 0)
+        BAIL_OUT ("failed to replace %s with a directory", name);
+    name = new_keypath ("test");
+    ok (sigcert_store (cert, name) == 0,
+        "sigcert_store works when test.pub.bin cannot be written");
+    ok ((cert2 = sigcert_load (name, false)) != NULL
+        && sigcert_verify_cert (ca, cert2) == 0,
+        "sigcert_load reads test.pub");
+    sigcert_destroy (cert2);
+    name = new_keypath ("test.pub.bin");
+    if (rmdir (name) < 0)
+        BAIL_OUT ("rmdir %s: %s", name, strerror (errno));
+
+    errno = 0;
+    ok (sigcert_store_bin (cert, NULL) < 0 && errno == EINVAL,
+        "sigcert_store_bin name=NULL fails with EINVAL");
+    name = new_keypath ("noexist");
+    errno = 0;
+    ok (sigcert_store_bin (cert, name) < 0 && errno == ENOENT,
+        "sigcert_store_bin fails with ENOENT if name.pub is missing");
+
+    cleanup_keypath ("test");
+    cleanup_keypath ("test.pub");
+    cleanup_keypath ("test.pub.bin");
+
+    sigcert_destroy (cert_pub);
+    sigcert_destroy (cert);
+    sigcert_destroy (ca);
+}
+
 void test_corner (void)
 {
     struct sigcert *cert;
@@ -608,6 +965,8 @@ void test_sign_cert (void)
         "sigcert_sign_cert works");
     ok (sigcert_verify_cert (ca, cert) == 0,
         "sigcert_verify_cert works");
+    ok (sigcert_verify_cert (ca, cert) == 0,
+        "sigcert_verify_cert works again");
 
     /* Verification of a signed cert still works after serialization.
      */
@@ -633,6 +992,7 @@ void test_sign_cert (void)
     sigcert_destroy (cert2);
     cleanup_keypath ("test");
     cleanup_keypath ("test.pub");
+    cleanup_keypath ("test.pub.bin");
 
     /* Verification of a signed but modified cert fails.
      */
@@ -642,6 +1002,13 @@ void test_sign_cert (void)
     ok (sigcert_verify_cert (ca, cert) < 0 && errno == EINVAL,
         "sigcert_verify_cert fails with EINVAL");
 
+    /* Restoring the original metadata restores the signature.
+     */
+    ok (sigcert_meta_set (cert, "username", SM_STRING, "itsme") == 0,
+        "sigcert_meta_set restores signed cert metadata");
+    ok (sigcert_verify_cert (ca, cert) == 0,
+        "sigcert_verify_cert works again");
+
     sigcert_destroy (cert);
     sigcert_destroy (ca);
 }
@@ -802,9 +1169,12 @@ int main (int argc, char *argv[])
     new_scratchdir ();
 
     test_meta ();
+    test_info ();
     test_load_store ();
     test_sign_verify_detached ();
+    test_verify_batch ();
     test_codec ();
+    test_bin ();
     test_corner ();
     test_sign_cert ();
     test_badcert ();
@@ -13,6 +13,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <glob.h>
 #include <limits.h>
 #include <libgen.h>
@@ -327,6 +328,71 @@ void parse_extra (void)
 
 }
 
+/* A document large enough that the parser's arena spans several blocks
+ * and its vectors grow many times.
+ */
+void parse_large (void)
+{
+    const int nodes = 1000;
+    const int keys = 300;
+    size_t size = nodes * 100 + keys * 40 + 100;
+    char *buf;
+    size_t len = 0;
+    char e[200];
+    toml_table_t *conf;
+    toml_array_t *arr;
+    toml_table_t *tab;
+    int64_t id;
+    char *str = NULL;
+    int i;
+
+    if (!(buf = malloc (size)))
+        BAIL_OUT ("out of memory");
+    for (i = 0; i < nodes; i++)
+        len += snprintf (buf + len, size - len,
+                         "[[node]]\nname = \"node%d\"\nid = %d\n"
+                         "cores = [0, 1, 2, 3, 4, 5, 6, 7, 8]\n", i, i);
+    len += snprintf (buf + len, size - len, "[\"policy\\ttab\"]\n");
+    for (i = 0; i < keys; i++)
+        len += snprintf (buf + len, size - len, "key_%d = -%d\n", i, i);
+    if (len >= size)
+        BAIL_OUT ("buffer too small");
+
+    conf = toml_parse (buf, e, sizeof (e));
+    ok (conf != NULL,
+        "large: parsed document");
+    if (!conf)
+        diag ("%s", e);
+    arr = conf ? toml_array_in (conf, "node") : NULL;
+    ok (arr != NULL && toml_table_at (arr, nodes - 1) != NULL
+        && toml_table_at (arr, nodes) == NULL,
+        "large: node array has %d tables", nodes);
+    tab = arr ? toml_table_at (arr, nodes - 1) : NULL;
+    ok (tab != NULL
+        && toml_rtoi (toml_raw_in (tab, "id"), &id) == 0 && id == nodes - 1
+        && toml_rtos (toml_raw_in (tab, "name"), &str) == 0
+        && !strcmp (str, "node999")
+        && toml_raw_at (toml_array_in (tab, "cores"), 8) != NULL,
+        "large: last node has expected values");
+    free (str);
+    tab = conf ? toml_table_in (conf, "policy\ttab") : NULL;
+    ok (tab != NULL && toml_key_in (tab, keys - 1) != NULL
+        && toml_rtoi (toml_raw_in (tab, "key_299"), &id) == 0 && id == -299,
+        "large: escaped table key and its %d values are found", keys);
+    toml_free (conf);
+
+    /* Same document, but with an error at the very end */
+    len += snprintf (buf + len, size - len, "key_0 = 1\n");
+    if (len >= size)
+        BAIL_OUT ("buffer too small");
+    conf = toml_parse (buf, e, sizeof (e));
+    ok (conf == NULL,
+        "large: duplicate key at end of document fails");
+    diag ("%s", e);
+
+    free (buf);
+}
+
 void check_ucs_to_utf8 (void)
 {
     char buf[6];
@@ -443,6 +509,7 @@ int main (int argc, char *argv[])
     parse_bad_input ();
 
     parse_extra ();
+    parse_large ();
 
     check_ucs_to_utf8 ();
     check_utf8_to_ucs ();
@@ -248,9 +248,12 @@ struct toml_array_t {
 };
     
 
+typedef struct arena_t arena_t;
+
 struct toml_table_t {
     const char* key;		/* key to this table */
     int implicit;		/* table was created implicitly */
+    arena_t* arena;		/* root table only: memory for the document */
 
     /* key-values in the table */
     int             nkval;
@@ -305,12 +308,26 @@ struct context_t {
     toml_table_t* root;
     toml_table_t* curtab;
 
+    arena_t* arena;		/* newest block; see arena_alloc() */
+    size_t   arenasz;		/* size of the next block */
+
     struct {
 	int     top;
 	char*   key[10];
 	token_t tok[10];
     } tpath;
 
+    /* builder mode (toml_build) */
+    const toml_builder_t* b;
+    void* barg;
+    void* broot;
+    void* bcurtab;
+    char* bkey;			/* key being added */
+    struct {
+	int    n;
+	int    size;
+	void** tab;
+    } implicit;			/* tables created implicitly */
 };
 
 #define STRINGIFY(x) #x
@@ -374,6 +391,132 @@ static int e_key_exists_error(context_t* ctx, token_t keytok)
 }
 
 
+/*
+ *  Arena allocator.  Everything allocated while parsing a document
+ *  (tables, arrays, keys, raw values, and the vectors that hold them)
+ *  comes from a chain of blocks that is released all at once, so the
+ *  parser never frees anything individually, and errors need no cleanup
+ *  beyond arena_free().
+ */
+struct arena_t {
+    arena_t* next;		/* older block */
+    size_t   size;		/* size of buf[] */
+    size_t   used;		/* bytes of buf[] in use */
+    char*    last;		/* most recent allocation, see arena_grow() */
+    char     buf[];
+};
+
+#define ARENA_ALIGN 16
+#define ARENA_MINSZ 1024
+
+static void arena_free(arena_t* a)
+{
+    while (a) {
+	arena_t* next = a->next;
+	free(a);
+	a = next;
+    }
+}
+
+/* Allocate size bytes (uninitialized) from the arena. */
+static void* arena_alloc(context_t* ctx, size_t size)
+{
+    arena_t* a = ctx->arena;
+    size_t off = 0;
+
+    if (a) {
+	off = (a->used + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    }
+    if (!a || off + size > a->size) {
+	/* new block: at least ctx->arenasz, which doubles each time */
+	size_t bsize = ctx->arenasz < ARENA_MINSZ ? ARENA_MINSZ : ctx->arenasz;
+	while (bsize < size) bsize *= 2;
+	if (0 == (a = malloc(sizeof(*a) + bsize))) {
+	    e_outofmemory(ctx, FLINE);
+	    return 0;		/* not reached */
+	}
+	a->next = ctx->arena;
+	a->size = bsize;
+	a->used = 0;
+	ctx->arena = a;
+	ctx->arenasz = bsize * 2;
+	off = 0;
+    }
+    a->last = a->buf + off;
+    a->used = off + size;
+    return a->last;
+}
+
+static void* arena_calloc(context_t* ctx, size_t size)
+{
+    return memset(arena_alloc(ctx, size), 0, size);
+}
+
+/* Resize ptr (allocated with oldsize bytes) to newsize bytes.  If ptr is
+ * the most recent allocation, it is extended in place when it fits.
+ */
+static void* arena_grow(context_t* ctx, void* ptr, size_t oldsize, size_t newsize)
+{
+    arena_t* a = ctx->arena;
+    void* x;
+
+    if (ptr && a && ptr == a->last
+	&& (char*)ptr + newsize <= a->buf + a->size) {
+	a->used = (char*)ptr - a->buf + newsize;
+	return ptr;
+    }
+    x = arena_alloc(ctx, newsize);
+    if (ptr) memcpy(x, ptr, oldsize);
+    return x;
+}
+
+static char* arena_strndup(context_t* ctx, const char* s, size_t n)
+{
+    char* x = arena_alloc(ctx, n + 1);
+    memcpy(x, s, n);
+    x[n] = 0;
+    return x;
+}
+
+/* Make room for element n in vec, where vec holds n elements of
+ * elsize bytes.  The capacity is not stored: it is 4 for n <= 4, and
+ * doubles each time n reaches a power of two.
+ */
+static void* vec_reserve(context_t* ctx, void* vec, int n, size_t elsize)
+{
+    if (n == 0)
+	return arena_alloc(ctx, 4 * elsize);
+    if (n < 4 || (n & (n - 1)))
+	return vec;
+    return arena_grow(ctx, vec, n * elsize, 2 * n * elsize);
+}
+
+
+/*
+ *  Character classes for the tokenizer, as 128-bit masks indexed
+ *  by character (ASCII only; anything else is not in the class).
+ */
+#define CBIT(c)		((uint64_t)1 << ((c) & 63))
+#define CRANGE(a, b)	((CBIT(b) << 1) - CBIT(a))
+
+/* bare key: [A-Za-z0-9_-] */
+static const uint64_t barekey_chars[2] = {
+    CRANGE('0', '9') | CBIT('-'),
+    CRANGE('A', 'Z') | CRANGE('a', 'z') | CBIT('_'),
+};
+
+/* bare key or unquoted value, except '.', which may be special */
+static const uint64_t bare_chars[2] = {
+    CRANGE('0', '9') | CBIT('-') | CBIT('+') | CBIT(':'),
+    CRANGE('A', 'Z') | CRANGE('a', 'z') | CBIT('_'),
+};
+
+static inline int in_class(const uint64_t cls[2], int ch)
+{
+    return (unsigned) ch < 128 && ((cls[ch >> 6] >> (ch & 63)) & 1);
+}
+
+
 
 /* 
  * Convert src to raw unescaped utf-8 string.
@@ -485,7 +628,9 @@ static char* normalize_string(const char* src, int srclen,
 }
 
 
-/* Normalize a key. Convert all special chars to raw unescaped utf-8 chars. */
+/* Normalize a key. Convert all special chars to raw unescaped utf-8 chars.
+ * The key is allocated from the arena.
+ */
 static char* normalize_key(context_t* ctx, token_t strtok)
 {
     const char* sp = strtok.ptr;
@@ -505,22 +650,23 @@ static char* normalize_key(context_t* ctx, token_t strtok)
 
 	if (ch == '\'') {
 	    /* for single quote, take it verbatim. */
-	    if (! (ret = strndup(sp, sq - sp))) {
-                e_outofmemory(ctx, FLINE);
-                return 0;       /* not reached */
-            }
+	    ret = arena_strndup(ctx, sp, sq - sp);
+	} else if (! memchr(sp, '\\', sq - sp)) {
+	    /* double quote without escapes: also verbatim */
+	    ret = arena_strndup(ctx, sp, sq - sp);
 	} else {
 	    /* for double quote, we need to normalize */
-	    ret = normalize_string(sp, sq - sp, 0, ebuf, sizeof(ebuf));
-	    if (!ret) {
+	    char* x = normalize_string(sp, sq - sp, 0, ebuf, sizeof(ebuf));
+	    if (!x) {
 		snprintf(ctx->errbuf, ctx->errbufsz, "line %d: %s", lineno, ebuf);
 		longjmp(ctx->jmp, 1);
 	    }
+	    ret = arena_strndup(ctx, x, strlen(x));
+	    free(x);
 	}
 
 	/* newlines are not allowed in keys */
 	if (strchr(ret, '\n')) {
-	    free(ret);
 	    e_bad_key_error(ctx, lineno);
             return 0;           /* not reached */
 	}
@@ -530,19 +676,13 @@ static char* normalize_key(context_t* ctx, token_t strtok)
     /* for bare-key allow only this regex: [A-Za-z0-9_-]+ */
     const char* xp;
     for (xp = sp; xp != sq; xp++) {
-	int k = *xp;
-	if (isalnum(k)) continue;
-	if (k == '_' || k == '-') continue;
+	if (in_class(barekey_chars, (unsigned char) *xp)) continue;
 	e_bad_key_error(ctx, lineno);
         return 0;               /* not reached */
     }
 
     /* dup and return it */
-    if (! (ret = strndup(sp, sq - sp))) {
-        e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
-    return ret;
+    return arena_strndup(ctx, sp, sq - sp);
 }
 
 
@@ -589,34 +729,21 @@ static int check_key(toml_table_t* tab, const char* key,
  */
 static toml_keyval_t* create_keyval_in_table(context_t* ctx, toml_table_t* tab, token_t keytok)
 {
-    /* first, normalize the key to be used for lookup. 
-     * remember to free it if we error out. 
-     */
+    /* first, normalize the key to be used for lookup. */
     char* newkey = normalize_key(ctx, keytok);
 
     /* if key exists: error out. */
     toml_keyval_t* dest = 0;
     if (check_key(tab, newkey, 0, 0, 0)) {
-	free(newkey);
 	e_key_exists_error(ctx, keytok);
         return 0;               /* not reached */
     }
 
     /* make a new entry */
     int n = tab->nkval;
-    toml_keyval_t** base;
-    if (0 == (base = (toml_keyval_t**) realloc(tab->kval, (n+1) * sizeof(*base)))) {
-	free(newkey);
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    toml_keyval_t** base = vec_reserve(ctx, tab->kval, n, sizeof(*base));
     tab->kval = base;
-    
-    if (0 == (base[n] = (toml_keyval_t*) calloc(1, sizeof(*base[n])))) {
-	free(newkey);
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    base[n] = arena_calloc(ctx, sizeof(*base[n]));
     dest = tab->kval[tab->nkval++];
 
     /* save the key in the new value struct */
@@ -629,16 +756,12 @@ static toml_keyval_t* create_keyval_in_table(context_t* ctx, toml_table_t* tab,
  */
 static toml_table_t* create_keytable_in_table(context_t* ctx, toml_table_t* tab, token_t keytok)
 {
-    /* first, normalize the key to be used for lookup. 
-     * remember to free it if we error out. 
-     */
+    /* first, normalize the key to be used for lookup. */
     char* newkey = normalize_key(ctx, keytok);
 
     /* if key exists: error out */
     toml_table_t* dest = 0;
     if (check_key(tab, newkey, 0, 0, &dest)) {
-	free(newkey);		/* don't need this anymore */
-	
 	/* special case: if table exists, but was created implicitly ... */
 	if (dest && dest->implicit) {
 	    /* we make it explicit now, and simply return it. */
@@ -651,19 +774,9 @@ static toml_table_t* create_keytable_in_table(context_t* ctx, toml_table_t* tab,
 
     /* create a new table entry */
     int n = tab->ntab;
-    toml_table_t** base;
-    if (0 == (base = (toml_table_t**) realloc(tab->tab, (n+1) * sizeof(*base)))) {
-	free(newkey);
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    toml_table_t** base = vec_reserve(ctx, tab->tab, n, sizeof(*base));
     tab->tab = base;
-	
-    if (0 == (base[n] = (toml_table_t*) calloc(1, sizeof(*base[n])))) {
-	free(newkey);
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    base[n] = arena_calloc(ctx, sizeof(*base[n]));
     dest = tab->tab[tab->ntab++];
     
     /* save the key in the new table struct */
@@ -679,16 +792,12 @@ static toml_array_t* create_keyarray_in_table(context_t* ctx,
 					      token_t keytok,
 					      int skip_if_exist)
 {
-    /* first, normalize the key to be used for lookup. 
-     * remember to free it if we error out. 
-     */
+    /* first, normalize the key to be used for lookup. */
     char* newkey = normalize_key(ctx, keytok);
     
     /* if key exists: error out */
     toml_array_t* dest = 0;
     if (check_key(tab, newkey, 0, &dest, 0)) {
-	free(newkey); 		/* don't need this anymore */
-
 	/* special case skip if exists? */
 	if (skip_if_exist) return dest;
 	
@@ -698,19 +807,9 @@ static toml_array_t* create_keyarray_in_table(context_t* ctx,
 
     /* make a new array entry */
     int n = tab->narr;
-    toml_array_t** base;
-    if (0 == (base = (toml_array_t**) realloc(tab->arr, (n+1) * sizeof(*base)))) {
-	free(newkey);
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    toml_array_t** base = vec_reserve(ctx, tab->arr, n, sizeof(*base));
     tab->arr = base;
-	
-    if (0 == (base[n] = (toml_array_t*) calloc(1, sizeof(*base[n])))) {
-	free(newkey);
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    base[n] = arena_calloc(ctx, sizeof(*base[n]));
     dest = tab->arr[tab->narr++];
 
     /* save the key in the new array struct */
@@ -724,17 +823,9 @@ static toml_array_t* create_array_in_array(context_t* ctx,
 					   toml_array_t* parent)
 {
     int n = parent->nelem;
-    toml_array_t** base;
-    if (0 == (base = (toml_array_t**) realloc(parent->u.arr, (n+1) * sizeof(*base)))) {
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    toml_array_t** base = vec_reserve(ctx, parent->u.arr, n, sizeof(*base));
     parent->u.arr = base;
-    
-    if (0 == (base[n] = (toml_array_t*) calloc(1, sizeof(*base[n])))) {
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    base[n] = arena_calloc(ctx, sizeof(*base[n]));
 
     return parent->u.arr[parent->nelem++];
 }
@@ -745,17 +836,9 @@ static toml_table_t* create_table_in_array(context_t* ctx,
 					   toml_array_t* parent)
 {
     int n = parent->nelem;
-    toml_table_t** base;
-    if (0 == (base = (toml_table_t**) realloc(parent->u.tab, (n+1) * sizeof(*base)))) {
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    toml_table_t** base = vec_reserve(ctx, parent->u.tab, n, sizeof(*base));
     parent->u.tab = base;
-    
-    if (0 == (base[n] = (toml_table_t*) calloc(1, sizeof(*base[n])))) {
-	e_outofmemory(ctx, FLINE);
-        return 0;               /* not reached */
-    }
+    base[n] = arena_calloc(ctx, sizeof(*base[n]));
 
     return parent->u.tab[parent->nelem++];
 }
@@ -805,10 +888,40 @@ static void parse_table(context_t* ctx, toml_table_t* tab)
     EAT_TOKEN(ctx, RBRACE);
 }
 
-static int valtype(const char* val)
+/* Fast path for the most common scalars: true, false, and decimal
+ * integers without underscores that cannot overflow.  Set *val and
+ * return its type, or return 0 if the toml_rto*() functions must decide.
+ */
+static int scan_scalar(const char* p, int len, toml_value_t* val)
+{
+    const char* q = p + len;
+    int64_t v = 0;
+    int neg = 0;
+
+    if (len == 4 && 0 == memcmp(p, "true", 4))
+	return val->u.b = 1, val->type = 'b';
+    if (len == 5 && 0 == memcmp(p, "false", 5))
+	return val->u.b = 0, val->type = 'b';
+
+    if (p < q && (*p == '+' || *p == '-'))
+	neg = (*p++ == '-');
+    if (p == q || q - p > 18) return 0;
+    if (*p == '0' && q - p > 1) return 0; /* leading zero */
+    for ( ; p < q; p++) {
+	if (! ('0' <= *p && *p <= '9')) return 0;
+	v = v * 10 + (*p - '0');
+    }
+    val->u.i = neg ? -v : v;
+    return val->type = 'i';
+}
+
+static int valtype(const char* val, int len)
 {
     toml_timestamp_t ts;
+    toml_value_t x;
+    int t;
     if (*val == '\'' || *val == '"') return 's';
+    if ((t = scan_scalar(val, len, &x))) return t;
     if (0 == toml_rtob(val, 0)) return 'b';
     if (0 == toml_rtoi(val, 0)) return 'i';
     if (0 == toml_rtod(val, 0)) return 'd';
@@ -848,22 +961,14 @@ static void parse_array(context_t* ctx, toml_array_t* arr)
 		}
 
 		/* make a new value in array */
-		char** tmp = (char**) realloc(arr->u.val, (arr->nelem+1) * sizeof(*tmp));
-		if (!tmp) {
-                    e_outofmemory(ctx, FLINE);
-                    return;     /* not reached */
-                }
-		arr->u.val = tmp;
-		if (! (val = strndup(val, vlen))) {
-                    e_outofmemory(ctx, FLINE);
-                    return;     /* not reached */
-                }
+		arr->u.val = vec_reserve(ctx, arr->u.val, arr->nelem, sizeof(*arr->u.val));
+		val = arena_strndup(ctx, val, vlen);
 		arr->u.val[arr->nelem++] = val;
 
 		/* set array type if this is the first entry, or check that the types matched. */
 		if (arr->nelem == 1) 
-		    arr->type = valtype(arr->u.val[0]);
-		else if (arr->type != valtype(val)) {
+		    arr->type = valtype(val, vlen);
+		else if (arr->type != valtype(val, vlen)) {
 		    e_syntax_error(ctx, ctx->tok.lineno, "array type mismatch");
                     return;     /* not reached */
                 }
@@ -951,11 +1056,7 @@ static void parse_keyval(context_t* ctx, toml_table_t* tab)
 	    toml_keyval_t* keyval = create_keyval_in_table(ctx, tab, key);
 	    token_t val = ctx->tok;
 	    assert(keyval->val == 0);
-	    keyval->val = strndup(val.ptr, val.len);
-	    if (! keyval->val) {
-                e_outofmemory(ctx, FLINE);
-                return;         /* not reached */
-            }
+	    keyval->val = arena_strndup(ctx, val.ptr, val.len);
 
 	    EAT_TOKEN(ctx, STRING);
 	    
@@ -998,12 +1099,9 @@ static void fill_tabpath(context_t* ctx)
     int lineno = ctx->tok.lineno;
     int i;
     
-    /* clear tpath */
-    for (i = 0; i < ctx->tpath.top; i++) {
-	char** p = &ctx->tpath.key[i];
-	xfree(*p);
-	*p = 0;
-    }
+    /* clear tpath (the keys belong to the arena) */
+    for (i = 0; i < ctx->tpath.top; i++)
+	ctx->tpath.key[i] = 0;
     ctx->tpath.top = 0;
     
     for (;;) {
@@ -1079,22 +1177,10 @@ static void walk_tabpath(context_t* ctx)
 	default:
 	    { /* Not found. Let's create an implicit table. */
 		int n = curtab->ntab;
-		toml_table_t** base = (toml_table_t**) realloc(curtab->tab, (n+1) * sizeof(*base));
-		if (0 == base) {
-                    e_outofmemory(ctx, FLINE);
-                    return;     /* not reached */
-                }
+		toml_table_t** base = vec_reserve(ctx, curtab->tab, n, sizeof(*base));
 		curtab->tab = base;
-		
-		if (0 == (base[n] = (toml_table_t*) calloc(1, sizeof(*base[n])))) {
-		    e_outofmemory(ctx, FLINE);
-                    return;     /* not reached */
-                }
-		
-		if (0 == (base[n]->key = strdup(key))) {
-		    e_outofmemory(ctx, FLINE);
-                    return;     /* not reached */
-                }
+		base[n] = arena_calloc(ctx, sizeof(*base[n]));
+		base[n]->key = key;	/* tpath keys belong to the arena */
 		
 		nexttab = curtab->tab[curtab->ntab++];
 		
@@ -1113,29 +1199,395 @@ static void walk_tabpath(context_t* ctx)
 }
 
     
-/* handle lines like [x.y.z] or [[x.y.z]] */
-static void parse_select(context_t* ctx)
+/*
+ * Builder mode.  These mirror the functions above, but call back to
+ * ctx->b to create tables, arrays and values instead of building a
+ * toml_table_t.  Values are converted as they are parsed, so there is
+ * no raw string to convert later.
+ */
+
+/* Add obj to tab under ctx->bkey.
+ * Return obj (borrowed; tab owns it).
+ */
+static void* b_set(context_t* ctx, void* tab, void* obj)
 {
-    int count_lbracket = 0;
-    if (ctx->tok.tok != LBRACKET) {
-        e_internal_error(ctx, FLINE);
-        return;                 /* not reached */
+    int rc = obj ? ctx->b->table_set(ctx->barg, tab, ctx->bkey, obj) : -1;
+
+    ctx->bkey = 0;
+    if (rc < 0) {
+	e_outofmemory(ctx, FLINE);
+	return 0;		/* not reached */
     }
-    count_lbracket++;
-    next_token(ctx, 1 /* DOT IS SPECIAL */);
-    if (ctx->tok.tok == LBRACKET) {
-	count_lbracket++;
-	next_token(ctx, 1 /* DOT IS SPECIAL */);
+    return obj;
+}
+
+/* Append obj to arr.  Return obj (borrowed; arr owns it).
+ */
+static void* b_append(context_t* ctx, void* arr, void* obj)
+{
+    if (!obj || ctx->b->array_append(ctx->barg, arr, obj) < 0) {
+	e_outofmemory(ctx, FLINE);
+	return 0;		/* not reached */
     }
+    return obj;
+}
 
-    fill_tabpath(ctx);
+static int b_is_implicit(context_t* ctx, void* tab, int remove)
+{
+    int i;
+    for (i = 0; i < ctx->implicit.n; i++) {
+	if (ctx->implicit.tab[i] == tab) {
+	    if (remove)
+		ctx->implicit.tab[i] = ctx->implicit.tab[--ctx->implicit.n];
+	    return 1;
+	}
+    }
+    return 0;
+}
 
-    /* For [x.y.z] or [[x.y.z]], remove z from tpath. 
+static void b_add_implicit(context_t* ctx, void* tab)
+{
+    if (ctx->implicit.n == ctx->implicit.size) {
+	int size = ctx->implicit.size ? ctx->implicit.size * 2 : 8;
+	ctx->implicit.tab = arena_grow(ctx, ctx->implicit.tab,
+				       ctx->implicit.size * sizeof(void*),
+				       size * sizeof(void*));
+	ctx->implicit.size = size;
+    }
+    ctx->implicit.tab[ctx->implicit.n++] = tab;
+}
+
+/* Convert value token to a builder value.  Set *type to the value type
+ * ('s', 'b', 'i', 'd', 'T', 'D', or 't') for array type checks.
+ */
+static void* b_value(context_t* ctx, token_t tok, int* type)
+{
+    toml_timestamp_t ts;
+    toml_value_t val;
+    char* s = 0;
+    char save = tok.ptr[tok.len];
+    void* obj;
+
+    /* N.B. the token is followed by a delimiter or the terminating NUL,
+     * so it may be terminated in place while it is converted.
      */
-    token_t z = ctx->tpath.tok[ctx->tpath.top-1];
-    free(ctx->tpath.key[ctx->tpath.top-1]);
-    ctx->tpath.top--;
-    
+    tok.ptr[tok.len] = 0;
+    memset(&val, 0, sizeof(val));
+    if (*tok.ptr == '\'' || *tok.ptr == '"') {
+	if (0 == toml_rtos(tok.ptr, &s)) {
+	    val.type = 's';
+	    val.u.s = s;
+	}
+    }
+    else if (scan_scalar(tok.ptr, tok.len, &val))
+	;
+    else if (0 == toml_rtob(tok.ptr, &val.u.b))
+	val.type = 'b';
+    else if (0 == toml_rtoi(tok.ptr, &val.u.i))
+	val.type = 'i';
+    else if (0 == toml_rtod(tok.ptr, &val.u.d))
+	val.type = 'd';
+    else if (0 == toml_rtots(tok.ptr, &ts)) {
+	val.type = (ts.year && ts.hour) ? 'T' : ts.year ? 'D' : 't';
+	val.u.ts = &ts;
+    }
+    tok.ptr[tok.len] = save;
+
+    if (val.type == 0) {
+	e_syntax_error(ctx, tok.lineno, "invalid value");
+	return 0;		/* not reached */
+    }
+    errno = 0;
+    obj = ctx->b->value_new(ctx->barg, &val);
+    xfree(s);
+    if (!obj) {
+	if (errno == ENOMEM)
+	    e_outofmemory(ctx, FLINE);
+	e_syntax_error(ctx, tok.lineno, "invalid value");
+	return 0;		/* not reached */
+    }
+    *type = val.type;
+    return obj;
+}
+
+/* Create a table in the table, or make an implicit table explicit.
+ */
+static void* b_add_table(context_t* ctx, void* tab, token_t keytok)
+{
+    void* dest = 0;
+
+    ctx->bkey = normalize_key(ctx, keytok);
+    if (ctx->b->table_get(ctx->barg, tab, ctx->bkey, &dest)) {
+	ctx->bkey = 0;
+	if (b_is_implicit(ctx, dest, 1))
+	    return dest;
+	e_key_exists_error(ctx, keytok);
+	return 0;		/* not reached */
+    }
+    return b_set(ctx, tab, ctx->b->table_new(ctx->barg));
+}
+
+/* Create an array in the table.  If skip_if_exist, return an existing
+ * array, or NULL if key exists but is not an array.
+ */
+static void* b_add_array(context_t* ctx, void* tab, token_t keytok,
+			 int skip_if_exist)
+{
+    void* dest = 0;
+    int kind;
+
+    ctx->bkey = normalize_key(ctx, keytok);
+    if ((kind = ctx->b->table_get(ctx->barg, tab, ctx->bkey, &dest))) {
+	ctx->bkey = 0;
+	if (skip_if_exist)
+	    return kind == 'a' ? dest : 0;
+	e_key_exists_error(ctx, keytok);
+	return 0;		/* not reached */
+    }
+    return b_set(ctx, tab, ctx->b->array_new(ctx->barg));
+}
+
+static void b_parse_keyval(context_t* ctx, void* tab);
+
+/* We are at '{ ... }'.
+ * Parse the table.
+ */
+static void b_parse_table(context_t* ctx, void* tab)
+{
+    EAT_TOKEN(ctx, LBRACE);
+
+    for (;;) {
+	SKIP_NEWLINES(ctx);
+
+	/* until } */
+	if (ctx->tok.tok == RBRACE) break;
+
+	if (ctx->tok.tok != STRING) {
+            e_syntax_error(ctx, ctx->tok.lineno, "syntax error");
+            return;             /* not reached */
+	}
+        b_parse_keyval(ctx, tab);
+	SKIP_NEWLINES(ctx);
+
+	/* on comma, continue to scan for next keyval */
+	if (ctx->tok.tok == COMMA) {
+	    EAT_TOKEN(ctx, COMMA);
+	    continue;
+	}
+	break;
+    }
+
+    if (ctx->tok.tok != RBRACE) {
+	e_syntax_error(ctx, ctx->tok.lineno, "syntax error");
+        return;                 /* not reached */
+    }
+
+    EAT_TOKEN(ctx, RBRACE);
+}
+
+/* We are at '[...]' */
+static void b_parse_array(context_t* ctx, void* arr)
+{
+    int kind = 0;
+    int type = 0;
+
+    EAT_TOKEN(ctx, LBRACKET);
+
+    for (;;) {
+	SKIP_NEWLINES(ctx);
+
+	/* until ] */
+	if (ctx->tok.tok == RBRACKET) break;
+
+	switch (ctx->tok.tok) {
+	case STRING:
+	    {
+		int t;
+
+		if (kind == 0) kind = 'v';
+		if (kind != 'v') {
+		    e_syntax_error(ctx, ctx->tok.lineno,
+                                   "a string array can only contain strings");
+                    return;     /* not reached */
+		}
+		b_append(ctx, arr, b_value(ctx, ctx->tok, &t));
+		if (type == 0)
+		    type = t;
+		else if (type != t) {
+		    e_syntax_error(ctx, ctx->tok.lineno, "array type mismatch");
+                    return;     /* not reached */
+		}
+		EAT_TOKEN(ctx, STRING);
+		break;
+	    }
+
+	case LBRACKET:
+	    if (kind == 0) kind = 'a';
+	    if (kind != 'a') {
+		e_syntax_error(ctx, ctx->tok.lineno, "array type mismatch");
+                return;         /* not reached */
+	    }
+	    b_parse_array(ctx, b_append(ctx, arr, ctx->b->array_new(ctx->barg)));
+	    break;
+
+	case LBRACE:
+	    if (kind == 0) kind = 't';
+	    if (kind != 't') {
+		e_syntax_error(ctx, ctx->tok.lineno, "array type mismatch");
+                return;         /* not reached */
+	    }
+	    b_parse_table(ctx, b_append(ctx, arr, ctx->b->table_new(ctx->barg)));
+	    break;
+
+	default:
+	    e_syntax_error(ctx, ctx->tok.lineno, "syntax error");
+            return;             /* not reached */
+	}
+
+	SKIP_NEWLINES(ctx);
+
+	/* on comma, continue to scan for next element */
+	if (ctx->tok.tok == COMMA) {
+	    EAT_TOKEN(ctx, COMMA);
+	    continue;
+	}
+	break;
+    }
+
+    if (ctx->tok.tok != RBRACKET) {
+	e_syntax_error(ctx, ctx->tok.lineno, "syntax error");
+        return;                 /* not reached */
+    }
+
+    EAT_TOKEN(ctx, RBRACKET);
+}
+
+/* handle lines like these:
+    key = "value"
+    key = [ array ]
+    key = { table }
+*/
+static void b_parse_keyval(context_t* ctx, void* tab)
+{
+    if (ctx->tok.tok != STRING) {
+	e_internal_error(ctx, FLINE);
+        return;                 /* not reached */
+    }
+
+    token_t key = ctx->tok;
+
+    EAT_TOKEN(ctx, STRING);
+    if (ctx->tok.tok != EQUAL) {
+	e_syntax_error(ctx, ctx->tok.lineno, "missing =");
+        return;                 /* not reached */
+    }
+
+    EAT_TOKEN(ctx, EQUAL);
+
+    switch (ctx->tok.tok) {
+    case STRING:
+	{ /* key = "value" */
+	    void* dest = 0;
+	    int t;
+
+	    ctx->bkey = normalize_key(ctx, key);
+	    if (ctx->b->table_get(ctx->barg, tab, ctx->bkey, &dest)) {
+		e_key_exists_error(ctx, key);
+		return;		/* not reached */
+	    }
+	    b_set(ctx, tab, b_value(ctx, ctx->tok, &t));
+	    EAT_TOKEN(ctx, STRING);
+	    return;
+	}
+
+    case LBRACKET:
+	/* key = [ array ] */
+	b_parse_array(ctx, b_add_array(ctx, tab, key, 0));
+	return;
+
+    case LBRACE:
+	/* key = { table } */
+	b_parse_table(ctx, b_add_table(ctx, tab, key));
+	return;
+
+    default:
+	e_syntax_error(ctx, ctx->tok.lineno, "syntax error");
+        return;                 /* not reached */
+    }
+}
+
+/* Walk tabpath from the root, and create new tables on the way.
+ * Sets ctx->bcurtab to the final table.
+ */
+static void b_walk_tabpath(context_t* ctx)
+{
+    void* curtab = ctx->broot;
+
+    for (int i = 0; i < ctx->tpath.top; i++) {
+	char* key = ctx->tpath.key[i];
+	void* next = 0;
+
+	switch (ctx->b->table_get(ctx->barg, curtab, key, &next)) {
+	case 't':
+	    break;
+
+	case 'a':
+	    /* found an array. next is the last table in the array. */
+	    if (ctx->b->array_last(ctx->barg, next, &next) != 't') {
+                e_internal_error(ctx, FLINE);
+                return;         /* not reached */
+            }
+	    break;
+
+	case 'v':
+	    e_key_exists_error(ctx, ctx->tpath.tok[i]);
+            return;             /* not reached */
+
+	default:
+	    /* Not found. Let's create an implicit table. */
+	    ctx->bkey = key;
+	    next = b_set(ctx, curtab, ctx->b->table_new(ctx->barg));
+	    b_add_implicit(ctx, next);
+	    break;
+	}
+	curtab = next;
+    }
+    ctx->bcurtab = curtab;
+}
+
+/* Builder version of select_table().
+ */
+static void b_select_table(context_t* ctx, token_t z, int count_lbracket)
+{
+    b_walk_tabpath(ctx);
+
+    if (count_lbracket == 1) {
+	/* [x.y.z] -> create z = {} in x.y */
+	ctx->bcurtab = b_add_table(ctx, ctx->bcurtab, z);
+    } else {
+	/* [[x.y.z]] -> create z = [] in x.y, and append a table */
+	void* arr = b_add_array(ctx, ctx->bcurtab, z, 1 /*skip_if_exist*/);
+	void* last;
+
+        if (!arr) {
+            e_syntax_error(ctx, z.lineno, "key exists");
+            return;		/* not reached */
+        }
+	int kind = ctx->b->array_last(ctx->barg, arr, &last);
+	if (kind != 0 && kind != 't') {
+            e_syntax_error(ctx, z.lineno, "array mismatch");
+            return;             /* not reached */
+        }
+	ctx->bcurtab = b_append(ctx, arr, ctx->b->table_new(ctx->barg));
+    }
+}
+
+
+/* Select table z in ctx->curtab for [x.y.z] (count_lbracket == 1),
+ * or append a table to array z for [[x.y.z]] (count_lbracket == 2).
+ */
+static void select_table(context_t* ctx, token_t z, int count_lbracket)
+{
     walk_tabpath(ctx);
 
     if (count_lbracket == 1) {
@@ -1156,31 +1608,40 @@ static void parse_select(context_t* ctx)
         }
 
 	/* add to z[] */
-	toml_table_t* dest;
-	{
-	    int n = arr->nelem;
-	    toml_table_t** base = realloc(arr->u.tab, (n+1) * sizeof(*base));
-	    if (0 == base) {
-                e_outofmemory(ctx, FLINE);
-                return;         /* not reached */
-            }
-	    arr->u.tab = base;
-	    
-	    if (0 == (base[n] = calloc(1, sizeof(*base[n])))) {
-		e_outofmemory(ctx, FLINE);
-                return;         /* not reached */
-            }
-	    
-            if (0 == (base[n]->key = strdup("__anon__"))) {
-		e_outofmemory(ctx, FLINE);
-                return;         /* not reached */
-            }
-	    
-	    dest = arr->u.tab[arr->nelem++];
-	}
+	toml_table_t* dest = create_table_in_array(ctx, arr);
+	dest->key = "__anon__";
 
 	ctx->curtab = dest;
     }
+}
+
+
+/* handle lines like [x.y.z] or [[x.y.z]] */
+static void parse_select(context_t* ctx)
+{
+    int count_lbracket = 0;
+    if (ctx->tok.tok != LBRACKET) {
+        e_internal_error(ctx, FLINE);
+        return;                 /* not reached */
+    }
+    count_lbracket++;
+    next_token(ctx, 1 /* DOT IS SPECIAL */);
+    if (ctx->tok.tok == LBRACKET) {
+	count_lbracket++;
+	next_token(ctx, 1 /* DOT IS SPECIAL */);
+    }
+
+    fill_tabpath(ctx);
+
+    /* For [x.y.z] or [[x.y.z]], remove z from tpath. 
+     */
+    token_t z = ctx->tpath.tok[ctx->tpath.top-1];
+    ctx->tpath.top--;
+    
+    if (ctx->b)
+	b_select_table(ctx, z, count_lbracket);
+    else
+	select_table(ctx, z, count_lbracket);
 
     if (ctx->tok.tok != RBRACKET) {
         e_syntax_error(ctx, ctx->tok.lineno, "expects ]");
@@ -1204,81 +1665,126 @@ static void parse_select(context_t* ctx)
 
 
 
-toml_table_t* toml_parse(char* conf,
-			 char* errbuf,
-			 int errbufsz)
+/* Initialize ctx to parse conf.
+ */
+static void init_context(context_t* ctx, char* conf, char* errbuf, int errbufsz)
 {
-    context_t ctx;
-
     // clear errbuf 
     if (errbufsz <= 0) errbufsz = 0;
     if (errbufsz > 0)  errbuf[0] = 0;
 
     // init context 
-    memset(&ctx, 0, sizeof(ctx));
-    ctx.start = conf;
-    ctx.stop = ctx.start + strlen(conf);
-    ctx.errbuf = errbuf;
-    ctx.errbufsz = errbufsz;
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->start = conf;
+    ctx->stop = ctx->start + strlen(conf);
+    ctx->errbuf = errbuf;
+    ctx->errbufsz = errbufsz;
 
     // start with an artificial newline of length 0
-    ctx.tok.tok = NEWLINE; 
-    ctx.tok.lineno = 1;
-    ctx.tok.ptr = conf;
-    ctx.tok.len = 0;
-
-    // make a root table
-    if (0 == (ctx.root = calloc(1, sizeof(*ctx.root)))) {
-        /* do not call outofmemory() here... setjmp not done yet */
-        snprintf(ctx.errbuf, ctx.errbufsz, "ERROR: out of memory (%s)", FLINE);
-        return 0;
-    }
+    ctx->tok.tok = NEWLINE; 
+    ctx->tok.lineno = 1;
+    ctx->tok.ptr = conf;
+    ctx->tok.len = 0;
+}
 
-    // set root as default table
-    ctx.curtab = ctx.root;
 
-    if (0 != setjmp(ctx.jmp)) {
-	// Got here from a long_jmp. Something bad has happened.
-	// Free resources and return error.
-	for (int i = 0; i < ctx.tpath.top; i++) xfree(ctx.tpath.key[i]);
-	toml_free(ctx.root);
-	return 0;
-    }
-
-    /* Scan forward until EOF */
-    for (token_t tok = ctx.tok; ! tok.eof ; tok = ctx.tok) {
+/* Scan forward until EOF */
+static void parse_document(context_t* ctx)
+{
+    for (token_t tok = ctx->tok; ! tok.eof ; tok = ctx->tok) {
 	switch (tok.tok) {
 	    
 	case NEWLINE:
-	    next_token(&ctx, 1);
+	    next_token(ctx, 1);
 	    break;
 	    
 	case STRING:
-	    parse_keyval(&ctx, ctx.curtab);
-	    if (ctx.tok.tok != NEWLINE) {
-                e_syntax_error(&ctx, ctx.tok.lineno, "extra chars after value");
-                return 0;         /* not reached */
+	    if (ctx->b)
+		b_parse_keyval(ctx, ctx->bcurtab);
+	    else
+		parse_keyval(ctx, ctx->curtab);
+	    if (ctx->tok.tok != NEWLINE) {
+                e_syntax_error(ctx, ctx->tok.lineno, "extra chars after value");
+                return;         /* not reached */
             }
 
-	    EAT_TOKEN(&ctx, NEWLINE);
+	    EAT_TOKEN(ctx, NEWLINE);
 	    break;
 	    
 	case LBRACKET:  /* [ x.y.z ] or [[ x.y.z ]] */
-	    parse_select(&ctx);
+	    parse_select(ctx);
 	    break;
 	    
 	default:
-	    snprintf(ctx.errbuf, ctx.errbufsz, "line %d: syntax error", tok.lineno);
-	    longjmp(ctx.jmp, 1);
+	    snprintf(ctx->errbuf, ctx->errbufsz, "line %d: syntax error", tok.lineno);
+	    longjmp(ctx->jmp, 1);
 	}
     }
+}
+
+
+toml_table_t* toml_parse(char* conf,
+			 char* errbuf,
+			 int errbufsz)
+{
+    context_t ctx;
+
+    init_context(&ctx, conf, errbuf, errbufsz);
+
+    // size the first arena block to hold most documents
+    ctx.arenasz = 2 * (ctx.stop - ctx.start);
+
+    if (0 != setjmp(ctx.jmp)) {
+	// Got here from a long_jmp. Something bad has happened.
+	// Free resources and return error.
+	arena_free(ctx.arena);
+	return 0;
+    }
 
-    /* success */
-    for (int i = 0; i < ctx.tpath.top; i++) xfree(ctx.tpath.key[i]);
+    // make a root table, and set it as default table
+    ctx.root = arena_calloc(&ctx, sizeof(*ctx.root));
+    ctx.curtab = ctx.root;
+
+    parse_document(&ctx);
+
+    /* success: the root table owns the arena */
+    ctx.root->arena = ctx.arena;
     return ctx.root;
 }
 
 
+void* toml_build(char* conf,
+		 const toml_builder_t* b,
+		 void* arg,
+		 char* errbuf,
+		 int errbufsz)
+{
+    context_t ctx;
+
+    init_context(&ctx, conf, errbuf, errbufsz);
+    ctx.b = b;
+    ctx.barg = arg;
+
+    // make a root table
+    if (0 == (ctx.broot = b->table_new(arg))) {
+        snprintf(ctx.errbuf, ctx.errbufsz, "ERROR: out of memory (%s)", FLINE);
+        return 0;
+    }
+    ctx.bcurtab = ctx.broot;
+
+    if (0 != setjmp(ctx.jmp)) {
+	arena_free(ctx.arena);
+	b->destroy(arg, ctx.broot);
+	return 0;
+    }
+
+    parse_document(&ctx);
+
+    arena_free(ctx.arena);
+    return ctx.broot;
+}
+
+
 toml_table_t* toml_parse_file(FILE* fp,
 			      char* errbuf,
 			      int errbufsz)
@@ -1296,7 +1802,7 @@ toml_table_t* toml_parse_file(FILE* fp,
 
     /* read from fp into buf */
     while (! feof(fp)) {
-	bufsz += 1000;
+	bufsz *= 2;
 	
 	/* Allocate 1 extra byte because we will tag on a NUL */
 	char* x = realloc(buf, bufsz + 1);
@@ -1328,66 +1834,10 @@ toml_table_t* toml_parse_file(FILE* fp,
 }
 
 
-static void xfree_kval(toml_keyval_t* p)
-{
-    if (!p) return;
-    xfree(p->key);
-    xfree(p->val);
-    xfree(p);
-}
-
-static void xfree_tab(toml_table_t* p);
-
-static void xfree_arr(toml_array_t* p)
-{
-    if (!p) return;
-
-    xfree(p->key);
-    switch (p->kind) {
-    case 'v':
-	for (int i = 0; i < p->nelem; i++) xfree(p->u.val[i]);
-	xfree(p->u.val);
-	break;
-
-    case 'a':
-	for (int i = 0; i < p->nelem; i++) xfree_arr(p->u.arr[i]);
-	xfree(p->u.arr);
-	break;
-
-    case 't':
-	for (int i = 0; i < p->nelem; i++) xfree_tab(p->u.tab[i]);
-	xfree(p->u.tab);
-	break;
-    }
-
-    xfree(p);
-}
-
-
-static void xfree_tab(toml_table_t* p)
-{
-    int i;
-    
-    if (!p) return;
-    
-    xfree(p->key);
-    
-    for (i = 0; i < p->nkval; i++) xfree_kval(p->kval[i]);
-    xfree(p->kval);
-
-    for (i = 0; i < p->narr; i++) xfree_arr(p->arr[i]);
-    xfree(p->arr);
-
-    for (i = 0; i < p->ntab; i++) xfree_tab(p->tab[i]);
-    xfree(p->tab);
-
-    xfree(p);
-}
-
-
 void toml_free(toml_table_t* tab)
 {
-    xfree_tab(tab);
+    /* N.B. tab itself is in the arena */
+    if (tab) arena_free(tab->arena);
 }
 
 
@@ -1495,13 +1945,11 @@ static tokentype_t scan_string(context_t* ctx, char* p, int lineno, int dotisspe
 	return ret_token(ctx, STRING, lineno, orig, p + 1 - orig);
     }
 
-    for ( ; *p && *p != '\n'; p++) {
-	int ch = *p;
-	if (ch == '.' && dotisspecial) break;
-	if ('A' <= ch && ch <= 'Z') continue;
-	if ('a' <= ch && ch <= 'z') continue;
-	if ('0' <= ch && ch <= '9') continue;
-	if (strchr("+-_.:", ch)) continue;
+    /* bare key or value: [A-Za-z0-9+-_.:] */
+    for ( ; ; p++) {
+	int ch = (unsigned char) *p;
+	if (in_class(bare_chars, ch)) continue;
+	if (ch == '.' && !dotisspecial) continue;
 	break;
     }
 
@@ -1513,13 +1961,20 @@ static tokentype_t next_token(context_t* ctx, int dotisspecial)
 {
     int   lineno = ctx->tok.lineno;
     char* p = ctx->tok.ptr;
-    int i;
 
     /* eat this tok */
-    for (i = 0; i < ctx->tok.len; i++) {
+    if (ctx->tok.len == 1) {
 	if (*p++ == '\n')
 	    lineno++;
     }
+    else if (ctx->tok.len > 1) {
+	char* q = p + ctx->tok.len;
+	while ((p = memchr(p, '\n', q - p))) {
+	    lineno++;
+	    p++;
+	}
+	p = q;
+    }
 
     /* make next tok */
     while (p < ctx->stop) {
@@ -102,6 +102,56 @@ struct toml_timestamp_t {
 /* Raw to Timestamp. Return 0 on success, -1 otherwise. */
 TOML_EXTERN int toml_rtots(const char* s, toml_timestamp_t* ret);
 
+/* Builder mode.  toml_build() parses 'conf' like toml_parse(), but
+ * instead of building a toml_table_t, it calls back to the functions
+ * in 'b' (passing 'arg') to build the caller's own representation.
+ * Values are converted once, as they are parsed.  Tables, arrays, and
+ * values are opaque handles.  An object passed to table_set() or
+ * array_append() is owned by the container, even on failure.
+ * Return the root table on success, or 0 otherwise.
+ */
+typedef struct toml_value_t toml_value_t;
+struct toml_value_t {
+    int type; /* 's'tring, 'b'ool, 'i'nt, 'd'ouble, 'T'imestamp, 'D'ate, 't'ime */
+    union {
+	const char* s;
+	int b;
+	int64_t i;
+	double d;
+	toml_timestamp_t* ts;
+    } u;
+};
+
+typedef struct toml_builder_t toml_builder_t;
+struct toml_builder_t {
+    /* Create table, array, or value.  Return 0 with errno set on failure.
+     * ENOMEM is reported as out of memory, and other value_new() errors
+     * as an invalid value on the current line.
+     */
+    void* (*table_new)(void* arg);
+    void* (*array_new)(void* arg);
+    void* (*value_new)(void* arg, const toml_value_t* val);
+
+    /* Add obj to container.  'key' is copied.  Return 0 on success, -1 otherwise. */
+    int (*table_set)(void* arg, void* tab, const char* key, void* obj);
+    int (*array_append)(void* arg, void* arr, void* obj);
+
+    /* Lookup key in table, or the last element of array.
+     * Return 't'able, 'a'rray, 'v'alue, or 0 if not found, and set *obj.
+     */
+    int (*table_get)(void* arg, void* tab, const char* key, void** obj);
+    int (*array_last)(void* arg, void* arr, void** obj);
+
+    /* Destroy the root table after a parse error. */
+    void (*destroy)(void* arg, void* tab);
+};
+
+TOML_EXTERN void* toml_build(char* conf, /* NUL terminated, please. */
+			     const toml_builder_t* b,
+			     void* arg,
+			     char* errbuf,
+			     int errbufsz);
+
 /* misc */
 TOML_EXTERN int toml_utf8_to_ucs(const char* orig, int len, int64_t* ret);
 TOML_EXTERN int toml_ucs_to_utf8(int64_t code, char buf[6]);
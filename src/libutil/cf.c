@@ -100,6 +100,29 @@ const char *cf_typedesc (enum cf_type type)
     return "unknown";
 }
 
+bool cf_equal (const cf_t *cf1, const cf_t *cf2)
+{
+    if (!cf1 || !cf2)
+        return cf1 == cf2;
+    return json_equal ((json_t *)cf1, (json_t *)cf2);
+}
+
+char *cf_dumps (const cf_t *cf)
+{
+    char *s;
+
+    if (!cf) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(s = json_dumps ((json_t *)cf, JSON_COMPACT | JSON_SORT_KEYS
+                                        | JSON_ENCODE_ANY))) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return s;
+}
+
 enum cf_type cf_typeof (const cf_t *cf)
 {
     if (!cf)
@@ -202,9 +225,7 @@ static int update_object (cf_t *cf,
                           struct cf_error *error)
 {
     struct tomltk_error toml_error;
-    toml_table_t *tab;
-    json_t *obj = NULL;
-    int saved_errno;
+    json_t *obj;
 
     if (!cf || json_typeof ((json_t *)cf) != JSON_OBJECT) {
         errprintf (error, filename, -1, "invalid config object");
@@ -212,33 +233,22 @@ static int update_object (cf_t *cf,
         return -1;
     }
     if (filename)
-        tab = tomltk_parse_file (filename, &toml_error);
+        obj = tomltk_parse_file_json (filename, &toml_error);
     else
-        tab = tomltk_parse (buf, len, &toml_error);
-    if (!tab) {
+        obj = tomltk_parse_json (buf, len, &toml_error);
+    if (!obj) {
         errprintf (error, toml_error.filename, toml_error.lineno,
                    "%s", toml_error.errbuf);
-        goto error;
-    }
-    if (!(obj = tomltk_table_to_json (tab))) {
-        errprintf (error, filename, -1, "converting TOML to JSON: %s",
-                   strerror (errno));
-        goto error;
+        return -1;
     }
     if (json_object_update (cf, obj) < 0) {
         errprintf (error, filename, -1, "updating JSON object: out of memory");
+        json_decref (obj);
         errno = ENOMEM;
-        goto error;
+        return -1;
     }
     json_decref (obj);
-    toml_free (tab);
     return 0;
-error:
-    saved_errno = errno;
-    toml_free (tab);
-    json_decref (obj);
-    errno = saved_errno;
-    return -1;
 }
 
 int cf_update (cf_t *cf, const char *buf, int len, struct cf_error *error)
@@ -397,6 +407,93 @@ int cf_check (const cf_t *cf,
     return 0;
 }
 
+/* Convert array of strings 'array' to a bitmask of 'opt->names' indices.
+ */
+static int bind_mask (const cf_t *array, const struct cf_field *field,
+                      uint32_t *mask, struct cf_error *error)
+{
+    const cf_t *el;
+    uint32_t m = 0;
+    int i, j;
+
+    for (i = 0; (el = cf_get_at (array, i)) != NULL; i++) {
+        if (cf_typeof (el) != CF_STRING) {
+            errprintf (error, NULL, -1, "'%s[%d]' must be of type %s",
+                       field->key, i, cf_typedesc (CF_STRING));
+            goto inval;
+        }
+        for (j = 0; field->names[j] != NULL; j++) {
+            if (!strcmp (field->names[j], cf_string (el)))
+                break;
+        }
+        if (!field->names[j] || j >= 32) {
+            errprintf (error, NULL, -1, "'%s' value '%s' is unknown",
+                       field->key, cf_string (el));
+            goto inval;
+        }
+        m |= 1U << j;
+    }
+    *mask = m;
+    return 0;
+inval:
+    errno = EINVAL;
+    return -1;
+}
+
+int cf_bind (const cf_t *cf, const struct cf_option opts[],
+             const struct cf_field fields[], int flags,
+             void *dst, struct cf_error *error)
+{
+    int i;
+
+    if (cf_check (cf, opts, flags, error) < 0)
+        return -1;
+    for (i = 0; fields && fields[i].key != NULL; i++) {
+        const struct cf_option *opt;
+        const cf_t *obj;
+        void *member;
+
+        if (!(opt = find_option (opts, fields[i].key)) || !dst) {
+            errprintf (error, NULL, -1, "cannot bind '%s'", fields[i].key);
+            errno = EINVAL;
+            return -1;
+        }
+        if (!(obj = cf_get_in (cf, fields[i].key)))
+            continue;
+        member = (char *)dst + fields[i].offset;
+        switch (opt->type) {
+            case CF_INT64:
+                *(int64_t *)member = cf_int64 (obj);
+                break;
+            case CF_DOUBLE:
+                *(double *)member = cf_double (obj);
+                break;
+            case CF_BOOL:
+                *(bool *)member = cf_bool (obj);
+                break;
+            case CF_STRING:
+                *(const char **)member = cf_string (obj);
+                break;
+            case CF_TIMESTAMP:
+                *(time_t *)member = cf_timestamp (obj);
+                break;
+            case CF_ARRAY:
+                if (fields[i].names) {
+                    if (bind_mask (obj, &fields[i], member, error) < 0)
+                        return -1;
+                    break;
+                }
+                /* fall through */
+            case CF_TABLE:
+                *(const cf_t **)member = obj;
+                break;
+            default:
+                break;
+        }
+    }
+    return 0;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
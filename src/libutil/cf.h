@@ -14,6 +14,7 @@
 #include <time.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include <limits.h>
 
 // flags for cf_check
@@ -46,6 +47,28 @@ struct cf_option {
 };
 #define CF_OPTIONS_TABLE_END { NULL, 0, false }
 
+/* cf_bind field table consists of an array of struct cf_field elements,
+ * built with CF_FIELD() or CF_MASK() and terminated by CF_FIELDS_TABLE_END.
+ * Each key must be declared in the cf_option table, and its type there
+ * determines the type of the struct member:
+ *   CF_INT64: int64_t           CF_DOUBLE: double
+ *   CF_BOOL: bool               CF_STRING: const char *
+ *   CF_TIMESTAMP: time_t        CF_TABLE, CF_ARRAY: const cf_t *
+ * CF_MASK() binds an array of strings to a uint32_t bitmask, with bit i
+ * set if the array contains names[i].  'names' is NULL terminated,
+ * with at most 32 entries, and any other string is an error.
+ */
+struct cf_field {
+    const char *key;
+    size_t offset;
+    const char *const *names;
+};
+#define CF_FIELD(key, type, member) \
+    { (key), offsetof (type, member), NULL }
+#define CF_MASK(key, type, member, names) \
+    { (key), offsetof (type, member), (names) }
+#define CF_FIELDS_TABLE_END { NULL, 0, NULL }
+
 /* Error information is filled in by cf_update, cf_file, and cf_check.
  * If filename is unavailable, it is set to empty string.
  * If lineno is unavailable, it is set to -1.
@@ -66,6 +89,17 @@ void cf_destroy (cf_t *cf);
  */
 cf_t *cf_copy (const cf_t *cf);
 
+/* Return true if 'cf1' and 'cf2' have the same type and value,
+ * comparing tables and arrays recursively.  Two NULL objects are equal.
+ */
+bool cf_equal (const cf_t *cf1, const cf_t *cf2);
+
+/* Serialize 'cf' to a string in which table keys are sorted, so that
+ * objects for which cf_equal() is true serialize identically.
+ * Caller must free.  Return NULL on failure with errno set.
+ */
+char *cf_dumps (const cf_t *cf);
+
 /* Get type of cf_t object.
  */
 enum cf_type cf_typeof (const cf_t *cf);
@@ -119,6 +153,19 @@ int cf_update_glob (cf_t *cf, const char *pattern, struct cf_error *error);
 int cf_check (const cf_t *cf, const struct cf_option opts[], int flags,
               struct cf_error *error);
 
+/* Apply 'opts' to table 'cf' as with cf_check(), then store the values
+ * of options listed in 'fields' in 'dst', a struct of the type named in
+ * CF_FIELD().  Members for options not present in 'cf' are unchanged,
+ * so defaults may be set beforehand.  CF_STRING, CF_TABLE, and CF_ARRAY
+ * values point into 'cf' and remain valid as long as it does.
+ * On success return 0.  On failure, return -1 with errno set, and 'dst'
+ * may be partially updated.  If error is non-NULL, write error
+ * description there.
+ */
+int cf_bind (const cf_t *cf, const struct cf_option opts[],
+             const struct cf_field fields[], int flags,
+             void *dst, struct cf_error *error);
+
 #endif /* !_UTIL_CF_H */
 
 /*
@@ -0,0 +1,544 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <libgen.h>
+#include <glob.h>
+#include <errno.h>
+#include <jansson.h>
+
+#include "cfcache.h"
+
+/* File layout, in host byte order:
+ *   header
+ *   pattern (string)
+ *   for each file: struct cfcache_file, path (string)
+ *   merged config (value)
+ * A string is a uint32_t length, the bytes, and a terminating nul.
+ * A value is a one byte type tag followed by:
+ *   'o' object: uint32_t count, then count (key string, value) pairs
+ *   'a' array: uint32_t count, then count values
+ *   's' string
+ *   'i' integer: int64_t
+ *   'r' real: double
+ *   't' true, 'f' false, 'n' null: nothing
+ */
+#define CFCACHE_MAGIC       "FLXCF001"
+#define CFCACHE_BYTEORDER   0x01020304
+
+/* Limit nesting of decoded values, since decoding is recursive.
+ */
+#define CFCACHE_MAX_DEPTH   64
+
+struct cfcache_header {
+    char magic[8];
+    uint32_t byteorder;
+    uint32_t nfiles;
+    uint64_t size;              // size of the whole file
+};
+
+struct cfcache_file {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t ctime_sec;
+    int64_t ctime_nsec;
+};
+
+struct wbuf {
+    char *data;
+    size_t len;
+    size_t size;
+};
+
+struct rbuf {
+    const char *p;
+    size_t left;
+};
+
+/* Stat files matched by glob.  Return array of gl_pathc entries, or NULL
+ * on failure.  Caller must free.
+ */
+static struct cfcache_file *stat_files (const glob_t *gl)
+{
+    struct cfcache_file *files;
+    struct stat sb;
+    size_t i;
+
+    if (!(files = calloc (gl->gl_pathc + 1, sizeof (*files))))
+        return NULL;
+    for (i = 0; i < gl->gl_pathc; i++) {
+        if (stat (gl->gl_pathv[i], &sb) < 0) {
+            free (files);
+            return NULL;
+        }
+        files[i].dev = sb.st_dev;
+        files[i].ino = sb.st_ino;
+        files[i].size = sb.st_size;
+        files[i].mtime_sec = sb.st_mtim.tv_sec;
+        files[i].mtime_nsec = sb.st_mtim.tv_nsec;
+        files[i].ctime_sec = sb.st_ctim.tv_sec;
+        files[i].ctime_nsec = sb.st_ctim.tv_nsec;
+    }
+    return files;
+}
+
+/* Return true if 'sb' is owned by the effective uid (or root, if 'dir')
+ * and not writable by group or other.
+ */
+static bool is_safe (const struct stat *sb, bool dir)
+{
+    if (dir ? !S_ISDIR (sb->st_mode) : !S_ISREG (sb->st_mode))
+        return false;
+    if (sb->st_uid != geteuid () && !(dir && sb->st_uid == 0))
+        return false;
+    if ((sb->st_mode & (S_IWGRP | S_IWOTH)))
+        return false;
+    return true;
+}
+
+static bool is_safe_dir (const char *path)
+{
+    struct stat sb;
+    char *cpy;
+    bool safe;
+
+    if (!(cpy = strdup (path)))
+        return false;
+    safe = (stat (dirname (cpy), &sb) == 0 && is_safe (&sb, true));
+    free (cpy);
+    return safe;
+}
+
+static int put (struct wbuf *b, const void *data, size_t len)
+{
+    if (b->len + len > b->size) {
+        size_t size = b->size ? b->size : 4096;
+        char *p;
+
+        while (size < b->len + len)
+            size *= 2;
+        if (!(p = realloc (b->data, size)))
+            return -1;
+        b->data = p;
+        b->size = size;
+    }
+    memcpy (b->data + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+static int put_u32 (struct wbuf *b, size_t n)
+{
+    uint32_t u = n;
+
+    if (n > UINT32_MAX) {
+        errno = EOVERFLOW;
+        return -1;
+    }
+    return put (b, &u, sizeof (u));
+}
+
+static int put_str (struct wbuf *b, const char *s, size_t len)
+{
+    if (put_u32 (b, len) < 0
+            || put (b, s, len) < 0
+            || put (b, "", 1) < 0)
+        return -1;
+    return 0;
+}
+
+static int put_tag (struct wbuf *b, char tag)
+{
+    return put (b, &tag, 1);
+}
+
+static int put_value (struct wbuf *b, json_t *o)
+{
+    const char *key;
+    json_t *val;
+    size_t index;
+
+    switch (json_typeof (o)) {
+        case JSON_OBJECT:
+            if (put_tag (b, 'o') < 0 || put_u32 (b, json_object_size (o)) < 0)
+                return -1;
+            json_object_foreach (o, key, val) {
+                if (put_str (b, key, strlen (key)) < 0
+                        || put_value (b, val) < 0)
+                    return -1;
+            }
+            return 0;
+        case JSON_ARRAY:
+            if (put_tag (b, 'a') < 0 || put_u32 (b, json_array_size (o)) < 0)
+                return -1;
+            json_array_foreach (o, index, val) {
+                if (put_value (b, val) < 0)
+                    return -1;
+            }
+            return 0;
+        case JSON_STRING:
+            if (put_tag (b, 's') < 0
+                    || put_str (b, json_string_value (o),
+                                strlen (json_string_value (o))) < 0)
+                return -1;
+            return 0;
+        case JSON_INTEGER: {
+            int64_t i = json_integer_value (o);
+            if (put_tag (b, 'i') < 0 || put (b, &i, sizeof (i)) < 0)
+                return -1;
+            return 0;
+        }
+        case JSON_REAL: {
+            double d = json_real_value (o);
+            if (put_tag (b, 'r') < 0 || put (b, &d, sizeof (d)) < 0)
+                return -1;
+            return 0;
+        }
+        case JSON_TRUE:
+            return put_tag (b, 't');
+        case JSON_FALSE:
+            return put_tag (b, 'f');
+        case JSON_NULL:
+            return put_tag (b, 'n');
+    }
+    errno = EINVAL;
+    return -1;
+}
+
+static int get (struct rbuf *r, void *dst, size_t len)
+{
+    if (r->left < len)
+        return -1;
+    memcpy (dst, r->p, len);
+    r->p += len;
+    r->left -= len;
+    return 0;
+}
+
+/* Return pointer to nul terminated string in buffer, and its length.
+ */
+static const char *get_str (struct rbuf *r, uint32_t *lenp)
+{
+    const char *s;
+    uint32_t len;
+
+    if (get (r, &len, sizeof (len)) < 0 || r->left < (size_t)len + 1)
+        return NULL;
+    s = r->p;
+    if (s[len] != '\0')
+        return NULL;
+    r->p += len + 1;
+    r->left -= len + 1;
+    *lenp = len;
+    return s;
+}
+
+/* Decode a value.  The cache was written by a trusted process from valid
+ * jansson objects, so string contents are not revalidated as UTF-8.
+ */
+static json_t *get_value (struct rbuf *r, int depth)
+{
+    json_t *o = NULL;
+    json_t *val;
+    const char *s;
+    uint32_t count;
+    uint32_t len;
+    char tag;
+
+    if (depth > CFCACHE_MAX_DEPTH || get (r, &tag, 1) < 0)
+        return NULL;
+    switch (tag) {
+        case 'o':
+            if (get (r, &count, sizeof (count)) < 0 || !(o = json_object ()))
+                return NULL;
+            while (count-- > 0) {
+                if (!(s = get_str (r, &len))
+                        || !(val = get_value (r, depth + 1))
+                        || json_object_set_new_nocheck (o, s, val) < 0)
+                    goto error;
+            }
+            break;
+        case 'a':
+            if (get (r, &count, sizeof (count)) < 0 || !(o = json_array ()))
+                return NULL;
+            while (count-- > 0) {
+                if (!(val = get_value (r, depth + 1))
+                        || json_array_append_new (o, val) < 0)
+                    goto error;
+            }
+            break;
+        case 's':
+            if (!(s = get_str (r, &len)))
+                return NULL;
+            o = json_string_nocheck (s);
+            break;
+        case 'i': {
+            int64_t i;
+            if (get (r, &i, sizeof (i)) < 0)
+                return NULL;
+            o = json_integer (i);
+            break;
+        }
+        case 'r': {
+            double d;
+            if (get (r, &d, sizeof (d)) < 0)
+                return NULL;
+            o = json_real (d);
+            break;
+        }
+        case 't':
+            o = json_true ();
+            break;
+        case 'f':
+            o = json_false ();
+            break;
+        case 'n':
+            o = json_null ();
+            break;
+    }
+    return o;
+error:
+    json_decref (o);
+    return NULL;
+}
+
+/* Decode cache in 'r' if it was made from 'pattern' matching 'gl' with
+ * stat info 'files'.  Return merged config, or NULL if the cache is invalid.
+ */
+static cf_t *decode_cache (struct rbuf *r, const char *pattern,
+                           const glob_t *gl, const struct cfcache_file *files)
+{
+    struct cfcache_header hdr;
+    struct cfcache_file file;
+    const char *s;
+    uint32_t len;
+    size_t i;
+    json_t *o;
+
+    if (get (r, &hdr, sizeof (hdr)) < 0
+            || memcmp (hdr.magic, CFCACHE_MAGIC, sizeof (hdr.magic)) != 0
+            || hdr.byteorder != CFCACHE_BYTEORDER
+            || hdr.nfiles != gl->gl_pathc
+            || hdr.size != r->left + sizeof (hdr))
+        return NULL;
+    if (!(s = get_str (r, &len)) || strcmp (s, pattern) != 0)
+        return NULL;
+    for (i = 0; i < gl->gl_pathc; i++) {
+        if (get (r, &file, sizeof (file)) < 0
+                || memcmp (&file, &files[i], sizeof (file)) != 0)
+            return NULL;
+        if (!(s = get_str (r, &len)) || strcmp (s, gl->gl_pathv[i]) != 0)
+            return NULL;
+    }
+    if (!(o = get_value (r, 0)))
+        return NULL;
+    if (!json_is_object (o) || r->left != 0) {
+        json_decref (o);
+        return NULL;
+    }
+    return o;
+}
+
+static cf_t *load_cache (const char *path, const char *pattern,
+                         const glob_t *gl, const struct cfcache_file *files)
+{
+    struct stat sb;
+    struct rbuf r;
+    void *map;
+    cf_t *cf;
+    int fd;
+
+    if (!is_safe_dir (path))
+        return NULL;
+    if ((fd = open (path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC)) < 0)
+        return NULL;
+    if (fstat (fd, &sb) < 0
+            || !is_safe (&sb, false)
+            || sb.st_size < sizeof (struct cfcache_header)) {
+        (void)close (fd);
+        return NULL;
+    }
+    map = mmap (NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    (void)close (fd);
+    if (map == MAP_FAILED)
+        return NULL;
+    r.p = map;
+    r.left = sb.st_size;
+    cf = decode_cache (&r, pattern, gl, files);
+    (void)munmap (map, sb.st_size);
+    return cf;
+}
+
+/* Return true if 'path' does not exist, or is a cache that may be replaced.
+ */
+static bool is_replaceable (const char *path)
+{
+    struct stat sb;
+    char magic[8];
+    int fd;
+    bool ok = false;
+
+    if ((fd = open (path, O_RDONLY | O_NOFOLLOW | O_CLOEXEC)) < 0)
+        return (errno == ENOENT);
+    if (fstat (fd, &sb) == 0
+            && S_ISREG (sb.st_mode)
+            && sb.st_uid == geteuid ()
+            && read (fd, magic, sizeof (magic)) == sizeof (magic)
+            && memcmp (magic, CFCACHE_MAGIC, sizeof (magic)) == 0)
+        ok = true;
+    (void)close (fd);
+    return ok;
+}
+
+static int write_all (int fd, const char *data, size_t len)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        if ((n = write (fd, data, len)) < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int store_cache (const char *path, const char *pattern,
+                        const glob_t *gl, const struct cfcache_file *files,
+                        const cf_t *cf)
+{
+    struct wbuf b = { 0 };
+    struct cfcache_header hdr;
+    char tmp[PATH_MAX + 1];
+    size_t i;
+    int fd;
+
+    if (!is_safe_dir (path) || !is_replaceable (path))
+        return -1;
+    memset (&hdr, 0, sizeof (hdr));
+    memcpy (hdr.magic, CFCACHE_MAGIC, sizeof (hdr.magic));
+    hdr.byteorder = CFCACHE_BYTEORDER;
+    hdr.nfiles = gl->gl_pathc;
+    if (put (&b, &hdr, sizeof (hdr)) < 0
+            || put_str (&b, pattern, strlen (pattern)) < 0)
+        goto error;
+    for (i = 0; i < gl->gl_pathc; i++) {
+        const char *s = gl->gl_pathv[i];
+        if (put (&b, &files[i], sizeof (files[i])) < 0
+                || put_str (&b, s, strlen (s)) < 0)
+            goto error;
+    }
+    if (put_value (&b, (json_t *)cf) < 0)
+        goto error;
+    hdr.size = b.len;
+    memcpy (b.data, &hdr, sizeof (hdr));
+
+    if (snprintf (tmp, sizeof (tmp), "%s.XXXXXX", path) >= sizeof (tmp))
+        goto error;
+    if ((fd = mkstemp (tmp)) < 0)
+        goto error;
+    if (write_all (fd, b.data, b.len) < 0
+            || close (fd) < 0
+            || rename (tmp, path) < 0) {
+        (void)unlink (tmp);
+        goto error;
+    }
+    free (b.data);
+    return 0;
+error:
+    free (b.data);
+    return -1;
+}
+
+int cfcache_update_glob (cf_t *cf, const char *pattern, const char *path,
+                         bool update, struct cf_error *error)
+{
+    struct cfcache_file *files = NULL;
+    struct cfcache_file *files2;
+    cf_t *tmp = NULL;
+    glob_t gl;
+    size_t i;
+    int count = -1;
+    int errnum = 0;
+
+    if (!path)
+        return cf_update_glob (cf, pattern, error);
+
+    /* Let cf_update_glob() report glob errors, or file errors that
+     * prevent the cache from being validated.
+     */
+    if (glob (pattern, GLOB_ERR, NULL, &gl) != 0) {
+        globfree (&gl);
+        return cf_update_glob (cf, pattern, error);
+    }
+    if (!(files = stat_files (&gl))) {
+        globfree (&gl);
+        return cf_update_glob (cf, pattern, error);
+    }
+
+    if (!(tmp = load_cache (path, pattern, &gl, files))) {
+        if (!(tmp = cf_create ())) {
+            errnum = errno;
+            goto done;
+        }
+        for (i = 0; i < gl.gl_pathc; i++) {
+            if (cf_update_file (tmp, gl.gl_pathv[i], error) < 0) {
+                errnum = errno;
+                goto done;
+            }
+        }
+        /* Don't cache the result if any file changed while being read.
+         */
+        if (update && (files2 = stat_files (&gl))) {
+            if (memcmp (files, files2, gl.gl_pathc * sizeof (*files)) == 0)
+                (void)store_cache (path, pattern, &gl, files, tmp);
+            free (files2);
+        }
+    }
+    if (json_object_update (cf, tmp) < 0) {
+        if (error) {
+            memset (error, 0, sizeof (*error));
+            strncpy (error->filename, pattern, PATH_MAX);
+            error->lineno = -1;
+            (void)snprintf (error->errbuf, sizeof (error->errbuf),
+                            "updating JSON object: out of memory");
+        }
+        errnum = ENOMEM;
+        goto done;
+    }
+    count = gl.gl_pathc;
+done:
+    cf_destroy (tmp);
+    free (files);
+    globfree (&gl);
+    errno = errnum;
+    return count;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
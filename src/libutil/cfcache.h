@@ -0,0 +1,47 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_CFCACHE_H
+#define _UTIL_CFCACHE_H
+
+#include <stdbool.h>
+
+#include "cf.h"
+
+/* Config cache - the merged result of cf_update_glob(), saved in a
+ * compact binary file so that later loads need not parse TOML.
+ *
+ * The cache records the glob pattern and the device, inode, size,
+ * mtime, and ctime of each matching file.  It is used only if the
+ * pattern expands to the same list of files, none of which changed.
+ *
+ * Since a setuid program may trust its contents, the cache is used only
+ * if it is a regular file owned by the caller's effective uid and not
+ * writable by group or other, in a directory with the same restrictions.
+ * The cache is replaced by writing a temporary file in that directory
+ * and renaming it over 'path', and a file at 'path' that is not a cache
+ * is never replaced.
+ */
+
+/* Update 'cf' with the files matching 'pattern' as with cf_update_glob(),
+ * using the cache at 'path' if it is valid.  If the cache is missing or
+ * stale and 'update' is true, try to rewrite it (failure is ignored).
+ * If 'path' is NULL, this is equivalent to cf_update_glob().
+ * Return the number of files loaded, or -1 on failure with errno set,
+ * and if error is non-NULL, an error description there.
+ */
+int cfcache_update_glob (cf_t *cf, const char *pattern, const char *path,
+                         bool update, struct cf_error *error);
+
+#endif /* !_UTIL_CFCACHE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -27,22 +27,84 @@
 
 #define KV_CHUNK 4096
 
+/* Minimum index size (must be a power of 2).
+ */
+#define KV_INDEX_MIN 16
+
+/* Binary encoding header: a zero byte (which cannot begin a text encoding,
+ * since keys are non-empty) followed by the version.
+ */
+#define KV_BINARY_VERSION   1
+#define KV_BINARY_HDRSZ     2
+
+/* Type hints of fixed size (8 byte) values in the binary encoding.
+ */
+#define KV_BIN_INT64        'I'
+#define KV_BIN_DOUBLE       'D'
+#define KV_BIN_TIMESTAMP    'T'
+#define KV_BIN_VALSZ        8
+
+/* Entries are located through 'index', an open addressed hash table
+ * (linear probing) of entry offsets into 'buf', stored as offset + 1
+ * so that zero marks an empty slot.  The table is kept at most half full.
+ * If a decoded buffer contains duplicate keys, only the first is indexed.
+ * Entries begin at 'start', which is nonzero if buf has a binary header.
+ * A view borrows 'buf' from the caller and may not be modified.
+ */
 struct kv {
     char *buf;
     int bufsz;
     int len;
+    int start;
+    bool view;
+    int *index;
+    int index_size;
+    int count;
+};
+
+/* Decoded value of any type, for conversion between encodings.
+ */
+struct kv_value {
+    const char *s;
+    int64_t i;
+    double d;
+    bool b;
+    time_t t;
 };
 
+static int index_build (struct kv *kv);
+
 void kv_destroy (struct kv *kv)
 {
     if (kv) {
         int saved_errno = errno;
-        free (kv->buf);
+        if (!kv->view)
+            free (kv->buf);
+        free (kv->index);
         free (kv);
         errno = saved_errno;
     }
 }
 
+/* Return offset of the first entry in encoded 'buf', i.e. the size
+ * of the binary encoding header, if any.
+ * Returns offset on success, -1 on failure with errno set.
+ */
+static int encoding_start (const char *buf, int len)
+{
+    if (len < 0 || (len > 0 && !buf))
+        goto inval;
+    if (len > 0 && buf[0] == '\0') {
+        if (len < KV_BINARY_HDRSZ || buf[1] != KV_BINARY_VERSION)
+            goto inval;
+        return KV_BINARY_HDRSZ;
+    }
+    return 0;
+inval:
+    errno = EINVAL;
+    return -1;
+}
+
 /* Create kv object from 'buf' and 'len'.
  * If len == 0, create an empty object.
  * Returns object on success, NULL on failure with errno set.
@@ -50,11 +112,10 @@ void kv_destroy (struct kv *kv)
 static struct kv *kv_create_from (const char *buf, int len)
 {
     struct kv *kv;
+    int start;
 
-    if (len < 0 || (len > 0 && !buf)) {
-        errno = EINVAL;
+    if ((start = encoding_start (buf, len)) < 0)
         return NULL;
-    }
     if (!(kv = calloc (1, sizeof (*kv))))
         return NULL;
     if (len > 0) {
@@ -64,6 +125,31 @@ static struct kv *kv_create_from (const char *buf, int len)
         }
         memcpy (kv->buf, buf, len);
         kv->bufsz = kv->len = len;
+        kv->start = start;
+    }
+    if (index_build (kv) < 0) {
+        kv_destroy (kv);
+        return NULL;
+    }
+    return kv;
+}
+
+struct kv *kv_view (const char *buf, int len)
+{
+    struct kv *kv;
+    int start;
+
+    if ((start = encoding_start (buf, len)) < 0)
+        return NULL;
+    if (!(kv = calloc (1, sizeof (*kv))))
+        return NULL;
+    kv->view = true;
+    kv->buf = (char *)buf; // N.B. never modified
+    kv->bufsz = kv->len = len;
+    kv->start = start;
+    if (index_build (kv) < 0) {
+        kv_destroy (kv);
+        return NULL;
     }
     return kv;
 }
@@ -82,10 +168,95 @@ struct kv *kv_copy (const struct kv *kv)
     return kv_create_from (kv->buf, kv->len);
 }
 
+/* Create an empty kv object with the specified encoding.
+ * Returns object on success, NULL on failure with errno set.
+ */
+static struct kv *kv_create_encoding (enum kv_encoding encoding)
+{
+    const char hdr[KV_BINARY_HDRSZ] = { '\0', KV_BINARY_VERSION };
+
+    if (encoding == KV_ENCODING_BINARY)
+        return kv_create_from (hdr, sizeof (hdr));
+    return kv_create ();
+}
+
+enum kv_encoding kv_get_encoding (const struct kv *kv)
+{
+    if (kv && kv->start > 0)
+        return KV_ENCODING_BINARY;
+    return KV_ENCODING_TEXT;
+}
+
+static int kv_put_prefix (struct kv *kv, const char *prefix, const char *key,
+                          const char *entry);
+
+/* Create a copy of 'kv' with the specified encoding.
+ * Returns object on success, NULL on failure with errno set.
+ */
+static struct kv *kv_copy_encoding (const struct kv *kv,
+                                    enum kv_encoding encoding)
+{
+    struct kv *cpy;
+    const char *key = NULL;
+
+    if (!(cpy = kv_create_encoding (encoding)))
+        return NULL;
+    while ((key = kv_next (kv, key))) {
+        if (kv_put_prefix (cpy, NULL, key, key) < 0) {
+            kv_destroy (cpy);
+            return NULL;
+        }
+    }
+    return cpy;
+}
+
+int kv_set_encoding (struct kv *kv, enum kv_encoding encoding)
+{
+    struct kv *cpy;
+    struct kv tmp;
+
+    if (!kv || (encoding != KV_ENCODING_TEXT
+                && encoding != KV_ENCODING_BINARY)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (kv_get_encoding (kv) == encoding)
+        return 0;
+    if (kv->view) {
+        errno = EROFS;
+        return -1;
+    }
+    if (!(cpy = kv_copy_encoding (kv, encoding)))
+        return -1;
+    tmp = *kv;
+    *kv = *cpy;
+    *cpy = tmp;
+    kv_destroy (cpy);
+    return 0;
+}
+
+/* If the encodings differ, compare in the text encoding, so that a value
+ * is equal to the value put to an object with the other encoding.
+ */
 bool kv_equal (const struct kv *kv1, const struct kv *kv2)
 {
+    struct kv *cpy;
+    bool equal;
+
     if (!kv1 || !kv2)
         return false;
+    if (kv_get_encoding (kv1) != kv_get_encoding (kv2)) {
+        if (kv_get_encoding (kv1) == KV_ENCODING_BINARY) {
+            const struct kv *tmp = kv1;
+            kv1 = kv2;
+            kv2 = tmp;
+        }
+        if (!(cpy = kv_copy_encoding (kv2, KV_ENCODING_TEXT)))
+            return false;
+        equal = kv_equal (kv1, cpy);
+        kv_destroy (cpy);
+        return equal;
+    }
     if (kv1->len != kv2->len)
         return false;
     if (memcmp (kv1->buf, kv2->buf, kv1->len) != 0)
@@ -115,23 +286,148 @@ static bool valid_key (const char *key)
     return true;
 }
 
+/* Return true if type hint 'c' denotes a fixed size binary value.
+ */
+static bool binary_hint (char c)
+{
+    return (c == KV_BIN_INT64 || c == KV_BIN_DOUBLE || c == KV_BIN_TIMESTAMP);
+}
+
+/* Return true if type hint 'c' is valid in kv's encoding.
+ * Booleans and strings are text in both encodings.
+ */
+static bool valid_hint (const struct kv *kv, char c)
+{
+    switch (c) {
+        case KV_STRING:
+        case KV_BOOL:
+            return true;
+        case KV_INT64:
+        case KV_DOUBLE:
+        case KV_TIMESTAMP:
+            return kv_get_encoding (kv) == KV_ENCODING_TEXT;
+        case KV_BIN_INT64:
+        case KV_BIN_DOUBLE:
+        case KV_BIN_TIMESTAMP:
+            return kv_get_encoding (kv) == KV_ENCODING_BINARY;
+        default:
+            return false;
+    }
+}
+
+static char entry_hint (const char *entry)
+{
+    return entry[strlen (entry) + 1];
+}
+
+static void put_le64 (char *p, uint64_t val)
+{
+    int i;
+
+    for (i = 0; i < KV_BIN_VALSZ; i++)
+        p[i] = (val >> (8 * i)) & 0xff;
+}
+
+static uint64_t get_le64 (const char *p)
+{
+    uint64_t val = 0;
+    int i;
+
+    for (i = 0; i < KV_BIN_VALSZ; i++)
+        val |= (uint64_t)(unsigned char)p[i] << (8 * i);
+    return val;
+}
+
+/* FNV-1a hash of key.
+ */
+static unsigned int hash_key (const char *key)
+{
+    unsigned int h = 2166136261U;
+
+    while (*key) {
+        h ^= (unsigned char)*key++;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/* Find index slot for 'key': either the slot holding it or the empty slot
+ * where it would be inserted.  The index must exist.
+ */
+static int index_slot (const struct kv *kv, const char *key)
+{
+    unsigned int mask = kv->index_size - 1;
+    unsigned int i = hash_key (key) & mask;
+
+    while (kv->index[i] != 0) {
+        if (!strcmp (key, kv->buf + kv->index[i] - 1))
+            break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+/* Resize index to 'size' slots and re-add existing entries.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int index_resize (struct kv *kv, int size)
+{
+    int *old = kv->index;
+    int oldsize = kv->index_size;
+    int i;
+
+    if (!(kv->index = calloc (size, sizeof (kv->index[0])))) {
+        kv->index = old;
+        return -1;
+    }
+    kv->index_size = size;
+    for (i = 0; i < oldsize; i++) {
+        if (old[i] != 0)
+            kv->index[index_slot (kv, kv->buf + old[i] - 1)] = old[i];
+    }
+    free (old);
+    return 0;
+}
+
+/* Add entry at 'offset' to the index, unless its key is already indexed.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int index_insert (struct kv *kv, int offset)
+{
+    int i;
+
+    if ((kv->count + 1) * 2 > kv->index_size) {
+        int size = kv->index_size > 0 ? kv->index_size * 2 : KV_INDEX_MIN;
+        if (index_resize (kv, size) < 0)
+            return -1;
+    }
+    i = index_slot (kv, kv->buf + offset);
+    if (kv->index[i] == 0) {
+        kv->index[i] = offset + 1;
+        kv->count++;
+    }
+    return 0;
+}
+
 /* Look up entry by key (and type if type != KV_UNKNOWN).
  * Returns entry on success, NULL on failure with errno set.
  */
 static const char *kv_find (const struct kv *kv, const char *key,
                             enum kv_type type)
 {
-    const char *entry = NULL;
+    const char *entry;
+    int i;
 
     if (!kv || !valid_key (key)) {
         errno = EINVAL;
         return NULL;
     }
-    while ((entry = kv_next (kv, entry))) {
-        if (!strcmp (key, entry)) {
+    if (kv->count > 0) {
+        i = index_slot (kv, key);
+        if (kv->index[i] != 0) {
+            entry = kv->buf + kv->index[i] - 1;
             if (type == KV_UNKNOWN || kv_typeof (entry) == type)
                 return entry;
-            break;
         }
     }
     errno = ENOENT;
@@ -139,6 +435,7 @@ static const char *kv_find (const struct kv *kv, const char *key,
 }
 
 /* Return length, not to exceed maxlen, of entry consisting of key\0Tvalue\0
+ * or for binary values, key\0Tvalue (value is 8 bytes).
  * Return -1 on invalid entry.
  */
 static int entry_length (const char *entry, int maxlen)
@@ -147,16 +444,50 @@ static int entry_length (const char *entry, int maxlen)
     int vallen; // including T
 
     keylen = strnlen (entry, maxlen);
-    if (keylen == 0 || keylen == maxlen)
+    if (keylen == 0 || keylen >= maxlen - 1)
         return -1;
     entry += keylen + 1;
     maxlen -= keylen + 1;
+    if (binary_hint (*entry)) {
+        if (maxlen < 1 + KV_BIN_VALSZ)
+            return -1;
+        return keylen + KV_BIN_VALSZ + 2;
+    }
     vallen = strnlen (entry, maxlen);
     if (vallen == 0 || vallen == maxlen)
         return -1;
     return keylen + vallen + 2;
 }
 
+/* (Re-)build the index from kv->buf, validating each entry:
+ * - nonzero key length
+ * - value has type hint char valid for the encoding
+ * - entries are properly terminated and exactly fill the buffer
+ * Return 0 on success, -1 on failure with errno set.
+ */
+static int index_build (struct kv *kv)
+{
+    int offset = kv->start;
+    int entry_len;
+
+    if (kv->index)
+        memset (kv->index, 0, kv->index_size * sizeof (kv->index[0]));
+    kv->count = 0;
+    while (offset < kv->len) {
+        const char *entry = kv->buf + offset;
+
+        if ((entry_len = entry_length (entry, kv->len - offset)) < 0
+                || !valid_hint (kv, entry_hint (entry))) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (index_insert (kv, offset) < 0)
+            return -1;
+        offset += entry_len;
+    }
+    return 0;
+}
+
 int kv_delete (struct kv *kv, const char *key)
 {
     const char *entry;
@@ -165,6 +496,10 @@ int kv_delete (struct kv *kv, const char *key)
 
     if (!(entry = kv_find (kv, key, KV_UNKNOWN)))
         return -1;
+    if (kv->view) {
+        errno = EROFS;
+        return -1;
+    }
     entry_offset = entry - kv->buf;
     entry_len = entry_length (entry, kv->len - entry_offset);
     assert (entry_len >= 0);
@@ -172,74 +507,191 @@ int kv_delete (struct kv *kv, const char *key)
              kv->buf + entry_offset + entry_len,
              kv->len - entry_offset - entry_len);
     kv->len -= entry_len;
+    /* Following entries moved, so offsets must be recomputed.
+     * The index does not grow, so this cannot fail.
+     */
+    if (index_build (kv) < 0)
+        return -1;
     return 0;
 }
 
-/* Put 'val' of a given type that has been already been converted to a string.
+/* Put 'val' of 'vallen' bytes with type hint 'hint', that has already been
+ * converted to the internal encoding.  Text values are null terminated.
  * Returns 0 on success, -1 on failure with errno set.
  */
-static int kv_put_raw (struct kv *kv, const char *key, enum kv_type type,
-                       const char *val)
+static int kv_put_raw (struct kv *kv, const char *key, char hint,
+                       const char *val, int vallen)
 {
     if (!kv || !valid_key (key) || !val) {
         errno = EINVAL;
         return -1;
     }
+    if (kv->view) {
+        errno = EROFS;
+        return -1;
+    }
     if (kv_delete (kv, key) < 0) {
         if (errno != ENOENT)
             return -1;
     }
     int keylen = strlen (key);
-    int vallen = strlen (val);
+    int offset = kv->len;
     if (kv_expand (kv, keylen + vallen + 3) < 0) // key\0Tval\0
         return -1;
-    strncpy (&kv->buf[kv->len], key, keylen + 1);
+    memcpy (&kv->buf[kv->len], key, keylen + 1);
     kv->len += keylen + 1;
-    kv->buf[kv->len++] = type;
-    strncpy (&kv->buf[kv->len], val, vallen + 1);
-    kv->len += vallen + 1;
+    kv->buf[kv->len++] = hint;
+    memcpy (&kv->buf[kv->len], val, vallen);
+    kv->len += vallen;
+    if (!binary_hint (hint))
+        kv->buf[kv->len++] = '\0';
+    if (index_insert (kv, offset) < 0) {
+        kv->len = offset;
+        return -1;
+    }
     return 0;
 }
 
-int kv_vput (struct kv *kv, const char *key, enum kv_type type, va_list ap)
+/* Convert value 'v' of 'type' to kv's encoding and put it.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int kv_put_value (struct kv *kv, const char *key, enum kv_type type,
+                         const struct kv_value *v)
 {
+    bool binary = (kv_get_encoding (kv) == KV_ENCODING_BINARY);
     char s[80];
-    const char *val = NULL;
+    uint64_t u;
+    int n;
+
+    switch (type) {
+        case KV_STRING:
+            if (!v->s)
+                goto inval;
+            return kv_put_raw (kv, key, type, v->s, strlen (v->s));
+        case KV_INT64:
+            if (binary) {
+                put_le64 (s, v->i);
+                return kv_put_raw (kv, key, KV_BIN_INT64, s, KV_BIN_VALSZ);
+            }
+            if ((n = snprintf (s, sizeof (s), "%" PRIi64, v->i))
+                                                        >= sizeof (s))
+                goto inval;
+            return kv_put_raw (kv, key, type, s, n);
+        case KV_DOUBLE:
+            if (binary) {
+                memcpy (&u, &v->d, sizeof (u));
+                put_le64 (s, u);
+                return kv_put_raw (kv, key, KV_BIN_DOUBLE, s, KV_BIN_VALSZ);
+            }
+            if ((n = snprintf (s, sizeof (s), "%f", v->d)) >= sizeof (s))
+                goto inval;
+            return kv_put_raw (kv, key, type, s, n);
+        case KV_BOOL:
+            if (v->b)
+                return kv_put_raw (kv, key, type, "true", 4);
+            return kv_put_raw (kv, key, type, "false", 5);
+        case KV_TIMESTAMP:
+            if (binary) {
+                put_le64 (s, (int64_t)v->t);
+                return kv_put_raw (kv, key, KV_BIN_TIMESTAMP, s,
+                                   KV_BIN_VALSZ);
+            }
+            if (timestamp_tostr (v->t, s, sizeof (s)) < 0)
+                goto inval;
+            return kv_put_raw (kv, key, type, s, strlen (s));
+        default:
+            goto inval;
+    }
+inval:
+    errno = EINVAL;
+    return -1;
+}
+
+/* Put a copy of 'entry' from another kv object under 'key', prepending
+ * 'prefix' if non-NULL.  The value is copied as is if it is valid in kv's
+ * encoding, otherwise it is converted.
+ * Returns 0 on success, -1 on failure with errno set.
+ */
+static int kv_put_prefix (struct kv *kv, const char *prefix, const char *key,
+                          const char *entry)
+{
+    char *newkey = NULL;
+    char hint = entry_hint (entry);
+    int rc;
+
+    if (prefix) {
+        if (asprintf (&newkey, "%s%s", prefix, key) < 0)
+            return -1;
+        key = newkey;
+    }
+    if (valid_hint (kv, hint)) {
+        const char *val = entry + strlen (entry) + 2;
+        int vallen = binary_hint (hint) ? KV_BIN_VALSZ : strlen (val);
+        rc = kv_put_raw (kv, key, hint, val, vallen);
+    }
+    else {
+        struct kv_value v = { 0 };
+
+        switch (kv_typeof (entry)) {
+            case KV_INT64:
+                v.i = kv_val_int64 (entry);
+                break;
+            case KV_DOUBLE:
+                v.d = kv_val_double (entry);
+                break;
+            case KV_TIMESTAMP:
+                v.t = kv_val_timestamp (entry);
+                break;
+            default:
+                break;
+        }
+        rc = kv_put_value (kv, key, kv_typeof (entry), &v);
+    }
+    if (rc < 0) {
+        int saved_errno = errno;
+        free (newkey);
+        errno = saved_errno;
+        return -1;
+    }
+    free (newkey);
+    return 0;
+}
+
+int kv_put_entry (struct kv *kv, const char *key, const char *entry)
+{
+    if (!kv || !entry) {
+        errno = EINVAL;
+        return -1;
+    }
+    return kv_put_prefix (kv, NULL, key, entry);
+}
+
+int kv_vput (struct kv *kv, const char *key, enum kv_type type, va_list ap)
+{
+    struct kv_value v = { 0 };
 
     if (!kv || !valid_key (key))
         goto inval;
     switch (type) {
         case KV_STRING:
-            val = va_arg (ap, const char *);
+            v.s = va_arg (ap, const char *);
             break;
         case KV_INT64:
-            if (vsnprintf (s, sizeof (s), "%" PRIi64, ap) >= sizeof (s))
-                goto inval;
-            val = s;
+            v.i = va_arg (ap, int64_t);
             break;
         case KV_DOUBLE:
-            if (vsnprintf (s, sizeof (s), "%f", ap) >= sizeof (s))
-                goto inval;
-            val = s;
+            v.d = va_arg (ap, double);
             break;
-        case KV_BOOL: {
-            bool b = va_arg (ap, int); // va promotes bool to int
-            val = b ? "true" : "false";
+        case KV_BOOL:
+            v.b = va_arg (ap, int); // va promotes bool to int
             break;
-        }
-        case KV_TIMESTAMP: {
-            time_t t = va_arg (ap, time_t);
-            if (timestamp_tostr (t, s, sizeof (s)) < 0)
-                goto inval;
-            val = s;
+        case KV_TIMESTAMP:
+            v.t = va_arg (ap, time_t);
             break;
-        }
         default:
             goto inval;
     }
-    if (!val)
-        goto inval;
-    return kv_put_raw (kv, key, type, val);
+    return kv_put_value (kv, key, type, &v);
 inval:
     errno = EINVAL;
     return -1;
@@ -261,11 +713,11 @@ const char *kv_next (const struct kv *kv, const char *key)
     int entry_len;
     int entry_offset;
 
-    if (!kv || kv->len == 0)
+    if (!kv || kv->len == kv->start)
         return NULL;
     if (!key)
-        return kv->buf;
-    if (key < kv->buf || key > kv->buf + kv->len)
+        return kv->buf + kv->start;
+    if (key < kv->buf + kv->start || key > kv->buf + kv->len)
         return NULL;
     entry_offset = key - kv->buf;
     entry_len = entry_length (key, kv->len - entry_offset);
@@ -274,20 +726,40 @@ const char *kv_next (const struct kv *kv, const char *key)
     return key + entry_len;
 }
 
+const char *kv_next_prefix (const struct kv *kv, const char *prefix,
+                            const char *key)
+{
+    int n = prefix ? strlen (prefix) : 0;
+
+    while ((key = kv_next (kv, key))) {
+        if (n == 0 || (!strncmp (key, prefix, n) && key[n] != '\0'))
+            return key;
+    }
+    return NULL;
+}
+
 const char *kv_val_string (const char *key)
 {
-    if (!key)
+    if (!key || binary_hint (entry_hint (key)))
         return "";
     return &key[strlen (key) + 2];
 }
 
 int64_t kv_val_int64 (const char *key)
 {
+    if (key && entry_hint (key) == KV_BIN_INT64)
+        return get_le64 (&key[strlen (key) + 2]);
     return strtoll (kv_val_string (key), NULL, 10);
 }
 
 double kv_val_double (const char *key)
 {
+    if (key && entry_hint (key) == KV_BIN_DOUBLE) {
+        uint64_t u = get_le64 (&key[strlen (key) + 2]);
+        double d;
+        memcpy (&d, &u, sizeof (d));
+        return d;
+    }
     return strtod (kv_val_string (key), NULL);
 }
 
@@ -303,7 +775,11 @@ bool kv_val_bool (const char *key)
 time_t kv_val_timestamp (const char *key)
 {
     time_t t;
-    const char *s = kv_val_string (key);
+    const char *s;
+
+    if (key && entry_hint (key) == KV_BIN_TIMESTAMP)
+        return (int64_t)get_le64 (&key[strlen (key) + 2]);
+    s = kv_val_string (key);
     if (timestamp_fromstr (s, &t) < 0)
         return 0;
     return t;
@@ -313,14 +789,20 @@ enum kv_type kv_typeof (const char *key)
 {
     if (!key)
         return KV_UNKNOWN;
-    enum kv_type type = key[strlen (key) + 1];
-    switch (type) {
+    char hint = entry_hint (key);
+    switch (hint) {
         case KV_STRING:
         case KV_INT64:
         case KV_DOUBLE:
         case KV_BOOL:
         case KV_TIMESTAMP:
-            return type;
+            return hint;
+        case KV_BIN_INT64:
+            return KV_INT64;
+        case KV_BIN_DOUBLE:
+            return KV_DOUBLE;
+        case KV_BIN_TIMESTAMP:
+            return KV_TIMESTAMP;
         default:
             return KV_UNKNOWN;
     }
@@ -381,45 +863,6 @@ int kv_get (const struct kv *kv, const char *key, enum kv_type type, ...)
     return rc;
 }
 
-/* Validate a just-decoded kv buffer.
- * Return 0 on success, -1 on failure with errno set.
- */
-static int kv_check_integrity (struct kv *kv)
-{
-    int nullcount;
-    int i;
-    const char *key = NULL;
-
-    /* properly terminated
-     */
-    if (kv->len > 0 && kv->buf[kv->len - 1] != '\0')
-        goto inval;
-
-    /* even number of nulls
-     */
-    nullcount = 0;
-    for (i = 0; i < kv->len; i++) {
-        if (kv->buf[i] == '\0')
-            nullcount++;
-    }
-    if (nullcount % 2 != 0)
-        goto inval;
-
-    /* nonzero key length
-     * value has valid type hint char
-     */
-    while ((key = kv_next (kv, key))) {
-        if (strlen (key) == 0)
-            goto inval;
-        if (kv_typeof (key) == KV_UNKNOWN)
-            goto inval;
-    }
-    return 0;
-inval:
-    errno = EINVAL;
-    return -1;
-}
-
 int kv_encode (const struct kv *kv, const char **buf, int *len)
 {
     if (!kv || !buf || !len) {
@@ -431,40 +874,11 @@ int kv_encode (const struct kv *kv, const char **buf, int *len)
     return 0;
 }
 
-struct kv *kv_decode (const char *buf, int len)
-{
-    struct kv *kv;
-
-    if (!(kv = kv_create_from (buf, len)))
-        return NULL;
-    if (kv_check_integrity (kv) < 0) {
-        kv_destroy (kv);
-        return NULL;
-    }
-    return kv;
-}
-
-/* Wrapper for kv_put_raw() which adds 'prefix' to key, if non-NULL.
- * Returns 0 on success, -1 on failure with errno set (ENOMEM).
+/* The buffer is validated while its index is built in kv_create_from().
  */
-static int kv_put_prefix (struct kv *kv, const char *prefix, const char *key,
-                          enum kv_type type, const char *val)
+struct kv *kv_decode (const char *buf, int len)
 {
-    char *newkey = NULL;
-
-    if (prefix) {
-        if (asprintf (&newkey, "%s%s", prefix, key) < 0)
-            return -1;
-        key = newkey;
-    }
-    if (kv_put_raw (kv, key, type, val) < 0) {
-        int saved_errno = errno;
-        free (newkey);
-        errno = saved_errno;
-        return -1;
-    }
-    free (newkey);
-    return 0;
+    return kv_create_from (buf, len);
 }
 
 int kv_join (struct kv *kv1, const struct kv *kv2, const char *prefix)
@@ -472,8 +886,7 @@ int kv_join (struct kv *kv1, const struct kv *kv2, const char *prefix)
     const char *key = NULL;
 
     while ((key = kv_next (kv2, key))) {
-        if (kv_put_prefix (kv1, prefix, key, kv_typeof (key),
-                                             kv_val_string (key)) < 0)
+        if (kv_put_prefix (kv1, prefix, key, key) < 0)
             return -1;
     }
     return 0;
@@ -485,15 +898,12 @@ struct kv *kv_split (const struct kv *kv1, const char *prefix)
     struct kv *kv2;
     int n = prefix ? strlen (prefix) : 0;
 
-    if (!(kv2 = kv_create ()))
+    if (!(kv2 = kv_create_encoding (kv_get_encoding (kv1))))
         return NULL;
-    while ((key = kv_next (kv1, key))) {
-        if (strlen (key) > n && !strncmp (key, prefix, n)) {
-            if (kv_put_raw (kv2, key + n, kv_typeof (key),
-                                          kv_val_string (key)) < 0) {
-                kv_destroy (kv2);
-                return NULL;
-            }
+    while ((key = kv_next_prefix (kv1, prefix, key))) {
+        if (kv_put_prefix (kv2, NULL, key + n, key) < 0) {
+            kv_destroy (kv2);
+            return NULL;
         }
     }
     return kv2;
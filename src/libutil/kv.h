@@ -16,6 +16,20 @@
  *
  * T=single-char type hint:
  *   s=string, i=int64_t, d=double, b=bool, t=timestamp
+ *
+ * A kv object keeps a hash index of its entries, built while a buffer
+ * is validated by kv_decode(), so lookups do not scan the buffer.
+ *
+ * Optional binary encoding (version 1), in which numeric values are stored
+ * as 8 byte little-endian integers and need not be parsed on access:
+ *   \0\1key\0Tvalue...
+ *
+ * T=single-char type hint:
+ *   s=string, b=bool (as above)
+ *   I=int64_t, D=double (IEEE 754), T=timestamp (seconds since epoch)
+ *
+ * Binary values are not null terminated.  The leading zero byte cannot
+ * begin a text encoding, so kv_decode() accepts either.
  */
 
 #include <stdbool.h>
@@ -32,25 +46,40 @@ enum kv_type {
     KV_TIMESTAMP = 't',
 };
 
+enum kv_encoding {
+    KV_ENCODING_TEXT = 0,
+    KV_ENCODING_BINARY = 1,
+};
+
 /* Create/destroy/copy kv object.
+ * New objects use the text encoding.  Copies keep the original encoding.
  */
 struct kv *kv_create (void);
 void kv_destroy (struct kv *kv);
 struct kv *kv_copy (const struct kv *kv);
 
+/* Create a read-only view of a kv buffer in either encoding, without
+ * copying it.  'buf' must remain valid and unchanged until the view is
+ * destroyed with kv_destroy().  Functions that would modify the view
+ * fail with EROFS.
+ * Returns view on success, NULL on failure with errno set.
+ */
+struct kv *kv_view (const char *buf, int len);
+
 /* Add kv2 entries to kv1, prepending 'prefix' to its keys (if non-NULL).
  * When there are key conflicts, values from kv2 override kv1.
  * Return 0 on success, -1 on failure with errno set.
  */
 int kv_join (struct kv *kv1, const struct kv *kv2, const char *prefix);
 
-/* Find entries in kv with matching key prefix.  Create new kv object,
- * consisting of these entries with key prefix removed.
+/* Find entries in kv with matching key prefix.  Create new kv object
+ * with the same encoding, consisting of these entries with key prefix removed.
  * Returns new kv object on success, NULL on failure with errno set.
  */
 struct kv *kv_split (const struct kv *kv, const char *prefix);
 
-/* Return true if kv1 is identical to kv2 (including entry order)
+/* Return true if kv1 is identical to kv2 (including entry order).
+ * If their encodings differ, they are compared in the text encoding.
  */
 bool kv_equal (const struct kv *kv1, const struct kv *kv2);
 
@@ -71,6 +100,13 @@ int kv_delete (struct kv *kv, const char *key);
 int kv_vput (struct kv *kv, const char *key, enum kv_type type, va_list ap);
 int kv_put (struct kv *kv, const char *key, enum kv_type type, ...);
 
+/* Add 'key' to kv object with the type and value of 'entry', an entry
+ * returned by kv_next() on another kv object.  The value is converted
+ * if the objects' encodings differ.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+int kv_put_entry (struct kv *kv, const char *key, const char *entry);
+
 /* Find key in kv object and get val (if non-NULL).
  * Return 0 on success, -1 on failure with errno set:
  *   EINVAL - invalid argument
@@ -80,12 +116,19 @@ int kv_vget (const struct kv *kv, const char *key,
              enum kv_type type, va_list ap);
 int kv_get (const struct kv *kv, const char *key, enum kv_type type, ...);
 
+/* Convert kv object to 'encoding'.  Values added later are stored in the
+ * same encoding, and kv_encode() returns it.
+ * Return 0 on success, -1 on failure with errno set.
+ */
+int kv_set_encoding (struct kv *kv, enum kv_encoding encoding);
+enum kv_encoding kv_get_encoding (const struct kv *kv);
+
 /* Access internal binary encoding.
  * Return 0 on success, -1 on failure with errno set.
  */
 int kv_encode (const struct kv *kv, const char **buf, int *len);
 
-/* Create kv object from binary encoding.
+/* Create kv object from text or binary encoding.
  * Return kv object on success, NULL on failure with errno set.
  */
 struct kv *kv_decode (const char *buf, int len);
@@ -104,11 +147,19 @@ struct kv *kv_decode (const char *buf, int len);
 const char *kv_next (const struct kv *kv, const char *key);
 enum kv_type kv_typeof (const char *key);
 
+/* Like kv_next(), but only return entries whose key begins with 'prefix'
+ * and is longer than it, so that key + strlen (prefix) is the key with
+ * prefix removed.  This iterates over entries in place, without allocating.
+ */
+const char *kv_next_prefix (const struct kv *kv, const char *prefix,
+                            const char *key);
+
 /* Iteration value accessors for keys returned by kv_next().
  * Use kv_typeof() to choose the proper accessor; if type doesn't
  * match, returned value is undefined.
  */
 const char *kv_val_string (const char *key); // N.B. never returns NULL
+                                             // "" for binary numeric values
 int64_t kv_val_int64 (const char *key);
 double kv_val_double (const char *key);
 bool kv_val_bool (const char *key);
@@ -10,13 +10,29 @@
               Algorithm specification can be found here:
                * http://csrc.nist.gov/publications/fips/fips180-2/fips180-2withchangenotice.pdf
               This implementation uses little endian byte order.
+              Blocks are compressed by the fastest engine available:
+              x86 SHA extensions, ARMv8 crypto extensions, or portable C,
+              selected at startup by CPU feature detection.
 *********************************************************************/
 
 /*************************** HEADER FILES ***************************/
 #include <stdlib.h>
 #include <memory.h>
+#include <string.h>
 #include "sha256.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define HAVE_SHA256_ARM 1
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#include <arm_neon.h>
+#endif
+
 /****************************** MACROS ******************************/
 #define ROTLEFT(a,b) (((a) << (b)) | ((a) >> (32-(b))))
 #define ROTRIGHT(a,b) (((a) >> (b)) | ((a) << (32-(b))))
@@ -41,45 +57,344 @@ static const WORD k[64] = {
 };
 
 /*********************** FUNCTION DEFINITIONS ***********************/
-void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+
+/* Compress 'nblocks' 64-byte blocks of 'data' into 'state'.
+ */
+typedef void (*sha256_blocks_f)(WORD state[8], const BYTE data[],
+                                size_t nblocks);
+
+/* Compress blocks of two independent messages, 'nblocks' each.
+ */
+typedef void (*sha256_blocks2_f)(WORD state1[8], const BYTE data1[],
+                                 WORD state2[8], const BYTE data2[],
+                                 size_t nblocks);
+
+static void sha256_blocks_generic(WORD state[8], const BYTE data[],
+                                  size_t nblocks)
 {
 	WORD a, b, c, d, e, f, g, h, i, j, t1, t2, m[64];
 
-	for (i = 0, j = 0; i < 16; ++i, j += 4)
-		m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
-	for ( ; i < 64; ++i)
-		m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
-
-	a = ctx->state[0];
-	b = ctx->state[1];
-	c = ctx->state[2];
-	d = ctx->state[3];
-	e = ctx->state[4];
-	f = ctx->state[5];
-	g = ctx->state[6];
-	h = ctx->state[7];
-
-	for (i = 0; i < 64; ++i) {
-		t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
-		t2 = EP0(a) + MAJ(a,b,c);
-		h = g;
-		g = f;
-		f = e;
-		e = d + t1;
-		d = c;
-		c = b;
-		b = a;
-		a = t1 + t2;
+	for ( ; nblocks > 0; nblocks--, data += 64) {
+		for (i = 0, j = 0; i < 16; ++i, j += 4)
+			m[i] = (data[j] << 24) | (data[j + 1] << 16) | (data[j + 2] << 8) | (data[j + 3]);
+		for ( ; i < 64; ++i)
+			m[i] = SIG1(m[i - 2]) + m[i - 7] + SIG0(m[i - 15]) + m[i - 16];
+
+		a = state[0];
+		b = state[1];
+		c = state[2];
+		d = state[3];
+		e = state[4];
+		f = state[5];
+		g = state[6];
+		h = state[7];
+
+		for (i = 0; i < 64; ++i) {
+			t1 = h + EP1(e) + CH(e,f,g) + k[i] + m[i];
+			t2 = EP0(a) + MAJ(a,b,c);
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+		state[5] += f;
+		state[6] += g;
+		state[7] += h;
 	}
+}
 
-	ctx->state[0] += a;
-	ctx->state[1] += b;
-	ctx->state[2] += c;
-	ctx->state[3] += d;
-	ctx->state[4] += e;
-	ctx->state[5] += f;
-	ctx->state[6] += g;
-	ctx->state[7] += h;
+static void sha256_blocks2_generic(WORD state1[8], const BYTE data1[],
+                                   WORD state2[8], const BYTE data2[],
+                                   size_t nblocks)
+{
+	sha256_blocks_generic(state1, data1, nblocks);
+	sha256_blocks_generic(state2, data2, nblocks);
+}
+
+#ifdef HAVE_SHA256_X86
+/* x86 SHA extensions.  The state is kept as ABEF/CDGH for sha256rnds2.
+ * Each group of four rounds extends the message schedule in place:
+ * W[i] = msg2 (msg1 (W[i-4], W[i-3]) + W[i-1..i-2] >> 32, W[i-1])
+ */
+#define X86_TARGET __attribute__((target("sha,sse4.1,ssse3")))
+
+#define X86_SCHED(m0, m1, m2, m3) \
+	m0 = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m0, m1), \
+	                          _mm_alignr_epi8(m3, m2, 4)), m3)
+
+#define X86_ROUNDS(s0, s1, m, i) do { \
+	__m128i t_ = _mm_add_epi32(m, _mm_loadu_si128((const __m128i *)&k[i])); \
+	s1 = _mm_sha256rnds2_epu32(s1, s0, t_); \
+	t_ = _mm_shuffle_epi32(t_, 0x0E); \
+	s0 = _mm_sha256rnds2_epu32(s0, s1, t_); \
+} while (0)
+
+#define X86_LOAD(m, data, i) \
+	m = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)((data) + (i) * 16)), \
+	                     _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL))
+
+/* Load state[8] as ABEF, CDGH.
+ */
+#define X86_STATE_IN(state, s0, s1) do { \
+	__m128i t_ = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xB1); \
+	s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1B); \
+	s0 = _mm_alignr_epi8(t_, s1, 8); \
+	s1 = _mm_blend_epi16(s1, t_, 0xF0); \
+} while (0)
+
+#define X86_STATE_OUT(state, s0, s1) do { \
+	__m128i t_ = _mm_shuffle_epi32(s0, 0x1B); \
+	s1 = _mm_shuffle_epi32(s1, 0xB1); \
+	s0 = _mm_blend_epi16(t_, s1, 0xF0); \
+	s1 = _mm_alignr_epi8(s1, t_, 8); \
+	_mm_storeu_si128((__m128i *)&state[0], s0); \
+	_mm_storeu_si128((__m128i *)&state[4], s1); \
+} while (0)
+
+/* 64 rounds over message words m0..m3, as 16 groups of four.
+ */
+#define X86_BLOCK(s0, s1, m0, m1, m2, m3, data) do { \
+	X86_LOAD(m0, data, 0); X86_ROUNDS(s0, s1, m0, 0); \
+	X86_LOAD(m1, data, 1); X86_ROUNDS(s0, s1, m1, 4); \
+	X86_LOAD(m2, data, 2); X86_ROUNDS(s0, s1, m2, 8); \
+	X86_LOAD(m3, data, 3); X86_ROUNDS(s0, s1, m3, 12); \
+	X86_SCHED(m0, m1, m2, m3); X86_ROUNDS(s0, s1, m0, 16); \
+	X86_SCHED(m1, m2, m3, m0); X86_ROUNDS(s0, s1, m1, 20); \
+	X86_SCHED(m2, m3, m0, m1); X86_ROUNDS(s0, s1, m2, 24); \
+	X86_SCHED(m3, m0, m1, m2); X86_ROUNDS(s0, s1, m3, 28); \
+	X86_SCHED(m0, m1, m2, m3); X86_ROUNDS(s0, s1, m0, 32); \
+	X86_SCHED(m1, m2, m3, m0); X86_ROUNDS(s0, s1, m1, 36); \
+	X86_SCHED(m2, m3, m0, m1); X86_ROUNDS(s0, s1, m2, 40); \
+	X86_SCHED(m3, m0, m1, m2); X86_ROUNDS(s0, s1, m3, 44); \
+	X86_SCHED(m0, m1, m2, m3); X86_ROUNDS(s0, s1, m0, 48); \
+	X86_SCHED(m1, m2, m3, m0); X86_ROUNDS(s0, s1, m1, 52); \
+	X86_SCHED(m2, m3, m0, m1); X86_ROUNDS(s0, s1, m2, 56); \
+	X86_SCHED(m3, m0, m1, m2); X86_ROUNDS(s0, s1, m3, 60); \
+} while (0)
+
+X86_TARGET
+static void sha256_blocks_x86(WORD state[8], const BYTE data[],
+                              size_t nblocks)
+{
+	__m128i s0, s1, save0, save1, m0, m1, m2, m3;
+
+	X86_STATE_IN(state, s0, s1);
+	for ( ; nblocks > 0; nblocks--, data += 64) {
+		save0 = s0;
+		save1 = s1;
+		X86_BLOCK(s0, s1, m0, m1, m2, m3, data);
+		s0 = _mm_add_epi32(s0, save0);
+		s1 = _mm_add_epi32(s1, save1);
+	}
+	X86_STATE_OUT(state, s0, s1);
+}
+
+/* Two messages are interleaved so that the latency of each sha256rnds2
+ * is hidden behind work on the other message.
+ */
+X86_TARGET
+static void sha256_blocks2_x86(WORD state1[8], const BYTE data1[],
+                               WORD state2[8], const BYTE data2[],
+                               size_t nblocks)
+{
+	__m128i a0, a1, asave0, asave1, am0, am1, am2, am3;
+	__m128i b0, b1, bsave0, bsave1, bm0, bm1, bm2, bm3;
+
+	X86_STATE_IN(state1, a0, a1);
+	X86_STATE_IN(state2, b0, b1);
+	for ( ; nblocks > 0; nblocks--, data1 += 64, data2 += 64) {
+		asave0 = a0;
+		asave1 = a1;
+		bsave0 = b0;
+		bsave1 = b1;
+		X86_LOAD(am0, data1, 0); X86_ROUNDS(a0, a1, am0, 0);
+		X86_LOAD(bm0, data2, 0); X86_ROUNDS(b0, b1, bm0, 0);
+		X86_LOAD(am1, data1, 1); X86_ROUNDS(a0, a1, am1, 4);
+		X86_LOAD(bm1, data2, 1); X86_ROUNDS(b0, b1, bm1, 4);
+		X86_LOAD(am2, data1, 2); X86_ROUNDS(a0, a1, am2, 8);
+		X86_LOAD(bm2, data2, 2); X86_ROUNDS(b0, b1, bm2, 8);
+		X86_LOAD(am3, data1, 3); X86_ROUNDS(a0, a1, am3, 12);
+		X86_LOAD(bm3, data2, 3); X86_ROUNDS(b0, b1, bm3, 12);
+		X86_SCHED(am0, am1, am2, am3); X86_ROUNDS(a0, a1, am0, 16);
+		X86_SCHED(bm0, bm1, bm2, bm3); X86_ROUNDS(b0, b1, bm0, 16);
+		X86_SCHED(am1, am2, am3, am0); X86_ROUNDS(a0, a1, am1, 20);
+		X86_SCHED(bm1, bm2, bm3, bm0); X86_ROUNDS(b0, b1, bm1, 20);
+		X86_SCHED(am2, am3, am0, am1); X86_ROUNDS(a0, a1, am2, 24);
+		X86_SCHED(bm2, bm3, bm0, bm1); X86_ROUNDS(b0, b1, bm2, 24);
+		X86_SCHED(am3, am0, am1, am2); X86_ROUNDS(a0, a1, am3, 28);
+		X86_SCHED(bm3, bm0, bm1, bm2); X86_ROUNDS(b0, b1, bm3, 28);
+		X86_SCHED(am0, am1, am2, am3); X86_ROUNDS(a0, a1, am0, 32);
+		X86_SCHED(bm0, bm1, bm2, bm3); X86_ROUNDS(b0, b1, bm0, 32);
+		X86_SCHED(am1, am2, am3, am0); X86_ROUNDS(a0, a1, am1, 36);
+		X86_SCHED(bm1, bm2, bm3, bm0); X86_ROUNDS(b0, b1, bm1, 36);
+		X86_SCHED(am2, am3, am0, am1); X86_ROUNDS(a0, a1, am2, 40);
+		X86_SCHED(bm2, bm3, bm0, bm1); X86_ROUNDS(b0, b1, bm2, 40);
+		X86_SCHED(am3, am0, am1, am2); X86_ROUNDS(a0, a1, am3, 44);
+		X86_SCHED(bm3, bm0, bm1, bm2); X86_ROUNDS(b0, b1, bm3, 44);
+		X86_SCHED(am0, am1, am2, am3); X86_ROUNDS(a0, a1, am0, 48);
+		X86_SCHED(bm0, bm1, bm2, bm3); X86_ROUNDS(b0, b1, bm0, 48);
+		X86_SCHED(am1, am2, am3, am0); X86_ROUNDS(a0, a1, am1, 52);
+		X86_SCHED(bm1, bm2, bm3, bm0); X86_ROUNDS(b0, b1, bm1, 52);
+		X86_SCHED(am2, am3, am0, am1); X86_ROUNDS(a0, a1, am2, 56);
+		X86_SCHED(bm2, bm3, bm0, bm1); X86_ROUNDS(b0, b1, bm2, 56);
+		X86_SCHED(am3, am0, am1, am2); X86_ROUNDS(a0, a1, am3, 60);
+		X86_SCHED(bm3, bm0, bm1, bm2); X86_ROUNDS(b0, b1, bm3, 60);
+		a0 = _mm_add_epi32(a0, asave0);
+		a1 = _mm_add_epi32(a1, asave1);
+		b0 = _mm_add_epi32(b0, bsave0);
+		b1 = _mm_add_epi32(b1, bsave1);
+	}
+	X86_STATE_OUT(state1, a0, a1);
+	X86_STATE_OUT(state2, b0, b1);
+}
+
+static int sha256_x86_supported(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)
+	    || !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+		return 0;
+	if (__get_cpuid_max(0, NULL) < 7)
+		return 0;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return (ebx & (1 << 29)) != 0; // SHA
+}
+#endif /* HAVE_SHA256_X86 */
+
+#ifdef HAVE_SHA256_ARM
+/* ARMv8 crypto extensions.  The state is kept as ABCD/EFGH.
+ */
+#define ARM_TARGET __attribute__((target("+crypto")))
+
+#define ARM_SCHED(m0, m1, m2, m3) \
+	m0 = vsha256su1q_u32(vsha256su0q_u32(m0, m1), m2, m3)
+
+#define ARM_ROUNDS(s0, s1, m, i) do { \
+	uint32x4_t t_ = vaddq_u32(m, vld1q_u32(&k[i])); \
+	uint32x4_t p_ = s0; \
+	s0 = vsha256hq_u32(s0, s1, t_); \
+	s1 = vsha256h2q_u32(s1, p_, t_); \
+} while (0)
+
+#define ARM_LOAD(m, data, i) \
+	m = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8((data) + (i) * 16)))
+
+ARM_TARGET
+static void sha256_blocks_arm(WORD state[8], const BYTE data[],
+                              size_t nblocks)
+{
+	uint32x4_t s0, s1, save0, save1, m0, m1, m2, m3;
+
+	s0 = vld1q_u32(&state[0]);
+	s1 = vld1q_u32(&state[4]);
+	for ( ; nblocks > 0; nblocks--, data += 64) {
+		save0 = s0;
+		save1 = s1;
+		ARM_LOAD(m0, data, 0); ARM_ROUNDS(s0, s1, m0, 0);
+		ARM_LOAD(m1, data, 1); ARM_ROUNDS(s0, s1, m1, 4);
+		ARM_LOAD(m2, data, 2); ARM_ROUNDS(s0, s1, m2, 8);
+		ARM_LOAD(m3, data, 3); ARM_ROUNDS(s0, s1, m3, 12);
+		ARM_SCHED(m0, m1, m2, m3); ARM_ROUNDS(s0, s1, m0, 16);
+		ARM_SCHED(m1, m2, m3, m0); ARM_ROUNDS(s0, s1, m1, 20);
+		ARM_SCHED(m2, m3, m0, m1); ARM_ROUNDS(s0, s1, m2, 24);
+		ARM_SCHED(m3, m0, m1, m2); ARM_ROUNDS(s0, s1, m3, 28);
+		ARM_SCHED(m0, m1, m2, m3); ARM_ROUNDS(s0, s1, m0, 32);
+		ARM_SCHED(m1, m2, m3, m0); ARM_ROUNDS(s0, s1, m1, 36);
+		ARM_SCHED(m2, m3, m0, m1); ARM_ROUNDS(s0, s1, m2, 40);
+		ARM_SCHED(m3, m0, m1, m2); ARM_ROUNDS(s0, s1, m3, 44);
+		ARM_SCHED(m0, m1, m2, m3); ARM_ROUNDS(s0, s1, m0, 48);
+		ARM_SCHED(m1, m2, m3, m0); ARM_ROUNDS(s0, s1, m1, 52);
+		ARM_SCHED(m2, m3, m0, m1); ARM_ROUNDS(s0, s1, m2, 56);
+		ARM_SCHED(m3, m0, m1, m2); ARM_ROUNDS(s0, s1, m3, 60);
+		s0 = vaddq_u32(s0, save0);
+		s1 = vaddq_u32(s1, save1);
+	}
+	vst1q_u32(&state[0], s0);
+	vst1q_u32(&state[4], s1);
+}
+
+static void sha256_blocks2_arm(WORD state1[8], const BYTE data1[],
+                               WORD state2[8], const BYTE data2[],
+                               size_t nblocks)
+{
+	sha256_blocks_arm(state1, data1, nblocks);
+	sha256_blocks_arm(state2, data2, nblocks);
+}
+
+static int sha256_arm_supported(void)
+{
+	return (getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+#endif /* HAVE_SHA256_ARM */
+
+struct sha256_engine {
+	const char *name;
+	sha256_blocks_f blocks;
+	sha256_blocks2_f blocks2;
+	int (*supported)(void);
+};
+
+static const struct sha256_engine engines[] = {
+#ifdef HAVE_SHA256_X86
+	{ "x86-sha", sha256_blocks_x86, sha256_blocks2_x86, sha256_x86_supported },
+#endif
+#ifdef HAVE_SHA256_ARM
+	{ "armv8-sha2", sha256_blocks_arm, sha256_blocks2_arm, sha256_arm_supported },
+#endif
+	{ "generic", sha256_blocks_generic, sha256_blocks2_generic, NULL },
+};
+
+/* Default to the portable engine until the constructor has run.
+ */
+static const struct sha256_engine *engine = &engines[sizeof(engines) / sizeof(engines[0]) - 1];
+
+__attribute__((constructor))
+static void sha256_engine_init(void)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+		if (!engines[i].supported || engines[i].supported()) {
+			engine = &engines[i];
+			break;
+		}
+	}
+}
+
+const char *sha256_engine_name(void)
+{
+	return engine->name;
+}
+
+int sha256_engine_select(const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+		if (!strcmp(engines[i].name, name)) {
+			if (engines[i].supported && !engines[i].supported())
+				return -1;
+			engine = &engines[i];
+			return 0;
+		}
+	}
+	return -1;
+}
+
+void sha256_transform(SHA256_CTX *ctx, const BYTE data[])
+{
+	engine->blocks(ctx->state, data, 1);
 }
 
 void sha256_init(SHA256_CTX *ctx)
@@ -98,17 +413,33 @@ void sha256_init(SHA256_CTX *ctx)
 
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len)
 {
-	WORD i;
+	size_t n;
 
-	for (i = 0; i < len; ++i) {
-		ctx->data[ctx->datalen] = data[i];
-		ctx->datalen++;
-		if (ctx->datalen == 64) {
-			sha256_transform(ctx, ctx->data);
-			ctx->bitlen += 512;
-			ctx->datalen = 0;
-		}
+	// Top up a partial block first.
+	if (ctx->datalen > 0) {
+		n = 64 - ctx->datalen;
+		if (n > len)
+			n = len;
+		memcpy(ctx->data + ctx->datalen, data, n);
+		ctx->datalen += n;
+		data += n;
+		len -= n;
+		if (ctx->datalen < 64)
+			return;
+		engine->blocks(ctx->state, ctx->data, 1);
+		ctx->bitlen += 512;
+		ctx->datalen = 0;
+	}
+	// Compress whole blocks directly from the input.
+	if ((n = len / 64) > 0) {
+		engine->blocks(ctx->state, data, n);
+		ctx->bitlen += (unsigned long long)n * 512;
+		data += n * 64;
+		len -= n * 64;
 	}
+	// Save the tail for next time.
+	memcpy(ctx->data, data, len);
+	ctx->datalen = len;
 }
 
 void sha256_final(SHA256_CTX *ctx, BYTE hash[])
@@ -127,7 +458,7 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 		ctx->data[i++] = 0x80;
 		while (i < 64)
 			ctx->data[i++] = 0x00;
-		sha256_transform(ctx, ctx->data);
+		engine->blocks(ctx->state, ctx->data, 1);
 		memset(ctx->data, 0, 56);
 	}
 
@@ -141,7 +472,7 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 	ctx->data[58] = ctx->bitlen >> 40;
 	ctx->data[57] = ctx->bitlen >> 48;
 	ctx->data[56] = ctx->bitlen >> 56;
-	sha256_transform(ctx, ctx->data);
+	engine->blocks(ctx->state, ctx->data, 1);
 
 	// Since this implementation uses little endian byte ordering and SHA uses big endian,
 	// reverse all the bytes when copying the final state to the output hash.
@@ -156,3 +487,31 @@ void sha256_final(SHA256_CTX *ctx, BYTE hash[])
 		hash[i + 28] = (ctx->state[7] >> (24 - i * 8)) & 0x000000ff;
 	}
 }
+
+void sha256_multi(const BYTE *data[], const size_t len[],
+                  BYTE hash[][SHA256_BLOCK_SIZE], int count)
+{
+	SHA256_CTX ctx1, ctx2;
+	size_t n;
+	int i;
+
+	// Hash messages in pairs, compressing their common whole blocks together.
+	for (i = 0; i + 1 < count; i += 2) {
+		sha256_init(&ctx1);
+		sha256_init(&ctx2);
+		n = (len[i] < len[i + 1] ? len[i] : len[i + 1]) / 64;
+		if (n > 0) {
+			engine->blocks2(ctx1.state, data[i], ctx2.state, data[i + 1], n);
+			ctx1.bitlen = ctx2.bitlen = (unsigned long long)n * 512;
+		}
+		sha256_update(&ctx1, data[i] + n * 64, len[i] - n * 64);
+		sha256_update(&ctx2, data[i + 1] + n * 64, len[i + 1] - n * 64);
+		sha256_final(&ctx1, hash[i]);
+		sha256_final(&ctx2, hash[i + 1]);
+	}
+	if (i < count) {
+		sha256_init(&ctx1);
+		sha256_update(&ctx1, data[i], len[i]);
+		sha256_final(&ctx1, hash[i]);
+	}
+}
@@ -31,4 +31,17 @@ void sha256_init(SHA256_CTX *ctx);
 void sha256_update(SHA256_CTX *ctx, const BYTE data[], size_t len);
 void sha256_final(SHA256_CTX *ctx, BYTE hash[]);
 
+/* Hash 'count' independent messages data[i], len[i] into hash[i].
+ * Pairs of messages are compressed together where the engine allows it.
+ */
+void sha256_multi(const BYTE *data[], const size_t len[],
+                  BYTE hash[][SHA256_BLOCK_SIZE], int count);
+
+/* The block compression engine is selected at startup by CPU feature
+ * detection.  Return its name ("x86-sha", "armv8-sha2", or "generic"),
+ * or select one by name for testing (returns -1 if not supported).
+ */
+const char *sha256_engine_name(void);
+int sha256_engine_select(const char *name);
+
 #endif   // SHA256_H
@@ -0,0 +1,135 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* bench_sha256.c - SHA-256 throughput benchmark
+ *
+ * Usage: bench_sha256 [seconds]
+ *
+ * Reports MB/s for each supported engine over a range of message sizes,
+ * hashing one message at a time and with sha256_multi().  libsodium's
+ * BLAKE2b (crypto_generichash), the alternate sign-munge hash type,
+ * is included for comparison.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sodium.h>
+
+#include "src/libutil/sha256.h"
+
+#define MULTI_COUNT 8
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static double bench_single (const BYTE *data, size_t len, double seconds)
+{
+    BYTE hash[SHA256_BLOCK_SIZE];
+    SHA256_CTX ctx;
+    double t0 = now ();
+    double t;
+    size_t bytes = 0;
+
+    do {
+        int i;
+        for (i = 0; i < 16; i++) {
+            sha256_init (&ctx);
+            sha256_update (&ctx, data, len);
+            sha256_final (&ctx, hash);
+            bytes += len;
+        }
+    } while ((t = now () - t0) < seconds);
+    return bytes / t / 1E6;
+}
+
+static double bench_blake2b (const BYTE *data, size_t len, double seconds)
+{
+    BYTE hash[crypto_generichash_BYTES];
+    double t0 = now ();
+    double t;
+    size_t bytes = 0;
+
+    do {
+        int i;
+        for (i = 0; i < 16; i++) {
+            crypto_generichash (hash, sizeof (hash), data, len, NULL, 0);
+            bytes += len;
+        }
+    } while ((t = now () - t0) < seconds);
+    return bytes / t / 1E6;
+}
+
+static double bench_multi (const BYTE *data, size_t len, double seconds)
+{
+    BYTE hash[MULTI_COUNT][SHA256_BLOCK_SIZE];
+    const BYTE *datap[MULTI_COUNT];
+    size_t lens[MULTI_COUNT];
+    double t0 = now ();
+    double t;
+    size_t bytes = 0;
+    int i;
+
+    for (i = 0; i < MULTI_COUNT; i++) {
+        datap[i] = data + i * len;
+        lens[i] = len;
+    }
+    do {
+        sha256_multi (datap, lens, hash, MULTI_COUNT);
+        bytes += len * MULTI_COUNT;
+    } while ((t = now () - t0) < seconds);
+    return bytes / t / 1E6;
+}
+
+int main (int argc, char *argv[])
+{
+    const char *engines[] = { "generic", "x86-sha", "armv8-sha2", NULL };
+    const size_t sizes[] = { 64, 256, 1024, 16384, 1048576, 0 };
+    double seconds = argc > 1 ? strtod (argv[1], NULL) : 0.5;
+    BYTE *data;
+    int i, j;
+
+    if (!(data = malloc (sizes[4] * MULTI_COUNT))) {
+        fprintf (stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < sizes[4] * MULTI_COUNT; i++)
+        data[i] = rand () & 0xff;
+
+    printf ("%-12s %9s %12s %12s\n", "engine", "size", "MB/s", "multi MB/s");
+    for (i = 0; engines[i] != NULL; i++) {
+        if (sha256_engine_select (engines[i]) < 0)
+            continue;
+        for (j = 0; sizes[j] != 0; j++) {
+            printf ("%-12s %9zu %12.1f %12.1f\n", engines[i], sizes[j],
+                    bench_single (data, sizes[j], seconds),
+                    bench_multi (data, sizes[j], seconds));
+        }
+    }
+    for (j = 0; sizes[j] != 0; j++) {
+        printf ("%-12s %9zu %12.1f %12s\n", "blake2b", sizes[j],
+                bench_blake2b (data, sizes[j], seconds), "-");
+    }
+    free (data);
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
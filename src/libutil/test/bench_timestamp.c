@@ -0,0 +1,139 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* bench_timestamp.c - ISO 8601 timestamp codec benchmark
+ *
+ * Usage: bench_timestamp [seconds]
+ *
+ * Reports conversions per second for timestamp_tostr() and
+ * timestamp_fromstr(), and for the equivalent gmtime_r/strftime and
+ * strptime/timegm calls, over a spread of times from 1970 to 2100.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "src/libutil/timestamp.h"
+
+#define NTIMES 1024
+
+static time_t times[NTIMES];
+static char strs[NTIMES][TIMESTAMP_STRLEN + 1];
+static volatile time_t sink;
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static int libc_tostr (time_t t, char *buf, int size)
+{
+    struct tm tm;
+    if (t < 0 || !gmtime_r (&t, &tm))
+        return -1;
+    if (strftime (buf, size, "%FT%TZ", &tm) == 0)
+        return -1;
+    return 0;
+}
+
+static int libc_fromstr (const char *s, time_t *tp)
+{
+    struct tm tm;
+    time_t t;
+    if (!strptime (s, "%FT%TZ", &tm))
+        return -1;
+    if ((t = timegm (&tm)) < 0)
+        return -1;
+    if (tp)
+        *tp = t;
+    return 0;
+}
+
+static double bench_tostr (int (*tostr)(time_t t, char *buf, int size),
+                           double seconds)
+{
+    char buf[64];
+    double t0 = now ();
+    double t;
+    long count = 0;
+    int i;
+
+    do {
+        for (i = 0; i < NTIMES; i++) {
+            if (tostr (times[i], buf, sizeof (buf)) < 0)
+                abort ();
+            sink = buf[18];
+        }
+        count += NTIMES;
+    } while ((t = now () - t0) < seconds);
+    return count / t;
+}
+
+static double bench_fromstr (int (*fromstr)(const char *s, time_t *tp),
+                             double seconds)
+{
+    double t0 = now ();
+    double t;
+    time_t val;
+    long count = 0;
+    int i;
+
+    do {
+        for (i = 0; i < NTIMES; i++) {
+            if (fromstr (strs[i], &val) < 0)
+                abort ();
+            sink = val;
+        }
+        count += NTIMES;
+    } while ((t = now () - t0) < seconds);
+    return count / t;
+}
+
+int main (int argc, char *argv[])
+{
+    double seconds = argc > 1 ? strtod (argv[1], NULL) : 1;
+    double fast, libc;
+    int i;
+
+    srand (1);
+    for (i = 0; i < NTIMES; i++) {
+        times[i] = (time_t)((double)rand () / RAND_MAX * 4102444800.);
+        if (timestamp_tostr (times[i], strs[i], sizeof (strs[i])) < 0) {
+            fprintf (stderr, "timestamp_tostr failed\n");
+            return 1;
+        }
+    }
+
+    printf ("%-24s %14s\n", "method", "conv/s");
+    fast = bench_tostr (timestamp_tostr, seconds);
+    libc = bench_tostr (libc_tostr, seconds);
+    printf ("%-24s %14.0f\n", "timestamp_tostr", fast);
+    printf ("%-24s %14.0f\n", "gmtime_r+strftime", libc);
+    printf ("speedup: %.2fx\n", fast / libc);
+
+    fast = bench_fromstr (timestamp_fromstr, seconds);
+    libc = bench_fromstr (libc_fromstr, seconds);
+    printf ("%-24s %14.0f\n", "timestamp_fromstr", fast);
+    printf ("%-24s %14.0f\n", "strptime+timegm", libc);
+    printf ("speedup: %.2fx\n", fast / libc);
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
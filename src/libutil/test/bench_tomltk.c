@@ -0,0 +1,157 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* bench_tomltk.c - TOML to JSON conversion benchmark
+ *
+ * Usage: bench_tomltk [seconds] [pattern]
+ *
+ * Reports passes per second over the files matching pattern (default:
+ * the BurntSushi valid input corpus), parsing each file with tomltk_parse()
+ * alone, then converting it to JSON by tomltk_parse() +
+ * tomltk_table_to_json(), and by tomltk_parse_json().
+ * Files are read into memory first so only parsing is measured.
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <glob.h>
+#include <jansson.h>
+
+#include "src/libtomlc99/toml.h"
+#include "src/libutil/tomltk.h"
+
+struct input {
+    char *buf;
+    int len;
+};
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static int read_file (const char *path, struct input *in)
+{
+    FILE *f;
+    long size;
+
+    if (!(f = fopen (path, "r")))
+        return -1;
+    if (fseek (f, 0, SEEK_END) < 0
+            || (size = ftell (f)) < 0
+            || fseek (f, 0, SEEK_SET) < 0
+            || !(in->buf = malloc (size + 1))
+            || fread (in->buf, 1, size, f) != size) {
+        fclose (f);
+        return -1;
+    }
+    in->len = size;
+    fclose (f);
+    return 0;
+}
+
+static json_t *parse_only (const char *buf, int len)
+{
+    toml_free (tomltk_parse (buf, len, NULL));
+    return NULL;
+}
+
+static json_t *convert_table (const char *buf, int len)
+{
+    toml_table_t *tab;
+    json_t *obj = NULL;
+
+    if ((tab = tomltk_parse (buf, len, NULL))) {
+        obj = tomltk_table_to_json (tab);
+        toml_free (tab);
+    }
+    return obj;
+}
+
+static json_t *convert_direct (const char *buf, int len)
+{
+    return tomltk_parse_json (buf, len, NULL);
+}
+
+static double bench (json_t *(*convert)(const char *buf, int len),
+                     struct input *in, int count, double seconds)
+{
+    double t0 = now ();
+    double t;
+    int passes = 0;
+    int i;
+
+    do {
+        for (i = 0; i < count; i++)
+            json_decref (convert (in[i].buf, in[i].len));
+        passes++;
+    } while ((t = now () - t0) < seconds);
+    return passes / t;
+}
+
+int main (int argc, char *argv[])
+{
+    double seconds = argc > 1 ? strtod (argv[1], NULL) : 1;
+    const char *pattern = argc > 2 ? argv[2]
+                                   : TEST_TOML_INPUT "/valid/*.toml";
+    struct input *in;
+    glob_t gl;
+    size_t bytes = 0;
+    size_t i;
+    double parse, table, direct;
+
+    if (glob (pattern, 0, NULL, &gl) != 0) {
+        fprintf (stderr, "%s: no match\n", pattern);
+        return 1;
+    }
+    if (!(in = calloc (gl.gl_pathc, sizeof (*in)))) {
+        fprintf (stderr, "out of memory\n");
+        return 1;
+    }
+    for (i = 0; i < gl.gl_pathc; i++) {
+        if (read_file (gl.gl_pathv[i], &in[i]) < 0) {
+            fprintf (stderr, "%s: read error\n", gl.gl_pathv[i]);
+            return 1;
+        }
+        bytes += in[i].len;
+    }
+
+    parse = bench (parse_only, in, gl.gl_pathc, seconds);
+    table = bench (convert_table, in, gl.gl_pathc, seconds);
+    direct = bench (convert_direct, in, gl.gl_pathc, seconds);
+
+    printf ("%zu files, %zu bytes\n", gl.gl_pathc, bytes);
+    printf ("%-24s %12s %12s\n", "method", "passes/s", "MB/s");
+    printf ("%-24s %12.1f %12.1f\n", "parse",
+            parse, parse * bytes / 1E6);
+    printf ("%-24s %12.1f %12.1f\n", "parse+table_to_json",
+            table, table * bytes / 1E6);
+    printf ("%-24s %12.1f %12.1f\n", "parse_json",
+            direct, direct * bytes / 1E6);
+    printf ("speedup: %.2fx\n", direct / table);
+
+    for (i = 0; i < gl.gl_pathc; i++)
+        free (in[i].buf);
+    free (in);
+    globfree (&gl);
+    return 0;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
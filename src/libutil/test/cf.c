@@ -99,6 +99,7 @@ void test_basic (void)
     struct cf_error error;
     int rc;
     const char *s;
+    char *dump;
     time_t t;
 
     /* Create a new cf object.  It's type should be table.
@@ -168,6 +169,37 @@ void test_basic (void)
     ok (cf_int64 (cf_get_in (cf2, "subvalue")) == 42,
         "accessed value in table");
 
+    /* Compare with a copy before and after changing a nested value.
+     */
+    if (!(cf_cpy = cf_copy (cf)))
+        BAIL_OUT ("cf_copy failed");
+    ok (cf_equal (cf, cf_cpy) == true,
+        "cf_equal says copy is equal");
+    ok (cf_equal (cf_get_in (cf, "tab"), cf_get_in (cf_cpy, "tab")) == true,
+        "cf_equal says copied sub-table is equal");
+    rc = cf_update (cf_cpy, "[tab]\nsubvalue = 43\n", 20, &error);
+    ok (rc == 0 && cf_equal (cf, cf_cpy) == false,
+        "cf_equal says copy with changed nested value differs");
+    ok (cf_equal (cf_get_in (cf, "ai"), cf_get_in (cf_cpy, "ai")) == true,
+        "cf_equal says unchanged array in copy is still equal");
+    cf_destroy (cf_cpy);
+
+    /* Serialize
+     */
+    if (!(cf_cpy = cf_create ()))
+        BAIL_OUT ("cf_create: %s", strerror (errno));
+    rc = cf_update (cf_cpy, "b = 1\na = [ 2, 3 ]\n", 19, &error);
+    dump = NULL;
+    ok (rc == 0 && (dump = cf_dumps (cf_cpy)) != NULL
+        && !strcmp (dump, "{\"a\":[2,3],\"b\":1}"),
+        "cf_dumps serializes table with sorted keys");
+    free (dump);
+    ok ((dump = cf_dumps (cf_get_in (cf_cpy, "b"))) != NULL
+        && !strcmp (dump, "1"),
+        "cf_dumps serializes a value");
+    free (dump);
+    cf_destroy (cf_cpy);
+
     cf_destroy (cf);
 }
 
@@ -318,6 +350,19 @@ void test_corner (void)
     ok (cf_copy (NULL) == NULL && errno == EINVAL,
         "cf_copy cf=NULL fails with EINVAL");
 
+    /* cf_equal
+     */
+    ok (cf_equal (NULL, NULL) == true,
+        "cf_equal cf1=NULL cf2=NULL returns true");
+    ok (cf_equal (cf_get_in (cf, "nokey"), NULL) == true,
+        "cf_equal with two missing keys returns true");
+
+    /* cf_dumps
+     */
+    errno = 0;
+    ok (cf_dumps (NULL) == NULL && errno == EINVAL,
+        "cf_dumps cf=NULL fails with EINVAL");
+
     /* cf_typeof
      */
     ok (cf_typeof (NULL) == CF_UNKNOWN,
@@ -569,6 +614,123 @@ void test_check (void)
     cf_destroy (cf);
 }
 
+struct bound {
+    int64_t i;
+    double d;
+    const char *s;
+    bool b;
+    time_t ts;
+    uint32_t mask;
+    const cf_t *tab;
+    int64_t opt;
+};
+
+static const char *const bind_names[] = { "red", "green", "blue", NULL };
+
+static const struct cf_option opts_bind[] = {
+    { "i", CF_INT64, true },
+    { "d", CF_DOUBLE, true },
+    { "s", CF_STRING, true },
+    { "b", CF_BOOL, true },
+    { "ts", CF_TIMESTAMP, true },
+    { "colors", CF_ARRAY, true },
+    { "tab", CF_TABLE, true },
+    { "opt", CF_INT64, false },
+    { "extra", CF_STRING, false },
+    CF_OPTIONS_TABLE_END,
+};
+
+static const struct cf_field fields_bind[] = {
+    CF_FIELD ("i", struct bound, i),
+    CF_FIELD ("d", struct bound, d),
+    CF_FIELD ("s", struct bound, s),
+    CF_FIELD ("b", struct bound, b),
+    CF_FIELD ("ts", struct bound, ts),
+    CF_MASK ("colors", struct bound, mask, bind_names),
+    CF_FIELD ("tab", struct bound, tab),
+    CF_FIELD ("opt", struct bound, opt),
+    CF_FIELDS_TABLE_END,
+};
+
+static const struct cf_field fields_undeclared[] = {
+    CF_FIELD ("smurf", struct bound, i),
+    CF_FIELDS_TABLE_END,
+};
+
+void test_bind (void)
+{
+    const char *t = "i = 1\n"
+                    "d = 3.14\n"
+                    "s = \"foo\"\n"
+                    "b = true\n"
+                    "ts = 1979-05-27T07:32:00Z\n"
+                    "colors = [ \"blue\", \"red\" ]\n"
+                    "extra = \"bar\"\n"
+                    "[tab]\n"
+                    "id = 2\n";
+    cf_t *cf;
+    struct cf_error error;
+    struct bound bound;
+    int rc;
+
+    if (!(cf = cf_create ()))
+        BAIL_OUT ("cf_create");
+    if (cf_update (cf, t, strlen (t), NULL) < 0)
+        BAIL_OUT ("cf_update");
+
+    memset (&bound, 0, sizeof (bound));
+    bound.opt = 42;
+    rc = cf_bind (cf, opts_bind, fields_bind, CF_STRICT, &bound, &error);
+    ok (rc == 0,
+        "cf_bind works");
+    cfdiag (rc, "cf_bind", &error);
+    ok (bound.i == 1 && bound.d == 3.14 && bound.b == true,
+        "cf_bind stored int64, double, and bool");
+    ok (bound.s != NULL && !strcmp (bound.s, "foo"),
+        "cf_bind stored string");
+    ok (bound.ts == strtotime ("1979-05-27T07:32:00Z"),
+        "cf_bind stored timestamp");
+    ok (bound.mask == ((1U << 0) | (1U << 2)),
+        "cf_bind stored array of names as mask");
+    ok (bound.tab == cf_get_in (cf, "tab")
+        && cf_int64 (cf_get_in (bound.tab, "id")) == 2,
+        "cf_bind stored table");
+    ok (bound.opt == 42,
+        "cf_bind left missing optional field unchanged");
+
+    t = "colors = [ \"purple\" ]\n";
+    if (cf_update (cf, t, strlen (t), NULL) < 0)
+        BAIL_OUT ("cf_update");
+    errno = 0;
+    rc = cf_bind (cf, opts_bind, fields_bind, CF_STRICT, &bound, &error);
+    ok (rc < 0 && errno == EINVAL,
+        "cf_bind fails with EINVAL on unknown name");
+    cfdiag (rc, "cf_bind", &error);
+
+    t = "colors = [ 1 ]\n";
+    if (cf_update (cf, t, strlen (t), NULL) < 0)
+        BAIL_OUT ("cf_update");
+    errno = 0;
+    rc = cf_bind (cf, opts_bind, fields_bind, CF_STRICT, &bound, &error);
+    ok (rc < 0 && errno == EINVAL,
+        "cf_bind fails with EINVAL on non-string array element");
+    cfdiag (rc, "cf_bind", &error);
+
+    errno = 0;
+    rc = cf_bind (cf, opts_missing, fields_bind, 0, &bound, &error);
+    ok (rc < 0 && errno == EINVAL,
+        "cf_bind fails on missing required key like cf_check");
+    cfdiag (rc, "cf_bind", &error);
+
+    errno = 0;
+    rc = cf_bind (cf, opts_bind, fields_undeclared, 0, &bound, &error);
+    ok (rc < 0 && errno == EINVAL,
+        "cf_bind fails with EINVAL on field not declared in options");
+    cfdiag (rc, "cf_bind", &error);
+
+    cf_destroy (cf);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -579,6 +741,7 @@ int main (int argc, char *argv[])
     test_update_file ();
     test_update_glob ();
     test_check ();
+    test_bind ();
 
     done_testing ();
 }
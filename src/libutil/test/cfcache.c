@@ -0,0 +1,221 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <jansson.h>
+
+#include "src/libtap/tap.h"
+#include "src/libutil/cf.h"
+#include "src/libutil/cfcache.h"
+
+static char dir[PATH_MAX + 1];
+static char pattern[PATH_MAX + 1];
+static char cache[PATH_MAX + 1];
+
+const char *t1 = \
+"i = 1\n" \
+"d = 3.14\n" \
+"s = \"foo\"\n" \
+"b = true\n" \
+"ts = 1979-05-27T07:32:00Z\n" \
+"ai = [ 1, 2, 3]\n" \
+"[tab]\n" \
+"subvalue = 42\n" \
+"[[list]]\n" \
+"name = \"x\"\n" \
+"[[list]]\n" \
+"name = \"y\"\n";
+
+const char *t2 = \
+"[tab2]\n" \
+"str = \"bar\"\n";
+
+static void create_file (const char *name, const char *s)
+{
+    char path[PATH_MAX + 1];
+    FILE *f;
+
+    if (snprintf (path, sizeof (path), "%s/%s", dir, name) >= sizeof (path))
+        BAIL_OUT ("path too long");
+    if (!(f = fopen (path, "w")) || fputs (s, f) < 0 || fclose (f) < 0)
+        BAIL_OUT ("%s: %s", path, strerror (errno));
+}
+
+static void remove_file (const char *name)
+{
+    char path[PATH_MAX + 1];
+
+    if (snprintf (path, sizeof (path), "%s/%s", dir, name) >= sizeof (path))
+        BAIL_OUT ("path too long");
+    (void)unlink (path);
+}
+
+/* Load config from 'pattern' with and without the cache,
+ * and return true if the results are the same.
+ */
+static bool load_check (bool update)
+{
+    struct cf_error error;
+    cf_t *cf;
+    cf_t *ref;
+    bool same;
+
+    if (!(cf = cf_create ()) || !(ref = cf_create ()))
+        BAIL_OUT ("cf_create");
+    if (cf_update_glob (ref, pattern, &error) < 0)
+        BAIL_OUT ("cf_update_glob: %s", error.errbuf);
+    if (cfcache_update_glob (cf, pattern, cache, update, &error) < 0) {
+        diag ("cfcache_update_glob: %s", error.errbuf);
+        same = false;
+    }
+    else
+        same = json_equal (cf, ref);
+    cf_destroy (cf);
+    cf_destroy (ref);
+    return same;
+}
+
+static ino_t cache_ino (void)
+{
+    struct stat sb;
+
+    if (stat (cache, &sb) < 0)
+        return 0;
+    return sb.st_ino;
+}
+
+void test_basic (void)
+{
+    struct stat sb;
+    ino_t ino;
+
+    ok (load_check (false) && cache_ino () == 0,
+        "cfcache_update_glob update=false does not create cache");
+    ok (load_check (true) && (ino = cache_ino ()) != 0,
+        "cfcache_update_glob update=true creates cache");
+    ok (stat (cache, &sb) == 0 && (sb.st_mode & 0777) == 0600,
+        "cache has mode 0600");
+    ok (load_check (true) && cache_ino () == ino,
+        "cached config is the same and cache is not rewritten");
+
+    create_file ("b.toml", t2);
+    ok (load_check (true) && cache_ino () != ino,
+        "new file matching pattern invalidates cache");
+    ino = cache_ino ();
+
+    create_file ("a.toml", "i = 2\n");
+    ok (load_check (true) && cache_ino () != ino,
+        "modified file invalidates cache");
+    ino = cache_ino ();
+
+    remove_file ("b.toml");
+    ok (load_check (true) && cache_ino () != ino,
+        "removed file invalidates cache");
+}
+
+void test_unsafe (void)
+{
+    ino_t ino = cache_ino ();
+
+    if (chmod (cache, 0620) < 0)
+        BAIL_OUT ("chmod: %s", strerror (errno));
+    ok (load_check (true) && cache_ino () != ino,
+        "group writable cache is ignored and replaced");
+
+    ino = cache_ino ();
+    if (chmod (dir, 0770) < 0)
+        BAIL_OUT ("chmod: %s", strerror (errno));
+    ok (load_check (true) && cache_ino () == ino,
+        "cache in group writable directory is ignored and not replaced");
+    if (chmod (dir, 0700) < 0)
+        BAIL_OUT ("chmod: %s", strerror (errno));
+
+    if (truncate (cache, 20) < 0)
+        BAIL_OUT ("truncate: %s", strerror (errno));
+    ok (load_check (true) && cache_ino () != ino,
+        "truncated cache is ignored and replaced");
+
+    unlink (cache);
+    create_file ("cache", "not a cache");
+    ino = cache_ino ();
+    ok (load_check (true) && cache_ino () == ino,
+        "file that is not a cache is not replaced");
+    unlink (cache);
+}
+
+void test_errors (void)
+{
+    struct cf_error error;
+    cf_t *cf;
+    char badpat[PATH_MAX + 1];
+    int rc;
+
+    if (!(cf = cf_create ()))
+        BAIL_OUT ("cf_create");
+
+    if (snprintf (badpat, sizeof (badpat), "%s/*.noexist", dir)
+            >= sizeof (badpat))
+        BAIL_OUT ("path too long");
+    rc = cfcache_update_glob (cf, badpat, cache, true, &error);
+    ok (rc == 0 && cache_ino () == 0,
+        "cfcache_update_glob returns 0 when pattern matches no files");
+
+    create_file ("c.toml", "bad =\n");
+    errno = 0;
+    rc = cfcache_update_glob (cf, pattern, cache, true, &error);
+    ok (rc < 0 && cache_ino () == 0,
+        "cfcache_update_glob fails on bad TOML and creates no cache");
+    diag ("%s: %d: %s", error.filename, error.lineno, error.errbuf);
+    remove_file ("c.toml");
+
+    rc = cfcache_update_glob (cf, pattern, NULL, true, &error);
+    ok (rc == 1,
+        "cfcache_update_glob path=NULL works");
+
+    cf_destroy (cf);
+}
+
+int main (int argc, char *argv[])
+{
+    const char *t = getenv ("TMPDIR");
+
+    plan (NO_PLAN);
+
+    (void)snprintf (dir, sizeof (dir), "%s/cfcache-XXXXXX", t ? t : "/tmp");
+    if (!mkdtemp (dir))
+        BAIL_OUT ("mkdtemp %s: %s", dir, strerror (errno));
+    if (snprintf (pattern, sizeof (pattern), "%s/*.toml", dir)
+            >= sizeof (pattern)
+        || snprintf (cache, sizeof (cache), "%s/cache", dir)
+            >= sizeof (cache))
+        BAIL_OUT ("path too long");
+    create_file ("a.toml", t1);
+
+    test_basic ();
+    test_unsafe ();
+    test_errors ();
+
+    remove_file ("a.toml");
+    if (rmdir (dir) < 0)
+        BAIL_OUT ("rmdir %s: %s", dir, strerror (errno));
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -339,6 +339,12 @@ static void bad_parameters (void)
     errno = 0;
     ok (kv_decode ("foo\0sbar\0\0sfoobar\0", 18) == NULL && errno == EINVAL,
         "kv_decode buf=(empty key entry) fails with EINVAL");
+    errno = 0;
+    ok (kv_decode ("foo\0xbar\0", 9) == NULL && errno == EINVAL,
+        "kv_decode buf=(bad type hint) fails with EINVAL");
+    errno = 0;
+    ok (kv_decode ("foo\0\0", 5) == NULL && errno == EINVAL,
+        "kv_decode buf=(empty value) fails with EINVAL");
 
     kv_destroy (kv);
     kv_destroy (kv2);
@@ -474,6 +480,273 @@ void join_split (void)
     kv_destroy (kv);
 }
 
+/* Exercise the index with enough keys to force it to grow several times,
+ * then delete, update, and round-trip through kv_decode().
+ */
+void many_keys (void)
+{
+    struct kv *kv;
+    struct kv *kv2 = NULL;
+    const char *buf;
+    char key[32];
+    int64_t val;
+    int len;
+    int errors;
+    int i;
+
+    if (!(kv = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    errors = 0;
+    for (i = 0; i < 1000; i++) {
+        snprintf (key, sizeof (key), "key.%d", i);
+        if (kv_put (kv, key, KV_INT64, (int64_t)i) < 0)
+            errors++;
+    }
+    ok (errors == 0,
+        "kv_put of 1000 keys works");
+    errors = 0;
+    for (i = 0; i < 1000; i++) {
+        snprintf (key, sizeof (key), "key.%d", i);
+        if (kv_get (kv, key, KV_INT64, &val) < 0 || val != i)
+            errors++;
+    }
+    ok (errors == 0,
+        "kv_get of 1000 keys works");
+    errno = 0;
+    ok (kv_get (kv, "key.1000", KV_INT64, &val) < 0 && errno == ENOENT,
+        "kv_get of missing key fails with ENOENT");
+
+    errors = 0;
+    for (i = 0; i < 1000; i += 2) {
+        snprintf (key, sizeof (key), "key.%d", i);
+        if (kv_delete (kv, key) < 0)
+            errors++;
+    }
+    for (i = 1; i < 1000; i += 2) {
+        snprintf (key, sizeof (key), "key.%d", i);
+        if (kv_put (kv, key, KV_INT64, (int64_t)i * 2) < 0)
+            errors++;
+    }
+    ok (errors == 0,
+        "kv_delete of even keys and kv_put of odd keys works");
+
+    ok (kv_encode (kv, &buf, &len) == 0 && (kv2 = kv_decode (buf, len)),
+        "kv_decode works");
+    errors = 0;
+    for (i = 0; i < 1000; i++) {
+        snprintf (key, sizeof (key), "key.%d", i);
+        if (i % 2 == 0) {
+            if (kv_get (kv2, key, KV_INT64, &val) == 0)
+                errors++;
+        }
+        else if (kv_get (kv2, key, KV_INT64, &val) < 0 || val != i * 2)
+            errors++;
+    }
+    ok (errors == 0,
+        "decoded object has expected keys");
+    kv_destroy (kv2);
+    kv_destroy (kv);
+
+    /* Duplicate keys in a decoded buffer: first wins, as before,
+     * and deleting it exposes the second.
+     */
+    ok ((kv = kv_decode ("a\0sx\0a\0sy\0", 10)) != NULL,
+        "kv_decode buf=(duplicate key) works");
+    ok (kv && kv_get (kv, "a", KV_STRING, &buf) == 0 && !strcmp (buf, "x"),
+        "kv_get returns first value");
+    ok (kv && kv_delete (kv, "a") == 0
+        && kv_get (kv, "a", KV_STRING, &buf) == 0 && !strcmp (buf, "y"),
+        "kv_delete exposes second value");
+    kv_destroy (kv);
+}
+
+void binary_encoding (void)
+{
+    struct kv *kv;
+    struct kv *kv2;
+    struct kv *kv3;
+    const char *buf;
+    const char *s;
+    int64_t i;
+    double d;
+    bool b;
+    time_t t;
+    time_t now = time (NULL);
+    int len;
+
+    if (!(kv = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    ok (kv_get_encoding (kv) == KV_ENCODING_TEXT,
+        "kv_create uses text encoding");
+    if (kv_put (kv, "s", KV_STRING, "foo") < 0
+        || kv_put (kv, "i", KV_INT64, (int64_t)-42) < 0
+        || kv_put (kv, "d", KV_DOUBLE, 0.5) < 0
+        || kv_put (kv, "b", KV_BOOL, true) < 0
+        || kv_put (kv, "t", KV_TIMESTAMP, now) < 0)
+        BAIL_OUT ("kv_put failed");
+    if (!(kv2 = kv_copy (kv)))
+        BAIL_OUT ("kv_copy failed");
+    ok (kv_set_encoding (kv2, KV_ENCODING_BINARY) == 0
+        && kv_get_encoding (kv2) == KV_ENCODING_BINARY,
+        "kv_set_encoding BINARY works");
+    ok (kv_equal (kv, kv2) && kv_equal (kv2, kv),
+        "binary object is equal to text object");
+    ok (kv_encode (kv2, &buf, &len) == 0 && len > 2
+        && buf[0] == '\0' && buf[1] == 1,
+        "binary encoding starts with zero byte and version");
+    diag_kv (kv2);
+
+    kv3 = kv_decode (buf, len);
+    ok (kv3 != NULL && kv_get_encoding (kv3) == KV_ENCODING_BINARY,
+        "kv_decode recognizes binary encoding");
+    ok (kv_get (kv3, "s", KV_STRING, &s) == 0 && !strcmp (s, "foo")
+        && kv_get (kv3, "i", KV_INT64, &i) == 0 && i == -42
+        && kv_get (kv3, "d", KV_DOUBLE, &d) == 0 && d == 0.5
+        && kv_get (kv3, "b", KV_BOOL, &b) == 0 && b == true
+        && kv_get (kv3, "t", KV_TIMESTAMP, &t) == 0 && t == now,
+        "kv_get of each type works");
+    errno = 0;
+    ok (kv_get (kv3, "i", KV_STRING, &s) < 0 && errno == ENOENT,
+        "kv_get with wrong type fails with ENOENT");
+    ok (kv_put (kv3, "i", KV_INT64, INT64_MAX) == 0
+        && kv_get (kv3, "i", KV_INT64, &i) == 0 && i == INT64_MAX,
+        "kv_put of binary int64 replaces value");
+    ok (kv_put (kv3, "d", KV_DOUBLE, 1.0 / 3) == 0
+        && kv_get (kv3, "d", KV_DOUBLE, &d) == 0 && d == 1.0 / 3,
+        "binary double keeps full precision");
+    ok (kv_delete (kv3, "s") == 0 && kv_get (kv3, "t", KV_TIMESTAMP, &t) == 0
+        && t == now,
+        "kv_delete works with binary values");
+
+    /* binary kv joined into text kv is converted, and vice versa
+     */
+    kv_destroy (kv3);
+    if (!(kv3 = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    ok (kv_join (kv3, kv2, NULL) == 0 && kv_equal (kv3, kv)
+        && kv_get_encoding (kv3) == KV_ENCODING_TEXT,
+        "kv_join of binary into text object converts values");
+    kv_destroy (kv3);
+    ok ((kv3 = kv_split (kv2, "")) != NULL
+        && kv_get_encoding (kv3) == KV_ENCODING_BINARY,
+        "kv_split of binary object is binary");
+    kv_destroy (kv3);
+    ok (kv_set_encoding (kv2, KV_ENCODING_TEXT) == 0
+        && kv_get_encoding (kv2) == KV_ENCODING_TEXT,
+        "kv_set_encoding TEXT works");
+    ok (kv_equal (kv, kv2),
+        "converting back yields original text encoding");
+
+    errno = 0;
+    ok (kv_set_encoding (kv2, 42) < 0 && errno == EINVAL,
+        "kv_set_encoding encoding=42 fails with EINVAL");
+    errno = 0;
+    ok (kv_decode ("\0\2", 2) == NULL && errno == EINVAL,
+        "kv_decode of unknown binary version fails with EINVAL");
+    errno = 0;
+    ok (kv_decode ("\0\1a\0I1234567", 12) == NULL && errno == EINVAL,
+        "kv_decode of truncated binary value fails with EINVAL");
+    errno = 0;
+    ok (kv_decode ("a\0I12345678", 11) == NULL && errno == EINVAL,
+        "kv_decode of binary value in text encoding fails with EINVAL");
+    errno = 0;
+    ok (kv_decode ("\0\1a\0i42\0", 8) == NULL && errno == EINVAL,
+        "kv_decode of text int64 in binary encoding fails with EINVAL");
+    ok ((kv3 = kv_decode ("\0\1", 2)) != NULL && kv_next (kv3, NULL) == NULL,
+        "kv_decode of empty binary object works");
+
+    kv_destroy (kv3);
+    kv_destroy (kv2);
+    kv_destroy (kv);
+}
+
+void views (void)
+{
+    struct kv *kv;
+    struct kv *view;
+    struct kv *kv2 = NULL;
+    const char *buf;
+    const char *key;
+    const char *s;
+    int64_t i;
+    int len;
+    int count;
+
+    if (!(kv = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    if (kv_put (kv, "a.x", KV_STRING, "foo") < 0
+        || kv_put (kv, "a.y", KV_INT64, (int64_t)42) < 0
+        || kv_put (kv, "a.", KV_STRING, "empty") < 0
+        || kv_put (kv, "b.x", KV_STRING, "bar") < 0
+        || kv_encode (kv, &buf, &len) < 0)
+        BAIL_OUT ("kv_put failed");
+
+    view = kv_view (buf, len);
+    ok (view != NULL,
+        "kv_view works");
+    ok (view && kv_equal (view, kv),
+        "view is equal to original");
+    ok (view && kv_encode (view, &s, &len) == 0 && s == buf,
+        "kv_encode of view returns borrowed buffer");
+    ok (view && kv_get (view, "a.y", KV_INT64, &i) == 0 && i == 42,
+        "kv_get works on view");
+    errno = 0;
+    ok (view && kv_put (view, "c", KV_STRING, "baz") < 0 && errno == EROFS,
+        "kv_put on view fails with EROFS");
+    errno = 0;
+    ok (view && kv_delete (view, "a.x") < 0 && errno == EROFS,
+        "kv_delete on view fails with EROFS");
+    errno = 0;
+    ok (view && kv_set_encoding (view, KV_ENCODING_BINARY) < 0
+        && errno == EROFS,
+        "kv_set_encoding on view fails with EROFS");
+    ok (view && (kv2 = kv_copy (view)) != NULL
+        && kv_put (kv2, "c", KV_STRING, "baz") == 0,
+        "kv_copy of view is writable");
+    kv_destroy (kv2);
+
+    count = 0;
+    key = NULL;
+    while ((key = kv_next_prefix (view, "a.", key))) {
+        if (!strcmp (key + 2, "x") || !strcmp (key + 2, "y"))
+            count++;
+        else
+            count = -100;
+    }
+    ok (count == 2,
+        "kv_next_prefix visits matching entries, skipping exact prefix");
+    count = 0;
+    key = NULL;
+    while ((key = kv_next_prefix (view, NULL, key)))
+        count++;
+    ok (count == 4,
+        "kv_next_prefix prefix=NULL visits all entries");
+
+    if (!(kv2 = kv_create ()))
+        BAIL_OUT ("kv_create failed");
+    key = NULL;
+    while ((key = kv_next_prefix (view, "a.", key))) {
+        if (kv_put_entry (kv2, key + 2, key) < 0)
+            break;
+    }
+    ok (kv_get (kv2, "x", KV_STRING, &s) == 0 && !strcmp (s, "foo")
+        && kv_get (kv2, "y", KV_INT64, &i) == 0 && i == 42,
+        "kv_put_entry copies entries");
+    errno = 0;
+    ok (kv_put_entry (kv2, "z", NULL) < 0 && errno == EINVAL,
+        "kv_put_entry entry=NULL fails with EINVAL");
+    kv_destroy (kv2);
+    kv_destroy (view);
+
+    errno = 0;
+    ok (kv_view ("foo\0sbar", 8) == NULL && errno == EINVAL,
+        "kv_view buf=(unterm) fails with EINVAL");
+    ok ((view = kv_view (NULL, 0)) != NULL && kv_next (view, NULL) == NULL,
+        "kv_view of empty buffer works");
+    kv_destroy (view);
+    kv_destroy (kv);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -485,6 +758,9 @@ int main (int argc, char *argv[])
     key_deletion ();
     key_update ();
     join_split ();
+    many_keys ();
+    binary_encoding ();
+    views ();
 
     done_testing ();
 }
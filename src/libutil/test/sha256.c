@@ -14,6 +14,7 @@
 
 /*************************** HEADER FILES ***************************/
 #include <stdio.h>
+#include <stdlib.h>
 #include <memory.h>
 #include <string.h>
 #include "src/libtap/tap.h"
@@ -55,10 +56,112 @@ void sha256_test()
 	    "text3 OK");
 }
 
+static void hash_oneshot(const BYTE *data, size_t len, BYTE *hash)
+{
+	SHA256_CTX ctx;
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, data, len);
+	sha256_final(&ctx, hash);
+}
+
+/* Compare the selected engine against the generic one on random
+ * lengths, fed in random-sized pieces.
+ */
+#define RANDOM_BUFSIZE 4096
+void sha256_random_test(const char *name)
+{
+	static BYTE data[RANDOM_BUFSIZE];
+	BYTE ref[SHA256_BLOCK_SIZE];
+	BYTE buf[SHA256_BLOCK_SIZE];
+	SHA256_CTX ctx;
+	int mismatch = 0;
+	int i;
+
+	srand(42);
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = rand() & 0xff;
+	for (i = 0; i < 200; i++) {
+		size_t len = rand() % sizeof(data);
+		size_t off = 0;
+
+		if (sha256_engine_select("generic") < 0)
+			BAIL_OUT("generic engine not available");
+		hash_oneshot(data, len, ref);
+		if (sha256_engine_select(name) < 0)
+			BAIL_OUT("%s engine not available", name);
+		sha256_init(&ctx);
+		while (off < len) {
+			size_t n = rand() % 150;
+			if (n > len - off)
+				n = len - off;
+			sha256_update(&ctx, data + off, n);
+			off += n;
+		}
+		sha256_final(&ctx, buf);
+		if (memcmp(ref, buf, SHA256_BLOCK_SIZE) != 0)
+			mismatch++;
+	}
+	ok (mismatch == 0,
+	    "%s: incremental hashes of random data match generic engine", name);
+}
+
+#define MULTI_COUNT 7
+void sha256_multi_test(const char *name)
+{
+	static BYTE data[MULTI_COUNT][1000];
+	const BYTE *datap[MULTI_COUNT];
+	size_t len[MULTI_COUNT];
+	BYTE hash[MULTI_COUNT][SHA256_BLOCK_SIZE];
+	BYTE ref[SHA256_BLOCK_SIZE];
+	int mismatch = 0;
+	int i, j;
+
+	if (sha256_engine_select(name) < 0)
+		BAIL_OUT("%s engine not available", name);
+	for (i = 0; i < MULTI_COUNT; i++) {
+		for (j = 0; j < sizeof(data[i]); j++)
+			data[i][j] = rand() & 0xff;
+		datap[i] = data[i];
+		len[i] = rand() % sizeof(data[i]);
+	}
+	len[0] = 0;
+	len[1] = sizeof(data[1]);
+	sha256_multi(datap, len, hash, MULTI_COUNT);
+	for (i = 0; i < MULTI_COUNT; i++) {
+		hash_oneshot(data[i], len[i], ref);
+		if (memcmp(ref, hash[i], SHA256_BLOCK_SIZE) != 0)
+			mismatch++;
+	}
+	ok (mismatch == 0,
+	    "%s: sha256_multi matches individual hashes", name);
+}
+
 int main()
 {
+	const char *engines[] = { "generic", "x86-sha", "armv8-sha2", NULL };
+	const char *def;
+	int i;
+
 	plan (NO_PLAN);
-	sha256_test ();
+
+	def = sha256_engine_name();
+	diag ("default engine is %s", def);
+	for (i = 0; engines[i] != NULL; i++) {
+		if (sha256_engine_select(engines[i]) < 0) {
+			diag ("%s engine is not supported here", engines[i]);
+			continue;
+		}
+		diag ("testing %s engine", engines[i]);
+		sha256_test ();
+		sha256_random_test (engines[i]);
+		sha256_multi_test (engines[i]);
+	}
+	ok (sha256_engine_select("nonexistent") < 0,
+	    "sha256_engine_select of unknown engine fails");
+	ok (sha256_engine_select(def) == 0 && !strcmp(sha256_engine_name(), def),
+	    "default engine restored");
+
 	done_testing ();
 	return(0);
 }
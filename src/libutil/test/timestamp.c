@@ -0,0 +1,241 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "src/libtap/tap.h"
+#include "src/libutil/timestamp.h"
+
+/* Reference implementation using libc.
+ */
+static int libc_tostr (time_t t, char *buf, int size)
+{
+    struct tm tm;
+    if (t < 0 || !gmtime_r (&t, &tm))
+        return -1;
+    if (strftime (buf, size, "%FT%TZ", &tm) == 0)
+        return -1;
+    return 0;
+}
+
+static int libc_fromstr (const char *s, time_t *tp)
+{
+    struct tm tm;
+    time_t t;
+    memset (&tm, 0, sizeof (tm));
+    if (!strptime (s, "%FT%TZ", &tm))
+        return -1;
+    if ((t = timegm (&tm)) < 0)
+        return -1;
+    *tp = t;
+    return 0;
+}
+
+/* Return true if timestamp_tostr() and timestamp_fromstr() agree
+ * with libc for 't'.
+ */
+static bool check_libc (time_t t)
+{
+    char buf[TIMESTAMP_STRLEN + 1];
+    char ref[64];
+    time_t t2, t3;
+
+    if (timestamp_tostr (t, buf, sizeof (buf)) < 0
+            || libc_tostr (t, ref, sizeof (ref)) < 0
+            || strcmp (buf, ref) != 0
+            || timestamp_fromstr (buf, &t2) < 0
+            || libc_fromstr (buf, &t3) < 0
+            || t2 != t || t3 != t) {
+        diag ("%lld: %s != %s", (long long)t, buf, ref);
+        return false;
+    }
+    return true;
+}
+
+static bool fromstr_is (const char *s, time_t expected)
+{
+    time_t t;
+
+    if (timestamp_fromstr (s, &t) < 0)
+        return false;
+    return t == expected;
+}
+
+static bool tostr_is (time_t t, const char *expected)
+{
+    char buf[TIMESTAMP_STRLEN + 1];
+
+    if (timestamp_tostr (t, buf, sizeof (buf)) < 0)
+        return false;
+    return !strcmp (buf, expected);
+}
+
+void test_basic (void)
+{
+    time_t t;
+
+    ok (tostr_is (0, "1970-01-01T00:00:00Z"),
+        "timestamp_tostr 0 works");
+    ok (tostr_is (1061702090, "2003-08-24T05:14:50Z"),
+        "timestamp_tostr 1061702090 works");
+    ok (tostr_is (951782400, "2000-02-29T00:00:00Z"),
+        "timestamp_tostr handles leap day in century leap year");
+    ok (fromstr_is ("1970-01-01T00:00:00Z", 0),
+        "timestamp_fromstr 1970-01-01T00:00:00Z works");
+    ok (fromstr_is ("2003-08-24T05:14:50Z", 1061702090),
+        "timestamp_fromstr 2003-08-24T05:14:50Z works");
+    ok (fromstr_is ("2000-02-29T00:00:00Z", 951782400),
+        "timestamp_fromstr handles leap day in century leap year");
+    ok (fromstr_is ("2016-12-31T23:59:60Z", 1483228800)
+        && libc_fromstr ("2016-12-31T23:59:60Z", &t) == 0 && t == 1483228800,
+        "timestamp_fromstr takes leap second as next minute, like libc");
+    ok (timestamp_fromstr ("2003-08-24T05:14:50Z", NULL) == 0,
+        "timestamp_fromstr tp=NULL works");
+    skip (sizeof (time_t) < 8, 2, "32-bit time_t");
+    ok (tostr_is (253402300799, "9999-12-31T23:59:59Z"),
+        "timestamp_tostr 9999-12-31T23:59:59Z works");
+    ok (fromstr_is ("9999-12-31T23:59:59Z", 253402300799),
+        "timestamp_fromstr 9999-12-31T23:59:59Z works");
+    end_skip;
+}
+
+/* Compare with libc at the last second of every day in 1970-2200,
+ * and at odd intervals through 9999.
+ */
+void test_libc (void)
+{
+    int64_t max = sizeof (time_t) < 8 ? INT32_MAX : 253402300799;
+    int64_t t;
+    int errors;
+
+    errors = 0;
+    for (t = 86399; t < 7289654400 && t <= max && errors < 10; t += 86400) {
+        if (!check_libc (t))
+            errors++;
+    }
+    ok (errors == 0,
+        "every day in 1970-2200 matches libc");
+
+    errors = 0;
+    for (t = 0; t <= max && errors < 10; t += 475177) {
+        if (!check_libc (t))
+            errors++;
+    }
+    ok (errors == 0,
+        "sampled times through 9999 match libc");
+
+    errors = 0;
+    for (t = 0; t < 86400 && errors < 10; t++) {
+        if (!check_libc (t))
+            errors++;
+    }
+    ok (errors == 0,
+        "every second of 1970-01-01 matches libc");
+}
+
+/* The result must not depend on the local timezone.
+ */
+void test_tz (void)
+{
+    char *tz = getenv ("TZ") ? strdup (getenv ("TZ")) : NULL;
+
+    setenv ("TZ", "America/Los_Angeles", 1);
+    tzset ();
+    ok (tostr_is (1061702090, "2003-08-24T05:14:50Z")
+        && fromstr_is ("2003-08-24T05:14:50Z", 1061702090),
+        "timestamp_tostr and timestamp_fromstr ignore TZ");
+    if (tz) {
+        setenv ("TZ", tz, 1);
+        free (tz);
+    }
+    else
+        unsetenv ("TZ");
+    tzset ();
+}
+
+void test_errors (void)
+{
+    const char *bad[] = {
+        "",
+        "2003-08-24T05:14:50",
+        "2003-08-24T05:14:50Zx",
+        "2003-08-24 05:14:50Z",
+        "2003/08/24T05:14:50Z",
+        "2003-8-24T05:14:50Z",
+        "03-08-24T05:14:50Z",
+        " 2003-08-24T05:14:50Z",
+        "20a3-08-24T05:14:50Z",
+        "2003-00-24T05:14:50Z",
+        "2003-13-24T05:14:50Z",
+        "2003-08-00T05:14:50Z",
+        "2003-08-32T05:14:50Z",
+        "2003-04-31T05:14:50Z",
+        "2003-02-29T05:14:50Z",
+        "2100-02-29T05:14:50Z",
+        "2003-08-24T24:14:50Z",
+        "2003-08-24T05:60:50Z",
+        "2003-08-24T05:14:61Z",
+        "1969-12-31T23:59:59Z",
+        "0000-01-01T00:00:00Z",
+        NULL,
+    };
+    char buf[TIMESTAMP_STRLEN + 1];
+    time_t t;
+    int i;
+
+    for (i = 0; bad[i] != NULL; i++) {
+        errno = 0;
+        ok (timestamp_fromstr (bad[i], &t) < 0 && errno == EINVAL,
+            "timestamp_fromstr \"%s\" fails with EINVAL", bad[i]);
+    }
+    errno = 0;
+    ok (timestamp_fromstr (NULL, &t) < 0 && errno == EINVAL,
+        "timestamp_fromstr s=NULL fails with EINVAL");
+
+    errno = 0;
+    ok (timestamp_tostr (-1, buf, sizeof (buf)) < 0 && errno == EINVAL,
+        "timestamp_tostr t=-1 fails with EINVAL");
+    errno = 0;
+    ok (timestamp_tostr (0, buf, sizeof (buf) - 1) < 0 && errno == EINVAL,
+        "timestamp_tostr with short buffer fails with EINVAL");
+    errno = 0;
+    ok (timestamp_tostr (0, NULL, sizeof (buf)) < 0 && errno == EINVAL,
+        "timestamp_tostr buf=NULL fails with EINVAL");
+    skip (sizeof (time_t) < 8, 1, "32-bit time_t");
+    errno = 0;
+    ok (timestamp_tostr (253402300800, buf, sizeof (buf)) < 0
+        && errno == EINVAL,
+        "timestamp_tostr after year 9999 fails with EINVAL");
+    end_skip;
+}
+
+int main (int argc, char *argv[])
+{
+    plan (NO_PLAN);
+
+    test_basic ();
+    test_libc ();
+    test_tz ();
+    test_errors ();
+
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -15,6 +15,8 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <glob.h>
+#include <libgen.h>
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
@@ -51,6 +53,11 @@ const char *bad1 = \
 "'# line 4 <- unbalanced tic\n"
 "# line 5\n";
 
+/* bad value on line 2 */
+const char *bad2 = \
+"a = 1\n" \
+"b = 1979-05-27\n";
+
 static void jdiag (const char *prefix, json_t *obj)
 {
     char *s = json_dumps (obj, JSON_INDENT(2));
@@ -252,6 +259,96 @@ void test_corner (void)
     json_decref (obj);
 }
 
+/* Parse 'path' with tomltk_parse_json() and with tomltk_parse() followed
+ * by tomltk_table_to_json(), and return true if the results agree.
+ * Set *parsed to whether parsing succeeded.
+ */
+static bool parse_json_agrees (const char *path, bool *parsed)
+{
+    toml_table_t *tab;
+    json_t *ref = NULL;
+    json_t *obj;
+    bool same;
+
+    if ((tab = tomltk_parse_file (path, NULL))) {
+        ref = tomltk_table_to_json (tab);
+        toml_free (tab);
+    }
+    obj = tomltk_parse_file_json (path, NULL);
+    same = (!obj && !ref) || (obj && ref && json_equal (obj, ref));
+    *parsed = (obj != NULL);
+    json_decref (obj);
+    json_decref (ref);
+    return same;
+}
+
+static void parse_json_corpus (const char *dir, bool good)
+{
+    char pattern[PATH_MAX + 1];
+    glob_t gl;
+    size_t i;
+
+    snprintf (pattern, sizeof (pattern), "%s/%s/*.toml", TEST_TOML_INPUT, dir);
+    if (glob (pattern, 0, NULL, &gl) != 0)
+        BAIL_OUT ("glob %s failed - test input not found", pattern);
+    for (i = 0; i < gl.gl_pathc; i++) {
+        bool parsed;
+        bool same = parse_json_agrees (gl.gl_pathv[i], &parsed);
+        ok (same && (good || !parsed),
+            "parse_json: %s/%s: %s", dir, basename (gl.gl_pathv[i]),
+            parsed ? "parsed" : "failed");
+    }
+    globfree (&gl);
+}
+
+void test_parse_json (void)
+{
+    const char *input[] = { t1, t2, t3, NULL };
+    struct tomltk_error error;
+    json_t *obj;
+    int i;
+
+    for (i = 0; input[i] != NULL; i++) {
+        toml_table_t *tab;
+        json_t *ref = NULL;
+
+        if (!(tab = tomltk_parse (input[i], strlen (input[i]), NULL))
+                || !(ref = tomltk_table_to_json (tab)))
+            BAIL_OUT ("t%d: parse/convert failed", i + 1);
+        obj = tomltk_parse_json (input[i], strlen (input[i]), NULL);
+        ok (obj != NULL && json_equal (obj, ref),
+            "t%d: tomltk_parse_json result matches tomltk_table_to_json", i + 1);
+        json_decref (obj);
+        json_decref (ref);
+        toml_free (tab);
+    }
+
+    errno = 0;
+    obj = tomltk_parse_json (bad1, strlen (bad1), &error);
+    ok (obj == NULL && errno == EINVAL && error.lineno == 4
+        && !strcmp (error.errbuf, "unterminated s-quote"),
+        "bad1: tomltk_parse_json fails on line 4");
+    errno = 0;
+    obj = tomltk_parse_json (bad2, strlen (bad2), &error);
+    ok (obj == NULL && errno == EINVAL && error.lineno == 2
+        && !strcmp (error.errbuf, "invalid value"),
+        "bad2: tomltk_parse_json fails with invalid value on line 2");
+
+    errno = 0;
+    ok (tomltk_parse_json ("foo", -1, NULL) == NULL  && errno == EINVAL,
+        "tomltk_parse_json len=-1 fails with EINVAL");
+    errno = 0;
+    ok (tomltk_parse_file_json (NULL, NULL) == NULL && errno == EINVAL,
+        "tomltk_parse_file_json filename=NULL fails with EINVAL");
+    errno = 0;
+    ok (tomltk_parse_file_json ("/noexist", &error) == NULL && errno == ENOENT
+        && !strcmp (error.filename, "/noexist"),
+        "tomltk_parse_file_json filename=(noexist) fails with ENOENT");
+
+    parse_json_corpus ("valid", true);
+    parse_json_corpus ("invalid", false);
+}
+
 int main (int argc, char *argv[])
 {
     plan (NO_PLAN);
@@ -262,6 +359,7 @@ int main (int argc, char *argv[])
     test_tojson_t3 ();
     test_parse_lineno ();
     test_corner ();
+    test_parse_json ();
 
     done_testing ();
 }
@@ -0,0 +1,118 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "src/libtap/tap.h"
+#include "src/libutil/sha256.h"
+#include "src/libutil/treehash.h"
+
+/* Straightforward computation of the tree hash as documented in
+ * treehash.h, for comparison.
+ */
+static void reference (const BYTE *data, size_t len, BYTE *hash)
+{
+    SHA256_CTX root;
+    SHA256_CTX leaf;
+    BYTE prefix;
+    BYTE lenbuf[8];
+    BYTE leafhash[SHA256_BLOCK_SIZE];
+    size_t offset = 0;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        lenbuf[i] = ((uint64_t)len >> (8 * i)) & 0xff;
+    prefix = 1;
+    sha256_init (&root);
+    sha256_update (&root, &prefix, 1);
+    sha256_update (&root, lenbuf, 8);
+    do {
+        size_t n = len - offset;
+        if (n > TREEHASH_CHUNK_SIZE)
+            n = TREEHASH_CHUNK_SIZE;
+        prefix = 0;
+        sha256_init (&leaf);
+        sha256_update (&leaf, &prefix, 1);
+        sha256_update (&leaf, data + offset, n);
+        sha256_final (&leaf, leafhash);
+        sha256_update (&root, leafhash, sizeof (leafhash));
+        offset += n;
+    } while (offset < len);
+    sha256_final (&root, hash);
+}
+
+static const size_t sizes[] = {
+    0,
+    1,
+    TREEHASH_CHUNK_SIZE - 1,
+    TREEHASH_CHUNK_SIZE,
+    TREEHASH_CHUNK_SIZE + 1,
+    5 * TREEHASH_CHUNK_SIZE + 123,
+};
+
+static const int threads[] = { 1, 2, 3, 0, 64 };
+
+int main (int argc, char *argv[])
+{
+    size_t maxlen = sizes[sizeof (sizes) / sizeof (sizes[0]) - 1];
+    BYTE *data;
+    BYTE ref[SHA256_BLOCK_SIZE];
+    BYTE hash[SHA256_BLOCK_SIZE];
+    BYTE hash2[SHA256_BLOCK_SIZE];
+    size_t i;
+    int j;
+
+    plan (NO_PLAN);
+
+    if (!(data = malloc (maxlen)))
+        BAIL_OUT ("out of memory");
+    for (i = 0; i < maxlen; i++)
+        data[i] = random () & 0xff;
+
+    for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); i++) {
+        reference (data, sizes[i], ref);
+        for (j = 0; j < sizeof (threads) / sizeof (threads[0]); j++) {
+            memset (hash, 0, sizeof (hash));
+            treehash_sha256 (data, sizes[i], threads[j], hash);
+            ok (memcmp (hash, ref, sizeof (ref)) == 0,
+                "treehash_sha256 len=%zu nthreads=%d matches reference",
+                sizes[i], threads[j]);
+        }
+    }
+
+    /* Changing a byte in the last chunk changes the hash.
+     */
+    treehash_sha256 (data, maxlen, 0, hash);
+    data[maxlen - 1] ^= 1;
+    treehash_sha256 (data, maxlen, 0, hash2);
+    ok (memcmp (hash, hash2, sizeof (hash)) != 0,
+        "treehash_sha256 detects change in last chunk");
+
+    /* Tree hash differs from the plain SHA-256 of the same input.
+     */
+    {
+        SHA256_CTX shx;
+        sha256_init (&shx);
+        sha256_update (&shx, data, 1);
+        sha256_final (&shx, hash2);
+        treehash_sha256 (data, 1, 1, hash);
+        ok (memcmp (hash, hash2, sizeof (hash)) != 0,
+            "treehash_sha256 differs from SHA-256");
+    }
+
+    free (data);
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,281 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <pwd.h>
+
+#include "src/libtap/tap.h"
+#include "src/libutil/sha256.h"
+#include "src/libutil/vcache.h"
+
+#define NSLOTS      4096
+#define NPROC       4
+#define PER_PROC    500
+
+static char tmpdir[PATH_MAX + 1];
+static char path[PATH_MAX + 1];
+
+static void make_key (int n, uint8_t *key)
+{
+    SHA256_CTX shx;
+
+    sha256_init (&shx);
+    sha256_update (&shx, (BYTE *)&n, sizeof (n));
+    sha256_final (&shx, key);
+}
+
+void test_basic (void)
+{
+    struct vcache *vc;
+    struct vcache *vc2;
+    uint8_t key[VCACHE_KEY_SIZE];
+    time_t now = time (NULL);
+
+    vc = vcache_open (path, NSLOTS, geteuid ());
+    ok (vc != NULL,
+        "vcache_open creates cache");
+    make_key (1, key);
+    errno = 0;
+    ok (vcache_lookup (vc, key, 42, "curve", now) < 0 && errno == ENOENT,
+        "vcache_lookup of missing entry fails with ENOENT");
+    ok (vcache_insert (vc, key, 42, "curve", now + 60) == 0,
+        "vcache_insert works");
+    ok (vcache_lookup (vc, key, 42, "curve", now) == 0,
+        "vcache_lookup finds entry");
+    errno = 0;
+    ok (vcache_lookup (vc, key, 43, "curve", now) < 0 && errno == ENOENT,
+        "vcache_lookup with different userid fails");
+    errno = 0;
+    ok (vcache_lookup (vc, key, 42, "munge", now) < 0 && errno == ENOENT,
+        "vcache_lookup with different mechanism fails");
+    errno = 0;
+    ok (vcache_lookup (vc, key, 42, "curve", now + 61) < 0 && errno == ENOENT,
+        "vcache_lookup after expiration fails");
+
+    vc2 = vcache_open (path, NSLOTS, geteuid ());
+    ok (vc2 != NULL && vcache_lookup (vc2, key, 42, "curve", now) == 0,
+        "entry is visible through another mapping");
+    make_key (2, key);
+    ok (vcache_insert (vc2, key, 7, "munge", now + 60) == 0
+        && vcache_lookup (vc, key, 7, "munge", now) == 0,
+        "entry inserted through another mapping is visible");
+    ok (vcache_insert (vc, key, 7, "munge", now + 120) == 0
+        && vcache_lookup (vc2, key, 7, "munge", now + 100) == 0,
+        "vcache_insert updates existing entry");
+    vcache_close (vc2);
+
+    errno = 0;
+    ok (vcache_insert (vc, key, 7, "toolongname", now) < 0 && errno == EINVAL,
+        "vcache_insert with long mechanism name fails with EINVAL");
+    errno = 0;
+    ok (vcache_open (path, NSLOTS * 2, geteuid ()) == NULL && errno == EINVAL,
+        "vcache_open with different slot count fails with EINVAL");
+    errno = 0;
+    ok (vcache_open (NULL, NSLOTS, geteuid ()) == NULL && errno == EINVAL,
+        "vcache_open path=NULL fails with EINVAL");
+    vcache_close (vc);
+}
+
+void test_eviction (void)
+{
+    struct vcache *vc;
+    uint8_t key[VCACHE_KEY_SIZE];
+    time_t now = time (NULL);
+    int found = 0;
+    int i;
+
+    if (!(vc = vcache_open (path, NSLOTS, geteuid ())))
+        BAIL_OUT ("vcache_open: %s", strerror (errno));
+    for (i = 0; i < NSLOTS * 2; i++) {
+        make_key (1000 + i, key);
+        if (vcache_insert (vc, key, i, "curve", now + 60) < 0)
+            break;
+    }
+    ok (i == NSLOTS * 2,
+        "vcache_insert of twice the slot count works");
+    make_key (1000 + NSLOTS * 2 - 1, key);
+    ok (vcache_lookup (vc, key, NSLOTS * 2 - 1, "curve", now) == 0,
+        "most recent entry is found");
+    for (i = 0; i < NSLOTS * 2; i++) {
+        make_key (1000 + i, key);
+        if (vcache_lookup (vc, key, i, "curve", now) == 0)
+            found++;
+    }
+    ok (found > 0 && found <= NSLOTS,
+        "%d of %d entries remain after eviction", found, NSLOTS * 2);
+    vcache_close (vc);
+}
+
+/* Insert from several processes at once.  Every entry that is found
+ * must have been inserted intact.
+ */
+void test_concurrent (void)
+{
+    struct vcache *vc;
+    uint8_t key[VCACHE_KEY_SIZE];
+    time_t now = time (NULL);
+    pid_t pid[NPROC];
+    int found = 0;
+    int bad = 0;
+    int i, j;
+
+    for (i = 0; i < NPROC; i++) {
+        if ((pid[i] = fork ()) < 0)
+            BAIL_OUT ("fork: %s", strerror (errno));
+        if (pid[i] == 0) {
+            if (!(vc = vcache_open (path, NSLOTS, geteuid ())))
+                _exit (1);
+            for (j = 0; j < PER_PROC; j++) {
+                int n = 100000 + i * PER_PROC + j;
+                make_key (n, key);
+                (void)vcache_insert (vc, key, n, "hmac", now + 60);
+            }
+            vcache_close (vc);
+            _exit (0);
+        }
+    }
+    for (i = 0; i < NPROC; i++) {
+        int status;
+        if (waitpid (pid[i], &status, 0) < 0)
+            BAIL_OUT ("waitpid: %s", strerror (errno));
+        if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+            bad++;
+    }
+    ok (bad == 0,
+        "%d processes inserted %d entries each", NPROC, PER_PROC);
+    if (!(vc = vcache_open (path, NSLOTS, geteuid ())))
+        BAIL_OUT ("vcache_open: %s", strerror (errno));
+    for (i = 0; i < NPROC * PER_PROC; i++) {
+        make_key (100000 + i, key);
+        if (vcache_lookup (vc, key, 100000 + i, "hmac", now) == 0)
+            found++;
+        else if (vcache_lookup (vc, key, 100000 + i + 1, "hmac", now) == 0)
+            bad++;
+    }
+    ok (bad == 0 && found > 0,
+        "%d of %d entries found, none corrupted", found, NPROC * PER_PROC);
+    vcache_close (vc);
+}
+
+void test_permissions (void)
+{
+    struct vcache *vc;
+
+    if (chmod (path, 0620) < 0)
+        BAIL_OUT ("chmod: %s", strerror (errno));
+    errno = 0;
+    ok (vcache_open (path, NSLOTS, geteuid ()) == NULL && errno == EPERM,
+        "vcache_open of group writable file fails with EPERM");
+    if (chmod (path, 0600) < 0)
+        BAIL_OUT ("chmod: %s", strerror (errno));
+    ok (unlink (path) == 0 && symlink ("/dev/null", path) == 0,
+        "replaced cache with symlink");
+    errno = 0;
+    ok (vcache_open (path, NSLOTS, geteuid ()) == NULL,
+        "vcache_open does not follow symlink");
+    (void)unlink (path);
+
+    errno = 0;
+    ok (vcache_open (path, NSLOTS, geteuid () + 1) == NULL && errno == ENOENT,
+        "vcache_open of missing cache by a reader fails with ENOENT");
+    if (!(vc = vcache_open (path, NSLOTS, geteuid ())))
+        BAIL_OUT ("vcache_open: %s", strerror (errno));
+    vcache_close (vc);
+    errno = 0;
+    ok (vcache_open (path, NSLOTS, geteuid () + 1) == NULL && errno == EPERM,
+        "vcache_open of cache not owned by writer fails with EPERM");
+    (void)unlink (path);
+}
+
+/* A cache written by root is consumed read-only by another user.
+ */
+void test_shared (void)
+{
+    struct vcache *vc;
+    struct passwd *pw = NULL;
+    uint8_t key[VCACHE_KEY_SIZE];
+    time_t now = time (NULL);
+    pid_t pid;
+    int status;
+
+    skip (geteuid () != 0 || !(pw = getpwnam ("nobody")), 2,
+          "must be root, with a nobody user");
+    if (!(vc = vcache_open (path, NSLOTS, 0)))
+        BAIL_OUT ("vcache_open: %s", strerror (errno));
+    make_key (1, key);
+    if (vcache_insert (vc, key, 42, "curve", now + 60) < 0)
+        BAIL_OUT ("vcache_insert: %s", strerror (errno));
+    if (chmod (tmpdir, 0755) < 0)
+        BAIL_OUT ("chmod: %s", strerror (errno));
+    if ((pid = fork ()) < 0)
+        BAIL_OUT ("fork: %s", strerror (errno));
+    if (pid == 0) {
+        struct vcache *vc2;
+
+        if (setgid (pw->pw_gid) < 0 || setuid (pw->pw_uid) < 0)
+            _exit (1);
+        if (!(vc2 = vcache_open (path, NSLOTS, 0))
+                || vcache_lookup (vc2, key, 42, "curve", now) < 0)
+            _exit (2);
+        make_key (2, key);
+        errno = 0;
+        if (vcache_insert (vc2, key, 42, "curve", now + 60) == 0
+                || errno != EROFS)
+            _exit (3);
+        vcache_close (vc2);
+        _exit (0);
+    }
+    ok (waitpid (pid, &status, 0) == pid
+        && WIFEXITED (status) && WEXITSTATUS (status) == 0,
+        "reader finds root's entry and vcache_insert fails with EROFS");
+    make_key (2, key);
+    ok (vcache_insert (vc, key, 42, "curve", now + 60) == 0,
+        "writer can still insert");
+    vcache_close (vc);
+    (void)unlink (path);
+    end_skip;
+}
+
+int main (int argc, char *argv[])
+{
+    const char *t = getenv ("TMPDIR");
+
+    plan (NO_PLAN);
+
+    (void)snprintf (tmpdir, sizeof (tmpdir), "%s/vcache-XXXXXX",
+                    t ? t : "/tmp");
+    if (!mkdtemp (tmpdir))
+        BAIL_OUT ("mkdtemp %s: %s", tmpdir, strerror (errno));
+    if (snprintf (path, sizeof (path), "%s/cache", tmpdir) >= sizeof (path))
+        BAIL_OUT ("path is too long");
+
+    test_basic ();
+    test_eviction ();
+    test_concurrent ();
+    test_permissions ();
+    test_shared ();
+
+    if (rmdir (tmpdir) < 0)
+        BAIL_OUT ("rmdir %s: %s", tmpdir, strerror (errno));
+    done_testing ();
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
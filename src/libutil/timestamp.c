@@ -8,32 +8,157 @@
  * SPDX-License-Identifier: LGPL-3.0
 \************************************************************/
 
+/* timestamp.c - fixed format ISO 8601 timestamps
+ *
+ * Only "YYYY-MM-DDTHH:MM:SSZ" is handled, so rather than going through
+ * gmtime_r/strftime and strptime/timegm, which consult the locale and
+ * are relatively slow, dates are converted directly to and from a day
+ * count using the proleptic Gregorian calendar.  The day conversions are
+ * the well known days_from_civil() / civil_from_days() algorithms, with
+ * 400 year eras of 146097 days.
+ */
+
 #if HAVE_CONFIG_H
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
 
 #include <time.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
 
 #include "timestamp.h"
 
+#define SECS_PER_DAY    86400
+
+/* 9999-12-31T23:59:59Z
+ */
+#define TIMESTAMP_MAX   INT64_C(253402300799)
+
+/* Days from 0000-03-01 to 1970-01-01.
+ */
+#define EPOCH_OFFSET    719468
+
+static bool is_leap (int y)
+{
+    return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+}
+
+static int days_in_month (int y, int m)
+{
+    static const int mdays[] = { 31, 28, 31, 30, 31, 30,
+                                 31, 31, 30, 31, 30, 31 };
+
+    return (m == 2 && is_leap (y)) ? 29 : mdays[m - 1];
+}
+
+/* Convert y-m-d (y >= 1) to days since 1970-01-01.
+ * Years are counted from March so the leap day falls at the end.
+ */
+static int64_t days_from_civil (int y, int m, int d)
+{
+    int era, yoe, doy, doe;
+
+    y -= m <= 2;
+    era = y / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (int64_t)era * 146097 + doe - EPOCH_OFFSET;
+}
+
+/* Convert days since 1970-01-01 (days >= 0) to y-m-d.
+ */
+static void civil_from_days (int64_t days, int *yp, int *monp, int *dp)
+{
+    int64_t z = days + EPOCH_OFFSET;
+    int era = z / 146097;
+    int doe = z - (int64_t)era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int m = mp < 10 ? mp + 3 : mp - 9;
+
+    *yp = yoe + era * 400 + (m <= 2);
+    *monp = m;
+    *dp = doy - (153 * mp + 2) / 5 + 1;
+}
+
+static inline void put2 (char *p, int v)
+{
+    p[0] = '0' + v / 10;
+    p[1] = '0' + v % 10;
+}
+
+/* Parse 'n' decimal digits at 'p'.  Return value, or -1 on non-digit.
+ */
+static inline int get_digits (const char *p, int n)
+{
+    int v = 0;
+
+    while (n-- > 0) {
+        unsigned int c = (unsigned char)*p++ - '0';
+        if (c > 9)
+            return -1;
+        v = v * 10 + c;
+    }
+    return v;
+}
+
 int timestamp_tostr (time_t t, char *buf, int size)
 {
-    struct tm tm;
-    if (t < 0 || !gmtime_r (&t, &tm))
-        return -1;
-    if (strftime (buf, size, "%FT%TZ", &tm) == 0)
+    int64_t days;
+    int secs;
+    int y, m, d;
+
+    if (t < 0 || (int64_t)t > TIMESTAMP_MAX || !buf
+            || size < TIMESTAMP_STRLEN + 1) {
+        errno = EINVAL;
         return -1;
+    }
+    days = (int64_t)t / SECS_PER_DAY;
+    secs = (int64_t)t % SECS_PER_DAY;
+    civil_from_days (days, &y, &m, &d);
+
+    put2 (buf, y / 100);
+    put2 (buf + 2, y % 100);
+    buf[4] = '-';
+    put2 (buf + 5, m);
+    buf[7] = '-';
+    put2 (buf + 8, d);
+    buf[10] = 'T';
+    put2 (buf + 11, secs / 3600);
+    buf[13] = ':';
+    put2 (buf + 14, secs / 60 % 60);
+    buf[16] = ':';
+    put2 (buf + 17, secs % 60);
+    buf[19] = 'Z';
+    buf[20] = '\0';
     return 0;
 }
 
 int timestamp_fromstr (const char *s, time_t *tp)
 {
-    struct tm tm;
-    time_t t;
-    if (!strptime (s, "%FT%TZ", &tm))
+    int y, m, d, hh, mm, ss;
+    int64_t t;
+
+    if (!s
+            || (y = get_digits (s, 4)) < 1970 || s[4] != '-'
+            || (m = get_digits (s + 5, 2)) < 1 || m > 12 || s[7] != '-'
+            || (d = get_digits (s + 8, 2)) < 1 || d > days_in_month (y, m)
+            || s[10] != 'T'
+            || (hh = get_digits (s + 11, 2)) < 0 || hh > 23 || s[13] != ':'
+            || (mm = get_digits (s + 14, 2)) < 0 || mm > 59 || s[16] != ':'
+            || (ss = get_digits (s + 17, 2)) < 0 || ss > 60
+            || s[19] != 'Z' || s[20] != '\0') {
+        errno = EINVAL;
         return -1;
-    if ((t = timegm (&tm)) < 0)
+    }
+    t = days_from_civil (y, m, d) * SECS_PER_DAY + hh * 3600 + mm * 60 + ss;
+    if (t != (time_t)t) { // 32-bit time_t
+        errno = EOVERFLOW;
         return -1;
+    }
     if (tp)
         *tp = t;
     return 0;
@@ -13,12 +13,21 @@
 
 #include <time.h>
 
+/* Length of a timestamp string, excluding the terminating NULL.
+ */
+#define TIMESTAMP_STRLEN 20
+
 /* Convert time_t (GMT) to ISO 8601 timestamp string,
- * e.g. "2003-08-24T05:14:50Z"
+ * e.g. "2003-08-24T05:14:50Z".  'size' must be at least TIMESTAMP_STRLEN + 1.
+ * 't' must fall within years 1970 through 9999.
+ * Return 0 on success, -1 on failure with errno set.
  */
 int timestamp_tostr (time_t t, char *buf, int size);
 
-/* Convert from ISO 8601 string to time_t.
+/* Convert from ISO 8601 string in exactly the form produced by
+ * timestamp_tostr() to time_t.  Seconds may be 60 (leap second), which
+ * is taken as the first second of the next minute, as timegm(3) does.
+ * Return 0 on success, -1 on failure with errno set.
  */
 int timestamp_fromstr (const char *s, time_t *tp);
 
@@ -12,8 +12,13 @@
 #  include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <time.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
 #include <errno.h>
 #include <string.h>
@@ -339,6 +344,213 @@ toml_table_t *tomltk_parse_file (const char *filename,
     return tab;
 }
 
+/* Builder callbacks for toml_build(), creating jansson objects directly.
+ * N.B. a timestamp is represented as a JSON object, but must be treated
+ * as a value by table_get() and array_last().
+ */
+static int json_kind (json_t *obj)
+{
+    if (json_is_object (obj))
+        return tomltk_json_to_epoch (obj, NULL) == 0 ? 'v' : 't';
+    if (json_is_array (obj))
+        return 'a';
+    return 'v';
+}
+
+static void *b_table_new (void *arg)
+{
+    json_t *obj = json_object ();
+    if (!obj)
+        errno = ENOMEM;
+    return obj;
+}
+
+static void *b_array_new (void *arg)
+{
+    json_t *obj = json_array ();
+    if (!obj)
+        errno = ENOMEM;
+    return obj;
+}
+
+static void *b_value_new (void *arg, const toml_value_t *val)
+{
+    json_t *obj = NULL;
+    time_t t;
+
+    switch (val->type) {
+        case 's':
+            obj = json_string (val->u.s);
+            break;
+        case 'b':
+            obj = val->u.b ? json_true () : json_false ();
+            break;
+        case 'i':
+            obj = json_integer (val->u.i);
+            break;
+        case 'd':
+            obj = json_real (val->u.d);
+            break;
+        case 'T':
+            if (tomltk_ts_to_epoch (val->u.ts, &t) < 0)
+                return NULL;
+            return tomltk_epoch_to_json (t);
+        default: // date or time without the other is unsupported
+            errno = EINVAL;
+            return NULL;
+    }
+    if (!obj)
+        errno = ENOMEM;
+    return obj;
+}
+
+static int b_table_set (void *arg, void *tab, const char *key, void *obj)
+{
+    return json_object_set_new (tab, key, obj);
+}
+
+static int b_array_append (void *arg, void *arr, void *obj)
+{
+    return json_array_append_new (arr, obj);
+}
+
+static int b_table_get (void *arg, void *tab, const char *key, void **obj)
+{
+    json_t *o;
+
+    if (!(o = json_object_get (tab, key)))
+        return 0;
+    *obj = o;
+    return json_kind (o);
+}
+
+static int b_array_last (void *arg, void *arr, void **obj)
+{
+    size_t n = json_array_size (arr);
+    json_t *o;
+
+    if (n == 0 || !(o = json_array_get (arr, n - 1)))
+        return 0;
+    *obj = o;
+    return json_kind (o);
+}
+
+static void b_destroy (void *arg, void *tab)
+{
+    json_decref (tab);
+}
+
+static const toml_builder_t json_builder = {
+    .table_new = b_table_new,
+    .array_new = b_array_new,
+    .value_new = b_value_new,
+    .table_set = b_table_set,
+    .array_append = b_array_append,
+    .table_get = b_table_get,
+    .array_last = b_array_last,
+    .destroy = b_destroy,
+};
+
+/* Parse NULL terminated 'buf' with the JSON builder.
+ */
+static json_t *parse_json (char *buf, const char *filename,
+                           struct tomltk_error *error)
+{
+    char errbuf[200];
+    json_t *obj;
+
+    if (!(obj = toml_build (buf, &json_builder, NULL,
+                            errbuf, sizeof (errbuf)))) {
+        errfromtoml (error, filename, errbuf);
+        errno = EINVAL;
+        return NULL;
+    }
+    return obj;
+}
+
+json_t *tomltk_parse_json (const char *conf, int len,
+                           struct tomltk_error *error)
+{
+    char *cpy;
+    json_t *obj;
+
+    if (len < 0 || (!conf && len != 0)) {
+        errprintf (error, NULL, -1, "invalid argument");
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(cpy = malloc (len + 1))) {
+        errprintf (error, NULL, -1, "out of memory");
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (len > 0)
+        memcpy (cpy, conf, len);
+    cpy[len] = '\0';
+    obj = parse_json (cpy, NULL, error);
+    free (cpy);
+    return obj;
+}
+
+json_t *tomltk_parse_file_json (const char *filename,
+                                struct tomltk_error *error)
+{
+    struct stat sb;
+    char *buf;
+    size_t size = 4096;
+    size_t len = 0;
+    ssize_t n;
+    json_t *obj;
+    int saved_errno;
+    int fd;
+
+    if (!filename) {
+        errprintf (error, NULL, -1, "invalid argument");
+        errno = EINVAL;
+        return NULL;
+    }
+    if ((fd = open (filename, O_RDONLY)) < 0) {
+        errprintf (error, filename, -1, "%s", strerror (errno));
+        return NULL;
+    }
+    /* Size the buffer from fstat, so a regular file is read in one go.
+     */
+    if (fstat (fd, &sb) == 0 && S_ISREG (sb.st_mode) && sb.st_size > 0)
+        size = sb.st_size;
+    if (!(buf = malloc (size + 1)))
+        goto nomem;
+    while ((n = read (fd, buf + len, size - len)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            errprintf (error, filename, -1, "%s", strerror (errno));
+            goto error;
+        }
+        len += n;
+        if (len == size) {
+            char *x;
+            if (!(x = realloc (buf, size * 2 + 1)))
+                goto nomem;
+            buf = x;
+            size *= 2;
+        }
+    }
+    (void)close (fd);
+    buf[len] = '\0';
+    obj = parse_json (buf, filename, error);
+    free (buf);
+    return obj;
+nomem:
+    errprintf (error, filename, -1, "out of memory");
+    errno = ENOMEM;
+error:
+    saved_errno = errno;
+    (void)close (fd);
+    free (buf);
+    errno = saved_errno;
+    return NULL;
+}
+
 /*
  * vi:tabstop=4 shiftwidth=4 expandtab
  */
@@ -63,6 +63,18 @@ toml_table_t *tomltk_parse (const char *conf, int len,
 toml_table_t *tomltk_parse_file (const char *filename,
                                  struct tomltk_error *error);
 
+/* Parse TOML directly to a JSON object, without building a toml_table_t
+ * and converting it with tomltk_table_to_json().  The result is the same,
+ * except that an unconvertible value is reported as a parse error with
+ * its line number.  On success, the object is returned.  On failure NULL
+ * is returned with errno set.  If 'error' is non-NULL, an error description
+ * is written there.
+ */
+json_t *tomltk_parse_json (const char *conf, int len,
+                           struct tomltk_error *error);
+json_t *tomltk_parse_file_json (const char *filename,
+                                struct tomltk_error *error);
+
 #endif /* !_UTIL_TOMLTK_H */
 
 /*
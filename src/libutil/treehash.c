@@ -0,0 +1,148 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "sha256.h"
+#include "treehash.h"
+
+static const BYTE leaf_prefix = 0x00;
+static const BYTE root_prefix = 0x01;
+
+struct tree {
+    const BYTE *data;
+    size_t len;
+    size_t nchunks;
+    BYTE (*leaves)[SHA256_BLOCK_SIZE];
+    size_t next;
+    pthread_mutex_t lock;
+};
+
+static void leaf_hash (const BYTE *data, size_t len, size_t i,
+                       BYTE hash[SHA256_BLOCK_SIZE])
+{
+    size_t offset = i * TREEHASH_CHUNK_SIZE;
+    size_t chunksz = len - offset;
+    SHA256_CTX shx;
+
+    if (chunksz > TREEHASH_CHUNK_SIZE)
+        chunksz = TREEHASH_CHUNK_SIZE;
+    sha256_init (&shx);
+    sha256_update (&shx, &leaf_prefix, 1);
+    sha256_update (&shx, data + offset, chunksz);
+    sha256_final (&shx, hash);
+}
+
+static void root_init (SHA256_CTX *shx, size_t len)
+{
+    BYTE lenbuf[8];
+    uint64_t n = len;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        lenbuf[i] = (n >> (8 * i)) & 0xff;
+    sha256_init (shx);
+    sha256_update (shx, &root_prefix, 1);
+    sha256_update (shx, lenbuf, sizeof (lenbuf));
+}
+
+/* Worker thread: claim the next chunk and hash it, until none are left.
+ */
+static void *leaf_thread (void *arg)
+{
+    struct tree *t = arg;
+    size_t i;
+
+    for (;;) {
+        pthread_mutex_lock (&t->lock);
+        i = t->next < t->nchunks ? t->next++ : t->nchunks;
+        pthread_mutex_unlock (&t->lock);
+        if (i == t->nchunks)
+            break;
+        leaf_hash (t->data, t->len, i, t->leaves[i]);
+    }
+    return NULL;
+}
+
+static int online_cpus (void)
+{
+    long n = sysconf (_SC_NPROCESSORS_ONLN);
+
+    if (n < 1)
+        return 1;
+    return n > TREEHASH_MAX_THREADS ? TREEHASH_MAX_THREADS : n;
+}
+
+/* Hash leaves one at a time directly into the root, without storing them.
+ */
+static void tree_sequential (const BYTE *data, size_t len, size_t nchunks,
+                             BYTE hash[SHA256_BLOCK_SIZE])
+{
+    SHA256_CTX root;
+    BYTE leaf[SHA256_BLOCK_SIZE];
+    size_t i;
+
+    root_init (&root, len);
+    for (i = 0; i < nchunks; i++) {
+        leaf_hash (data, len, i, leaf);
+        sha256_update (&root, leaf, sizeof (leaf));
+    }
+    sha256_final (&root, hash);
+}
+
+void treehash_sha256 (const BYTE *data, size_t len, int nthreads,
+                      BYTE hash[SHA256_BLOCK_SIZE])
+{
+    struct tree t = { .data = data, .len = len };
+    pthread_t tid[TREEHASH_MAX_THREADS - 1];
+    SHA256_CTX root;
+    int started = 0;
+    int i;
+
+    t.nchunks = len > 0 ? (len - 1) / TREEHASH_CHUNK_SIZE + 1 : 1;
+    if (nthreads <= 0)
+        nthreads = online_cpus ();
+    if (nthreads > TREEHASH_MAX_THREADS)
+        nthreads = TREEHASH_MAX_THREADS;
+    if (nthreads > t.nchunks)
+        nthreads = t.nchunks;
+    if (nthreads < 2 || !(t.leaves = calloc (t.nchunks, sizeof (*t.leaves)))) {
+        tree_sequential (data, len, t.nchunks, hash);
+        return;
+    }
+    pthread_mutex_init (&t.lock, NULL);
+    /* If a thread cannot be created, the others (at least the caller)
+     * pick up its share of the chunks.
+     */
+    for (i = 0; i < nthreads - 1; i++) {
+        if (pthread_create (&tid[started], NULL, leaf_thread, &t) == 0)
+            started++;
+    }
+    (void)leaf_thread (&t);
+    for (i = 0; i < started; i++)
+        (void)pthread_join (tid[i], NULL);
+    pthread_mutex_destroy (&t.lock);
+
+    root_init (&root, len);
+    sha256_update (&root, (const BYTE *)t.leaves,
+                   t.nchunks * sizeof (*t.leaves));
+    sha256_final (&root, hash);
+    free (t.leaves);
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,45 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_TREEHASH_H
+#define _UTIL_TREEHASH_H
+
+#include <stddef.h>
+
+#include "sha256.h"
+
+/* Two level SHA-256 tree hash, so large inputs can be hashed in parallel.
+ *
+ * The input is split into TREEHASH_CHUNK_SIZE chunks (the last may be
+ * short, and empty input has one empty chunk).  Each chunk is a leaf:
+ *   leaf[i] = SHA256 (0x00 || chunk[i])
+ * and the digest is:
+ *   root = SHA256 (0x01 || len as 64-bit little endian || leaf[0] || ...)
+ *
+ * The digest depends only on the input, not on the number of threads.
+ */
+
+#define TREEHASH_CHUNK_SIZE     (1024*1024)
+#define TREEHASH_MAX_THREADS    16
+
+/* Compute tree hash of 'data' into 'hash', hashing leaves on up to
+ * 'nthreads' threads including the caller.  If nthreads <= 0, use the
+ * number of online CPUs, capped at TREEHASH_MAX_THREADS.  This cannot
+ * fail: if threads or memory are unavailable, leaves are hashed by the
+ * calling thread.
+ */
+void treehash_sha256 (const BYTE *data, size_t len, int nthreads,
+                      BYTE hash[SHA256_BLOCK_SIZE]);
+
+#endif /* !_UTIL_TREEHASH_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
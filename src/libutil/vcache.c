@@ -0,0 +1,301 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#if HAVE_CONFIG_H
+#  include <config.h>
+#endif /* HAVE_CONFIG_H */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include "vcache.h"
+
+/* File layout: header, then 'nslots' slots, each 64 bytes.
+ * Fields are in host byte order.
+ */
+#define VCACHE_MAGIC    "FLXVC001"
+
+/* An entry may be stored in any of PROBE_MAX slots following the slot
+ * selected by its key.
+ */
+#define PROBE_MAX       8
+
+struct vcache_header {
+    char magic[8];
+    uint32_t nslots;
+    uint32_t slotsize;
+    char pad[48];
+};
+
+struct vcache_slot {
+    uint32_t seq;               // 0=empty, odd=being written
+    uint32_t reserved;
+    int64_t userid;
+    int64_t xtime;
+    uint8_t key[VCACHE_KEY_SIZE];
+    char mech[VCACHE_MECH_MAX + 1];
+};
+
+struct vcache {
+    void *map;
+    size_t size;
+    struct vcache_slot *slots;
+    uint32_t nslots;
+    bool readonly;              // caller is not the trusted writer
+};
+
+void vcache_close (struct vcache *vc)
+{
+    if (vc) {
+        int saved_errno = errno;
+        if (vc->map)
+            (void)munmap (vc->map, vc->size);
+        free (vc);
+        errno = saved_errno;
+    }
+}
+
+/* Initialize a new (empty) file if 'create' is true, or check the header
+ * of an existing one.  The caller holds an exclusive flock if 'create'
+ * is true, otherwise a shared one.
+ */
+static int vcache_init_file (int fd, size_t size, uint32_t nslots,
+                             bool create)
+{
+    struct vcache_header hdr;
+    struct stat sb;
+
+    if (fstat (fd, &sb) < 0)
+        return -1;
+    if (sb.st_size == 0 && create) {
+        memset (&hdr, 0, sizeof (hdr));
+        memcpy (hdr.magic, VCACHE_MAGIC, sizeof (hdr.magic));
+        hdr.nslots = nslots;
+        hdr.slotsize = sizeof (struct vcache_slot);
+        if (ftruncate (fd, size) < 0)
+            return -1;
+        if (pwrite (fd, &hdr, sizeof (hdr), 0) != sizeof (hdr))
+            return -1;
+        return 0;
+    }
+    if (sb.st_size != size
+            || pread (fd, &hdr, sizeof (hdr), 0) != sizeof (hdr)
+            || memcmp (hdr.magic, VCACHE_MAGIC, sizeof (hdr.magic)) != 0
+            || hdr.nslots != nslots
+            || hdr.slotsize != sizeof (struct vcache_slot)) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+struct vcache *vcache_open (const char *path, int nslots, uid_t writer)
+{
+    struct vcache *vc;
+    struct stat sb;
+    int flags = O_CLOEXEC | O_NOFOLLOW;
+    int prot = PROT_READ;
+    int fd;
+    int rc;
+    int saved_errno;
+
+    if (!path || nslots < PROBE_MAX) {
+        errno = EINVAL;
+        return NULL;
+    }
+    if (!(vc = calloc (1, sizeof (*vc))))
+        return NULL;
+    vc->nslots = nslots;
+    vc->size = sizeof (struct vcache_header)
+             + (size_t)nslots * sizeof (struct vcache_slot);
+    vc->readonly = (geteuid () != writer);
+    if (vc->readonly)
+        flags |= O_RDONLY;
+    else {
+        flags |= O_RDWR | O_CREAT;
+        prot |= PROT_WRITE;
+    }
+    if ((fd = open (path, flags, 0644)) < 0)
+        goto error;
+    if (fstat (fd, &sb) < 0)
+        goto error_close;
+    if (!S_ISREG (sb.st_mode) || sb.st_uid != writer
+                              || (sb.st_mode & (S_IWGRP | S_IWOTH))) {
+        errno = EPERM;
+        goto error_close;
+    }
+    if (flock (fd, vc->readonly ? LOCK_SH : LOCK_EX) < 0)
+        goto error_close;
+    rc = vcache_init_file (fd, vc->size, nslots, !vc->readonly);
+    saved_errno = errno;
+    (void)flock (fd, LOCK_UN);
+    if (rc < 0) {
+        errno = saved_errno;
+        goto error_close;
+    }
+    if ((vc->map = mmap (NULL, vc->size, prot, MAP_SHARED,
+                         fd, 0)) == MAP_FAILED) {
+        vc->map = NULL;
+        goto error_close;
+    }
+    (void)close (fd);
+    vc->slots = (struct vcache_slot *)((char *)vc->map
+                                       + sizeof (struct vcache_header));
+    return vc;
+error_close:
+    saved_errno = errno;
+    (void)close (fd);
+    errno = saved_errno;
+error:
+    vcache_close (vc);
+    return NULL;
+}
+
+/* Key is a uniform hash, so use its first bytes to select a slot.
+ */
+static uint32_t key_slot (struct vcache *vc, const uint8_t *key)
+{
+    uint32_t h;
+
+    memcpy (&h, key, sizeof (h));
+    return h % vc->nslots;
+}
+
+/* Copy slot 's' to 'copy' if it holds a complete entry that was not
+ * modified during the copy.  Return sequence number, or 0 if not.
+ */
+static uint32_t slot_read (struct vcache_slot *s, struct vcache_slot *copy)
+{
+    uint32_t seq = __atomic_load_n (&s->seq, __ATOMIC_ACQUIRE);
+
+    if (seq == 0 || (seq & 1))
+        return 0;
+    memcpy (copy, s, sizeof (*copy));
+    __atomic_thread_fence (__ATOMIC_ACQUIRE);
+    if (__atomic_load_n (&s->seq, __ATOMIC_RELAXED) != seq)
+        return 0;
+    return seq;
+}
+
+int vcache_lookup (struct vcache *vc, const uint8_t key[VCACHE_KEY_SIZE],
+                   int64_t userid, const char *mech, time_t now)
+{
+    uint32_t home;
+    int i;
+
+    if (!vc || !key || !mech) {
+        errno = EINVAL;
+        return -1;
+    }
+    home = key_slot (vc, key);
+    for (i = 0; i < PROBE_MAX; i++) {
+        struct vcache_slot copy;
+        struct vcache_slot *s = &vc->slots[(home + i) % vc->nslots];
+
+        if (slot_read (s, &copy) == 0)
+            continue;
+        if (memcmp (copy.key, key, VCACHE_KEY_SIZE) != 0)
+            continue;
+        if (copy.userid != userid
+                || strncmp (copy.mech, mech, sizeof (copy.mech)) != 0
+                || copy.xtime < now)
+            break;
+        return 0;
+    }
+    errno = ENOENT;
+    return -1;
+}
+
+/* Try to claim slot 's' for writing by advancing its sequence number
+ * from 'seq' (even) to odd.  Return true on success.
+ */
+static bool slot_claim (struct vcache_slot *s, uint32_t seq)
+{
+    return __atomic_compare_exchange_n (&s->seq, &seq, seq + 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+int vcache_insert (struct vcache *vc, const uint8_t key[VCACHE_KEY_SIZE],
+                   int64_t userid, const char *mech, time_t xtime)
+{
+    struct vcache_slot *cand[PROBE_MAX];
+    uint32_t candseq[PROBE_MAX];
+    int ncand = 0;
+    int prio = 4;
+    time_t now = time (NULL);
+    uint32_t home;
+    int i;
+
+    if (!vc || !key || !mech || strlen (mech) > VCACHE_MECH_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (vc->readonly) {
+        errno = EROFS;
+        return -1;
+    }
+    /* Prefer, in order: a slot holding this key, an empty slot,
+     * an expired slot.  Otherwise evict any slot in the probe sequence.
+     */
+    home = key_slot (vc, key);
+    for (i = 0; i < PROBE_MAX; i++) {
+        struct vcache_slot *s = &vc->slots[(home + i) % vc->nslots];
+        struct vcache_slot copy;
+        uint32_t seq = __atomic_load_n (&s->seq, __ATOMIC_ACQUIRE);
+        int p;
+
+        if (seq & 1)
+            continue;
+        if (seq == 0)
+            p = 1;
+        else if (slot_read (s, &copy) != seq)
+            continue;
+        else if (memcmp (copy.key, key, VCACHE_KEY_SIZE) == 0)
+            p = 0;
+        else if (copy.xtime < now)
+            p = 2;
+        else
+            p = 3;
+        if (p < prio) {
+            prio = p;
+            ncand = 0;
+        }
+        if (p == prio) {
+            cand[ncand] = s;
+            candseq[ncand++] = seq;
+        }
+    }
+    for (i = 0; i < ncand; i++) {
+        struct vcache_slot *s = cand[i];
+        if (slot_claim (s, candseq[i])) {
+            s->userid = userid;
+            s->xtime = xtime;
+            memcpy (s->key, key, VCACHE_KEY_SIZE);
+            memset (s->mech, 0, sizeof (s->mech));
+            memcpy (s->mech, mech, strlen (mech));
+            __atomic_store_n (&s->seq, candseq[i] + 2, __ATOMIC_RELEASE);
+            return 0;
+        }
+    }
+    errno = EBUSY;
+    return -1;
+}
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
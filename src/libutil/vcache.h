@@ -0,0 +1,71 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+#ifndef _UTIL_VCACHE_H
+#define _UTIL_VCACHE_H
+
+#include <sys/types.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Verification cache - a memory-mapped file, shared by processes on
+ * a node, that records signed envelopes already verified.
+ *
+ * Entries are keyed by a 32 byte digest of the envelope and hold the
+ * userid, the mechanism name (up to VCACHE_MECH_MAX characters), and
+ * the time after which the signature is no longer valid.  The file is
+ * a fixed size open addressed table.  Entries are inserted without locks:
+ * each slot has a sequence number that is odd while the slot is being
+ * written, and readers discard a slot whose sequence changed while they
+ * read it.  Inserts are best effort, and may evict other entries.
+ *
+ * Since an entry lets a verifier skip verification, only one trusted
+ * uid, the 'writer', may write the cache.  The file is only used if it
+ * is a regular file owned by the writer and not writable by group or
+ * other.  Processes running as the writer open it read-write and create
+ * it (mode 0644) if needed.  Others, e.g. a broker or job shell reading a
+ * cache written by the IMP as root, open it read-only and only consume
+ * entries.  A private cache is one whose writer is the caller's own uid.
+ */
+
+#define VCACHE_KEY_SIZE     32
+#define VCACHE_MECH_MAX     7
+
+struct vcache;
+
+/* Open the cache at 'path' written by uid 'writer'.  If the effective uid
+ * is 'writer', open it read-write, creating it with 'nslots' slots if it
+ * does not exist.  Otherwise open it read-only.
+ * Returns cache on success, NULL on failure with errno set:
+ *   EPERM  - file is not owned by 'writer' or has unsafe permissions
+ *   EINVAL - invalid argument, or file is not a cache of 'nslots' slots
+ *   ENOENT - file does not exist and the caller is not 'writer'
+ */
+struct vcache *vcache_open (const char *path, int nslots, uid_t writer);
+void vcache_close (struct vcache *vc);
+
+/* Look up entry for 'key' that matches 'userid' and 'mech' and is still
+ * valid at 'now'.  Returns 0 if found, or -1 with errno = ENOENT.
+ */
+int vcache_lookup (struct vcache *vc, const uint8_t key[VCACHE_KEY_SIZE],
+                   int64_t userid, const char *mech, time_t now);
+
+/* Insert entry, valid until 'xtime'.  Returns 0 on success, or -1 with
+ * errno set (EBUSY if all candidate slots are being written, EROFS if
+ * the caller is not the cache's writer).
+ */
+int vcache_insert (struct vcache *vc, const uint8_t key[VCACHE_KEY_SIZE],
+                   int64_t userid, const char *mech, time_t xtime);
+
+#endif /* !_UTIL_VCACHE_H */
+
+/*
+ * vi:tabstop=4 shiftwidth=4 expandtab
+ */
@@ -0,0 +1,184 @@
+/************************************************************\
+ * Copyright 2018 Lawrence Livermore National Security, LLC
+ * (c.f. AUTHORS, NOTICE.LLNS, COPYING)
+ *
+ * This file is part of the Flux resource manager framework.
+ * For details, see https://github.com/flux-framework.
+ *
+ * SPDX-License-Identifier: LGPL-3.0
+\************************************************************/
+
+/* bench_sign.c - signing mechanism benchmark
+ *
+ * Usage: bench_sign [-b] [-n count] [-s size] mech ...
+ *
+ * For each mechanism, sign 'count' messages with 'size' byte payloads
+ * (default 1000 x 1024), then verify each of them, and report operations
+ * per second.  With -b, sign and verify them in a single batch each.
+ * Configuration is loaded from FLUX_IMP_CONFIG_PATTERN, and each mechanism
+ * must be listed in allowed-types.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <unistd.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdbool.h>
+
+#include "src/lib/context.h"
+#include "src/lib/sign.h"
+
+const char *prog = "bench_sign";
+
+static void die (const char *fmt, ...)
+{
+    va_list ap;
+    char buf[256];
+
+    va_start (ap, fmt);
+    (void)vsnprintf (buf, sizeof (buf), fmt, ap);
+    va_end (ap);
+    fprintf (stderr, "%s: %s\n", prog, buf);
+    exit (1);
+}
+
+static void usage (void)
+{
+    die ("Usage: bench_sign [-b] [-n count] [-s size] mech ...");
+}
+
+static double now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static void bench (flux_security_t *ctx, const char *mech,
+                   const char *payload, int size, int count)
+{
+    char **msgs;
+    double t0;
+    double tsign;
+    double tverify;
+    int i;
+
+    if (!(msgs = calloc (count, sizeof (msgs[0]))))
+        die ("out of memory");
+    t0 = now ();
+    for (i = 0; i < count; i++) {
+        const char *s;
+        if (!(s = flux_sign_wrap (ctx, payload, size, mech, 0)))
+            die ("flux_sign_wrap: %s", flux_security_last_error (ctx));
+        if (!(msgs[i] = strdup (s)))
+            die ("out of memory");
+    }
+    tsign = now () - t0;
+    t0 = now ();
+    for (i = 0; i < count; i++) {
+        if (flux_sign_unwrap (ctx, msgs[i], NULL, NULL, NULL, 0) < 0)
+            die ("flux_sign_unwrap: %s", flux_security_last_error (ctx));
+    }
+    tverify = now () - t0;
+    printf ("%-8s %12.0f %12.0f\n", mech, count / tsign, count / tverify);
+    for (i = 0; i < count; i++)
+        free (msgs[i]);
+    free (msgs);
+}
+
+static void bench_batch (flux_security_t *ctx, const char *mech,
+                         const char *payload, int size, int count)
+{
+    struct flux_sign_batch_item *items;
+    char **msgs;
+    double t0;
+    double tsign;
+    double tverify;
+    int i;
+
+    if (!(items = calloc (count, sizeof (items[0])))
+            || !(msgs = calloc (count, sizeof (msgs[0]))))
+        die ("out of memory");
+    for (i = 0; i < count; i++) {
+        items[i].payload = payload;
+        items[i].payloadsz = size;
+    }
+    t0 = now ();
+    if (flux_sign_wrap_batch (ctx, items, count, mech, 0) < 0)
+        die ("flux_sign_wrap_batch: %s", flux_security_last_error (ctx));
+    tsign = now () - t0;
+    for (i = 0; i < count; i++) {
+        if (!(msgs[i] = strdup (items[i].input)))
+            die ("out of memory");
+    }
+    memset (items, 0, count * sizeof (items[0]));
+    for (i = 0; i < count; i++)
+        items[i].input = msgs[i];
+    t0 = now ();
+    if (flux_sign_unwrap_batch (ctx, items, count, 0) < 0)
+        die ("flux_sign_unwrap_batch: %s", flux_security_last_error (ctx));
+    tverify = now () - t0;
+    printf ("%-8s %12.0f %12.0f\n", mech, count / tsign, count / tverify);
+    for (i = 0; i < count; i++)
+        free (msgs[i]);
+    free (msgs);
+    free (items);
+}
+
+int main (int argc, char **argv)
+{
+    flux_security_t *ctx;
+    int count = 1000;
+    int size = 1024;
+    bool batch = false;
+    char *payload;
+    int ch;
+
+    while ((ch = getopt (argc, argv, "bn:s:")) != -1) {
+        switch (ch) {
+            case 'b':
+                batch = true;
+                break;
+            case 'n':
+                count = strtol (optarg, NULL, 10);
+                break;
+            case 's':
+                size = strtol (optarg, NULL, 10);
+                break;
+            default:
+                usage ();
+        }
+    }
+    if (optind == argc || count < 1 || size < 0)
+        usage ();
+
+    if (!(ctx = flux_security_create (0)))
+        die ("flux_security_create");
+    if (flux_security_configure (ctx, getenv ("FLUX_IMP_CONFIG_PATTERN")) < 0)
+        die ("flux_security_configure: %s", flux_security_last_error (ctx));
+    if (!(payload = malloc (size + 1)))
+        die ("out of memory");
+    memset (payload, 'x', size);
+
+    printf ("%-8s %12s %12s\n", "mech", "sign/s", "verify/s");
+    for (; optind < argc; optind++) {
+        if (batch)
+            bench_batch (ctx, argv[optind], payload, size, count);
+        else
+            bench (ctx, argv[optind], payload, size, count);
+    }
+
+    free (payload);
+    flux_security_destroy (ctx);
+    return 0;
+}
+
+/* vi: ts=4 sw=4 expandtab
+ */
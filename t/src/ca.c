@@ -113,7 +113,7 @@ static void verify (const char *path)
         die ("ca_load: %s", error);
     if (!(cert = sigcert_load (path, false)))
         die ("sigcert_load: %s", strerror (errno));
-    if (ca_verify (ca, cert, &userid, NULL, error) < 0)
+    if (ca_verify (ca, cert, &userid, NULL, NULL, error) < 0)
         die ("ca_verify: %s", error);
     printf ("%lld\n", (long long)userid);
     sigcert_destroy (cert);
@@ -40,24 +40,35 @@ static void die (const char *fmt, ...)
     exit (1);
 }
 
-static int read_all (void *buf, int bufsz)
+/* Read stdin to EOF into a buffer that the caller must free.
+ * The buffer is NULL-terminated (not included in returned count).
+ */
+static int read_all (char **bufp)
 {
-    int n;
+    char *buf = NULL;
+    int bufsz = 0;
     int count = 0;
+    int n;
+
     do {
-        if ((n = read (STDIN_FILENO, (char *)buf + count, bufsz - count)) < 0)
+        if (count + 1 >= bufsz) {
+            bufsz = bufsz ? bufsz * 2 : 8192;
+            if (!(buf = realloc (buf, bufsz)))
+                die ("out of memory");
+        }
+        if ((n = read (STDIN_FILENO, buf + count, bufsz - count - 1)) < 0)
             die ("read stdin: %s", strerror (errno));
         count += n;
-    } while (n > 0 && count < bufsz);
-    if (n > 0)
-        die ("input buffer exceeded");
+    } while (n > 0);
+    buf[count] = '\0';
+    *bufp = buf;
     return count;
 }
 
 int main (int argc, char **argv)
 {
     flux_security_t *ctx;
-    char buf[1024];
+    char *buf;
     int buflen;
     const char *msg;
 
@@ -69,13 +80,14 @@ int main (int argc, char **argv)
     if (flux_security_configure (ctx, getenv ("FLUX_IMP_CONFIG_PATTERN")) < 0)
         die ("flux_security_configure: %s", flux_security_last_error (ctx));
 
-    buflen = read_all (buf, sizeof (buf));
+    buflen = read_all (&buf);
 
     if (!(msg = flux_sign_wrap (ctx, buf, buflen, NULL, 0)))
         die ("flux_sign_wrap: %s", flux_security_last_error (ctx));
 
     printf ("%s\n", msg);
 
+    free (buf);
     flux_security_destroy (ctx);
 
     return 0;
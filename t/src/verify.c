@@ -41,25 +41,37 @@ static void die (const char *fmt, ...)
     exit (1);
 }
 
-static int read_all (void *buf, int bufsz)
+/* Read stdin to EOF into a buffer that the caller must free.
+ * The buffer is NULL-terminated (not included in returned count).
+ */
+static int read_all (char **bufp)
 {
-    int n;
+    char *buf = NULL;
+    int bufsz = 0;
     int count = 0;
+    int n;
+
     do {
-        if ((n = read (STDIN_FILENO, (char *)buf + count, bufsz - count)) < 0)
+        if (count + 1 >= bufsz) {
+            bufsz = bufsz ? bufsz * 2 : 8192;
+            if (!(buf = realloc (buf, bufsz)))
+                die ("out of memory");
+        }
+        if ((n = read (STDIN_FILENO, buf + count, bufsz - count - 1)) < 0)
             die ("read stdin: %s", strerror (errno));
         count += n;
-    } while (n > 0 && count < bufsz);
-    if (n > 0)
-        die ("input buffer exceeded");
+    } while (n > 0);
+    buf[count] = '\0';
+    *bufp = buf;
     return count;
 }
 
 int main (int argc, char **argv)
 {
     flux_security_t *ctx;
-    char buf[8192];
-    int buflen;
+    char *buf;
+    char *line;
+    char *saveptr = NULL;
     int64_t userid;
     const char *payload;
     int payloadsz;
@@ -72,19 +84,27 @@ int main (int argc, char **argv)
     if (flux_security_configure (ctx, getenv ("FLUX_IMP_CONFIG_PATTERN")) < 0)
         die ("flux_security_configure: %s", flux_security_last_error (ctx));
 
-    buflen = read_all (buf, sizeof (buf) - 1);
-    buf[buflen] = '\0';
-    while (buflen > 0 && isspace (buf[buflen - 1]))
-        buf[--buflen] = '\0';
-
-    if (flux_sign_unwrap (ctx, buf, (const void **)&payload, &payloadsz,
-                          &userid, 0) < 0)
-        die ("flux_sign_unwrap: %s", flux_security_last_error (ctx));
-
-    fwrite (payload, payloadsz, 1, stdout);
-    if (ferror (stdout))
-        die ("write stdout failed");
+    (void)read_all (&buf);
 
+    /* Each line of input is a signed message, verified in turn with the
+     * same context.
+     */
+    line = strtok_r (buf, "\n", &saveptr);
+    do {
+        int len = line ? strlen (line) : 0;
+        while (len > 0 && isspace (line[len - 1]))
+            line[--len] = '\0';
+        if (flux_sign_unwrap (ctx, line ? line : "",
+                              (const void **)&payload, &payloadsz,
+                              &userid, 0) < 0)
+            die ("flux_sign_unwrap: %s", flux_security_last_error (ctx));
+
+        fwrite (payload, payloadsz, 1, stdout);
+        if (ferror (stdout))
+            die ("write stdout failed");
+    } while ((line = strtok_r (NULL, "\n", &saveptr)));
+
+    free (buf);
     flux_security_destroy (ctx);
 
     return 0;
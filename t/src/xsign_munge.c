@@ -28,10 +28,13 @@
 
 #include "src/libutil/kv.h"
 #include "src/libutil/sha256.h"
+#include "src/libutil/treehash.h"
 
 enum {
     HASH_TYPE_INVALID = 0,
     HASH_TYPE_SHA256 = 1,
+    HASH_TYPE_BLAKE2B = 2,
+    HASH_TYPE_TREE_SHA256 = 3,
     HASH_TYPE_BOGUS = 42,
 };
 
@@ -115,10 +118,23 @@ static char *make_signature (munge_ctx_t munge, const char *headerpayload,
     munge_err_t e;
 
     digest[0] = hashtype;
-    sha256_init (&shx);
-    sha256_update (&shx, (const BYTE *)headerpayload,
-                   strlen (headerpayload) - truncate_hash);
-    sha256_final (&shx, digest + 1);
+    if (hashtype == HASH_TYPE_BLAKE2B) {
+        crypto_generichash (digest + 1, SHA256_BLOCK_SIZE,
+                            (const BYTE *)headerpayload,
+                            strlen (headerpayload) - truncate_hash,
+                            NULL, 0);
+    }
+    else if (hashtype == HASH_TYPE_TREE_SHA256) {
+        treehash_sha256 ((const BYTE *)headerpayload,
+                         strlen (headerpayload) - truncate_hash,
+                         1, digest + 1);
+    }
+    else {
+        sha256_init (&shx);
+        sha256_update (&shx, (const BYTE *)headerpayload,
+                       strlen (headerpayload) - truncate_hash);
+        sha256_final (&shx, digest + 1);
+    }
     if (change_hash)
         digest[1]++;
     e = munge_encode (&cred, munge, digest, sizeof (digest));
@@ -183,13 +199,22 @@ int main (int argc, char **argv)
     char *msg = NULL;
 
     if (argc != 2)
-        die ("Usage: xsign_munge {good|xuser|xhashtype|xhashtrun|xhashchg|xpaychg|xcredchg} <input >output");
+        die ("Usage: xsign_munge {good|blake2b|tree|xuser|xhashtype|xhashtrun|xhashchg|xpaychg|xblake2bpaychg|xcredchg} <input >output");
 
     buflen = read_all (buf, sizeof (buf));
 
     if (!strcmp (argv[1], "good"))
         msg = test_sign_wrap (buf, buflen, getuid (), HASH_TYPE_SHA256,
                               0, false, false, false);
+    else if (!strcmp (argv[1], "blake2b"))
+        msg = test_sign_wrap (buf, buflen, getuid (), HASH_TYPE_BLAKE2B,
+                              0, false, false, false);
+    else if (!strcmp (argv[1], "tree"))
+        msg = test_sign_wrap (buf, buflen, getuid (), HASH_TYPE_TREE_SHA256,
+                              0, false, false, false);
+    else if (!strcmp (argv[1], "xblake2bpaychg"))
+        msg = test_sign_wrap (buf, buflen, getuid (), HASH_TYPE_BLAKE2B,
+                              0, false, true, false);
     else if (!strcmp (argv[1], "xuser"))
         msg = test_sign_wrap (buf, buflen, getuid () + 1, HASH_TYPE_SHA256,
                               0, false, false, false);
@@ -18,4 +18,10 @@ basedir=${SHARNESS_BUILD_DIRECTORY}/src
 test_expect_success SUDO 'privsep unit tests' '
 	sudo $basedir/imp/test_privsep.t
 '
+test_expect_success SUDO 'sigagent unit tests' '
+	sudo $basedir/libca/test_sigagent.t
+'
+test_expect_success SUDO 'vcache unit tests' '
+	sudo $basedir/libutil/test_vcache.t
+'
 test_done
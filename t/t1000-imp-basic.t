@@ -35,6 +35,24 @@ test_expect_success 'Bad IMP config generates error' '
 	  test_must_fail $flux_imp version 2>bad-config.error ) &&
 	grep "loading config: bad.toml: 1: syntax error" bad-config.error
 '
+test_expect_success 'FLUX_IMP_CONFIG_CACHE creates config cache' '
+	mkdir -m 0700 cachedir &&
+	echo "allow-sudo = false" > cached.toml &&
+	FLUX_IMP_CONFIG_PATTERN=cached.toml \
+	  FLUX_IMP_CONFIG_CACHE=cachedir/imp.cache $flux_imp version &&
+	test -f cachedir/imp.cache
+'
+test_expect_success 'config cache is used while config is unchanged' '
+	FLUX_IMP_CONFIG_PATTERN=cached.toml \
+	  FLUX_IMP_CONFIG_CACHE=cachedir/imp.cache $flux_imp version
+'
+test_expect_success 'modified config invalidates config cache' '
+	echo "bad =" > cached.toml &&
+	( export FLUX_IMP_CONFIG_PATTERN=cached.toml &&
+	  export FLUX_IMP_CONFIG_CACHE=cachedir/imp.cache &&
+	  test_must_fail $flux_imp version 2>cached-config.error ) &&
+	grep "loading config: cached.toml: 1: syntax error" cached-config.error
+'
 test_expect_success SUDO 'flux-imp version works under sudo' '
 	sudo $flux_imp version | grep "flux-imp v"
 '
@@ -30,6 +30,7 @@ fi
 sign=${SHARNESS_BUILD_DIRECTORY}/t/src/sign
 xsign=${SHARNESS_BUILD_DIRECTORY}/t/src/xsign_munge
 verify=${SHARNESS_BUILD_DIRECTORY}/t/src/verify
+bench_sign=${SHARNESS_BUILD_DIRECTORY}/t/src/bench_sign
 export FLUX_IMP_CONFIG_PATTERN=${SHARNESS_TRASH_DIRECTORY}/sign.toml
 
 
@@ -67,6 +68,19 @@ test_expect_success 'sign/verify a short message' '
 	test_cmp sign.in verify.out
 '
 
+test_expect_success 'verify the same message twice in one context' '
+	cat sign.out sign.out | ${verify} >twice.out &&
+	cat sign.in sign.in >twice.exp &&
+	test_cmp twice.exp twice.out
+'
+
+test_expect_success 'altered payload with cached munge cred fails verify' '
+	sed -e "s/SGVsbG8K/SmVsbG8K/" sign.out >altered.out &&
+	! cmp -s sign.out altered.out &&
+	cat sign.out altered.out | test_must_fail ${verify} 2>altered.err &&
+	grep -q "hash mismatch" altered.err
+'
+
 test_expect_success 'verify a hand-created test message' '
 	${xsign} good </dev/null >good.out &&
 	${verify} <good.out
@@ -108,6 +122,147 @@ test_expect_success 'message with altered munge cred fails verify' '
 	grep -q "munge_decode" xcredchg.err
 '
 
+test_expect_success 'verify a hand-created BLAKE2B test message' '
+	${xsign} blake2b </dev/null >blake2b.out &&
+	${verify} <blake2b.out
+'
+
+test_expect_success 'BLAKE2B message with altered payload fails verify' '
+	${xsign} xblake2bpaychg </dev/null >xblake2bpaychg.out &&
+	test_must_fail ${verify} <xblake2bpaychg.out 2>xblake2bpaychg.err &&
+	grep -q "BLAKE2B hash mismatch" xblake2bpaychg.err
+'
+
+test_expect_success 'create sign.toml with hash-type = blake2b' '
+	cat >sign.toml <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "munge"
+	allowed-types = [ "munge" ]
+	[sign.munge]
+	socket-path = "${MUNGE_SOCKET}"
+	hash-type = "blake2b"
+	EOT
+'
+
+test_expect_success 'sign/verify a short message with BLAKE2B' '
+	echo Hello >b2sign.in &&
+	${sign} <b2sign.in >b2sign.out &&
+	${verify} <b2sign.out >b2verify.out &&
+	test_cmp b2sign.in b2verify.out
+'
+
+test_expect_success 'SHA256 message verifies with hash-type = blake2b' '
+	${verify} <good.out
+'
+
+test_expect_success 'verify a hand-created TREE-SHA256 test message' '
+	${xsign} tree </dev/null >tree.out &&
+	${verify} <tree.out
+'
+
+test_expect_success 'create sign.toml with hash-type = tree-sha256' '
+	cat >sign.toml <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "munge"
+	allowed-types = [ "munge" ]
+	[sign.munge]
+	socket-path = "${MUNGE_SOCKET}"
+	hash-type = "tree-sha256"
+	EOT
+'
+
+test_expect_success 'sign/verify a multi-chunk message with TREE-SHA256' '
+	dd if=/dev/urandom of=tree.in bs=1024 count=3072 2>/dev/null &&
+	${sign} <tree.in >tree-sign.out &&
+	${verify} <tree-sign.out >tree-verify.out &&
+	test_cmp tree.in tree-verify.out
+'
+
+test_expect_success 'TREE-SHA256 message with altered payload fails verify' '
+	sed "s/\.A/.B/;t;s/\.[A-Za-z0-9+\/]/.A/" tree-sign.out >tree-bad.out &&
+	test_must_fail ${verify} <tree-bad.out 2>tree-bad.err &&
+	grep -q "TREE-SHA256 hash mismatch" tree-bad.err
+'
+
+test_expect_success 'create sign.toml with unknown hash-type' '
+	cat >sign.toml <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "munge"
+	allowed-types = [ "munge" ]
+	[sign.munge]
+	socket-path = "${MUNGE_SOCKET}"
+	hash-type = "md5"
+	EOT
+'
+
+test_expect_success 'sign fails with unknown hash-type' '
+	test_must_fail ${sign} <sign.in 2>badhash.err &&
+	grep -q "unknown hash-type" badhash.err
+'
+
+test_expect_success 'create sign.toml with async-hash = true' '
+	cat >sign.toml <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "munge"
+	allowed-types = [ "munge" ]
+	[sign.munge]
+	socket-path = "${MUNGE_SOCKET}"
+	async-hash = true
+	EOT
+'
+
+test_expect_success 'sign/verify a large message with async-hash' '
+	dd if=/dev/urandom of=large.in bs=1024 count=256 2>/dev/null &&
+	${sign} <large.in >large.out &&
+	${verify} <large.out >lverify.out &&
+	test_cmp large.in lverify.out
+'
+
+test_expect_success 'sign/verify a short message with async-hash' '
+	echo Hello >async.in &&
+	${sign} <async.in >async.out &&
+	${verify} <async.out >async_verify.out &&
+	test_cmp async.in async_verify.out
+'
+
+test_expect_success 'create sign.toml with batch-threads = 4' '
+	cat >sign.toml <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "munge"
+	allowed-types = [ "munge" ]
+	[sign.munge]
+	socket-path = "${MUNGE_SOCKET}"
+	batch-threads = 4
+	EOT
+'
+
+test_expect_success 'sign/verify a batch with munge' '
+	${bench_sign} -b -n 100 munge >bench-batch.out &&
+	grep -q "^munge" bench-batch.out
+'
+
+test_expect_success 'create sign.toml with batch-threads = 0' '
+	cat >sign.toml <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "munge"
+	allowed-types = [ "munge" ]
+	[sign.munge]
+	socket-path = "${MUNGE_SOCKET}"
+	batch-threads = 0
+	EOT
+'
+
+test_expect_success 'sign fails with batch-threads = 0' '
+	test_must_fail ${sign} <sign.in 2>badthreads.err &&
+	grep -q "batch-threads" badthreads.err
+'
+
 # N.B. max-ttl = (exactly) -100 is allowed for testing
 test_expect_success 'create sign.toml with max-ttl=-100' '
 	cat >sign.toml <<-EOT
@@ -13,12 +13,15 @@ test -n "$FLUX_TESTS_LOGFILE" && set -- "$@" --logfile
 flux_imp=${SHARNESS_BUILD_DIRECTORY}/src/imp/flux-imp
 keygen=${SHARNESS_BUILD_DIRECTORY}/t/src/keygen
 certutil=${SHARNESS_BUILD_DIRECTORY}/t/src/certutil
+certdb=${SHARNESS_BUILD_DIRECTORY}/src/certdb/flux-certdb
 ca=${SHARNESS_BUILD_DIRECTORY}/t/src/ca
 sign=${SHARNESS_BUILD_DIRECTORY}/t/src/sign
 verify=${SHARNESS_BUILD_DIRECTORY}/t/src/verify
 xsign=${SHARNESS_BUILD_DIRECTORY}/t/src/xsign_curve
 prelib=${SHARNESS_BUILD_DIRECTORY}/t/src/.libs/getpwuid.so
 uidlookup=${SHARNESS_BUILD_DIRECTORY}/t/src/uidlookup
+bench_sign=${SHARNESS_BUILD_DIRECTORY}/t/src/bench_sign
+agent=${SHARNESS_BUILD_DIRECTORY}/src/agent/flux-sign-agent
 
 export FLUX_IMP_CONFIG_PATTERN=${SHARNESS_TRASH_DIRECTORY}/conf.d/*.toml
 
@@ -52,6 +55,14 @@ config_sign_curve_noca() {
 	EOT
 }
 
+config_sign_curve_certdb() {
+	cat <<-EOT
+	[sign.curve]
+	require-ca = false
+	cert-db = "${SHARNESS_TRASH_DIRECTORY}/certs.db"
+	EOT
+}
+
 config_ca() {
 	cat <<-EOT
 	[ca]
@@ -85,6 +96,13 @@ test_expect_success 'create user signing cert' '
 	mv u.pub.signed u.pub
 '
 
+test_expect_success 'convert signed user cert to binary' '
+	${certdb} tobin u &&
+	test -f u.pub.bin &&
+	${certutil} u get uuid >uuid.out &&
+	test -s uuid.out
+'
+
 test_expect_success 'sign/verify zero length payload' '
 	cat /dev/null >zsign.in &&
 	${sign} <zsign.in >zsign.out &&
@@ -156,6 +174,52 @@ test_expect_success 'message with mech-specific header fails verify' '
 	grep -q "incomplete header" xheader.err
 '
 
+test_expect_success 'start signing agent with per-user socket path' '
+	${agent} "agent-%u.sock" u &
+	echo $! >agent.pid &&
+	i=0 &&
+	while ! test -S agent-$(id -u).sock && test $i -lt 100; do
+		sleep 0.1
+		i=$((i+1))
+	done &&
+	test -S agent-$(id -u).sock
+'
+
+test_expect_success 'configure [sign.curve] agent-socket' '
+	config_sign >conf.d/sign.toml &&
+	config_sign_curve_ca >>conf.d/sign.toml &&
+	echo "agent-socket = \"agent-%u.sock\"" >>conf.d/sign.toml
+'
+
+test_expect_success 'sign/verify with agent, without access to secret key' '
+	mv u u.secret &&
+	echo Hello >agent.in &&
+	${sign} <agent.in >agent.out &&
+	mv u.secret u &&
+	${verify} <agent.out >agent-verify.out &&
+	test_cmp agent.in agent-verify.out
+'
+
+test_expect_success 'bench_sign works with agent' '
+	${bench_sign} -n 100 curve >bench.out &&
+	grep -q "^curve" bench.out
+'
+
+test_expect_success 'stop signing agent' '
+	kill $(cat agent.pid) &&
+	i=0 &&
+	while test -S agent-$(id -u).sock && test $i -lt 100; do
+		sleep 0.1
+		i=$((i+1))
+	done &&
+	! test -S agent-$(id -u).sock
+'
+
+test_expect_success 'sign falls back to secret key when agent is not running' '
+	${sign} <agent.in >noagent.out &&
+	${verify} <noagent.out
+'
+
 test_expect_success 'drop [sign.curve] config' '
 	config_sign >conf.d/sign.toml
 '
@@ -243,6 +307,53 @@ test_expect_success 'sign/verify zero length payload using unsigned cert' '
 		LD_PRELOAD=${prelib} ${verify} <znoca.out
 '
 
+test_expect_success 'flux-certdb with no arguments prints usage' '
+	test_must_fail ${certdb} 2>certdb_usage.err &&
+	grep "^Usage: flux-certdb" certdb_usage.err
+'
+
+test_expect_success 'build cert database' '
+	${certdb} -j 2 build certs.db passwd &&
+	${certdb} get certs.db $(id -u) >certdb.out &&
+	test_cmp testuser/.flux/curve/sig.pub certdb.out
+'
+
+test_expect_success 'configure for no CA with cert database' '
+	config_sign >conf.d/sign.toml &&
+	config_sign_curve_certdb >>conf.d/sign.toml
+'
+
+test_expect_success 'sign/verify zero length payload using cert database' '
+	TEST_PASSWD_FILE=${SHARNESS_TRASH_DIRECTORY}/passwd \
+		LD_PRELOAD=${prelib} ${sign} </dev/null >zcertdb.out &&
+	${verify} <zcertdb.out
+'
+
+test_expect_success 'verify fails after home cert is changed and updated' '
+	mv testuser/.flux/curve/sig testuser/.flux/curve/sig.save &&
+	mv testuser/.flux/curve/sig.pub testuser/.flux/curve/sig.pub.save &&
+	${keygen} testuser/.flux/curve/sig &&
+	TEST_PASSWD_FILE=${SHARNESS_TRASH_DIRECTORY}/passwd \
+		LD_PRELOAD=${prelib} ${certdb} update certs.db $(id -u) &&
+	test_must_fail ${verify} <zcertdb.out 2>xcertdb.err &&
+	grep -q "cert verification failed" xcertdb.err
+'
+
+test_expect_success 'verify fails for user missing from cert database' '
+	rm -f testuser/.flux/curve/sig.pub testuser/.flux/curve/sig.pub.bin &&
+	TEST_PASSWD_FILE=${SHARNESS_TRASH_DIRECTORY}/passwd \
+		LD_PRELOAD=${prelib} ${certdb} update certs.db $(id -u) &&
+	test_must_fail ${verify} <zcertdb.out 2>ycertdb.err &&
+	grep -q "error loading cert" ycertdb.err
+'
+
+test_expect_success 'restore home cert and configure for no CA' '
+	mv testuser/.flux/curve/sig.save testuser/.flux/curve/sig &&
+	mv testuser/.flux/curve/sig.pub.save testuser/.flux/curve/sig.pub &&
+	config_sign >conf.d/sign.toml &&
+	config_sign_curve_noca >>conf.d/sign.toml
+'
+
 test_expect_success 'verify fails after home cert is changed' '
 	${keygen} testuser/.flux/curve/sig &&
 	! TEST_PASSWD_FILE=${SHARNESS_TRASH_DIRECTORY}/passwd \
@@ -0,0 +1,223 @@
+#!/bin/sh
+#
+
+test_description='sign-hmac tests
+
+Test basic functionality of sign-hmac mechanism.
+'
+
+# Append --logfile option if FLUX_TESTS_LOGFILE is set in environment:
+test -n "$FLUX_TESTS_LOGFILE" && set -- "$@" --logfile
+. `dirname $0`/sharness.sh
+
+sign=${SHARNESS_BUILD_DIRECTORY}/t/src/sign
+verify=${SHARNESS_BUILD_DIRECTORY}/t/src/verify
+bench_sign=${SHARNESS_BUILD_DIRECTORY}/t/src/bench_sign
+
+export FLUX_IMP_CONFIG_PATTERN=${SHARNESS_TRASH_DIRECTORY}/conf.d/*.toml
+
+config_sign() {
+	cat <<-EOT
+	[sign]
+	max-ttl = 60
+	default-type = "hmac"
+	allowed-types = [ "hmac" ]
+	EOT
+}
+
+config_sign_hmac() {
+	cat <<-EOT
+	[sign.hmac]
+	key-path = "${SHARNESS_TRASH_DIRECTORY}/${1:-hmac.key}"
+	EOT
+}
+
+test_expect_success 'create config and key' '
+	mkdir -p conf.d &&
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac >>conf.d/sign.toml &&
+	head -c 32 /dev/urandom >hmac.key &&
+	chmod 600 hmac.key
+'
+
+test_expect_success 'sign/verify zero length payload' '
+	cat /dev/null >zsign.in &&
+	${sign} <zsign.in >zsign.out &&
+	${verify} <zsign.out >zverify.out &&
+	test_cmp zsign.in zverify.out
+'
+
+test_expect_success 'sign/verify a short message' '
+	echo Hello >sign.in &&
+	${sign} <sign.in >sign.out &&
+	${verify} <sign.out >verify.out &&
+	test_cmp sign.in verify.out
+'
+
+test_expect_success 'message with altered payload fails verify' '
+	sed "s/\.A/.B/;t;s/\.[A-Za-z0-9+\/]/.A/" sign.out >xpaychg.out &&
+	test_must_fail ${verify} <xpaychg.out 2>xpaychg.err &&
+	grep -q "verification failure" xpaychg.err
+'
+
+test_expect_success 'message with truncated signature fails verify' '
+	sed "s/.....$//" sign.out >xsig.out &&
+	test_must_fail ${verify} <xsig.out 2>xsig.err &&
+	grep -q "malformed signature" xsig.err
+'
+
+test_expect_success 'configure hash-type = sha256' '
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac >>conf.d/sign.toml &&
+	echo "hash-type = \"sha256\"" >>conf.d/sign.toml
+'
+
+test_expect_success 'sign/verify a short message with HMAC-SHA256' '
+	${sign} <sign.in >sha256.out &&
+	${verify} <sha256.out >sha256-verify.out &&
+	test_cmp sign.in sha256-verify.out
+'
+
+test_expect_success 'BLAKE2b message verifies with hash-type = sha256' '
+	${verify} <sign.out
+'
+
+test_expect_success 'configure unknown hash-type' '
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac >>conf.d/sign.toml &&
+	echo "hash-type = \"md5\"" >>conf.d/sign.toml
+'
+
+test_expect_success 'sign fails with unknown hash-type' '
+	test_must_fail ${sign} </dev/null 2>badhash.err &&
+	grep -q "unknown hash-type" badhash.err
+'
+
+test_expect_success 'configure a different key' '
+	head -c 32 /dev/urandom >other.key &&
+	chmod 600 other.key &&
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac other.key >>conf.d/sign.toml
+'
+
+test_expect_success 'verify fails with a different key' '
+	test_must_fail ${verify} <sign.out 2>otherkey.err &&
+	grep -q "verification failure" otherkey.err
+'
+
+test_expect_success 'sign fails with key readable by other users' '
+	chmod 644 other.key &&
+	test_must_fail ${sign} </dev/null 2>perm.err &&
+	grep -q "not accessible by other users" perm.err
+'
+
+test_expect_success 'sign fails with short key' '
+	head -c 16 /dev/urandom >other.key &&
+	chmod 600 other.key &&
+	test_must_fail ${sign} </dev/null 2>short.err &&
+	grep -q "key must be" short.err
+'
+
+test_expect_success 'sign fails with missing key' '
+	rm -f other.key &&
+	test_must_fail ${sign} </dev/null 2>nokey.err &&
+	grep -q "other.key" nokey.err
+'
+
+test_expect_success 'sign fails with missing [sign.hmac] config' '
+	config_sign >conf.d/sign.toml &&
+	test_must_fail ${sign} </dev/null 2>noconf.err &&
+	grep -q "config missing" noconf.err
+'
+
+test_expect_success 'verify fails when hmac is not in allowed-types' '
+	config_sign | sed "s/\[ \"hmac\" \]/[ \"none\" ]/" >conf.d/sign.toml &&
+	config_sign_hmac >>conf.d/sign.toml &&
+	test_must_fail ${verify} <sign.out 2>notallowed.err &&
+	grep -q "not allowed" notallowed.err
+'
+
+test_expect_success 'restore config' '
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac >>conf.d/sign.toml
+'
+
+config_cache() {
+	config_sign &&
+	echo "verify-cache-dir = \"${SHARNESS_TRASH_DIRECTORY}\"" &&
+	config_sign_hmac ${1:-hmac.key}
+}
+
+test_expect_success 'configure verify-cache-dir' '
+	config_cache >conf.d/sign.toml
+'
+
+test_expect_success 'verify creates verify cache' '
+	${verify} <sign.out >cverify.out &&
+	test_cmp sign.in cverify.out &&
+	test -f verify-cache
+'
+
+test_expect_success 'verify with cached result works' '
+	${verify} <sign.out >cverify2.out &&
+	test_cmp sign.in cverify2.out
+'
+
+test_expect_success 'message with altered payload fails verify with cache' '
+	test_must_fail ${verify} <xpaychg.out 2>cxpaychg.err &&
+	grep -q "verification failure" cxpaychg.err
+'
+
+test_expect_success 'cached result is used without re-verification' '
+	cp -p hmac.key hmac.key.save &&
+	head -c 32 /dev/urandom >hmac.key &&
+	${verify} <sign.out >cverify3.out &&
+	mv hmac.key.save hmac.key &&
+	test_cmp sign.in cverify3.out
+'
+
+test_expect_success 'cached result is not used under a different config' '
+	head -c 32 /dev/urandom >other.key &&
+	chmod 600 other.key &&
+	config_cache other.key >conf.d/sign.toml &&
+	test_must_fail ${verify} <sign.out 2>cverify5.err &&
+	grep -q "verification failure" cverify5.err &&
+	config_cache >conf.d/sign.toml
+'
+
+test_expect_success 'group writable verify cache is ignored' '
+	chmod 620 verify-cache &&
+	cp -p hmac.key hmac.key.save &&
+	head -c 32 /dev/urandom >hmac.key &&
+	test_must_fail ${verify} <sign.out 2>cperm.err &&
+	mv hmac.key.save hmac.key &&
+	grep -q "verification failure" cperm.err &&
+	rm -f verify-cache
+'
+
+test_expect_success 'verify as non-writer does not create verify cache' '
+	{ config_sign &&
+	  echo "verify-cache-dir = \"${SHARNESS_TRASH_DIRECTORY}\"" &&
+	  echo "verify-cache-writer = $(($(id -u)+1))" &&
+	  config_sign_hmac; } >conf.d/sign.toml &&
+	${verify} <sign.out >cverify4.out &&
+	test_cmp sign.in cverify4.out &&
+	test ! -f verify-cache
+'
+
+test_expect_success 'restore config' '
+	config_sign >conf.d/sign.toml &&
+	config_sign_hmac >>conf.d/sign.toml
+'
+
+test_expect_success 'bench_sign runs' '
+	${bench_sign} -n 10 hmac >bench.out &&
+	grep -q "^hmac" bench.out
+'
+
+test_expect_success 'bench_sign runs in batch mode' '
+	${bench_sign} -b -n 10 hmac >bench-batch.out &&
+	grep -q "^hmac" bench-batch.out
+'
+
+test_done